@@ -23,6 +23,7 @@
 #include <unistd.h>     // IWYU pragma: keep
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <utility>
 #include <vector>
@@ -37,6 +38,166 @@
 #include "ecclesia/lib/file/path.h"
 
 namespace ecclesia {
+namespace {
+
+// Construct an error status for a failed open() of the given path.
+absl::Status OpenError(absl::string_view path, int open_errno) {
+  if (open_errno == ENOENT) {
+    return absl::NotFoundError(
+        absl::StrFormat("file not found at path: %s", path));
+  }
+  return absl::InternalError(absl::StrFormat(
+      "unable to open the file at path: %s, errno: %d", path, open_errno));
+}
+
+// Convert a path relative to an open directory into a form usable with the
+// *at() system calls. An empty path refers to the directory itself.
+std::string RelativePath(absl::string_view path) {
+  if (path.empty()) return ".";
+  return std::string(path);
+}
+
+// Read the entire contents of an open file, starting from offset 0. Falls back
+// to a plain read for files which do not support positional reads.
+absl::StatusOr<std::string> ReadFromFd(int fd, absl::string_view path) {
+  std::string value;
+  bool positional = true;
+  while (true) {
+    char buffer[4096];
+    const ssize_t n = positional
+                          ? pread(fd, buffer, sizeof(buffer), value.size())
+                          : read(fd, buffer, sizeof(buffer));
+    if (n < 0) {
+      const auto read_errno = errno;
+      if (read_errno == EINTR) {
+        continue;  // Retry on EINTR.
+      }
+      if (read_errno == ESPIPE && positional && value.empty()) {
+        positional = false;
+        continue;
+      }
+      return absl::InternalError(absl::StrFormat(
+          "failure while reading from file at path: %s, errno: %d", path,
+          read_errno));
+    } else if (n == 0) {
+      break;  // Nothing left to read.
+    } else {
+      value.append(buffer, n);
+    }
+  }
+  return value;
+}
+
+// Write the given value to an open file, starting at offset 0. Falls back to
+// a plain write for files which do not support positional writes.
+absl::Status WriteToFd(int fd, absl::string_view path,
+                       absl::string_view value) {
+  const char *data = value.data();
+  size_t size = value.size();
+  off_t offset = 0;
+  bool positional = true;
+  while (size > 0) {
+    ssize_t result = positional ? pwrite(fd, data, size, offset)
+                                : write(fd, data, size);
+    if (result <= 0) {
+      const auto write_errno = errno;
+      if (write_errno == EINTR) continue;  // Retry on EINTR.
+      if (result < 0 && write_errno == ESPIPE && positional && offset == 0) {
+        positional = false;
+        continue;
+      }
+      return absl::InternalError(absl::StrFormat(
+          "failure while writing to file at path: %s, errno: %d", path,
+          write_errno));
+    }
+    // We successfully wrote out 'result' bytes, advance the data pointer.
+    size -= result;
+    data += result;
+    offset += result;
+  }
+  return absl::OkStatus();
+}
+
+// Read exactly value.size() bytes at the given offset of an open file.
+absl::Status ReadFromFdAt(int fd, absl::string_view path, uint64_t offset,
+                          absl::Span<char> value) {
+  ssize_t rlen;
+  do {
+    rlen = pread(fd, value.data(), value.size(), offset);
+  } while (rlen < 0 && errno == EINTR);
+  if (rlen < 0 || static_cast<size_t>(rlen) != value.size()) {
+    return absl::InternalError(absl::StrFormat(
+        "failed to read %d bytes from offset %#x of file %s, rlen: %d",
+        value.size(), offset, path, rlen));
+  }
+  return absl::OkStatus();
+}
+
+// Write exactly value.size() bytes at the given offset of an open file.
+absl::Status WriteToFdAt(int fd, absl::string_view path, uint64_t offset,
+                         absl::Span<const char> value) {
+  ssize_t wlen;
+  do {
+    wlen = pwrite(fd, value.data(), value.size(), offset);
+  } while (wlen < 0 && errno == EINTR);
+  if (wlen < 0 || static_cast<size_t>(wlen) != value.size()) {
+    return absl::InternalError(absl::StrFormat(
+        "failed to write %d bytes to offset %#x of file %s, wlen: %d",
+        value.size(), offset, path, wlen));
+  }
+  return absl::OkStatus();
+}
+
+// Read the value of a symlink, relative to the given directory descriptor.
+// The path is only used for error messages.
+absl::StatusOr<std::string> ReadLinkAt(int dirfd, const std::string &name,
+                                       absl::string_view path) {
+  // Do an lstat of the path to determine the link size and verify the file is
+  // in fact a symlink.
+  struct stat st;
+  if (fstatat(dirfd, name.c_str(), &st, AT_SYMLINK_NOFOLLOW) < 0) {
+    if (errno == ENOENT) {
+      return absl::NotFoundError(
+          absl::StrFormat("file not found at path: %s", path));
+    } else {
+      return absl::InternalError(absl::StrFormat(
+          "failure while lstat-ing file at path: %s, errno: %d", path, errno));
+    }
+  }
+  if (!S_ISLNK(st.st_mode)) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("path: %s is not a symlink", path));
+  }
+  // Read the symlink using a std::string buffer size from the lstat.
+  std::string link(st.st_size + 1, '\0');
+  ssize_t rc = readlinkat(dirfd, name.c_str(), &link[0], link.size());
+  if (rc == -1) {
+    return absl::InternalError(absl::StrFormat(
+        "unable to read the link at path: %s, errno: %d", path, errno));
+  }
+  if (rc > st.st_size) {
+    // If this happens it means someone changed (and enlarged) the link in
+    // between the lstat and readlink. Just consider that an error.
+    return absl::InternalError(absl::StrFormat(
+        "the link at: %s was changed while it was being read", path));
+  }
+  // The first "rc" characters in the string were populated. Return that.
+  return link.substr(0, rc);
+}
+
+int ModeToOpenFlags(ApifsFileHandle::Mode mode) {
+  switch (mode) {
+    case ApifsFileHandle::Mode::kWriteOnly:
+      return O_WRONLY | O_CLOEXEC;
+    case ApifsFileHandle::Mode::kReadWrite:
+      return O_RDWR | O_CLOEXEC;
+    case ApifsFileHandle::Mode::kReadOnly:
+      break;
+  }
+  return O_RDONLY | O_CLOEXEC;
+}
+
+}  // namespace
 
 ApifsDirectory::ApifsDirectory() {}
 
@@ -61,18 +222,14 @@ absl::StatusOr<struct stat> ApifsDirectory::Stat(std::string path) const {
 }
 
 absl::StatusOr<std::vector<std::string>> ApifsDirectory::ListEntries() const {
-  if (!Exists()) {
-    return absl::NotFoundError(
-        absl::StrFormat("directory not found at path: %s", dir_path_));
-  }
+  auto maybe_iter = DirectoryIterator::Open(dir_path_);
+  if (!maybe_iter.ok()) return maybe_iter.status();
   std::vector<std::string> entries;
-  absl::Status status = WithEachFileInDirectory(
-      dir_path_, [this, &entries](absl::string_view entry) {
-        entries.push_back(JoinFilePaths(dir_path_, entry));
-      });
-  if (!status.ok()) {
-    return status;
+  DirectoryEntry entry;
+  while (maybe_iter->Next(&entry)) {
+    entries.push_back(JoinFilePaths(dir_path_, entry.name));
   }
+  if (!maybe_iter->status().ok()) return maybe_iter->status();
   return entries;
 }
 
@@ -117,156 +274,170 @@ absl::StatusOr<struct stat> ApifsFile::Stat() const {
 }
 
 absl::StatusOr<std::string> ApifsFile::Read() const {
-  if (!Exists()) {
-    return absl::NotFoundError(
-        absl::StrFormat("File not found at path: %s", path_));
-  }
-
-  const int fd = open(path_.c_str(), O_RDONLY);
-  if (fd < 0) {
-    return absl::NotFoundError(absl::StrFormat(
-        "unable to open the file at path: %s, errno: %d", path_, errno));
-  }
+  const int fd = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return OpenError(path_, errno);
   auto fd_closer = FdCloser(fd);
-
-  std::string value;
-  while (true) {
-    char buffer[4096];
-    const ssize_t n = read(fd, buffer, sizeof(buffer));
-    if (n < 0) {
-      const auto read_errno = errno;
-      if (read_errno == EINTR) {
-        continue;  // Retry on EINTR.
-      }
-      return absl::InternalError(absl::StrFormat(
-          "failure while reading from file at path: %s, errno: %d", path_,
-          read_errno));
-      break;
-    } else if (n == 0) {
-      break;  // Nothing left to read.
-    } else {
-      value.append(buffer, n);
-    }
-  }
-  return value;
+  return ReadFromFd(fd, path_);
 }
 
 absl::Status ApifsFile::Write(absl::string_view value) const {
-  if (!Exists()) {
-    return absl::NotFoundError(
-        absl::StrFormat("File not found at path: %s", path_));
-  }
-  const int fd = open(path_.c_str(), O_WRONLY);
-  if (fd < 0) {
-    return absl::NotFoundError(
-        absl::StrFormat("unable to open the file at path: %s", path_));
-  }
+  const int fd = open(path_.c_str(), O_WRONLY | O_CLOEXEC);
+  if (fd < 0) return OpenError(path_, errno);
   auto fd_closer = FdCloser(fd);
-  const char *data = value.data();
-  size_t size = value.size();
-  while (size > 0) {
-    ssize_t result = write(fd, data, size);
-    if (result <= 0) {
-      const auto write_errno = errno;
-      if (write_errno == EINTR) continue;  // Retry on EINTR.
-      return absl::InternalError(absl::StrFormat(
-          "failure while writing to file at path: %s, errno: %d", path_,
-          errno));
-      break;
-    }
-    // We successfully wrote out 'result' bytes, advance the data pointer.
-    size -= result;
-    data += result;
-  }
-  return absl::OkStatus();
+  return WriteToFd(fd, path_, value);
 }
 
 absl::Status ApifsFile::SeekAndRead(uint64_t offset,
                                     absl::Span<char> value) const {
-  if (!Exists()) {
-    return absl::NotFoundError(
-        absl::StrFormat("File not found at path: %s", path_));
-  }
-
-  int fd = open(path_.c_str(), O_RDONLY);
-  if (fd < 0) {
-    return absl::NotFoundError(absl::StrFormat(
-        "Unable to open the file at path: %s, errno: %d", path_, errno));
-  }
+  const int fd = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return OpenError(path_, errno);
   auto fd_closer = FdCloser(fd);
-  if (lseek64(fd, offset, SEEK_SET) == static_cast<off_t>(-1)) {
-    return absl::NotFoundError(absl::StrFormat(
-        "Unable to seek to offset: %#x in file %s", offset, path_));
-  }
-
-  // Read data.
-  size_t size = value.size();
-  int rlen = read(fd, value.data(), size);
-  if (rlen != size) {
-    return absl::InternalError(absl::StrFormat(
-        "Fail to read %d bytes from offset %#x. rlen: %d", size, offset, rlen));
-  }
-  return absl::OkStatus();
+  return ReadFromFdAt(fd, path_, offset, value);
 }
 
 absl::Status ApifsFile::SeekAndWrite(uint64_t offset,
                                      absl::Span<const char> value) const {
-  if (!Exists()) {
-    return absl::NotFoundError(
-        absl::StrFormat("File not found at path: %s", path_));
-  }
-  const int fd = open(path_.c_str(), O_WRONLY);
-  if (fd < 0) {
-    return absl::NotFoundError(
-        absl::StrFormat("Unable to open the file at path: %s", path_));
-  }
+  const int fd = open(path_.c_str(), O_WRONLY | O_CLOEXEC);
+  if (fd < 0) return OpenError(path_, errno);
   auto fd_closer = FdCloser(fd);
-  if (lseek64(fd, offset, SEEK_SET) == static_cast<off_t>(-1)) {
-    return absl::NotFoundError(absl::StrFormat(
-        "Unable to seek to msr: %#x in file %s", offset, path_));
-  }
-  // Write data.
-  size_t size = value.size();
-  int wlen = write(fd, value.data(), size);
-  if (wlen != size) {
-    return absl::NotFoundError(
-        absl::StrFormat("Failed to write %d bytes to msr %s", size, path_));
-  }
-  return absl::OkStatus();
+  return WriteToFdAt(fd, path_, offset, value);
 }
 
 absl::StatusOr<std::string> ApifsFile::ReadLink() const {
-  // Do an lstat of the path to determine the link size and verify the file is
-  // in fact a symlink.
-  struct stat st;
-  if (lstat(path_.c_str(), &st) < 0) {
-    if (errno == ENOENT) {
-      return absl::NotFoundError(
-          absl::StrFormat("file not found at path: %s", path_));
-    } else {
-      return absl::InternalError(absl::StrFormat(
-          "failure while lstat-ing file at path: %s, errno: %d", path_, errno));
-    }
-  }
-  if (!S_ISLNK(st.st_mode)) {
-    return absl::InvalidArgumentError(
-        absl::StrFormat("path: %s is not a symlink", path_));
+  return ReadLinkAt(AT_FDCWD, path_, path_);
+}
+
+absl::StatusOr<ApifsFileHandle> ApifsFileHandle::Open(const ApifsFile &file,
+                                                      Mode mode) {
+  return Open(file.path_, mode);
+}
+
+absl::StatusOr<ApifsFileHandle> ApifsFileHandle::Open(std::string path,
+                                                      Mode mode) {
+  const int fd = open(path.c_str(), ModeToOpenFlags(mode));
+  if (fd < 0) return OpenError(path, errno);
+  return ApifsFileHandle(fd, std::move(path));
+}
+
+ApifsFileHandle::ApifsFileHandle(int fd, std::string path)
+    : fd_(fd), path_(std::move(path)) {}
+
+ApifsFileHandle::ApifsFileHandle(ApifsFileHandle &&other)
+    : fd_(std::exchange(other.fd_, -1)), path_(std::move(other.path_)) {}
+
+ApifsFileHandle &ApifsFileHandle::operator=(ApifsFileHandle &&other) {
+  if (this != &other) {
+    if (fd_ >= 0) close(fd_);
+    fd_ = std::exchange(other.fd_, -1);
+    path_ = std::move(other.path_);
   }
-  // Read the symlink using a std::string buffer size from the lstat.
-  std::string link(st.st_size + 1, '\0');
-  ssize_t rc = readlink(path_.c_str(), &link[0], link.size());
-  if (rc == -1) {
-    return absl::InternalError(absl::StrFormat(
-        "unable to read the link at path: %s, errno: %d", path_, errno));
+  return *this;
+}
+
+ApifsFileHandle::~ApifsFileHandle() {
+  if (fd_ >= 0) close(fd_);
+}
+
+absl::StatusOr<std::string> ApifsFileHandle::Read() const {
+  return ReadFromFd(fd_, path_);
+}
+
+absl::Status ApifsFileHandle::Write(absl::string_view value) const {
+  return WriteToFd(fd_, path_, value);
+}
+
+absl::Status ApifsFileHandle::ReadAt(uint64_t offset,
+                                     absl::Span<char> value) const {
+  return ReadFromFdAt(fd_, path_, offset, value);
+}
+
+absl::Status ApifsFileHandle::WriteAt(uint64_t offset,
+                                      absl::Span<const char> value) const {
+  return WriteToFdAt(fd_, path_, offset, value);
+}
+
+absl::StatusOr<ApifsDirectoryHandle> ApifsDirectoryHandle::Open(
+    const ApifsDirectory &directory) {
+  return Open(directory.dir_path_);
+}
+
+absl::StatusOr<ApifsDirectoryHandle> ApifsDirectoryHandle::Open(
+    std::string path) {
+  const int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) return OpenError(path, errno);
+  return ApifsDirectoryHandle(fd, std::move(path));
+}
+
+ApifsDirectoryHandle::ApifsDirectoryHandle(int fd, std::string dir_path)
+    : fd_(fd), dir_path_(std::move(dir_path)) {}
+
+ApifsDirectoryHandle::ApifsDirectoryHandle(ApifsDirectoryHandle &&other)
+    : fd_(std::exchange(other.fd_, -1)),
+      dir_path_(std::move(other.dir_path_)) {}
+
+ApifsDirectoryHandle &ApifsDirectoryHandle::operator=(
+    ApifsDirectoryHandle &&other) {
+  if (this != &other) {
+    if (fd_ >= 0) close(fd_);
+    fd_ = std::exchange(other.fd_, -1);
+    dir_path_ = std::move(other.dir_path_);
   }
-  if (rc > st.st_size) {
-    // If this happens it means someone changed (and enlarged) the link in
-    // between the lstat and readlink. Just consider that an error.
+  return *this;
+}
+
+ApifsDirectoryHandle::~ApifsDirectoryHandle() {
+  if (fd_ >= 0) close(fd_);
+}
+
+absl::StatusOr<ApifsDirectoryHandle> ApifsDirectoryHandle::OpenDirectory(
+    absl::string_view path) const {
+  const int fd = openat(fd_, RelativePath(path).c_str(),
+                        O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  std::string full_path = JoinFilePaths(dir_path_, path);
+  if (fd < 0) return OpenError(full_path, errno);
+  return ApifsDirectoryHandle(fd, std::move(full_path));
+}
+
+absl::StatusOr<ApifsFileHandle> ApifsDirectoryHandle::OpenFile(
+    absl::string_view path, ApifsFileHandle::Mode mode) const {
+  const int fd = openat(fd_, RelativePath(path).c_str(), ModeToOpenFlags(mode));
+  std::string full_path = JoinFilePaths(dir_path_, path);
+  if (fd < 0) return OpenError(full_path, errno);
+  return ApifsFileHandle(fd, std::move(full_path));
+}
+
+bool ApifsDirectoryHandle::Exists(absl::string_view path) const {
+  return faccessat(fd_, RelativePath(path).c_str(), F_OK, 0) == 0;
+}
+
+absl::StatusOr<struct stat> ApifsDirectoryHandle::Stat(
+    absl::string_view path) const {
+  struct stat st;
+  if (fstatat(fd_, RelativePath(path).c_str(), &st, 0) < 0) {
     return absl::InternalError(absl::StrFormat(
-        "the link at: %s was changed while it was being read", path_));
+        "failure while stat-ing file at path: %s, errno: %d",
+        JoinFilePaths(dir_path_, path), errno));
   }
-  // The first "rc" characters in the string were populated. Return that.
-  return link.substr(0, rc);
+  return st;
+}
+
+absl::StatusOr<std::string> ApifsDirectoryHandle::Read(
+    absl::string_view path) const {
+  auto maybe_file = OpenFile(path, ApifsFileHandle::Mode::kReadOnly);
+  if (!maybe_file.ok()) return maybe_file.status();
+  return maybe_file->Read();
+}
+
+absl::Status ApifsDirectoryHandle::Write(absl::string_view path,
+                                         absl::string_view value) const {
+  auto maybe_file = OpenFile(path, ApifsFileHandle::Mode::kWriteOnly);
+  if (!maybe_file.ok()) return maybe_file.status();
+  return maybe_file->Write(value);
+}
+
+absl::StatusOr<std::string> ApifsDirectoryHandle::ReadLink(
+    absl::string_view path) const {
+  return ReadLinkAt(fd_, RelativePath(path), JoinFilePaths(dir_path_, path));
 }
 
 }  // namespace ecclesia
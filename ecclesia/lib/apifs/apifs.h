@@ -25,6 +25,7 @@
 #include <sys/types.h>  // IWYU pragma: keep
 #include <unistd.h>     // IWYU pragma: keep
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -83,7 +84,8 @@ class ApifsDirectory {
   absl::StatusOr<std::string> ReadLink(std::string path) const;
 
  private:
-  friend class ApifsFile;  // For accessing the root.
+  friend class ApifsFile;             // For accessing the root.
+  friend class ApifsDirectoryHandle;  // For accessing the root.
 
   std::string dir_path_;
 };
@@ -133,9 +135,110 @@ class ApifsFile {
   absl::StatusOr<std::string> ReadLink() const;
 
  private:
+  friend class ApifsFileHandle;  // For accessing the path.
+
+  std::string path_;
+};
+
+// An open file in an API filesystem. Unlike ApifsFile, which opens the file
+// for every operation, this holds the file open for as long as the handle is
+// alive. All operations are done with pread and pwrite so they do not depend
+// on (or modify) the current file offset.
+//
+// For sysfs attributes every Read re-reads the attribute from offset 0, which
+// causes the kernel to regenerate its contents. This means a handle can be
+// kept around and read repeatedly to get up-to-date values.
+class ApifsFileHandle {
+ public:
+  enum class Mode { kReadOnly, kWriteOnly, kReadWrite };
+
+  // Open a file, either from an ApifsFile or by absolute path.
+  static absl::StatusOr<ApifsFileHandle> Open(const ApifsFile &file,
+                                              Mode mode = Mode::kReadOnly);
+  static absl::StatusOr<ApifsFileHandle> Open(std::string path,
+                                              Mode mode = Mode::kReadOnly);
+
+  // Handles own a file descriptor, so they can be moved but not copied.
+  ApifsFileHandle(const ApifsFileHandle &other) = delete;
+  ApifsFileHandle &operator=(const ApifsFileHandle &other) = delete;
+  ApifsFileHandle(ApifsFileHandle &&other);
+  ApifsFileHandle &operator=(ApifsFileHandle &&other);
+
+  ~ApifsFileHandle();
+
+  // Return the filesystem path this handle was opened from.
+  const std::string &GetPath() const { return path_; }
+
+  // Read the entire contents of the file, starting from offset 0.
+  absl::StatusOr<std::string> Read() const;
+  // Write the value to the file, starting at offset 0.
+  absl::Status Write(absl::string_view value) const;
+
+  // Read or write exactly value.size() bytes at the given offset.
+  absl::Status ReadAt(uint64_t offset, absl::Span<char> value) const;
+  absl::Status WriteAt(uint64_t offset, absl::Span<const char> value) const;
+
+ private:
+  // Only constructed by ApifsFileHandle::Open and ApifsDirectoryHandle.
+  friend class ApifsDirectoryHandle;
+  // For doing reads directly from the underlying descriptor.
+  friend class ApifsBulkReader;
+  ApifsFileHandle(int fd, std::string path);
+
+  int fd_;
   std::string path_;
 };
 
+// An open directory in an API filesystem. This provides the same operations
+// as ApifsDirectory, but all of the lookups are done relative to the open
+// directory using the *at() family of system calls. This avoids rebuilding
+// and re-resolving the full path for every access to a child, which can be
+// significant when iterating over large directories in sysfs.
+class ApifsDirectoryHandle {
+ public:
+  // Open a directory, either from an ApifsDirectory or by absolute path.
+  static absl::StatusOr<ApifsDirectoryHandle> Open(
+      const ApifsDirectory &directory);
+  static absl::StatusOr<ApifsDirectoryHandle> Open(std::string path);
+
+  // Handles own a file descriptor, so they can be moved but not copied.
+  ApifsDirectoryHandle(const ApifsDirectoryHandle &other) = delete;
+  ApifsDirectoryHandle &operator=(const ApifsDirectoryHandle &other) = delete;
+  ApifsDirectoryHandle(ApifsDirectoryHandle &&other);
+  ApifsDirectoryHandle &operator=(ApifsDirectoryHandle &&other);
+
+  ~ApifsDirectoryHandle();
+
+  // Return the filesystem path this handle was opened from.
+  const std::string &GetPath() const { return dir_path_; }
+
+  // Open a subdirectory or a file relative to this directory.
+  absl::StatusOr<ApifsDirectoryHandle> OpenDirectory(
+      absl::string_view path) const;
+  absl::StatusOr<ApifsFileHandle> OpenFile(
+      absl::string_view path,
+      ApifsFileHandle::Mode mode = ApifsFileHandle::Mode::kReadOnly) const;
+
+  // Indicates if the given path exists.
+  bool Exists(absl::string_view path) const;
+
+  // Retrieve the stat information for a given path.
+  absl::StatusOr<struct stat> Stat(absl::string_view path) const;
+
+  // Read and write the entire contents of a file.
+  absl::StatusOr<std::string> Read(absl::string_view path) const;
+  absl::Status Write(absl::string_view path, absl::string_view value) const;
+
+  // Read a symlink value for a given path.
+  absl::StatusOr<std::string> ReadLink(absl::string_view path) const;
+
+ private:
+  ApifsDirectoryHandle(int fd, std::string dir_path);
+
+  int fd_;
+  std::string dir_path_;
+};
+
 }  // namespace ecclesia
 
 #endif  // ECCLESIA_LIB_APIFS_APIFS_H_
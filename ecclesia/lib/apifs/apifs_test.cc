@@ -16,6 +16,7 @@
 
 #include "ecclesia/lib/apifs/apifs.h"
 
+#include <stdio.h>
 #include <sys/stat.h>
 
 #include <string>
@@ -193,6 +194,117 @@ TEST_F(ApifsTest, TestReadLink) {
   EXPECT_THAT(f4.ReadLink(), IsOkAndHolds("file1"));
 }
 
+TEST_F(ApifsTest, TestMissingFilesAreNotFound) {
+  EXPECT_TRUE(absl::IsNotFound(apifs_.Read("ab/file5").status()));
+  EXPECT_TRUE(absl::IsNotFound(apifs_.Write("ab/file5", "testing")));
+
+  std::vector<char> data(4);
+  ApifsFile f5(apifs_, "ab/file5");
+  EXPECT_TRUE(absl::IsNotFound(f5.SeekAndRead(0, absl::MakeSpan(data))));
+  EXPECT_TRUE(absl::IsNotFound(f5.SeekAndWrite(0, absl::MakeConstSpan(data))));
+}
+
+TEST_F(ApifsTest, TestFileHandleRead) {
+  auto maybe_handle = ApifsFileHandle::Open(ApifsFile(apifs_, "ab/file2"));
+  ASSERT_THAT(maybe_handle, IsOk());
+  EXPECT_THAT(maybe_handle->Read(), IsOkAndHolds("x\ny\nz\n"));
+
+  // Reads always start from the beginning of the file, so repeated reads see
+  // any updated contents.
+  EXPECT_THAT(maybe_handle->Read(), IsOkAndHolds("x\ny\nz\n"));
+  fs_.WriteFile("/sys/ab/file2", "updated\n");
+  EXPECT_THAT(maybe_handle->Read(), IsOkAndHolds("updated\n"));
+
+  auto maybe_large = ApifsFileHandle::Open(ApifsFile(apifs_, "ab/largefile"));
+  ASSERT_THAT(maybe_large, IsOk());
+  EXPECT_THAT(maybe_large->Read(), IsOkAndHolds(std::string(10000, 'J')));
+
+  // A read-only handle cannot be written to.
+  EXPECT_THAT(maybe_handle->Write("testing"), Not(IsOk()));
+}
+
+TEST_F(ApifsTest, TestFileHandleWrite) {
+  auto maybe_handle = ApifsFileHandle::Open(
+      ApifsFile(apifs_, "ab/file3"), ApifsFileHandle::Mode::kReadWrite);
+  ASSERT_THAT(maybe_handle, IsOk());
+  EXPECT_THAT(maybe_handle->Write("hello, world!\n"), IsOk());
+  EXPECT_THAT(maybe_handle->Read(), IsOkAndHolds("hello, world!\n"));
+
+  // Writes also start from the beginning of the file.
+  EXPECT_THAT(maybe_handle->Write("HELLO"), IsOk());
+  EXPECT_THAT(maybe_handle->Read(), IsOkAndHolds("HELLO, world!\n"));
+
+  std::vector<char> data(5);
+  EXPECT_THAT(maybe_handle->ReadAt(7, absl::MakeSpan(data)), IsOk());
+  EXPECT_EQ(std::string(data.begin(), data.end()), "world");
+  EXPECT_THAT(maybe_handle->ReadAt(10, absl::MakeSpan(data)), Not(IsOk()));
+  EXPECT_THAT(maybe_handle->WriteAt(7, absl::MakeConstSpan("WORLD", 5)),
+              IsOk());
+  EXPECT_THAT(apifs_.Read("ab/file3"), IsOkAndHolds("HELLO, WORLD!\n"));
+}
+
+TEST_F(ApifsTest, TestFileHandleOpenFails) {
+  EXPECT_TRUE(absl::IsNotFound(
+      ApifsFileHandle::Open(ApifsFile(apifs_, "ab/file5")).status()));
+  EXPECT_TRUE(absl::IsNotFound(ApifsFileHandle::Open(ApifsFile()).status()));
+}
+
+TEST_F(ApifsTest, TestDirectoryHandle) {
+  auto maybe_root = ApifsDirectoryHandle::Open(apifs_);
+  ASSERT_THAT(maybe_root, IsOk());
+  EXPECT_EQ(maybe_root->GetPath(), apifs_.GetPath());
+
+  auto maybe_ab = maybe_root->OpenDirectory("ab");
+  ASSERT_THAT(maybe_ab, IsOk());
+  EXPECT_EQ(maybe_ab->GetPath(), ApifsDirectory(apifs_, "ab").GetPath());
+
+  EXPECT_TRUE(maybe_ab->Exists("file1"));
+  EXPECT_TRUE(maybe_ab->Exists("cd/ef"));
+  EXPECT_FALSE(maybe_ab->Exists("file5"));
+  EXPECT_TRUE(maybe_root->Exists("ab/file4"));
+
+  auto maybe_stat = maybe_ab->Stat("");
+  ASSERT_THAT(maybe_stat, IsOk());
+  EXPECT_TRUE(S_ISDIR(maybe_stat->st_mode));
+  maybe_stat = maybe_ab->Stat("file1");
+  ASSERT_THAT(maybe_stat, IsOk());
+  EXPECT_TRUE(S_ISREG(maybe_stat->st_mode));
+  EXPECT_THAT(maybe_ab->Stat("file5"), Not(IsOk()));
+
+  EXPECT_THAT(maybe_ab->Read("file1"), IsOkAndHolds("contents**\n"));
+  EXPECT_THAT(maybe_ab->Read("file4"), IsOkAndHolds("contents**\n"));
+  EXPECT_THAT(maybe_root->Read("ab/file2"), IsOkAndHolds("x\ny\nz\n"));
+  EXPECT_TRUE(absl::IsNotFound(maybe_ab->Read("file5").status()));
+  EXPECT_THAT(maybe_ab->Read("cd"), Not(IsOk()));
+
+  EXPECT_THAT(maybe_ab->Write("file3", "hello\n"), IsOk());
+  EXPECT_THAT(apifs_.Read("ab/file3"), IsOkAndHolds("hello\n"));
+  EXPECT_TRUE(absl::IsNotFound(maybe_ab->Write("file5", "hello\n")));
+
+  EXPECT_THAT(maybe_ab->ReadLink("file4"), IsOkAndHolds("file1"));
+  EXPECT_THAT(maybe_ab->ReadLink("file1"), Not(IsOk()));
+  EXPECT_TRUE(absl::IsNotFound(maybe_ab->ReadLink("file5").status()));
+
+  // Directories can only be opened as directories.
+  EXPECT_THAT(maybe_ab->OpenDirectory("file1"), Not(IsOk()));
+  EXPECT_TRUE(absl::IsNotFound(maybe_ab->OpenDirectory("xy").status()));
+  EXPECT_TRUE(absl::IsNotFound(
+      ApifsDirectoryHandle::Open(ApifsDirectory(apifs_, "xy")).status()));
+}
+
+TEST_F(ApifsTest, TestDirectoryHandleOutlivesPath) {
+  auto maybe_cd = ApifsDirectoryHandle::Open(ApifsDirectory(apifs_, "ab/cd"));
+  ASSERT_THAT(maybe_cd, IsOk());
+
+  // Lookups are relative to the open directory, so they continue to work even
+  // when the directory is renamed.
+  ASSERT_EQ(rename(fs_.GetTruePath("/sys/ab/cd").c_str(),
+                   fs_.GetTruePath("/sys/ab/renamed").c_str()),
+            0);
+  EXPECT_TRUE(maybe_cd->Exists("ef"));
+  EXPECT_THAT(maybe_cd->OpenDirectory("ef"), IsOk());
+}
+
 class MsrTest : public ::testing::Test {
  protected:
   MsrTest()
@@ -0,0 +1,519 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/lib/apifs/bulk_read.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "ecclesia/lib/apifs/apifs.h"
+#include "ecclesia/lib/logging/logging.h"
+
+namespace ecclesia {
+namespace {
+
+// The size of each read submitted for a file. API filesystem files are almost
+// always smaller than this; larger files take multiple rounds of reads.
+constexpr size_t kReadChunkSize = 4096;
+
+// How many times to retry when the kernel is temporarily unable to accept
+// submissions and there are no completions to reap to make room, and how long
+// to back off for on the first retry. Each retry backs off for longer.
+constexpr int kMaxBusyRetries = 10;
+constexpr absl::Duration kBusyBackoff = absl::Milliseconds(1);
+
+// The state of a single file being read through the ring.
+struct PendingRead {
+  size_t index = 0;        // Index of the file in the inputs and results.
+  std::string path;        // The path of the file, used for opens and errors.
+  int fd = -1;             // The open file descriptor, or -1 if not open.
+  std::string data = {};   // The data read so far.
+  bool done = false;       // Set once the result for the file is filled in.
+};
+
+absl::Status OpenError(absl::string_view path, int open_errno) {
+  if (open_errno == ENOENT) {
+    return absl::NotFoundError(
+        absl::StrFormat("file not found at path: %s", path));
+  }
+  return absl::InternalError(absl::StrFormat(
+      "unable to open the file at path: %s, errno: %d", path, open_errno));
+}
+
+absl::Status ReadError(absl::string_view path, int read_errno) {
+  return absl::InternalError(
+      absl::StrFormat("failure while reading from file at path: %s, errno: %d",
+                      path, read_errno));
+}
+
+// The error reported for a file which could not be read because the ring
+// itself failed before the file was finished.
+absl::Status RingError(absl::string_view path, const absl::Status &status) {
+  return absl::Status(
+      status.code(), absl::StrFormat("unable to read the file at path: %s, %s",
+                                     path, status.message()));
+}
+
+}  // namespace
+
+// A minimal wrapper around an io_uring instance. This only implements what the
+// reader needs: submitting a batch of operations and waiting for all of them to
+// complete.
+class ApifsBulkReader::Ring {
+ public:
+  // Set up a ring with at least the given number of entries. Returns null if
+  // io_uring is not available, or does not support the needed operations.
+  static std::unique_ptr<Ring> Create(unsigned entries,
+                                      IoUringEnterInterface *enter) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0) return nullptr;
+    auto ring = std::unique_ptr<Ring>(new Ring(fd, enter));
+    if (!ring->Map(params) || !ring->SupportsNeededOps()) return nullptr;
+    return ring;
+  }
+
+  Ring(const Ring &other) = delete;
+  Ring &operator=(const Ring &other) = delete;
+
+  ~Ring() {
+    // The kernel can still be writing into the buffers of a broken ring, as
+    // its outstanding reads could not be waited for, so they are leaked.
+    if (broken_) buffers_.release();
+    if (sqes_ != MAP_FAILED) munmap(sqes_, sqes_size_);
+    if (cq_ptr_ != MAP_FAILED && cq_ptr_ != sq_ptr_) munmap(cq_ptr_, cq_size_);
+    if (sq_ptr_ != MAP_FAILED) munmap(sq_ptr_, sq_size_);
+    close(fd_);
+  }
+
+  // The maximum number of operations that can be submitted in a single Run.
+  size_t Capacity() const { return sq_entries_; }
+
+  // Indicates if the ring failed with operations still outstanding, in which
+  // case it must not be used again.
+  bool IsBroken() const { return broken_; }
+
+  // Read all of the given pending files. Files which do not yet have an open
+  // descriptor are opened, and then closed again once they have been read.
+  // Files which already have a descriptor are left open. The number of files
+  // must not exceed Capacity().
+  void ReadAll(absl::Span<PendingRead> pending,
+               absl::Span<absl::StatusOr<std::string>> results);
+
+  // Submit "count" operations, each one prepared by calling prepare with its
+  // index and a zeroed submission entry, and then wait for all of them to
+  // complete. The complete function is called with the index and result of
+  // every completed operation. The count must not exceed Capacity().
+  //
+  // If the ring fails, the operations which were never submitted are
+  // withdrawn and the ones which were are all waited for, and passed to
+  // complete, before the error is returned. This keeps any completions from
+  // being delivered to a later batch. If they cannot be waited for then the
+  // ring is broken.
+  absl::Status Run(size_t count,
+                   absl::FunctionRef<void(size_t, io_uring_sqe *)> prepare,
+                   absl::FunctionRef<void(size_t, int)> complete) {
+    // Fill in the submission queue. We are the only producer, so the tail only
+    // needs to be published once all of the entries are filled in.
+    unsigned tail = *sq_tail_;
+    for (size_t i = 0; i < count; ++i) {
+      unsigned sq_index = tail & *sq_mask_;
+      io_uring_sqe *sqe = &sqes_[sq_index];
+      memset(sqe, 0, sizeof(*sqe));
+      prepare(i, sqe);
+      sqe->user_data = i;
+      sq_array_[sq_index] = sq_index;
+      ++tail;
+    }
+    __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+
+    size_t to_submit = count;
+    size_t in_flight = 0;
+    // Set when the kernel cannot take any more submissions until some of the
+    // completions have been reaped.
+    bool wait_for_room = false;
+    int busy_retries = 0;
+    absl::Status status;
+    while (to_submit > 0 || in_flight > 0) {
+      size_t submit = wait_for_room ? 0 : to_submit;
+      size_t min_complete = wait_for_room ? 1 : to_submit + in_flight;
+      int rc = enter_->Call(fd_, submit, min_complete, IORING_ENTER_GETEVENTS);
+      if (rc < 0) {
+        int error = errno;
+        if (error == EINTR) continue;
+        if ((error == EAGAIN || error == EBUSY) &&
+            ++busy_retries <= kMaxBusyRetries) {
+          // Make room by reaping completions, waiting for one if there are
+          // none yet, rather than resubmitting straight away.
+          in_flight -= Reap(complete);
+          if (in_flight > 0) {
+            wait_for_room = true;
+          } else {
+            absl::SleepFor(kBusyBackoff * busy_retries);
+          }
+          continue;
+        }
+        status = absl::InternalError(
+            absl::StrFormat("io_uring_enter failed, errno: %d", error));
+        break;
+      }
+      wait_for_room = false;
+      busy_retries = 0;
+      size_t submitted = std::min<size_t>(rc, submit);
+      to_submit -= submitted;
+      in_flight += submitted;
+      in_flight -= Reap(complete);
+    }
+    if (status.ok()) return status;
+
+    // The kernel did not consume the entries which were never submitted, so
+    // take them back out of the queue rather than leaving them to be
+    // submitted with the next batch.
+    __atomic_store_n(sq_tail_, tail - static_cast<unsigned>(to_submit),
+                     __ATOMIC_RELEASE);
+    while (in_flight > 0) {
+      int rc = enter_->Call(fd_, 0, in_flight, IORING_ENTER_GETEVENTS);
+      if (rc < 0 && errno != EINTR) {
+        ErrorLog() << "unable to wait for " << in_flight
+                   << " outstanding io_uring operations, errno: " << errno;
+        broken_ = true;
+        break;
+      }
+      in_flight -= Reap(complete);
+    }
+    return status;
+  }
+
+ private:
+  Ring(int fd, IoUringEnterInterface *enter) : fd_(fd), enter_(enter) {}
+
+  // Pass every available completion to complete, returning how many there
+  // were.
+  size_t Reap(absl::FunctionRef<void(size_t, int)> complete) {
+    size_t reaped = 0;
+    unsigned head = *cq_head_;
+    unsigned cq_tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    while (head != cq_tail) {
+      const io_uring_cqe &cqe = cqes_[head & *cq_mask_];
+      complete(cqe.user_data, cqe.res);
+      ++head;
+      ++reaped;
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    return reaped;
+  }
+
+  // Map the submission and completion rings into memory.
+  bool Map(const io_uring_params &params) {
+    sq_entries_ = params.sq_entries;
+    buffers_ = std::make_unique<char[]>(sq_entries_ * kReadChunkSize);
+    sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+
+    sq_ptr_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sq_ptr_ == MAP_FAILED) return false;
+    if (single_mmap) {
+      cq_ptr_ = sq_ptr_;
+    } else {
+      cq_ptr_ = mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+      if (cq_ptr_ == MAP_FAILED) return false;
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) return false;
+    sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+    char *sq = static_cast<char *>(sq_ptr_);
+    sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    char *cq = static_cast<char *>(cq_ptr_);
+    cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    return true;
+  }
+
+  // Check that the kernel supports all of the operations the reader uses.
+  // Kernels which are too old to support probing are also too old to support
+  // the operations, so a failed probe is treated as no support.
+  bool SupportsNeededOps() {
+    constexpr unsigned kNumProbeOps = 256;
+    std::vector<char> buffer(sizeof(io_uring_probe) +
+                             kNumProbeOps * sizeof(io_uring_probe_op));
+    auto *probe = reinterpret_cast<io_uring_probe *>(buffer.data());
+    if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PROBE, probe,
+                kNumProbeOps) < 0) {
+      return false;
+    }
+    for (unsigned op : {IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE}) {
+      if (op > probe->last_op ||
+          !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  const int fd_;
+  IoUringEnterInterface *const enter_;
+  unsigned sq_entries_ = 0;
+  bool broken_ = false;
+
+  // Buffers for reads, one chunk for every submission queue entry. These are
+  // reused across batches rather than reading directly into the results, so
+  // that small files don't need a full chunk allocated for them.
+  std::unique_ptr<char[]> buffers_;
+
+  size_t sq_size_ = 0;
+  size_t cq_size_ = 0;
+  size_t sqes_size_ = 0;
+  void *sq_ptr_ = MAP_FAILED;
+  void *cq_ptr_ = MAP_FAILED;
+  io_uring_sqe *sqes_ = static_cast<io_uring_sqe *>(MAP_FAILED);
+
+  unsigned *sq_tail_ = nullptr;
+  unsigned *sq_mask_ = nullptr;
+  unsigned *sq_array_ = nullptr;
+  unsigned *cq_head_ = nullptr;
+  unsigned *cq_tail_ = nullptr;
+  unsigned *cq_mask_ = nullptr;
+  io_uring_cqe *cqes_ = nullptr;
+};
+
+// Read all of the given pending files through the ring. Files which do not yet
+// have an open descriptor are opened, and then closed again once they have been
+// read. Files which already have a descriptor are left open.
+void ApifsBulkReader::Ring::ReadAll(
+    absl::Span<PendingRead> pending,
+    absl::Span<absl::StatusOr<std::string>> results) {
+  // Open all of the files which need to be opened.
+  std::vector<PendingRead *> to_open;
+  for (PendingRead &file : pending) {
+    if (file.fd < 0) to_open.push_back(&file);
+  }
+  std::vector<PendingRead *> to_close;
+  absl::Status status = Run(
+      to_open.size(),
+      [&](size_t i, io_uring_sqe *sqe) {
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = reinterpret_cast<uintptr_t>(to_open[i]->path.c_str());
+        sqe->open_flags = O_RDONLY | O_CLOEXEC;
+      },
+      [&](size_t i, int res) {
+        if (res < 0) {
+          results[to_open[i]->index] = OpenError(to_open[i]->path, -res);
+          to_open[i]->done = true;
+        } else {
+          to_open[i]->fd = res;
+          to_close.push_back(to_open[i]);
+        }
+      });
+
+  // Keep issuing reads until every file has either hit end-of-file or failed.
+  // A read which fills the entire chunk means there may be more data.
+  std::vector<PendingRead *> to_read;
+  if (status.ok()) {
+    for (PendingRead &file : pending) {
+      if (file.fd >= 0) to_read.push_back(&file);
+    }
+  }
+  while (status.ok() && !to_read.empty()) {
+    std::vector<PendingRead *> next_to_read;
+    status = Run(
+        to_read.size(),
+        [&](size_t i, io_uring_sqe *sqe) {
+          PendingRead &file = *to_read[i];
+          sqe->opcode = IORING_OP_READ;
+          sqe->fd = file.fd;
+          sqe->addr =
+              reinterpret_cast<uintptr_t>(&buffers_[i * kReadChunkSize]);
+          sqe->len = kReadChunkSize;
+          sqe->off = file.data.size();
+        },
+        [&](size_t i, int res) {
+          PendingRead &file = *to_read[i];
+          if (res < 0) {
+            if (res == -EINTR || res == -EAGAIN) {
+              next_to_read.push_back(&file);
+            } else {
+              results[file.index] = ReadError(file.path, -res);
+              file.done = true;
+            }
+            return;
+          }
+          file.data.append(&buffers_[i * kReadChunkSize], res);
+          if (static_cast<size_t>(res) == kReadChunkSize) {
+            next_to_read.push_back(&file);
+          } else {
+            results[file.index] = std::move(file.data);
+            file.done = true;
+          }
+        });
+    to_read = std::move(next_to_read);
+  }
+  // If the ring failed then any file that was not finished, whether it was
+  // never opened or was part way through being read, gets the ring error.
+  for (PendingRead &file : pending) {
+    if (!file.done) results[file.index] = RingError(file.path, status);
+  }
+
+  // Close everything that was opened, including files whose opens only
+  // completed while a failed batch was being drained. A broken ring cannot be
+  // used for this, so then the files are closed directly.
+  if (broken_) {
+    status = absl::InternalError("the ring is broken");
+  } else {
+    status = Run(
+        to_close.size(),
+        [&](size_t i, io_uring_sqe *sqe) {
+          sqe->opcode = IORING_OP_CLOSE;
+          sqe->fd = to_close[i]->fd;
+        },
+        [&](size_t i, int res) {
+          // The data has already been read, so a failed close does not affect
+          // the result. The descriptor is released by the kernel either way.
+          if (res < 0) {
+            ErrorLog() << "failed to close file " << to_close[i]->path
+                       << ", errno: " << -res;
+          }
+          to_close[i]->fd = -1;
+        });
+  }
+  if (!status.ok()) {
+    ErrorLog() << "io_uring close batch failed, closing files directly: "
+               << status;
+    for (PendingRead *file : to_close) {
+      if (file->fd >= 0 && close(file->fd) < 0) {
+        ErrorLog() << "failed to close file " << file->path
+                   << ", errno: " << errno;
+      }
+    }
+  }
+}
+
+namespace {
+
+// The interface used by readers which are not given one.
+IoUringEnterInterface *DefaultIoUringEnter() {
+  static SysIoUringEnter *const sys_io_uring_enter = new SysIoUringEnter;
+  return sys_io_uring_enter;
+}
+
+}  // namespace
+
+int SysIoUringEnter::Call(int ring_fd, unsigned to_submit,
+                          unsigned min_complete, unsigned flags) {
+  return syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags,
+                 nullptr, 0);
+}
+
+ApifsBulkReader::ApifsBulkReader() : ApifsBulkReader(Options()) {}
+
+ApifsBulkReader::ApifsBulkReader(const Options &options)
+    : ApifsBulkReader(options, DefaultIoUringEnter()) {}
+
+ApifsBulkReader::ApifsBulkReader(const Options &options,
+                                 IoUringEnterInterface *io_uring_enter)
+    : options_(options), io_uring_enter_(io_uring_enter) {
+  if (options_.use_io_uring && options_.queue_depth > 0) {
+    ring_ = Ring::Create(options_.queue_depth, io_uring_enter_);
+  }
+}
+
+ApifsBulkReader::~ApifsBulkReader() = default;
+
+void ApifsBulkReader::ReplaceBrokenRing() {
+  if (!ring_->IsBroken()) return;
+  ErrorLog() << "replacing a broken io_uring instance";
+  ring_ = Ring::Create(options_.queue_depth, io_uring_enter_);
+}
+
+std::vector<absl::StatusOr<std::string>> ApifsBulkReader::Read(
+    absl::Span<const ApifsFile> files) {
+  std::vector<absl::StatusOr<std::string>> results(
+      files.size(), absl::UnknownError("file was not read"));
+  absl::MutexLock ml(&ring_mutex_);
+  size_t start = 0;
+  while (start < files.size() && ring_ != nullptr) {
+    size_t end = std::min(files.size(), start + ring_->Capacity());
+    std::vector<PendingRead> pending;
+    pending.reserve(end - start);
+    for (size_t i = start; i < end; ++i) {
+      pending.push_back({.index = i, .path = files[i].GetPath(), .fd = -1});
+    }
+    ring_->ReadAll(absl::MakeSpan(pending), absl::MakeSpan(results));
+    ReplaceBrokenRing();
+    start = end;
+  }
+  for (size_t i = start; i < files.size(); ++i) results[i] = files[i].Read();
+  return results;
+}
+
+std::vector<absl::StatusOr<std::string>> ApifsBulkReader::Read(
+    absl::Span<const ApifsFileHandle *const> handles) {
+  std::vector<absl::StatusOr<std::string>> results(
+      handles.size(), absl::UnknownError("file was not read"));
+  absl::MutexLock ml(&ring_mutex_);
+  size_t start = 0;
+  while (start < handles.size() && ring_ != nullptr) {
+    size_t end = std::min(handles.size(), start + ring_->Capacity());
+    std::vector<PendingRead> pending;
+    pending.reserve(end - start);
+    for (size_t i = start; i < end; ++i) {
+      pending.push_back({.index = i,
+                         .path = handles[i]->GetPath(),
+                         .fd = handles[i]->fd_});
+    }
+    ring_->ReadAll(absl::MakeSpan(pending), absl::MakeSpan(results));
+    ReplaceBrokenRing();
+    start = end;
+  }
+  for (size_t i = start; i < handles.size(); ++i) {
+    results[i] = handles[i]->Read();
+  }
+  return results;
+}
+
+}  // namespace ecclesia
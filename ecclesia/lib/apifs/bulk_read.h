@@ -0,0 +1,120 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This library provides support for reading many small API filesystem files
+// at once. Reading a sysfs attribute one at a time costs an open, a read and a
+// close system call per attribute; when a refresh needs to read hundreds of
+// them that overhead dominates.
+//
+// When the kernel supports it the reader submits all of the opens, reads and
+// closes through io_uring, so that each phase of a batch costs only a handful
+// of system calls. Otherwise it falls back to reading the files one at a time.
+// The reads are cheap enough that starting threads for them on every batch
+// would cost more than it saves.
+
+#ifndef ECCLESIA_LIB_APIFS_BULK_READ_H_
+#define ECCLESIA_LIB_APIFS_BULK_READ_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "ecclesia/lib/apifs/apifs.h"
+
+namespace ecclesia {
+
+// Provides a virtual interface for the io_uring_enter system call, which the
+// reader makes all of its calls to through this. This allows failures to be
+// injected in testing.
+class IoUringEnterInterface {
+ public:
+  IoUringEnterInterface() {}
+  virtual ~IoUringEnterInterface() = default;
+
+  virtual int Call(int ring_fd, unsigned to_submit, unsigned min_complete,
+                   unsigned flags) = 0;
+};
+
+// Implementation of the interface that uses the system call.
+class SysIoUringEnter final : public IoUringEnterInterface {
+ public:
+  int Call(int ring_fd, unsigned to_submit, unsigned min_complete,
+           unsigned flags) override;
+};
+
+class ApifsBulkReader {
+ public:
+  struct Options {
+    // The maximum number of files that will be in flight in io_uring at once.
+    // Larger batches are split up into multiple rounds.
+    int queue_depth = 256;
+    // Allows io_uring to be disabled, to force the sequential reader.
+    bool use_io_uring = true;
+  };
+
+  ApifsBulkReader();
+  explicit ApifsBulkReader(const Options &options);
+  // Makes its io_uring_enter calls through the given interface, which must
+  // outlive the reader.
+  ApifsBulkReader(const Options &options,
+                  IoUringEnterInterface *io_uring_enter);
+
+  // The reader can own an io_uring instance so it cannot be copied.
+  ApifsBulkReader(const ApifsBulkReader &other) = delete;
+  ApifsBulkReader &operator=(const ApifsBulkReader &other) = delete;
+
+  ~ApifsBulkReader();
+
+  // Indicates if reads will be done using io_uring.
+  bool UsingIoUring() const {
+    absl::MutexLock ml(&ring_mutex_);
+    return ring_ != nullptr;
+  }
+
+  // Read the entire contents of all the given files. The results are returned
+  // in the same order as the inputs, with each one having either the file
+  // contents or the error encountered while reading it. As with the ApifsFile
+  // functions, a file that does not exist produces a NotFound error.
+  std::vector<absl::StatusOr<std::string>> Read(
+      absl::Span<const ApifsFile> files);
+
+  // Read the entire contents of all of the given handles, starting from offset
+  // 0. This saves the open and close on every read, for files which are read
+  // on every refresh.
+  std::vector<absl::StatusOr<std::string>> Read(
+      absl::Span<const ApifsFileHandle *const> handles);
+
+ private:
+  class Ring;
+
+  // Replaces the ring if it failed in a way that it cannot recover from. If
+  // a new ring cannot be set up, the reader falls back to sequential reads.
+  void ReplaceBrokenRing() ABSL_EXCLUSIVE_LOCKS_REQUIRED(ring_mutex_);
+
+  const Options options_;
+  IoUringEnterInterface *const io_uring_enter_;
+
+  mutable absl::Mutex ring_mutex_;
+  std::unique_ptr<Ring> ring_ ABSL_GUARDED_BY(ring_mutex_);
+};
+
+}  // namespace ecclesia
+
+#endif  // ECCLESIA_LIB_APIFS_BULK_READ_H_
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks comparing the bulk reader against reading files one at a time
+// with ApifsFile, on a simulated sysfs tree of many small attribute files.
+
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "ecclesia/lib/apifs/apifs.h"
+#include "ecclesia/lib/apifs/bulk_read.h"
+#include "ecclesia/lib/file/test_filesystem.h"
+
+namespace ecclesia {
+namespace {
+
+constexpr int kNumFiles = 10000;
+
+// Set up a tree of small files, shared by all of the benchmarks.
+const std::vector<ApifsFile> &GetBenchmarkFiles() {
+  static const auto *files = []() {
+    static auto *fs = new TestFilesystem(GetTestTempdirPath());
+    ApifsDirectory apifs(fs->GetTruePath("/sys"));
+    auto *files = new std::vector<ApifsFile>();
+    for (int i = 0; i < kNumFiles; ++i) {
+      std::string dir = absl::StrCat("/sys/devices/dev", i / 100);
+      if (i % 100 == 0) fs->CreateDir(dir);
+      std::string path = absl::StrCat(dir, "/attr", i % 100);
+      fs->CreateFile(path, absl::StrCat(i, "\n"));
+      files->emplace_back(fs->GetTruePath(path));
+    }
+    return files;
+  }();
+  return *files;
+}
+
+void BM_SequentialRead(benchmark::State &state) {
+  const std::vector<ApifsFile> &files = GetBenchmarkFiles();
+  for (auto _ : state) {
+    for (const ApifsFile &file : files) {
+      benchmark::DoNotOptimize(file.Read());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * files.size());
+}
+BENCHMARK(BM_SequentialRead)->Unit(benchmark::kMillisecond);
+
+void BM_BulkRead(benchmark::State &state) {
+  const std::vector<ApifsFile> &files = GetBenchmarkFiles();
+  ApifsBulkReader::Options options;
+  options.use_io_uring = state.range(0);
+  ApifsBulkReader reader(options);
+  if (options.use_io_uring && !reader.UsingIoUring()) {
+    state.SkipWithError("io_uring is not available");
+    return;
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(reader.Read(files));
+  }
+  state.SetItemsProcessed(state.iterations() * files.size());
+}
+BENCHMARK(BM_BulkRead)
+    ->ArgName("io_uring")
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace ecclesia
@@ -0,0 +1,311 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/lib/apifs/bulk_read.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "ecclesia/lib/apifs/apifs.h"
+#include "ecclesia/lib/file/dir.h"
+#include "ecclesia/lib/file/test_filesystem.h"
+#include "ecclesia/lib/testing/status.h"
+
+namespace ecclesia {
+namespace {
+
+using ::testing::Not;
+
+// All of the tests are run with both io_uring enabled and disabled. On systems
+// without io_uring both variants exercise the sequential reader.
+class ApifsBulkReaderTest : public ::testing::TestWithParam<bool> {
+ protected:
+  ApifsBulkReaderTest()
+      : fs_(GetTestTempdirPath()), apifs_(GetTestTempdirPath("sys")) {
+    fs_.CreateDir("/sys/devices/dir");
+    for (int i = 0; i < kNumFiles; ++i) {
+      fs_.CreateFile(absl::StrCat("/sys/devices/attr", i),
+                     absl::StrCat("value", i, "\n"));
+    }
+    fs_.CreateFile("/sys/devices/empty", "");
+    fs_.CreateFile("/sys/devices/large", std::string(10000, 'J'));
+    fs_.CreateFile("/sys/devices/exact", std::string(4096, 'K'));
+  }
+
+  ApifsBulkReader::Options MakeOptions(int queue_depth) {
+    ApifsBulkReader::Options options;
+    options.queue_depth = queue_depth;
+    options.use_io_uring = GetParam();
+    return options;
+  }
+
+  static constexpr int kNumFiles = 50;
+
+  TestFilesystem fs_;
+  ApifsDirectory apifs_;
+};
+
+TEST_P(ApifsBulkReaderTest, ReadFiles) {
+  ApifsBulkReader reader(MakeOptions(8));
+  if (!GetParam()) {
+    EXPECT_FALSE(reader.UsingIoUring());
+  }
+
+  std::vector<ApifsFile> files;
+  for (int i = 0; i < kNumFiles; ++i) {
+    files.emplace_back(apifs_, absl::StrCat("devices/attr", i));
+  }
+  files.emplace_back(apifs_, "devices/empty");
+  files.emplace_back(apifs_, "devices/large");
+  files.emplace_back(apifs_, "devices/exact");
+
+  std::vector<absl::StatusOr<std::string>> results = reader.Read(files);
+  ASSERT_EQ(results.size(), files.size());
+  for (int i = 0; i < kNumFiles; ++i) {
+    EXPECT_THAT(results[i], IsOkAndHolds(absl::StrCat("value", i, "\n")));
+  }
+  EXPECT_THAT(results[kNumFiles], IsOkAndHolds(""));
+  EXPECT_THAT(results[kNumFiles + 1], IsOkAndHolds(std::string(10000, 'J')));
+  EXPECT_THAT(results[kNumFiles + 2], IsOkAndHolds(std::string(4096, 'K')));
+}
+
+TEST_P(ApifsBulkReaderTest, ReadFailures) {
+  ApifsBulkReader reader(MakeOptions(4));
+
+  std::vector<ApifsFile> files = {
+      ApifsFile(apifs_, "devices/attr0"),
+      ApifsFile(apifs_, "devices/missing"),
+      ApifsFile(apifs_, "devices/dir"),
+      ApifsFile(),
+      ApifsFile(apifs_, "devices/attr1"),
+  };
+  std::vector<absl::StatusOr<std::string>> results = reader.Read(files);
+  ASSERT_EQ(results.size(), files.size());
+  EXPECT_THAT(results[0], IsOkAndHolds("value0\n"));
+  EXPECT_TRUE(absl::IsNotFound(results[1].status()));
+  EXPECT_THAT(results[2], Not(IsOk()));
+  EXPECT_TRUE(absl::IsNotFound(results[3].status()));
+  EXPECT_THAT(results[4], IsOkAndHolds("value1\n"));
+}
+
+TEST_P(ApifsBulkReaderTest, ReadHandles) {
+  ApifsBulkReader reader(MakeOptions(4));
+
+  std::vector<ApifsFileHandle> handles;
+  for (int i = 0; i < 10; ++i) {
+    auto maybe_handle = ApifsFileHandle::Open(
+        ApifsFile(apifs_, absl::StrCat("devices/attr", i)));
+    ASSERT_THAT(maybe_handle, IsOk());
+    handles.push_back(std::move(*maybe_handle));
+  }
+  std::vector<const ApifsFileHandle *> handle_ptrs;
+  for (const ApifsFileHandle &handle : handles) {
+    handle_ptrs.push_back(&handle);
+  }
+
+  std::vector<absl::StatusOr<std::string>> results = reader.Read(handle_ptrs);
+  ASSERT_EQ(results.size(), handles.size());
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_THAT(results[i], IsOkAndHolds(absl::StrCat("value", i, "\n")));
+  }
+
+  // The handles are left open and re-read from the start, so updated contents
+  // are picked up by a second read.
+  fs_.WriteFile("/sys/devices/attr3", "updated\n");
+  results = reader.Read(handle_ptrs);
+  ASSERT_EQ(results.size(), handles.size());
+  EXPECT_THAT(results[2], IsOkAndHolds("value2\n"));
+  EXPECT_THAT(results[3], IsOkAndHolds("updated\n"));
+  EXPECT_THAT(handles[3].Read(), IsOkAndHolds("updated\n"));
+}
+
+TEST_P(ApifsBulkReaderTest, ReadNothing) {
+  ApifsBulkReader reader(MakeOptions(4));
+  EXPECT_TRUE(reader.Read(absl::Span<const ApifsFile>()).empty());
+  EXPECT_TRUE(reader.Read(absl::Span<const ApifsFileHandle *const>()).empty());
+}
+
+INSTANTIATE_TEST_SUITE_P(IoUring, ApifsBulkReaderTest, ::testing::Bool());
+
+// Makes the real system call, except that call number fail_call fails with EIO
+// without doing anything. The calls before it only submit operations rather
+// than waiting for them, so that operations which cannot complete straight
+// away are still outstanding when the failure happens.
+class FailingIoUringEnter : public IoUringEnterInterface {
+ public:
+  FailingIoUringEnter(int fail_call, std::function<void()> on_failure)
+      : fail_call_(fail_call), on_failure_(std::move(on_failure)) {}
+
+  int Call(int ring_fd, unsigned to_submit, unsigned min_complete,
+           unsigned flags) override {
+    int call = ++calls_;
+    if (call == fail_call_) {
+      on_failure_();
+      errno = EIO;
+      return -1;
+    }
+    if (call < fail_call_) {
+      min_complete = 0;
+      flags &= ~IORING_ENTER_GETEVENTS;
+    }
+    return sys_.Call(ring_fd, to_submit, min_complete, flags);
+  }
+
+ private:
+  const int fail_call_;
+  std::function<void()> on_failure_;
+  int calls_ = 0;
+  SysIoUringEnter sys_;
+};
+
+class ApifsBulkReaderFailureTest : public ::testing::Test {
+ protected:
+  ApifsBulkReaderFailureTest()
+      : fs_(GetTestTempdirPath()), apifs_(GetTestTempdirPath("sys")) {
+    fs_.CreateDir("/sys/devices");
+    for (int i = 0; i < 4; ++i) {
+      fs_.CreateFile(absl::StrCat("/sys/devices/attr", i),
+                     absl::StrCat("value", i, "\n"));
+    }
+    // Reads of an empty FIFO cannot complete until something is written to
+    // it, so they stay outstanding. Opening it for both reading and writing
+    // keeps a writer around without blocking.
+    fifo_path_ = fs_.GetTruePath("/sys/devices/fifo");
+    unlink(fifo_path_.c_str());
+    EXPECT_EQ(mkfifo(fifo_path_.c_str(), 0600), 0);
+    fifo_fd_ = open(fifo_path_.c_str(), O_RDWR | O_CLOEXEC);
+    EXPECT_GE(fifo_fd_, 0);
+  }
+
+  ~ApifsBulkReaderFailureTest() override {
+    close(fifo_fd_);
+    unlink(fifo_path_.c_str());
+  }
+
+  void WriteFifo(absl::string_view data) {
+    EXPECT_EQ(write(fifo_fd_, data.data(), data.size()), data.size());
+  }
+
+  static int CountOpenFds() {
+    int count = 0;
+    WithEachFileInDirectory("/proc/self/fd",
+                            [&count](absl::string_view) { ++count; })
+        .IgnoreError();
+    return count;
+  }
+
+  std::vector<ApifsFile> RegularFiles() {
+    std::vector<ApifsFile> files;
+    for (int i = 0; i < 4; ++i) {
+      files.emplace_back(apifs_, absl::StrCat("devices/attr", i));
+    }
+    return files;
+  }
+
+  void ExpectRegularFilesRead(ApifsBulkReader &reader) {
+    std::vector<absl::StatusOr<std::string>> results =
+        reader.Read(RegularFiles());
+    ASSERT_EQ(results.size(), 4);
+    for (size_t i = 0; i < results.size(); ++i) {
+      EXPECT_THAT(results[i], IsOkAndHolds(absl::StrCat("value", i, "\n")));
+    }
+  }
+
+  TestFilesystem fs_;
+  ApifsDirectory apifs_;
+  std::string fifo_path_;
+  int fifo_fd_ = -1;
+};
+
+TEST_F(ApifsBulkReaderFailureTest, FailureWithReadsOutstanding) {
+  // The first call submits all of the reads, and the second one, which would
+  // wait for them, fails while the read of the FIFO is still outstanding. The
+  // read is then completed by writing to the FIFO.
+  FailingIoUringEnter enter(2, [this]() { WriteFifo("fifo\n"); });
+  ApifsBulkReader reader(ApifsBulkReader::Options(), &enter);
+  if (!reader.UsingIoUring()) GTEST_SKIP() << "io_uring is not available";
+
+  std::vector<ApifsFileHandle> handles;
+  for (const ApifsFile &file : RegularFiles()) {
+    auto maybe_handle = ApifsFileHandle::Open(file);
+    ASSERT_THAT(maybe_handle, IsOk());
+    handles.push_back(std::move(*maybe_handle));
+  }
+  auto maybe_fifo = ApifsFileHandle::Open(ApifsFile(apifs_, "devices/fifo"));
+  ASSERT_THAT(maybe_fifo, IsOk());
+  handles.push_back(std::move(*maybe_fifo));
+  std::vector<const ApifsFileHandle *> handle_ptrs;
+  for (const ApifsFileHandle &handle : handles) {
+    handle_ptrs.push_back(&handle);
+  }
+
+  // Every result is either the contents of the file, from a read which was
+  // completed while the failed batch was drained, or the ring error.
+  std::vector<absl::StatusOr<std::string>> results = reader.Read(handle_ptrs);
+  ASSERT_EQ(results.size(), handles.size());
+  for (size_t i = 0; i < 4; ++i) {
+    if (results[i].ok()) {
+      EXPECT_EQ(*results[i], absl::StrCat("value", i, "\n"));
+    } else {
+      EXPECT_EQ(results[i].status().code(), absl::StatusCode::kInternal);
+    }
+  }
+  if (results[4].ok()) {
+    EXPECT_EQ(*results[4], "fifo\n");
+  } else {
+    EXPECT_EQ(results[4].status().code(), absl::StatusCode::kInternal);
+  }
+
+  // None of the failed batch's completions are seen by later batches.
+  ExpectRegularFilesRead(reader);
+  ExpectRegularFilesRead(reader);
+}
+
+TEST_F(ApifsBulkReaderFailureTest, FailureBeforeSubmitting) {
+  FailingIoUringEnter enter(1, []() {});
+  ApifsBulkReader reader(ApifsBulkReader::Options(), &enter);
+  if (!reader.UsingIoUring()) GTEST_SKIP() << "io_uring is not available";
+
+  int open_fds = CountOpenFds();
+  std::vector<absl::StatusOr<std::string>> results =
+      reader.Read(RegularFiles());
+  ASSERT_EQ(results.size(), 4);
+  for (const absl::StatusOr<std::string> &result : results) {
+    EXPECT_EQ(result.status().code(), absl::StatusCode::kInternal);
+  }
+  EXPECT_EQ(CountOpenFds(), open_fds);
+
+  // The opens which were never submitted are not submitted by later batches.
+  ExpectRegularFilesRead(reader);
+  ExpectRegularFilesRead(reader);
+}
+
+}  // namespace
+}  // namespace ecclesia
@@ -39,8 +39,31 @@ constexpr size_t kBcdUpperBound = sizeof(kBcdPlusTable) - 1;
 
 absl::StatusOr<std::string> ParseBcdPlus(
     absl::Span<const unsigned char> bytes) {
-  std::string value;
-  value.reserve(2 * bytes.size());
+  std::string value(BcdPlusDecodedSize(bytes.size()), '\0');
+  absl::StatusOr<size_t> maybe_size =
+      ParseBcdPlus(bytes, absl::MakeSpan(value));
+  if (!maybe_size.ok()) return maybe_size.status();
+  value.resize(*maybe_size);
+  return value;
+}
+
+absl::StatusOr<std::string> ParseSixBitAscii(
+    absl::Span<const unsigned char> bytes) {
+  std::string value(SixBitAsciiDecodedSize(bytes.size()), '\0');
+  absl::StatusOr<size_t> maybe_size =
+      ParseSixBitAscii(bytes, absl::MakeSpan(value));
+  if (!maybe_size.ok()) return maybe_size.status();
+  value.resize(*maybe_size);
+  return value;
+}
+
+absl::StatusOr<size_t> ParseBcdPlus(absl::Span<const unsigned char> bytes,
+                                    absl::Span<char> out) {
+  if (out.size() < BcdPlusDecodedSize(bytes.size())) {
+    return absl::InvalidArgumentError(
+        "BCD plus decoding failed! Output buffer is too small");
+  }
+  size_t out_index = 0;
   for (uint8_t byte : bytes) {
     uint8_t lower_code = ExtractBits(byte, BitRange(3, 0));
     uint8_t upper_code = ExtractBits(byte, BitRange(7, 4));
@@ -49,18 +72,22 @@ absl::StatusOr<std::string> ParseBcdPlus(
           "BCD plus decoding failed! Data must be "
           "between 0h-Ch");
     } else {
-      value.push_back(kBcdPlusTable[upper_code]);
-      value.push_back(kBcdPlusTable[lower_code]);
+      out[out_index++] = kBcdPlusTable[upper_code];
+      out[out_index++] = kBcdPlusTable[lower_code];
     }
   }
-  return value;
+  return out_index;
 }
 
-absl::StatusOr<std::string> ParseSixBitAscii(
-    absl::Span<const unsigned char> bytes) {
+absl::StatusOr<size_t> ParseSixBitAscii(absl::Span<const unsigned char> bytes,
+                                        absl::Span<char> out) {
+  if (out.size() < SixBitAsciiDecodedSize(bytes.size())) {
+    return absl::InvalidArgumentError(
+        "6-bit ASCII decoding failed! Output buffer is too small");
+  }
+  size_t out_index = 0;
   uint32_t idx = 0;  // packed bytes starting index
   uint32_t buf = 0;  // buffer that holds 4 encoded bytes
-  std::string value;
   for (uint8_t byte : bytes) {
     buf |= byte << (idx << 3);
     idx++;
@@ -68,10 +95,10 @@ absl::StatusOr<std::string> ParseSixBitAscii(
     //  characters to every 3 bytes, with the first character in the least
     //  significant 6-bits of the first byte
     if (idx == 3) {
-      value.push_back(0x20 + ExtractBits(buf, BitRange(5, 0)));
-      value.push_back(0x20 + ExtractBits(buf, BitRange(11, 6)));
-      value.push_back(0x20 + ExtractBits(buf, BitRange(17, 12)));
-      value.push_back(0x20 + ExtractBits(buf, BitRange(23, 18)));
+      out[out_index++] = 0x20 + ExtractBits(buf, BitRange(5, 0));
+      out[out_index++] = 0x20 + ExtractBits(buf, BitRange(11, 6));
+      out[out_index++] = 0x20 + ExtractBits(buf, BitRange(17, 12));
+      out[out_index++] = 0x20 + ExtractBits(buf, BitRange(23, 18));
       buf = 0;
       idx = 0;
     }
@@ -79,9 +106,9 @@ absl::StatusOr<std::string> ParseSixBitAscii(
   // Handle the remaining byte_offset bytes if data length is not a
   // multiple of 3
   for (uint8_t bit_idx = 0; bit_idx < idx * 6; bit_idx += 6) {
-    value.push_back(0x20 + ExtractBits(buf, BitRange(bit_idx + 5, bit_idx)));
+    out[out_index++] = 0x20 + ExtractBits(buf, BitRange(bit_idx + 5, bit_idx));
   }
-  return value;
+  return out_index;
 }
 
 }  // namespace ecclesia
@@ -25,6 +25,7 @@
 #ifndef ECCLESIA_LIB_CODEC_DECODE_H_
 #define ECCLESIA_LIB_CODEC_DECODE_H_
 
+#include <cstddef>
 #include <string>
 
 #include "absl/status/statusor.h"
@@ -40,6 +41,21 @@ absl::StatusOr<std::string> ParseBcdPlus(absl::Span<const unsigned char> bytes);
 absl::StatusOr<std::string> ParseSixBitAscii(
     absl::Span<const unsigned char> bytes);
 
+// The number of characters produced by decoding the given number of bytes.
+inline size_t BcdPlusDecodedSize(size_t num_bytes) { return 2 * num_bytes; }
+inline size_t SixBitAsciiDecodedSize(size_t num_bytes) {
+  return num_bytes / 3 * 4 + num_bytes % 3;
+}
+
+// Variants of the above functions which decode into a caller-provided buffer
+// instead of allocating a new string. The buffer must be large enough to hold
+// the decoded text (see the *DecodedSize functions); on success the number of
+// characters written into it is returned.
+absl::StatusOr<size_t> ParseBcdPlus(absl::Span<const unsigned char> bytes,
+                                    absl::Span<char> out);
+absl::StatusOr<size_t> ParseSixBitAscii(absl::Span<const unsigned char> bytes,
+                                        absl::Span<char> out);
+
 }  // namespace ecclesia
 
 #endif  // ECCLESIA_LIB_CODEC_DECODE_H_
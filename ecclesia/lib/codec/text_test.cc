@@ -16,15 +16,21 @@
 
 #include "ecclesia/lib/codec/text.h"
 
+#include <cstddef>
 #include <cstdint>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "ecclesia/lib/testing/status.h"
 
 namespace ecclesia {
 namespace {
 
+using ::testing::Not;
+
 TEST(TextDecode, DecodeValidBCD) {
   static constexpr char kBcdTranslated[] = "42-421 ...";
   static constexpr uint8_t kValidBcdString[] = {0x42, 0xB4, 0x21, 0xAC, 0xCC};
@@ -48,5 +54,39 @@ TEST(TextDecode, DecodeValidSixBitWithUnusedBits) {
               IsOkAndHolds(k6BitTranslated));
 }
 
+TEST(TextDecode, DecodeInvalidBCD) {
+  static constexpr uint8_t kInvalidBcdString[] = {0x42, 0xEF};
+
+  EXPECT_THAT(ParseBcdPlus(kInvalidBcdString), Not(IsOk()));
+}
+
+TEST(TextDecode, DecodeIntoBuffer) {
+  static constexpr uint8_t kValidBcdString[] = {0x42, 0xB4, 0x21, 0xAC, 0xCC};
+  static constexpr uint8_t kValidSixBitAscii[] = {0x37, 0x9A, 0x7F, 0x66};
+  char buffer[16];
+
+  EXPECT_EQ(BcdPlusDecodedSize(sizeof(kValidBcdString)), 10);
+  absl::StatusOr<size_t> maybe_size =
+      ParseBcdPlus(kValidBcdString, absl::MakeSpan(buffer));
+  ASSERT_THAT(maybe_size, IsOkAndHolds(10));
+  EXPECT_EQ(absl::string_view(buffer, *maybe_size), "42-421 ...");
+
+  EXPECT_EQ(SixBitAsciiDecodedSize(sizeof(kValidSixBitAscii)), 5);
+  maybe_size = ParseSixBitAscii(kValidSixBitAscii, absl::MakeSpan(buffer));
+  ASSERT_THAT(maybe_size, IsOkAndHolds(5));
+  EXPECT_EQ(absl::string_view(buffer, *maybe_size), "WHY?F");
+}
+
+TEST(TextDecode, DecodeIntoBufferTooSmall) {
+  static constexpr uint8_t kValidBcdString[] = {0x42, 0xB4, 0x21};
+  static constexpr uint8_t kValidSixBitAscii[] = {0x37, 0x9A, 0x7F};
+  char buffer[3];
+
+  EXPECT_THAT(ParseBcdPlus(kValidBcdString, absl::MakeSpan(buffer)),
+              Not(IsOk()));
+  EXPECT_THAT(ParseSixBitAscii(kValidSixBitAscii, absl::MakeSpan(buffer)),
+              Not(IsOk()));
+}
+
 }  // namespace
 }  // namespace ecclesia
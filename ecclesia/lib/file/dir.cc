@@ -16,20 +16,67 @@
 
 #include "ecclesia/lib/file/dir.h"
 
+#include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 
+#include <cstddef>
+#include <cstdint>
 #include <stack>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/match.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "ecclesia/lib/file/path.h"
 
 namespace ecclesia {
+namespace {
+
+// The size of the buffer used for reading directory entries. This is large
+// enough to hold several hundred typical entries.
+constexpr size_t kDirectoryBufferSize = 32 * 1024;
+
+// The layout of the records returned by getdents64. The C library does not
+// provide a definition of this structure.
+struct LinuxDirent64 {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+DirectoryEntryType TypeFromDtype(unsigned char d_type) {
+  switch (d_type) {
+    case DT_UNKNOWN:
+      return DirectoryEntryType::kUnknown;
+    case DT_REG:
+      return DirectoryEntryType::kFile;
+    case DT_DIR:
+      return DirectoryEntryType::kDirectory;
+    case DT_LNK:
+      return DirectoryEntryType::kSymlink;
+    default:
+      return DirectoryEntryType::kOther;
+  }
+}
+
+DirectoryEntryType TypeFromMode(mode_t mode) {
+  if (S_ISREG(mode)) return DirectoryEntryType::kFile;
+  if (S_ISDIR(mode)) return DirectoryEntryType::kDirectory;
+  if (S_ISLNK(mode)) return DirectoryEntryType::kSymlink;
+  return DirectoryEntryType::kOther;
+}
+
+}  // namespace
 
 absl::Status MakeDirectories(absl::string_view dirname) {
   std::stack<std::string> missing_dirs;
@@ -60,4 +107,101 @@ absl::Status MakeDirectories(absl::string_view dirname) {
   return absl::OkStatus();
 }
 
+absl::StatusOr<DirectoryIterator> DirectoryIterator::Open(
+    absl::string_view dirname, DirectoryEntryFilter filter) {
+  std::string c_dirname(dirname);  // Needed to get a NUL terminator.
+  int fd = open(c_dirname.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    if (errno == ENOENT) {
+      return absl::NotFoundError(
+          absl::StrFormat("directory not found at path: %s", dirname));
+    }
+    return absl::InternalError(absl::StrFormat(
+        "unable to open directory %s, errno: %d", dirname, errno));
+  }
+  return DirectoryIterator(fd, std::move(c_dirname), std::move(filter));
+}
+
+DirectoryIterator::DirectoryIterator(int fd, std::string dirname,
+                                     DirectoryEntryFilter filter)
+    : fd_(fd),
+      dirname_(std::move(dirname)),
+      filter_(std::move(filter)),
+      buffer_(kDirectoryBufferSize) {}
+
+DirectoryIterator::DirectoryIterator(DirectoryIterator &&other)
+    : fd_(std::exchange(other.fd_, -1)),
+      dirname_(std::move(other.dirname_)),
+      filter_(std::move(other.filter_)),
+      status_(std::move(other.status_)),
+      buffer_(std::move(other.buffer_)),
+      buffer_offset_(std::exchange(other.buffer_offset_, 0)),
+      buffer_size_(std::exchange(other.buffer_size_, 0)) {}
+
+DirectoryIterator &DirectoryIterator::operator=(DirectoryIterator &&other) {
+  if (this != &other) {
+    if (fd_ >= 0) close(fd_);
+    fd_ = std::exchange(other.fd_, -1);
+    dirname_ = std::move(other.dirname_);
+    filter_ = std::move(other.filter_);
+    status_ = std::move(other.status_);
+    buffer_ = std::move(other.buffer_);
+    buffer_offset_ = std::exchange(other.buffer_offset_, 0);
+    buffer_size_ = std::exchange(other.buffer_size_, 0);
+  }
+  return *this;
+}
+
+DirectoryIterator::~DirectoryIterator() {
+  if (fd_ >= 0) close(fd_);
+}
+
+bool DirectoryIterator::Fill() {
+  if (fd_ < 0 || !status_.ok()) return false;
+  long rc;
+  do {
+    rc = syscall(SYS_getdents64, fd_, buffer_.data(), buffer_.size());
+  } while (rc < 0 && errno == EINTR);
+  if (rc < 0) {
+    status_ = absl::InternalError(absl::StrFormat(
+        "failure while reading directory %s, errno: %d", dirname_, errno));
+    return false;
+  }
+  buffer_offset_ = 0;
+  buffer_size_ = rc;
+  return rc > 0;
+}
+
+bool DirectoryIterator::Next(DirectoryEntry *entry) {
+  while (true) {
+    if (buffer_offset_ >= buffer_size_ && !Fill()) return false;
+
+    const auto *dirent =
+        reinterpret_cast<const LinuxDirent64 *>(&buffer_[buffer_offset_]);
+    buffer_offset_ += dirent->d_reclen;
+
+    absl::string_view name = dirent->d_name;
+    // Skip the entries which don't correspond to real entries.
+    if (name == "." || name == "..") continue;
+    if (!absl::StartsWith(name, filter_.prefix)) continue;
+
+    DirectoryEntryType type = TypeFromDtype(dirent->d_type);
+    if (filter_.type.has_value()) {
+      // Look up the type if the filesystem didn't provide it.
+      if (type == DirectoryEntryType::kUnknown) {
+        struct stat st;
+        if (fstatat(fd_, dirent->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+          type = TypeFromMode(st.st_mode);
+        }
+      }
+      if (type != *filter_.type) continue;
+    }
+
+    entry->name = name;
+    entry->type = type;
+    entry->inode = dirent->d_ino;
+    return true;
+  }
+}
+
 }  // namespace ecclesia
@@ -17,14 +17,15 @@
 #ifndef ECCLESIA_LIB_FILE_DIR_H_
 #define ECCLESIA_LIB_FILE_DIR_H_
 
-#include <dirent.h>
-
-#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include "absl/status/status.h"
-#include "absl/strings/str_format.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 
 namespace ecclesia {
 
@@ -35,53 +36,107 @@ namespace ecclesia {
 // reason. Returns OK if the directory already exists.
 absl::Status MakeDirectories(absl::string_view dirname);
 
+// The type of a directory entry, as reported by the directory listing.
+enum class DirectoryEntryType {
+  kUnknown,
+  kFile,
+  kDirectory,
+  kSymlink,
+  kOther,
+};
+
+// A single entry in a directory. The name refers to a buffer owned by the
+// DirectoryIterator that produced it and is only valid until the next call to
+// DirectoryIterator::Next.
+struct DirectoryEntry {
+  absl::string_view name;
+  DirectoryEntryType type = DirectoryEntryType::kUnknown;
+  // The inode number of the entry. On sysfs a new inode is allocated when a
+  // device is removed and re-added, so this can be used to detect replaced
+  // entries which have the same name.
+  uint64_t inode = 0;
+};
+
+// Optional filters for limiting which entries a DirectoryIterator produces.
+struct DirectoryEntryFilter {
+  // If set, only entries of this type are produced. Filesystems which do not
+  // report entry types in their listings will have the type looked up.
+  absl::optional<DirectoryEntryType> type;
+  // Only entries whose name starts with this prefix are produced.
+  std::string prefix;
+};
+
+// Streaming iterator over the entries in a directory. The entries are read in
+// bulk from the kernel into a single buffer which is reused for the lifetime of
+// the iterator, so iterating over a directory does not allocate per entry. The
+// pseudo-entries "." and ".." are never produced. Typical usage:
+//
+//   auto maybe_iter = DirectoryIterator::Open("/sys/bus/pci/devices");
+//   if (!maybe_iter.ok()) return maybe_iter.status();
+//   DirectoryEntry entry;
+//   while (maybe_iter->Next(&entry)) {
+//     ... do something with entry.name ...
+//   }
+//   if (!maybe_iter->status().ok()) return maybe_iter->status();
+class DirectoryIterator {
+ public:
+  // Open the given directory for iteration. Returns a NotFound error if the
+  // directory does not exist.
+  static absl::StatusOr<DirectoryIterator> Open(
+      absl::string_view dirname, DirectoryEntryFilter filter = {});
+
+  // Iterators own a file descriptor, so they can be moved but not copied.
+  DirectoryIterator(const DirectoryIterator &other) = delete;
+  DirectoryIterator &operator=(const DirectoryIterator &other) = delete;
+  DirectoryIterator(DirectoryIterator &&other);
+  DirectoryIterator &operator=(DirectoryIterator &&other);
+
+  ~DirectoryIterator();
+
+  // Advance to the next entry in the directory and store it in entry. Returns
+  // false when there are no more entries, or if an error occurred. The status
+  // function can be used to tell the two cases apart.
+  bool Next(DirectoryEntry *entry);
+
+  // The error encountered during iteration, if any.
+  const absl::Status &status() const { return status_; }
+
+ private:
+  DirectoryIterator(int fd, std::string dirname, DirectoryEntryFilter filter);
+
+  // Refill the buffer with more entries. Returns false if there are no more
+  // entries or an error occurred.
+  bool Fill();
+
+  int fd_;
+  std::string dirname_;
+  DirectoryEntryFilter filter_;
+  absl::Status status_;
+
+  // Buffer holding the entries most recently read from the kernel, and the
+  // range of it which has been filled in and not yet consumed.
+  std::vector<char> buffer_;
+  size_t buffer_offset_ = 0;
+  size_t buffer_size_ = 0;
+};
+
 // Iterates over a list of all filenames in directory, invoking output_func with
 // each filename. The filename will be passed as a string_view whose underlying
-// buffer will be released at the end of the WithEachFileInDirectory call.
+// buffer is only valid until output_func returns.
 //
 // The paths passed to output_func will be directory entries, not full paths
 // (e.g. a file "/tmp/myfile.txt" in dirname "/tmp" will be passed as
-// "myfile.txt"). If no files were found or there are any errors, output_func
-// will not be called.
+// "myfile.txt"). If the directory cannot be opened, output_func will not be
+// called.
 template <typename F>
 absl::Status WithEachFileInDirectory(absl::string_view dirname, F output_func) {
-  // Constants for the names of the pseudo directory entries.
-  static constexpr absl::string_view kCurrentDir = ".";
-  static constexpr absl::string_view kParentDir = "..";
-
-  class ScandirCloser {
-   public:
-    ScandirCloser(struct dirent **namelist, int n)
-        : namelist_(namelist), n_(n) {}
-    ~ScandirCloser() {
-      int i = n_;
-      while (i--) free(namelist_[i]);
-      free(namelist_);
-    }
-
-   private:
-    struct dirent **namelist_;
-    int n_;
-  };
-
-  struct dirent **namelist;
-  std::string c_dirname(dirname);  // Needed to get a NUL terminator.
-  if (int n = scandir(c_dirname.c_str(), &namelist, nullptr, nullptr); n >= 0) {
-    ScandirCloser closer(namelist, n);
-    while (n--) {
-      absl::string_view directory_entry = namelist[n]->d_name;
-      // Skip the entries which don't correspond to real entries.
-      if (directory_entry == kCurrentDir || directory_entry == kParentDir) {
-        continue;
-      }
-      // Call the provided output function with the name.
-      output_func(directory_entry);
-    }
-    return absl::OkStatus();
-  } else {
-    return absl::InternalError(
-        absl::StrFormat("scandir() failed on directory %s", dirname));
+  auto maybe_iter = DirectoryIterator::Open(dirname);
+  if (!maybe_iter.ok()) return maybe_iter.status();
+  DirectoryEntry entry;
+  while (maybe_iter->Next(&entry)) {
+    output_func(entry.name);
   }
+  return maybe_iter->status();
 }
 
 }  // namespace ecclesia
@@ -16,9 +16,12 @@
 
 #include "ecclesia/lib/file/dir.h"
 
+#include <sys/stat.h>
+
 #include <filesystem>
 #include <fstream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "gmock/gmock.h"
@@ -34,8 +37,11 @@ namespace {
 
 namespace fs = std::filesystem;
 
+using ::testing::IsEmpty;
 using ::testing::Not;
+using ::testing::Pair;
 using ::testing::UnorderedElementsAre;
+using ::testing::UnorderedElementsAreArray;
 
 // Sets up a temporary directory in the test directory in order to ensure no
 // filesystem state is passed on from test to test.
@@ -143,6 +149,19 @@ TEST_F(DirTest, WithEachFileTwoFiles) {
               UnorderedElementsAre("file1", "file2"));
 }
 
+TEST_F(DirTest, WithEachFileManyFiles) {
+  // Create enough files that reading them requires multiple buffer refills.
+  std::vector<std::string> expected;
+  for (int i = 0; i < 2000; ++i) {
+    std::string name = absl::StrCat("file_with_a_long_name_", i);
+    std::ofstream touch(fs::path(TestDirName()) / name);
+    expected.push_back(std::move(name));
+  }
+
+  EXPECT_THAT(WithEachFileInDirectoryVector(TestDirName()),
+              UnorderedElementsAreArray(expected));
+}
+
 TEST_F(DirTest, WithEachFileSubdirectoriesListed) {
   fs::path subdir = fs::path(TestDirName()) / "subdir";
   fs::create_directories(subdir);
@@ -152,5 +171,103 @@ TEST_F(DirTest, WithEachFileSubdirectoriesListed) {
               UnorderedElementsAre("subdir"));
 }
 
+class DirectoryIteratorTest : public ::testing::Test {
+ protected:
+  DirectoryIteratorTest() : fs_(GetTestTempdirPath()) {
+    fs_.CreateDir("/devices/0000:00:00.0");
+    fs_.CreateDir("/devices/0000:00:01.0");
+    fs_.CreateFile("/devices/uevent", "");
+    fs_.CreateFile("/devices/power", "");
+    fs_.CreateSymlink("0000:00:01.0", "/devices/0000:01:00.0");
+  }
+
+  // Collect all of the entries produced by an iterator into name, type pairs.
+  std::vector<std::pair<std::string, DirectoryEntryType>> ReadAll(
+      DirectoryEntryFilter filter) {
+    std::vector<std::pair<std::string, DirectoryEntryType>> entries;
+    auto maybe_iter =
+        DirectoryIterator::Open(fs_.GetTruePath("/devices"), filter);
+    EXPECT_THAT(maybe_iter, IsOk());
+    if (!maybe_iter.ok()) return entries;
+    DirectoryEntry entry;
+    while (maybe_iter->Next(&entry)) {
+      entries.emplace_back(entry.name, entry.type);
+    }
+    EXPECT_THAT(maybe_iter->status(), IsOk());
+    // Once finished, the iterator should stay finished.
+    EXPECT_FALSE(maybe_iter->Next(&entry));
+    return entries;
+  }
+
+  TestFilesystem fs_;
+};
+
+TEST_F(DirectoryIteratorTest, AllEntries) {
+  EXPECT_THAT(ReadAll({}),
+              UnorderedElementsAre(
+                  Pair("0000:00:00.0", DirectoryEntryType::kDirectory),
+                  Pair("0000:00:01.0", DirectoryEntryType::kDirectory),
+                  Pair("0000:01:00.0", DirectoryEntryType::kSymlink),
+                  Pair("uevent", DirectoryEntryType::kFile),
+                  Pair("power", DirectoryEntryType::kFile)));
+}
+
+TEST_F(DirectoryIteratorTest, FilterByType) {
+  EXPECT_THAT(ReadAll({.type = DirectoryEntryType::kDirectory}),
+              UnorderedElementsAre(
+                  Pair("0000:00:00.0", DirectoryEntryType::kDirectory),
+                  Pair("0000:00:01.0", DirectoryEntryType::kDirectory)));
+  EXPECT_THAT(ReadAll({.type = DirectoryEntryType::kSymlink}),
+              UnorderedElementsAre(
+                  Pair("0000:01:00.0", DirectoryEntryType::kSymlink)));
+}
+
+TEST_F(DirectoryIteratorTest, FilterByPrefix) {
+  EXPECT_THAT(ReadAll({.prefix = "0000:00:"}),
+              UnorderedElementsAre(
+                  Pair("0000:00:00.0", DirectoryEntryType::kDirectory),
+                  Pair("0000:00:01.0", DirectoryEntryType::kDirectory)));
+  EXPECT_THAT(
+      ReadAll({.type = DirectoryEntryType::kFile, .prefix = "0000"}),
+      IsEmpty());
+}
+
+TEST_F(DirectoryIteratorTest, EntriesHaveInodes) {
+  auto maybe_iter = DirectoryIterator::Open(fs_.GetTruePath("/devices"));
+  ASSERT_THAT(maybe_iter, IsOk());
+
+  DirectoryEntry entry;
+  while (maybe_iter->Next(&entry)) {
+    struct stat st;
+    std::string path = fs_.GetTruePath(absl::StrCat("/devices/", entry.name));
+    ASSERT_EQ(lstat(path.c_str(), &st), 0);
+    EXPECT_EQ(entry.inode, st.st_ino) << entry.name;
+  }
+  EXPECT_THAT(maybe_iter->status(), IsOk());
+}
+
+TEST_F(DirectoryIteratorTest, OpenFailures) {
+  EXPECT_TRUE(absl::IsNotFound(
+      DirectoryIterator::Open(fs_.GetTruePath("/missing")).status()));
+  EXPECT_THAT(DirectoryIterator::Open(fs_.GetTruePath("/devices/uevent")),
+              Not(IsOk()));
+}
+
+TEST_F(DirectoryIteratorTest, MovedIteratorContinues) {
+  auto maybe_iter = DirectoryIterator::Open(fs_.GetTruePath("/devices"));
+  ASSERT_THAT(maybe_iter, IsOk());
+
+  std::vector<std::string> names;
+  DirectoryEntry entry;
+  ASSERT_TRUE(maybe_iter->Next(&entry));
+  names.emplace_back(entry.name);
+
+  DirectoryIterator iter = std::move(*maybe_iter);
+  while (iter.Next(&entry)) names.emplace_back(entry.name);
+  EXPECT_THAT(iter.status(), IsOk());
+  EXPECT_THAT(names, UnorderedElementsAre("0000:00:00.0", "0000:00:01.0",
+                                          "0000:01:00.0", "uevent", "power"));
+}
+
 }  // namespace
 }  // namespace ecclesia
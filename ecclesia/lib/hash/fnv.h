@@ -0,0 +1,51 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Implementation of the 64-bit FNV-1a hash. This is a simple non-cryptographic
+// hash which, unlike absl::Hash, produces the same value for the same input in
+// every process. That makes it suitable for fingerprints which are saved or
+// handed out to clients, such as cache keys and ETags.
+
+#ifndef ECCLESIA_LIB_HASH_FNV_H_
+#define ECCLESIA_LIB_HASH_FNV_H_
+
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+
+namespace ecclesia {
+
+inline constexpr uint64_t kFnv64OffsetBasis = 0xcbf29ce484222325;
+inline constexpr uint64_t kFnv64Prime = 0x100000001b3;
+
+// Compute the 64-bit FNV-1a hash of the given bytes.
+inline uint64_t Fnv1a64(absl::Span<const uint8_t> data) {
+  uint64_t hash = kFnv64OffsetBasis;
+  for (uint8_t byte : data) {
+    hash ^= byte;
+    hash *= kFnv64Prime;
+  }
+  return hash;
+}
+inline uint64_t Fnv1a64(absl::string_view data) {
+  return Fnv1a64(absl::MakeConstSpan(
+      reinterpret_cast<const uint8_t *>(data.data()), data.size()));
+}
+
+}  // namespace ecclesia
+
+#endif  // ECCLESIA_LIB_HASH_FNV_H_
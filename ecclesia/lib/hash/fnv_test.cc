@@ -0,0 +1,42 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/lib/hash/fnv.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+
+namespace ecclesia {
+namespace {
+
+TEST(Fnv1a64Test, KnownValues) {
+  // Reference values from the FNV test suite.
+  EXPECT_EQ(Fnv1a64(""), 0xcbf29ce484222325);
+  EXPECT_EQ(Fnv1a64("a"), 0xaf63dc4c8601ec8c);
+  EXPECT_EQ(Fnv1a64("foobar"), 0x85944171f73967e8);
+}
+
+TEST(Fnv1a64Test, BytesAndStringsAgree) {
+  std::vector<uint8_t> bytes = {'f', 'o', 'o', 'b', 'a', 'r', 0x80, 0xff};
+  EXPECT_EQ(Fnv1a64(bytes), Fnv1a64(absl::string_view("foobar\x80\xff", 8)));
+}
+
+}  // namespace
+}  // namespace ecclesia
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/lib/io/msr_batch.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "ecclesia/lib/codec/endian.h"
+
+namespace ecclesia {
+namespace {
+
+constexpr char kDevCpuDir[] = "/dev/cpu";
+
+}  // namespace
+
+MsrBatch::MsrBatch() : MsrBatch(kDevCpuDir) {}
+
+MsrBatch::MsrBatch(std::string dev_cpu_dir, int max_parallelism)
+    : dev_cpu_dir_(std::move(dev_cpu_dir)),
+      max_parallelism_(std::max(max_parallelism, 1)) {}
+
+MsrBatch::~MsrBatch() {
+  std::vector<std::thread> workers;
+  {
+    absl::MutexLock ml(&work_mutex_);
+    for (size_t i = 0; i < workers_.size(); ++i) {
+      work_.push(nullptr);
+    }
+    workers = std::move(workers_);
+  }
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+
+  absl::MutexLock ml(&fds_mutex_);
+  for (const auto &[cpu, fd] : fds_) {
+    close(fd);
+  }
+}
+
+absl::StatusOr<int> MsrBatch::GetFd(int cpu) {
+  absl::MutexLock ml(&fds_mutex_);
+  if (auto iter = fds_.find(cpu); iter != fds_.end()) {
+    return iter->second;
+  }
+  std::string path = absl::StrFormat("%s/%d/msr", dev_cpu_dir_, cpu);
+  // Prefer a descriptor that can also be used for writes, but fall back to a
+  // read-only one if that is all we're allowed.
+  int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+  if (fd < 0 && (errno == EACCES || errno == EPERM || errno == EROFS)) {
+    fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  }
+  if (fd < 0) {
+    if (errno == ENOENT) {
+      return absl::NotFoundError(
+          absl::StrFormat("msr device not found at path: %s", path));
+    }
+    return absl::InternalError(absl::StrFormat(
+        "unable to open msr device at path: %s, errno: %d", path, errno));
+  }
+  fds_.emplace(cpu, fd);
+  return fd;
+}
+
+absl::StatusOr<uint64_t> MsrBatch::Read(int cpu, uint64_t reg) {
+  absl::StatusOr<int> maybe_fd = GetFd(cpu);
+  if (!maybe_fd.ok()) return maybe_fd.status();
+
+  char buffer[sizeof(uint64_t)];
+  ssize_t rlen;
+  do {
+    rlen = pread(*maybe_fd, buffer, sizeof(buffer), reg);
+  } while (rlen < 0 && errno == EINTR);
+  if (rlen != sizeof(buffer)) {
+    return absl::InternalError(absl::StrFormat(
+        "failed to read msr %#x on cpu %d, rlen: %d", reg, cpu, rlen));
+  }
+  return LittleEndian::Load64(buffer);
+}
+
+absl::Status MsrBatch::Write(int cpu, uint64_t reg, uint64_t value) {
+  absl::StatusOr<int> maybe_fd = GetFd(cpu);
+  if (!maybe_fd.ok()) return maybe_fd.status();
+
+  char buffer[sizeof(uint64_t)];
+  LittleEndian::Store64(value, buffer);
+  ssize_t wlen;
+  do {
+    wlen = pwrite(*maybe_fd, buffer, sizeof(buffer), reg);
+  } while (wlen < 0 && errno == EINTR);
+  if (wlen != sizeof(buffer)) {
+    return absl::InternalError(absl::StrFormat(
+        "failed to write msr %#x on cpu %d, wlen: %d", reg, cpu, wlen));
+  }
+  return absl::OkStatus();
+}
+
+std::vector<absl::StatusOr<uint64_t>> MsrBatch::ReadAll(
+    absl::Span<const Request> requests) {
+  std::vector<absl::StatusOr<uint64_t>> results(
+      requests.size(), absl::UnknownError("msr read was not performed"));
+
+  // Group the requests by CPU, preserving the order of requests within each
+  // group. Each group is then processed by a single thread.
+  std::vector<std::vector<size_t>> groups;
+  absl::flat_hash_map<int, size_t> group_index;
+  for (size_t i = 0; i < requests.size(); ++i) {
+    auto [iter, inserted] =
+        group_index.try_emplace(requests[i].cpu, groups.size());
+    if (inserted) groups.emplace_back();
+    groups[iter->second].push_back(i);
+  }
+
+  std::atomic<size_t> next_group = 0;
+  auto worker = [&]() {
+    for (size_t g = next_group++; g < groups.size(); g = next_group++) {
+      for (size_t i : groups[g]) {
+        results[i] = Read(requests[i].cpu, requests[i].reg);
+      }
+    }
+  };
+
+  // Make sure all of the descriptors are opened before handing out work so
+  // that the workers don't all contend on the descriptor table.
+  for (const std::vector<size_t> &group : groups) {
+    GetFd(requests[group.front()].cpu).IgnoreError();
+  }
+
+  // The calling thread acts as one of the workers, and waits for the others
+  // to finish before returning since they refer to its local state.
+  size_t num_threads = std::min<size_t>(groups.size(), max_parallelism_);
+  if (num_threads > 1) {
+    size_t num_workers = num_threads - 1;
+    absl::BlockingCounter workers_done(num_workers);
+    RunOnWorkers(num_workers, [&]() {
+      worker();
+      workers_done.DecrementCount();
+    });
+    worker();
+    workers_done.Wait();
+  } else {
+    worker();
+  }
+  return results;
+}
+
+void MsrBatch::RunOnWorkers(size_t num_workers,
+                            const std::function<void()> &func) {
+  absl::MutexLock ml(&work_mutex_);
+  while (workers_.size() < num_workers) {
+    workers_.emplace_back(&MsrBatch::WorkerLoop, this);
+  }
+  for (size_t i = 0; i < num_workers; ++i) {
+    work_.push(func);
+  }
+}
+
+bool MsrBatch::WorkAvailable() const { return !work_.empty(); }
+
+void MsrBatch::WorkerLoop() {
+  while (true) {
+    std::function<void()> func;
+    {
+      absl::MutexLock ml(&work_mutex_);
+      work_mutex_.Await(absl::Condition(this, &MsrBatch::WorkAvailable));
+      func = std::move(work_.front());
+      work_.pop();
+    }
+    if (func == nullptr) return;
+    func();
+  }
+}
+
+}  // namespace ecclesia
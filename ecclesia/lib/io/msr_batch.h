@@ -0,0 +1,106 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This library provides support for reading Model Specific Registers on many
+// logical CPUs at once. Unlike the Msr class, which opens the msr device for
+// every access, this keeps one open file descriptor per logical CPU and does
+// all of its accesses with pread/pwrite.
+//
+// Because an MSR access has to be executed on the target CPU, accesses to
+// different CPUs can proceed independently. The ReadAll function takes
+// advantage of this to do the reads for multiple CPUs in parallel, using worker
+// threads which are started on first use and kept for the lifetime of the
+// object.
+
+#ifndef ECCLESIA_LIB_IO_MSR_BATCH_H_
+#define ECCLESIA_LIB_IO_MSR_BATCH_H_
+
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+
+namespace ecclesia {
+
+class MsrBatch {
+ public:
+  // A single register on a single logical CPU.
+  struct Request {
+    int cpu;
+    uint64_t reg;
+  };
+
+  // Construct an object for accessing the msr devices under /dev/cpu.
+  MsrBatch();
+
+  // This constructor allows a customized directory that contains the N/msr
+  // devices, mostly for testing purpose. The maximum number of CPUs that will
+  // be read from in parallel by ReadAll can also be specified.
+  explicit MsrBatch(std::string dev_cpu_dir, int max_parallelism = 16);
+
+  // The object owns file descriptors and threads so it cannot be copied.
+  MsrBatch(const MsrBatch &other) = delete;
+  MsrBatch &operator=(const MsrBatch &other) = delete;
+
+  ~MsrBatch();
+
+  // Read and write a single register on a single CPU.
+  absl::StatusOr<uint64_t> Read(int cpu, uint64_t reg);
+  absl::Status Write(int cpu, uint64_t reg, uint64_t value);
+
+  // Read all of the requested registers. The results are returned in the same
+  // order as the requests. Requests for the same CPU are done in order, on the
+  // same thread; requests for different CPUs are done in parallel.
+  std::vector<absl::StatusOr<uint64_t>> ReadAll(
+      absl::Span<const Request> requests);
+
+ private:
+  // Get the file descriptor for the given CPU, opening it if necessary.
+  absl::StatusOr<int> GetFd(int cpu);
+
+  // Run func on num_workers of the worker threads, starting more of them if
+  // there are not enough yet. Returns without waiting for func to finish.
+  void RunOnWorkers(size_t num_workers, const std::function<void()> &func);
+
+  // Check for queued work, and the loop run by each of the worker threads.
+  bool WorkAvailable() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(work_mutex_);
+  void WorkerLoop();
+
+  const std::string dev_cpu_dir_;
+  const int max_parallelism_;
+
+  // Work waiting to be picked up by the worker threads. A null function tells
+  // a worker to exit.
+  absl::Mutex work_mutex_;
+  std::queue<std::function<void()>> work_ ABSL_GUARDED_BY(work_mutex_);
+  std::vector<std::thread> workers_ ABSL_GUARDED_BY(work_mutex_);
+
+  absl::Mutex fds_mutex_;
+  absl::flat_hash_map<int, int> fds_ ABSL_GUARDED_BY(fds_mutex_);
+};
+
+}  // namespace ecclesia
+
+#endif  // ECCLESIA_LIB_IO_MSR_BATCH_H_
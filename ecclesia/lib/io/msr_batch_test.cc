@@ -0,0 +1,151 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/lib/io/msr_batch.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "ecclesia/lib/file/dir.h"
+#include "ecclesia/lib/file/test_filesystem.h"
+#include "ecclesia/lib/testing/status.h"
+
+namespace ecclesia {
+namespace {
+
+using ::testing::Not;
+
+class MsrBatchTest : public ::testing::Test {
+ protected:
+  MsrBatchTest() : fs_(GetTestTempdirPath()) {
+    // Each fake msr device has every byte set to the CPU number, so that the
+    // value read at any offset identifies which device it came from.
+    for (int cpu = 0; cpu < kNumCpus; ++cpu) {
+      fs_.CreateDir(absl::StrCat("/dev/cpu/", cpu));
+      fs_.CreateFile(absl::StrCat("/dev/cpu/", cpu, "/msr"),
+                     std::string(32, static_cast<char>(cpu + 1)));
+    }
+  }
+
+  // The expected value of any fully in-range read from the given CPU.
+  static uint64_t ExpectedValue(int cpu) {
+    return 0x0101010101010101 * (cpu + 1);
+  }
+
+  // The number of threads in the current process.
+  static int CountThreads() {
+    int count = 0;
+    WithEachFileInDirectory("/proc/self/task",
+                            [&count](absl::string_view) { ++count; })
+        .IgnoreError();
+    return count;
+  }
+
+  static constexpr int kNumCpus = 8;
+
+  TestFilesystem fs_;
+};
+
+TEST_F(MsrBatchTest, ReadWriteSingle) {
+  MsrBatch batch(fs_.GetTruePath("/dev/cpu"));
+
+  EXPECT_THAT(batch.Read(3, 0), IsOkAndHolds(ExpectedValue(3)));
+  EXPECT_THAT(batch.Write(3, 8, 0xdeadbeefdeadbeef), IsOk());
+  EXPECT_THAT(batch.Read(3, 8), IsOkAndHolds(0xdeadbeefdeadbeef));
+  // The other devices should be unaffected.
+  EXPECT_THAT(batch.Read(2, 8), IsOkAndHolds(ExpectedValue(2)));
+}
+
+TEST_F(MsrBatchTest, ReadFailures) {
+  MsrBatch batch(fs_.GetTruePath("/dev/cpu"));
+
+  EXPECT_TRUE(absl::IsNotFound(batch.Read(kNumCpus, 0).status()));
+  EXPECT_THAT(batch.Read(0, 28), Not(IsOk()));
+  EXPECT_THAT(batch.Write(kNumCpus, 0, 0), Not(IsOk()));
+}
+
+TEST_F(MsrBatchTest, DescriptorsStayOpen) {
+  MsrBatch batch(fs_.GetTruePath("/dev/cpu"));
+  EXPECT_THAT(batch.Read(1, 0), IsOkAndHolds(ExpectedValue(1)));
+
+  // Once opened, the device is accessed through the existing descriptor, so
+  // removing the path doesn't stop reads from working.
+  fs_.RemoveAllContents();
+  EXPECT_THAT(batch.Read(1, 0), IsOkAndHolds(ExpectedValue(1)));
+  EXPECT_THAT(batch.Read(2, 0), Not(IsOk()));
+}
+
+TEST_F(MsrBatchTest, ReadAllReturnsResultsInOrder) {
+  MsrBatch batch(fs_.GetTruePath("/dev/cpu"), /*max_parallelism=*/3);
+  ASSERT_THAT(batch.Write(5, 16, 0x1234), IsOk());
+
+  std::vector<MsrBatch::Request> requests;
+  for (int cpu = kNumCpus - 1; cpu >= 0; --cpu) {
+    requests.push_back({.cpu = cpu, .reg = 0});
+    requests.push_back({.cpu = cpu, .reg = 16});
+  }
+  requests.push_back({.cpu = kNumCpus, .reg = 0});
+  requests.push_back({.cpu = 0, .reg = 30});
+
+  std::vector<absl::StatusOr<uint64_t>> results = batch.ReadAll(requests);
+  ASSERT_EQ(results.size(), requests.size());
+  for (int i = 0; i < kNumCpus * 2; ++i) {
+    int cpu = requests[i].cpu;
+    if (cpu == 5 && requests[i].reg == 16) {
+      EXPECT_THAT(results[i], IsOkAndHolds(0x1234));
+    } else {
+      EXPECT_THAT(results[i], IsOkAndHolds(ExpectedValue(cpu)));
+    }
+  }
+  EXPECT_THAT(results[kNumCpus * 2], Not(IsOk()));
+  EXPECT_THAT(results[kNumCpus * 2 + 1], Not(IsOk()));
+}
+
+TEST_F(MsrBatchTest, ReadAllReusesWorkerThreads) {
+  MsrBatch batch(fs_.GetTruePath("/dev/cpu"), /*max_parallelism=*/4);
+  std::vector<MsrBatch::Request> requests;
+  for (int cpu = 0; cpu < kNumCpus; ++cpu) {
+    requests.push_back({.cpu = cpu, .reg = 0});
+  }
+
+  // The first batch starts the workers, after which repeated batches should
+  // not start any more threads.
+  batch.ReadAll(requests);
+  int num_threads = CountThreads();
+  for (int i = 0; i < 10; ++i) {
+    std::vector<absl::StatusOr<uint64_t>> results = batch.ReadAll(requests);
+    ASSERT_EQ(results.size(), requests.size());
+    for (int cpu = 0; cpu < kNumCpus; ++cpu) {
+      EXPECT_THAT(results[cpu], IsOkAndHolds(ExpectedValue(cpu)));
+    }
+  }
+  EXPECT_EQ(CountThreads(), num_threads);
+}
+
+TEST_F(MsrBatchTest, ReadAllWithNoRequests) {
+  MsrBatch batch(fs_.GetTruePath("/dev/cpu"));
+  EXPECT_TRUE(batch.ReadAll({}).empty());
+}
+
+}  // namespace
+}  // namespace ecclesia
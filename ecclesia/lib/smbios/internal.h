@@ -27,6 +27,7 @@
 
 #include "absl/memory/memory.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "ecclesia/lib/logging/logging.h"
 #include "ecclesia/lib/smbios/structures.emb.h"
 
@@ -34,8 +35,8 @@ namespace ecclesia {
 
 // Information regarding a SMBIOS structure in memory
 struct SmbiosStructureInfo {
-  uint8_t* formatted_data_start;
-  uint8_t* unformed_data_start;
+  const uint8_t* formatted_data_start;
+  const uint8_t* unformed_data_start;
   std::size_t structure_size;
 };
 
@@ -43,23 +44,26 @@ struct SmbiosStructureInfo {
 class TableEntry {
  public:
   // The constructor takes a reference to the SmbiosStructureInfo that has
-  // pointers to the different sections of an SMBIOS table entry
-  TableEntry(const SmbiosStructureInfo& info) {
-    data_ = std::vector(info.formatted_data_start, info.unformed_data_start);
+  // pointers to the different sections of an SMBIOS table entry. The entry
+  // does not copy the structure: the memory referenced by info must outlive
+  // the entry. The offsets of the character strings in the unformed section
+  // are located once here so that GetString does not need to search for them.
+  TableEntry(const SmbiosStructureInfo& info)
+      : data_(info.formatted_data_start,
+              info.unformed_data_start - info.formatted_data_start) {
     // Extract the list of character strings from the unformed section
-    char* start = reinterpret_cast<char*>(info.unformed_data_start);
+    const char* start = reinterpret_cast<const char*>(info.unformed_data_start);
     while (*start != '\0') {
       strings_.emplace_back(start);
-      // Move to the next character string
-      // Since std::string constructed from a char* doesn't include the
-      // terminating null char, add 1 to size
+      // Move to the next character string, skipping over the terminating null
+      // character of the current one.
       start += strings_.back().size() + 1;
     }
   }
 
-  // Need to allow move since the table entries are stored in a vector.
-  // Note that any previously obtained view objects should still be valid, since
-  // the underlaying storage is std::vector<>.
+  // Need to allow move since the table entries are stored in a vector. Note
+  // that any previously obtained view objects should still be valid, since
+  // they refer to the underlying table and not to the entry.
   TableEntry(const TableEntry&) = delete;
   TableEntry& operator=(const TableEntry&) = delete;
   TableEntry(TableEntry&&) = default;
@@ -84,8 +88,8 @@ class TableEntry {
   }
 
  private:
-  std::vector<uint8_t> data_;  // Formatted data
-  std::vector<std::string> strings_;
+  absl::Span<const uint8_t> data_;  // Formatted data
+  std::vector<absl::string_view> strings_;
 };
 
 }  // namespace ecclesia
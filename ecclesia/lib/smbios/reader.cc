@@ -16,6 +16,8 @@
 
 #include "ecclesia/lib/smbios/reader.h"
 
+#include <sys/stat.h>
+
 #include <algorithm>
 #include <cstddef>
 #include <cstdint>
@@ -24,9 +26,14 @@
 #include <memory>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 #include "absl/memory/memory.h"
+#include "absl/status/statusor.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "ecclesia/lib/file/mmap.h"
 #include "ecclesia/lib/logging/logging.h"
 #include "ecclesia/lib/smbios/bios.h"
 #include "ecclesia/lib/smbios/entry_point.emb.h"
@@ -67,6 +74,36 @@ std::vector<uint8_t> GetBinaryFileContents(const std::string &file_path,
   return contents;
 }
 
+// Load the SMBIOS structure table, returning a span covering its contents. The
+// table is memory mapped if possible and the mapping is saved in `mapping`.
+// Not every kernel supports mapping the sysfs DMI table, in which case the
+// contents are instead read into `copy`.
+absl::Span<const uint8_t> LoadStructureTable(
+    const std::string &file_path, std::size_t max_size,
+    absl::optional<MappedMemory> *mapping, std::vector<uint8_t> *copy) {
+  struct stat st;
+  if (stat(file_path.c_str(), &st) != 0) {
+    ErrorLog() << "failed to stat file " << file_path;
+    return absl::Span<const uint8_t>();
+  }
+  std::size_t size = st.st_size;
+  if (size > max_size) {
+    ErrorLog() << "file " << file_path << " is larger than the maximum "
+               << "structure table size of " << max_size;
+    return absl::Span<const uint8_t>();
+  }
+  if (size > 0) {
+    absl::StatusOr<MappedMemory> maybe_mapping = MappedMemory::Create(
+        file_path, 0, size, MappedMemory::Type::kReadOnly);
+    if (maybe_mapping.ok()) {
+      mapping->emplace(std::move(*maybe_mapping));
+      return (*mapping)->MemoryAsReadOnlySpan<uint8_t>();
+    }
+  }
+  *copy = GetBinaryFileContents(file_path, max_size);
+  return *copy;
+}
+
 // The data array includes the checksum. 8-bit addition of all the bytes should
 // be equal to zero.
 template <typename View>
@@ -82,8 +119,8 @@ inline bool VerifyChecksum(View message_view) {
 }
 
 // Extract the information for a single SMBIOS structure into `info`
-bool ExtractSmbiosStructure(uint8_t *start_address, std::size_t max_length,
-                            SmbiosStructureInfo *info) {
+bool ExtractSmbiosStructure(const uint8_t *start_address,
+                            std::size_t max_length, SmbiosStructureInfo *info) {
   auto smbios_structure_view =
       MakeSmbiosStructureView(start_address, max_length);
 
@@ -137,44 +174,53 @@ SmbiosReader::SmbiosReader(std::string entry_point_path,
           : entry_point_view.entry_point_64bit()
                 .structure_table_max_size()
                 .Read();
-  // Read the SMBIOS tables
-  std::vector<uint8_t> table_data =
-      GetBinaryFileContents(tables_path, structure_table_max_size);
+  // Load the SMBIOS tables
+  table_ = LoadStructureTable(tables_path, structure_table_max_size,
+                              &table_mapping_, &table_copy_);
+  absl::Span<const uint8_t> table = table_;
 
-  // Start extracting the SMBIOS structures one by one
-  uint8_t *start_address = table_data.data();
-  const uint8_t *end_address = start_address + table_data.size() - 1;
-
-  while (start_address <= end_address) {
-    std::size_t max_length = end_address - start_address + 1;
+  // Start extracting the SMBIOS structures one by one, indexing them by type
+  std::size_t offset = 0;
+  while (offset < table.size()) {
     SmbiosStructureInfo info;
-    if (!ExtractSmbiosStructure(start_address, max_length, &info)) {
+    if (!ExtractSmbiosStructure(table.data() + offset, table.size() - offset,
+                                &info)) {
       ErrorLog() << "Error extracting SMBIOS structure";
       return;
     }
-    entries_.emplace_back(info);
-    start_address += info.structure_size;
+    const TableEntry &entry = entries_.emplace_back(info);
+    uint8_t type = static_cast<uint8_t>(
+        entry.GetSmbiosStructureView().structure_type().Read());
+    entries_by_type_[type].push_back(entries_.size() - 1);
+    offset += info.structure_size;
   }
 }
 
-std::unique_ptr<BiosInformation> SmbiosReader::GetBiosInformation() const {
-  for (auto &entry : entries_) {
-    if (entry.GetSmbiosStructureView().structure_type().Read() ==
-        StructureType::BIOS_INFORMATION) {
-      return absl::make_unique<BiosInformation>(&entry);
-    }
+std::vector<const TableEntry *> SmbiosReader::GetEntriesOfType(
+    StructureType type) const {
+  std::vector<const TableEntry *> entries;
+  auto iter = entries_by_type_.find(static_cast<uint8_t>(type));
+  if (iter == entries_by_type_.end()) return entries;
+  entries.reserve(iter->second.size());
+  for (std::size_t index : iter->second) {
+    entries.push_back(&entries_[index]);
   }
-  return nullptr;
+  return entries;
+}
+
+std::unique_ptr<BiosInformation> SmbiosReader::GetBiosInformation() const {
+  std::vector<const TableEntry *> entries =
+      GetEntriesOfType(StructureType::BIOS_INFORMATION);
+  if (entries.empty()) return nullptr;
+  return absl::make_unique<BiosInformation>(entries.front());
 }
 
 std::vector<MemoryDevice> SmbiosReader::GetAllMemoryDevices() const {
   std::vector<MemoryDevice> memory_devices;
 
-  for (auto &entry : entries_) {
-    if (entry.GetSmbiosStructureView().structure_type().Read() ==
-        StructureType::MEMORY_DEVICE) {
-      memory_devices.emplace_back(&entry);
-    }
+  for (const TableEntry *entry :
+       GetEntriesOfType(StructureType::MEMORY_DEVICE)) {
+    memory_devices.emplace_back(entry);
   }
   // Sort the memory devices based on the device locator string
   std::sort(memory_devices.begin(), memory_devices.end(), [](auto &x, auto &y) {
@@ -185,23 +231,18 @@ std::vector<MemoryDevice> SmbiosReader::GetAllMemoryDevices() const {
 }
 
 std::unique_ptr<SystemEventLog> SmbiosReader::GetSystemEventLog() const {
-  for (auto &entry : entries_) {
-    if (entry.GetSmbiosStructureView().structure_type().Read() ==
-        StructureType::SYSTEM_EVENT_LOG) {
-      return absl::make_unique<SystemEventLog>(&entry);
-    }
-  }
-  return nullptr;
+  std::vector<const TableEntry *> entries =
+      GetEntriesOfType(StructureType::SYSTEM_EVENT_LOG);
+  if (entries.empty()) return nullptr;
+  return absl::make_unique<SystemEventLog>(entries.front());
 }
 
 std::vector<ProcessorInformation> SmbiosReader::GetAllProcessors() const {
   std::vector<ProcessorInformation> processor_information;
 
-  for (auto &entry : entries_) {
-    if (entry.GetSmbiosStructureView().structure_type().Read() ==
-        StructureType::PROCESSOR_INFORMATION) {
-      processor_information.emplace_back(&entry);
-    }
+  for (const TableEntry *entry :
+       GetEntriesOfType(StructureType::PROCESSOR_INFORMATION)) {
+    processor_information.emplace_back(entry);
   }
   // Sort the processors based on the socket designation
   std::sort(
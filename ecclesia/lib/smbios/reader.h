@@ -17,14 +17,21 @@
 #ifndef ECCLESIA_LIB_SMBIOS_READER_H_
 #define ECCLESIA_LIB_SMBIOS_READER_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "ecclesia/lib/file/mmap.h"
 #include "ecclesia/lib/smbios/bios.h"
 #include "ecclesia/lib/smbios/internal.h"
 #include "ecclesia/lib/smbios/memory_device.h"
 #include "ecclesia/lib/smbios/processor_information.h"
+#include "ecclesia/lib/smbios/structures.emb.h"
 #include "ecclesia/lib/smbios/system_event_log.h"
 
 namespace ecclesia {
@@ -33,6 +40,11 @@ namespace ecclesia {
 // structure. This can be easily extended to support a 64-bit entry point if
 // needed. The reader should outlive any objects returned by it, since the
 // objects contain TableEntry pointers which are owned by the reader.
+//
+// The structure table is memory mapped where the underlying file supports it
+// and the table entries refer directly into it. All of the structures are
+// indexed by type when the table is parsed so that the lookup functions only
+// visit the structures of the type they are asked for.
 class SmbiosReader {
  public:
   // The constructor takes in path to the entry_point and the smbios tables
@@ -58,8 +70,23 @@ class SmbiosReader {
   // Type 4 (Processor Information)
   std::vector<ProcessorInformation> GetAllProcessors() const;
 
+  // The raw bytes of the structure table, for identifying the table as a
+  // whole without reading it again. Empty if the table could not be loaded.
+  absl::Span<const uint8_t> GetRawTable() const { return table_; }
+
  private:
+  // Returns the entries of the given type, in table order.
+  std::vector<const TableEntry *> GetEntriesOfType(StructureType type) const;
+
+  // The raw bytes of the structure table. This is a mapping of the table file
+  // when it can be mapped, otherwise it is a copy of the file contents.
+  absl::optional<MappedMemory> table_mapping_;
+  std::vector<uint8_t> table_copy_;
+  absl::Span<const uint8_t> table_;
+
   std::vector<TableEntry> entries_;
+  // Indexes into entries_ of all the structures of each type.
+  absl::flat_hash_map<uint8_t, std::vector<std::size_t>> entries_by_type_;
 };
 
 }  // namespace ecclesia
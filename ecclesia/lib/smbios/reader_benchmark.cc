@@ -0,0 +1,159 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks for parsing and querying SMBIOS tables. The tables are built by
+// replicating the structures from the Indus tables in test_data, to simulate
+// machines with many more processors and memory devices.
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "benchmark/benchmark.h"
+#include "ecclesia/lib/codec/endian.h"
+#include "ecclesia/lib/file/test_filesystem.h"
+#include "ecclesia/lib/smbios/bios.h"
+#include "ecclesia/lib/smbios/reader.h"
+#include "ecclesia/lib/smbios/structures.emb.h"
+
+namespace ecclesia {
+namespace {
+
+constexpr absl::string_view kTestDataDir = "lib/smbios/test_data/";
+
+// The type of the end-of-table structure, which must only appear once.
+constexpr uint8_t kEndOfTableType = 127;
+
+// Split the Indus structure table into the individual structures, dropping
+// the end-of-table structure.
+std::vector<std::string> GetTestStructures() {
+  std::ifstream file(
+      GetTestDataDependencyPath(absl::StrCat(kTestDataDir, "DMI")),
+      std::ios::in | std::ios::binary);
+  std::string table((std::istreambuf_iterator<char>(file)),
+                    std::istreambuf_iterator<char>());
+
+  std::vector<std::string> structures;
+  std::size_t offset = 0;
+  while (offset + 4 <= table.size()) {
+    uint8_t type = table[offset];
+    // Skip the formatted section and then search for the double-null at the
+    // end of the strings.
+    uint8_t length = table[offset + 1];
+    std::size_t end = absl::string_view(table).find(
+        absl::string_view("\0\0", 2), offset + length);
+    if (end == absl::string_view::npos) break;
+    end += 2;
+    if (type != kEndOfTableType) {
+      structures.push_back(table.substr(offset, end - offset));
+    }
+    offset = end;
+  }
+  return structures;
+}
+
+// The files containing a synthetic entry point and structure table.
+struct SyntheticTables {
+  std::string entry_point_path;
+  std::string tables_path;
+  std::size_t num_structures;
+};
+
+// Write out an entry point and structure table containing the given number of
+// copies of the Indus structures.
+SyntheticTables CreateSyntheticTables(TestFilesystem &fs, int copies) {
+  static const auto *structures =
+      new std::vector<std::string>(GetTestStructures());
+
+  SyntheticTables tables;
+  std::string table;
+  for (int i = 0; i < copies; ++i) {
+    for (const std::string &structure : *structures) {
+      table.append(structure);
+    }
+  }
+  // End-of-table structure, with an empty string section.
+  table.append({static_cast<char>(kEndOfTableType), 4, 0, 0, '\0', '\0'});
+  tables.num_structures = structures->size() * copies + 1;
+
+  // A 64-bit entry point with just enough information for the reader.
+  std::string entry_point(0x18, '\0');
+  entry_point.replace(0, 5, "_SM3_");
+  entry_point[6] = 0x18;
+  entry_point[7] = 3;
+  LittleEndian::Store32(table.size(), &entry_point[12]);
+  uint8_t sum = 0;
+  for (char c : entry_point) sum += c;
+  entry_point[5] = -sum;
+
+  fs.WriteFile("/smbios_entry_point", entry_point);
+  fs.WriteFile("/DMI", table);
+  tables.entry_point_path = fs.GetTruePath("/smbios_entry_point");
+  tables.tables_path = fs.GetTruePath("/DMI");
+  return tables;
+}
+
+void BM_ReadTables(benchmark::State &state) {
+  TestFilesystem fs(GetTestTempdirPath());
+  SyntheticTables tables = CreateSyntheticTables(fs, state.range(0));
+  for (auto _ : state) {
+    SmbiosReader reader(tables.entry_point_path, tables.tables_path);
+    benchmark::DoNotOptimize(reader);
+  }
+  state.SetItemsProcessed(state.iterations() * tables.num_structures);
+}
+BENCHMARK(BM_ReadTables)->ArgName("copies")->Arg(1)->Arg(16)->Arg(256);
+
+void BM_GetAllMemoryDevices(benchmark::State &state) {
+  TestFilesystem fs(GetTestTempdirPath());
+  SyntheticTables tables = CreateSyntheticTables(fs, state.range(0));
+  SmbiosReader reader(tables.entry_point_path, tables.tables_path);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(reader.GetAllMemoryDevices());
+  }
+}
+BENCHMARK(BM_GetAllMemoryDevices)
+    ->ArgName("copies")
+    ->Arg(1)
+    ->Arg(16)
+    ->Arg(256);
+
+void BM_GetBiosStrings(benchmark::State &state) {
+  TestFilesystem fs(GetTestTempdirPath());
+  SyntheticTables tables = CreateSyntheticTables(fs, 1);
+  SmbiosReader reader(tables.entry_point_path, tables.tables_path);
+  std::unique_ptr<BiosInformation> bios = reader.GetBiosInformation();
+  if (!bios) {
+    state.SkipWithError("no BIOS information structure found");
+    return;
+  }
+  BiosInformationStructureView view = bios->GetMessageView();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(bios->GetString(view.vendor_snum().Read()));
+    benchmark::DoNotOptimize(bios->GetString(view.version_snum().Read()));
+    benchmark::DoNotOptimize(bios->GetString(view.release_date_snum().Read()));
+  }
+}
+BENCHMARK(BM_GetBiosStrings);
+
+}  // namespace
+}  // namespace ecclesia
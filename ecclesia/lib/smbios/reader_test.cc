@@ -16,6 +16,9 @@
 
 #include "ecclesia/lib/smbios/reader.h"
 
+#include <cstdint>
+#include <fstream>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <vector>
@@ -24,6 +27,7 @@
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "ecclesia/lib/file/test_filesystem.h"
 #include "ecclesia/lib/smbios/bios.h"
 #include "ecclesia/lib/smbios/processor_information.h"
@@ -50,9 +54,13 @@ class SmbiosReaderTest : public ::testing::Test {
     std::string table_path =
         GetTestDataDependencyPath(absl::StrCat(kTestDataDir, "DMI"));
     reader_ = absl::make_unique<SmbiosReader>(entry_point_path, table_path);
+    std::ifstream table_file(table_path, std::ios::binary);
+    table_contents_.assign(std::istreambuf_iterator<char>(table_file),
+                           std::istreambuf_iterator<char>());
   }
 
   std::unique_ptr<SmbiosReader> reader_;
+  std::vector<uint8_t> table_contents_;
 };
 
 TEST_F(SmbiosReaderTest, VerifyBiosInformationStructure) {
@@ -146,6 +154,11 @@ TEST_F(SmbiosReaderTest, VerifyProcessorInformationStructure) {
   }
 }
 
+TEST_F(SmbiosReaderTest, RawTableMatchesTableFile) {
+  ASSERT_FALSE(table_contents_.empty());
+  EXPECT_EQ(reader_->GetRawTable(), absl::MakeConstSpan(table_contents_));
+}
+
 }  // namespace
 
 }  // namespace ecclesia
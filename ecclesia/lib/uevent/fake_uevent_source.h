@@ -0,0 +1,87 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A fake implementation of UeventSource for use in tests. Events are queued up
+// by the test and then handed out by Receive.
+
+#ifndef ECCLESIA_LIB_UEVENT_FAKE_UEVENT_SOURCE_H_
+#define ECCLESIA_LIB_UEVENT_FAKE_UEVENT_SOURCE_H_
+
+#include <deque>
+#include <string>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "ecclesia/lib/uevent/uevent.h"
+
+namespace ecclesia {
+
+class FakeUeventSource : public UeventSource {
+ public:
+  FakeUeventSource() {}
+
+  // Queue up an event to be received.
+  void Push(Uevent event) {
+    absl::MutexLock ml(&mutex_);
+    queue_.push_back(std::move(event));
+  }
+  void Push(UeventAction action, absl::string_view subsystem,
+            absl::string_view devpath) {
+    Uevent event;
+    event.action = action;
+    event.subsystem = std::string(subsystem);
+    event.devpath = std::string(devpath);
+    Push(std::move(event));
+  }
+
+  // Queue up an error, which will be returned in place of an event.
+  void PushError(absl::Status status) {
+    absl::MutexLock ml(&mutex_);
+    queue_.push_back(std::move(status));
+  }
+
+  // Indicates if all of the queued events have been received.
+  bool IsEmpty() const {
+    absl::MutexLock ml(&mutex_);
+    return queue_.empty();
+  }
+
+  absl::StatusOr<Uevent> Receive(absl::Duration timeout) override {
+    absl::MutexLock ml(&mutex_);
+    auto not_empty = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+      return !queue_.empty();
+    };
+    if (!mutex_.AwaitWithTimeout(absl::Condition(&not_empty), timeout)) {
+      return absl::DeadlineExceededError("no uevent received");
+    }
+    absl::StatusOr<Uevent> next = std::move(queue_.front());
+    queue_.pop_front();
+    return next;
+  }
+
+ private:
+  mutable absl::Mutex mutex_;
+  std::deque<absl::StatusOr<Uevent>> queue_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace ecclesia
+
+#endif  // ECCLESIA_LIB_UEVENT_FAKE_UEVENT_SOURCE_H_
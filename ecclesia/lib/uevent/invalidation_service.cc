@@ -0,0 +1,163 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/lib/uevent/invalidation_service.h"
+
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "ecclesia/lib/cache/rcu_snapshot.h"
+#include "ecclesia/lib/logging/logging.h"
+#include "ecclesia/lib/uevent/uevent.h"
+
+namespace ecclesia {
+namespace {
+
+// How long the background thread waits for each event. This bounds how long it
+// takes for the thread to notice that it has been asked to stop.
+constexpr absl::Duration kPollInterval = absl::Milliseconds(200);
+
+// How long the background thread waits after a source failure before trying
+// again, to avoid spinning on a persistent error.
+constexpr absl::Duration kErrorBackoff = absl::Seconds(1);
+
+// Indicates if an event with the given action can change inventory.
+bool ActionInvalidates(UeventAction action) {
+  switch (action) {
+    case UeventAction::kAdd:
+    case UeventAction::kRemove:
+    case UeventAction::kChange:
+    case UeventAction::kMove:
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+UeventInvalidationService::UeventInvalidationService(
+    std::unique_ptr<UeventSource> source)
+    : source_(std::move(source)) {}
+
+UeventInvalidationService::~UeventInvalidationService() {
+  stop_.Notify();
+  if (thread_.joinable()) thread_.join();
+}
+
+void UeventInvalidationService::RegisterInvalidator(
+    absl::string_view subsystem, RcuInvalidator invalidator) {
+  RegisterInvalidator(subsystem, nullptr, std::move(invalidator));
+}
+
+void UeventInvalidationService::RegisterInvalidator(
+    absl::string_view subsystem, const void *owner,
+    RcuInvalidator invalidator) {
+  absl::MutexLock ml(&mutex_);
+  std::vector<Registration> &registrations = invalidators_[subsystem];
+  if (owner) {
+    for (Registration &registration : registrations) {
+      if (registration.owner == owner) {
+        registration.invalidator = std::move(invalidator);
+        return;
+      }
+    }
+  }
+  registrations.push_back(
+      {.owner = owner, .invalidator = std::move(invalidator)});
+}
+
+void UeventInvalidationService::InvalidateAll() {
+  absl::flat_hash_map<std::string, std::vector<Registration>> to_invalidate;
+  {
+    absl::MutexLock ml(&mutex_);
+    to_invalidate.swap(invalidators_);
+  }
+  // The invalidators are triggered without holding the lock, so that any
+  // notifications they trigger are free to register new invalidators.
+  for (auto &[subsystem, registrations] : to_invalidate) {
+    for (Registration &registration : registrations) {
+      registration.invalidator.InvalidateSnapshot();
+    }
+  }
+}
+
+void UeventInvalidationService::HandleEvent(const Uevent &event) {
+  if (!ActionInvalidates(event.action)) return;
+
+  std::vector<Registration> to_invalidate;
+  {
+    absl::MutexLock ml(&mutex_);
+    auto iter = invalidators_.find(event.subsystem);
+    if (iter == invalidators_.end()) return;
+    to_invalidate = std::move(iter->second);
+    invalidators_.erase(iter);
+  }
+  for (Registration &registration : to_invalidate) {
+    registration.invalidator.InvalidateSnapshot();
+  }
+}
+
+absl::Status UeventInvalidationService::ReceiveAndHandle(
+    absl::Duration timeout) {
+  absl::StatusOr<Uevent> maybe_event = source_->Receive(timeout);
+  if (maybe_event.ok()) {
+    HandleEvent(*maybe_event);
+    return absl::OkStatus();
+  }
+  if (absl::IsResourceExhausted(maybe_event.status())) {
+    // Events were lost, so there is no way to know what changed.
+    InvalidateAll();
+    return absl::OkStatus();
+  }
+  if (!absl::IsDeadlineExceeded(maybe_event.status())) {
+    ErrorLog() << "unable to receive uevents: " << maybe_event.status();
+  }
+  return maybe_event.status();
+}
+
+int UeventInvalidationService::ProcessEvents(absl::Duration timeout) {
+  int num_events = 0;
+  // Once an event has arrived, only handle the ones which are already queued.
+  while (ReceiveAndHandle(timeout).ok()) {
+    ++num_events;
+    timeout = absl::ZeroDuration();
+  }
+  return num_events;
+}
+
+void UeventInvalidationService::Start() {
+  thread_ = std::thread([this]() {
+    while (!stop_.HasBeenNotified()) {
+      absl::Status status = ReceiveAndHandle(kPollInterval);
+      if (!status.ok() && !absl::IsDeadlineExceeded(status)) {
+        stop_.WaitForNotificationWithTimeout(kErrorBackoff);
+      }
+    }
+  });
+}
+
+}  // namespace ecclesia
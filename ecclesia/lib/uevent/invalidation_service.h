@@ -0,0 +1,116 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This library provides a service for invalidating cached hardware inventory
+// in response to uevents. Caches which are built by scanning sysfs register an
+// RcuInvalidator for the subsystem they were built from; when the kernel sends
+// an event indicating that a device in that subsystem has been added, removed
+// or changed, all of the invalidators registered for the subsystem are
+// triggered. This allows inventory to be scanned once and then only rescanned
+// when something has actually changed.
+//
+// Each registration is one-shot: an invalidator refers to a single snapshot,
+// and once that snapshot is stale there is nothing left for it to do. A cache
+// which rebuilds its snapshot should register the new invalidator. Caches can
+// also be rebuilt for reasons other than an event, so registrations can be
+// made on behalf of an owner; a new registration from the same owner replaces
+// the old one rather than leaving a stale invalidator behind.
+
+#ifndef ECCLESIA_LIB_UEVENT_INVALIDATION_SERVICE_H_
+#define ECCLESIA_LIB_UEVENT_INVALIDATION_SERVICE_H_
+
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "ecclesia/lib/cache/rcu_snapshot.h"
+#include "ecclesia/lib/uevent/uevent.h"
+
+namespace ecclesia {
+
+class UeventInvalidationService {
+ public:
+  explicit UeventInvalidationService(std::unique_ptr<UeventSource> source);
+
+  // The service can own a thread, so it cannot be copied.
+  UeventInvalidationService(const UeventInvalidationService &other) = delete;
+  UeventInvalidationService &operator=(const UeventInvalidationService &other) =
+      delete;
+
+  // Stops the background thread, if it was started.
+  ~UeventInvalidationService();
+
+  // Register an invalidator to be triggered by the next add, remove, change or
+  // move event for a device in the given subsystem (e.g. "pci", "usb", "cpu").
+  void RegisterInvalidator(absl::string_view subsystem,
+                           RcuInvalidator invalidator);
+
+  // Register an invalidator on behalf of the given owner, which is usually the
+  // cache that owns the snapshot. This replaces any invalidator the same owner
+  // has registered for the subsystem that has not been triggered yet.
+  void RegisterInvalidator(absl::string_view subsystem, const void *owner,
+                           RcuInvalidator invalidator);
+
+  // Trigger and clear all registered invalidators, for every subsystem. This
+  // is done automatically if the source reports that events were dropped.
+  void InvalidateAll();
+
+  // Wait for up to the given timeout for an event, and then handle it along
+  // with any further events which are immediately available. Returns the number
+  // of events handled. This can be used to drive the service directly, instead
+  // of using a background thread; it should not be used after Start.
+  int ProcessEvents(absl::Duration timeout);
+
+  // Start a background thread which processes events until the service is
+  // destroyed. Must be called at most once.
+  void Start();
+
+ private:
+  // Handle a single event from the source.
+  void HandleEvent(const Uevent &event);
+
+  // Wait for up to the given timeout for a single event from the source and
+  // handle it. Returns the error from the source if no event was handled.
+  absl::Status ReceiveAndHandle(absl::Duration timeout);
+
+  std::unique_ptr<UeventSource> source_;
+
+  // A registered invalidator, along with the owner that registered it. The
+  // owner is null for registrations which were not made on behalf of one.
+  struct Registration {
+    const void *owner;
+    RcuInvalidator invalidator;
+  };
+
+  absl::Mutex mutex_;
+  absl::flat_hash_map<std::string, std::vector<Registration>> invalidators_
+      ABSL_GUARDED_BY(mutex_);
+
+  absl::Notification stop_;
+  std::thread thread_;
+};
+
+}  // namespace ecclesia
+
+#endif  // ECCLESIA_LIB_UEVENT_INVALIDATION_SERVICE_H_
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/lib/uevent/invalidation_service.h"
+
+#include <memory>
+#include <utility>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "ecclesia/lib/cache/rcu_snapshot.h"
+#include "ecclesia/lib/uevent/fake_uevent_source.h"
+#include "ecclesia/lib/uevent/uevent.h"
+
+namespace ecclesia {
+namespace {
+
+class UeventInvalidationServiceTest : public ::testing::Test {
+ protected:
+  UeventInvalidationServiceTest()
+      : source_(new FakeUeventSource()),
+        service_(absl::WrapUnique(source_)) {}
+
+  // Create a new snapshot whose invalidator is registered for the subsystem.
+  RcuSnapshot<int> Watch(absl::string_view subsystem) {
+    auto snapshot = RcuSnapshot<int>::Create(0);
+    service_.RegisterInvalidator(subsystem, snapshot.invalidator);
+    return snapshot.snapshot;
+  }
+
+  FakeUeventSource *source_;  // Owned by service_.
+  UeventInvalidationService service_;
+};
+
+TEST_F(UeventInvalidationServiceTest, NoEvents) {
+  RcuSnapshot<int> pci = Watch("pci");
+  EXPECT_EQ(service_.ProcessEvents(absl::ZeroDuration()), 0);
+  EXPECT_TRUE(pci.IsFresh());
+}
+
+TEST_F(UeventInvalidationServiceTest, EventsInvalidateTheirSubsystem) {
+  RcuSnapshot<int> pci = Watch("pci");
+  RcuSnapshot<int> usb1 = Watch("usb");
+  RcuSnapshot<int> usb2 = Watch("usb");
+
+  source_->Push(UeventAction::kAdd, "usb", "/devices/usb1/1-1");
+  EXPECT_EQ(service_.ProcessEvents(absl::ZeroDuration()), 1);
+  EXPECT_TRUE(pci.IsFresh());
+  EXPECT_FALSE(usb1.IsFresh());
+  EXPECT_FALSE(usb2.IsFresh());
+
+  source_->Push(UeventAction::kRemove, "pci", "/devices/pci0000:00");
+  EXPECT_EQ(service_.ProcessEvents(absl::ZeroDuration()), 1);
+  EXPECT_FALSE(pci.IsFresh());
+}
+
+TEST_F(UeventInvalidationServiceTest, OnlyInventoryActionsInvalidate) {
+  RcuSnapshot<int> cpu = Watch("cpu");
+
+  source_->Push(UeventAction::kOnline, "cpu", "/devices/system/cpu/cpu1");
+  source_->Push(UeventAction::kBind, "cpu", "/devices/system/cpu/cpu1");
+  source_->Push(UeventAction::kUnknown, "cpu", "/devices/system/cpu/cpu1");
+  EXPECT_EQ(service_.ProcessEvents(absl::ZeroDuration()), 3);
+  EXPECT_TRUE(cpu.IsFresh());
+
+  source_->Push(UeventAction::kChange, "cpu", "/devices/system/cpu/cpu1");
+  EXPECT_EQ(service_.ProcessEvents(absl::ZeroDuration()), 1);
+  EXPECT_FALSE(cpu.IsFresh());
+}
+
+TEST_F(UeventInvalidationServiceTest, RegistrationsAreOneShot) {
+  RcuSnapshot<int> first = Watch("pci");
+  source_->Push(UeventAction::kAdd, "pci", "/devices/pci0000:00");
+  service_.ProcessEvents(absl::ZeroDuration());
+  EXPECT_FALSE(first.IsFresh());
+
+  // A rebuilt cache registers its new invalidator, which is only triggered by
+  // events after that point.
+  RcuSnapshot<int> second = Watch("pci");
+  EXPECT_TRUE(second.IsFresh());
+  source_->Push(UeventAction::kAdd, "pci", "/devices/pci0000:00");
+  service_.ProcessEvents(absl::ZeroDuration());
+  EXPECT_FALSE(second.IsFresh());
+}
+
+TEST_F(UeventInvalidationServiceTest, OwnersReplaceTheirRegistrations) {
+  int owner1, owner2;
+  auto first = RcuSnapshot<int>::Create(1);
+  RcuNotification first_notification;
+  first.snapshot.RegisterNotification(first_notification);
+  service_.RegisterInvalidator("pci", &owner1, first.invalidator);
+
+  // The owner rebuilds without an event, e.g. after a manual invalidation. The
+  // new registration replaces the old one instead of being added next to it.
+  auto second = RcuSnapshot<int>::Create(2);
+  service_.RegisterInvalidator("pci", &owner1, second.invalidator);
+  auto other = RcuSnapshot<int>::Create(3);
+  service_.RegisterInvalidator("pci", &owner2, other.invalidator);
+
+  source_->Push(UeventAction::kAdd, "pci", "/devices/pci0000:00");
+  service_.ProcessEvents(absl::ZeroDuration());
+  EXPECT_FALSE(first_notification.HasTriggered());
+  EXPECT_FALSE(second.snapshot.IsFresh());
+  EXPECT_FALSE(other.snapshot.IsFresh());
+}
+
+TEST_F(UeventInvalidationServiceTest, DroppedEventsInvalidateEverything) {
+  RcuSnapshot<int> pci = Watch("pci");
+  RcuSnapshot<int> usb = Watch("usb");
+
+  source_->PushError(absl::ResourceExhaustedError("dropped"));
+  EXPECT_EQ(service_.ProcessEvents(absl::ZeroDuration()), 1);
+  EXPECT_FALSE(pci.IsFresh());
+  EXPECT_FALSE(usb.IsFresh());
+}
+
+TEST_F(UeventInvalidationServiceTest, SourceErrorsStopProcessing) {
+  RcuSnapshot<int> pci = Watch("pci");
+
+  source_->PushError(absl::InternalError("broken"));
+  source_->Push(UeventAction::kAdd, "pci", "/devices/pci0000:00");
+  EXPECT_EQ(service_.ProcessEvents(absl::ZeroDuration()), 0);
+  EXPECT_TRUE(pci.IsFresh());
+  EXPECT_EQ(service_.ProcessEvents(absl::ZeroDuration()), 1);
+  EXPECT_FALSE(pci.IsFresh());
+}
+
+TEST_F(UeventInvalidationServiceTest, BackgroundThread) {
+  auto snapshot = RcuSnapshot<int>::Create(0);
+  RcuNotification notification;
+  snapshot.snapshot.RegisterNotification(notification);
+  service_.RegisterInvalidator("pci", snapshot.invalidator);
+
+  service_.Start();
+  source_->Push(UeventAction::kAdd, "pci", "/devices/pci0000:00");
+
+  // Wait for the background thread to pick up the event.
+  absl::Time deadline = absl::Now() + absl::Seconds(10);
+  while (!notification.HasTriggered() && absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  EXPECT_TRUE(notification.HasTriggered());
+  EXPECT_FALSE(snapshot.snapshot.IsFresh());
+}
+
+}  // namespace
+}  // namespace ecclesia
@@ -0,0 +1,216 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/lib/uevent/uevent.h"
+
+#include <errno.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+
+namespace ecclesia {
+namespace {
+
+// Mapping between actions and their string representations.
+constexpr struct {
+  UeventAction action;
+  absl::string_view name;
+} kActionNames[] = {
+    {UeventAction::kAdd, "add"},
+    {UeventAction::kRemove, "remove"},
+    {UeventAction::kChange, "change"},
+    {UeventAction::kMove, "move"},
+    {UeventAction::kOnline, "online"},
+    {UeventAction::kOffline, "offline"},
+    {UeventAction::kBind, "bind"},
+    {UeventAction::kUnbind, "unbind"},
+};
+
+// Netlink multicast group that the kernel sends uevents to.
+constexpr unsigned kKernelUeventGroup = 1;
+
+// The kernel limits uevents to this size.
+constexpr size_t kMaxUeventSize = 8192;
+
+// Size to request for the socket receive buffer. Uevents tend to arrive in
+// bursts (e.g. when a device with many functions is hotplugged), so a larger
+// buffer makes it less likely that events are dropped.
+constexpr int kReceiveBufferSize = 1024 * 1024;
+
+}  // namespace
+
+UeventAction UeventActionFromString(absl::string_view action) {
+  for (const auto &entry : kActionNames) {
+    if (entry.name == action) return entry.action;
+  }
+  return UeventAction::kUnknown;
+}
+
+absl::string_view UeventActionToString(UeventAction action) {
+  for (const auto &entry : kActionNames) {
+    if (entry.action == action) return entry.name;
+  }
+  return "unknown";
+}
+
+absl::StatusOr<Uevent> ParseUevent(absl::Span<const char> message) {
+  absl::string_view data(message.data(), message.size());
+  if (absl::StartsWith(data, "libudev")) {
+    return absl::InvalidArgumentError("udev messages are not supported");
+  }
+
+  // The message is a sequence of NUL-terminated strings. The first one is the
+  // header, the rest are properties.
+  Uevent event;
+  bool have_header = false;
+  while (!data.empty()) {
+    size_t end = data.find('\0');
+    absl::string_view field = data.substr(0, end);
+    data.remove_prefix(end == data.npos ? data.size() : end + 1);
+    if (field.empty()) continue;
+
+    if (!have_header) {
+      size_t at = field.find('@');
+      if (at == field.npos) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("malformed uevent header: %s", field));
+      }
+      event.action = UeventActionFromString(field.substr(0, at));
+      event.devpath = std::string(field.substr(at + 1));
+      have_header = true;
+      continue;
+    }
+
+    size_t equals = field.find('=');
+    if (equals == field.npos) continue;
+    event.properties.emplace(field.substr(0, equals),
+                             field.substr(equals + 1));
+  }
+  if (!have_header) {
+    return absl::InvalidArgumentError("empty uevent message");
+  }
+
+  // The properties are authoritative over the header, if they are present.
+  if (auto iter = event.properties.find("ACTION");
+      iter != event.properties.end()) {
+    event.action = UeventActionFromString(iter->second);
+  }
+  if (auto iter = event.properties.find("DEVPATH");
+      iter != event.properties.end()) {
+    event.devpath = iter->second;
+  }
+  if (auto iter = event.properties.find("SUBSYSTEM");
+      iter != event.properties.end()) {
+    event.subsystem = iter->second;
+  }
+  return event;
+}
+
+absl::StatusOr<std::unique_ptr<NetlinkUeventSource>>
+NetlinkUeventSource::Create() {
+  int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK,
+                  NETLINK_KOBJECT_UEVENT);
+  if (fd < 0) {
+    return absl::InternalError(absl::StrFormat(
+        "unable to open uevent netlink socket, errno: %d", errno));
+  }
+  // Try to grow the receive buffer. Forcing the size requires privileges, so
+  // fall back to the normal (capped) option if that fails.
+  if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &kReceiveBufferSize,
+                 sizeof(kReceiveBufferSize)) < 0) {
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &kReceiveBufferSize,
+               sizeof(kReceiveBufferSize));
+  }
+
+  struct sockaddr_nl addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.nl_family = AF_NETLINK;
+  addr.nl_groups = kKernelUeventGroup;
+  if (bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0) {
+    int bind_errno = errno;
+    close(fd);
+    return absl::InternalError(absl::StrFormat(
+        "unable to bind uevent netlink socket, errno: %d", bind_errno));
+  }
+  return std::unique_ptr<NetlinkUeventSource>(new NetlinkUeventSource(fd));
+}
+
+NetlinkUeventSource::NetlinkUeventSource(int fd)
+    : fd_(fd), buffer_(kMaxUeventSize) {}
+
+NetlinkUeventSource::~NetlinkUeventSource() { close(fd_); }
+
+absl::StatusOr<Uevent> NetlinkUeventSource::Receive(absl::Duration timeout) {
+  absl::Time deadline = absl::Now() + timeout;
+  while (true) {
+    struct pollfd pfd = {.fd = fd_, .events = POLLIN, .revents = 0};
+    int timeout_ms = absl::ToInt64Milliseconds(
+        std::max(deadline - absl::Now(), absl::ZeroDuration()));
+    int rc = poll(&pfd, 1, timeout_ms);
+    if (rc < 0) {
+      if (errno == EINTR) continue;
+      return absl::InternalError(
+          absl::StrFormat("failure while polling for uevents, errno: %d",
+                          errno));
+    }
+    if (rc == 0) {
+      return absl::DeadlineExceededError("no uevent received");
+    }
+
+    // Only accept messages sent by the kernel. Anything else on the multicast
+    // group is from a userspace process and is ignored.
+    struct sockaddr_nl addr;
+    struct iovec iov = {.iov_base = buffer_.data(), .iov_len = buffer_.size()};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &addr;
+    msg.msg_namelen = sizeof(addr);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    ssize_t len = recvmsg(fd_, &msg, 0);
+    if (len < 0) {
+      if (errno == EINTR || errno == EAGAIN) continue;
+      if (errno == ENOBUFS) {
+        return absl::ResourceExhaustedError("uevents were dropped");
+      }
+      return absl::InternalError(absl::StrFormat(
+          "failure while receiving uevent, errno: %d", errno));
+    }
+    if (addr.nl_pid != 0 || (msg.msg_flags & MSG_TRUNC)) continue;
+
+    auto maybe_event = ParseUevent(absl::MakeConstSpan(buffer_.data(), len));
+    if (maybe_event.ok()) return maybe_event;
+  }
+}
+
+}  // namespace ecclesia
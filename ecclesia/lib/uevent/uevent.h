@@ -0,0 +1,113 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This library provides support for receiving kernel uevents. The kernel sends
+// a uevent over netlink whenever a device is added, removed or changed, which
+// makes them useful for finding out when cached hardware inventory has gone
+// stale without having to rescan sysfs.
+//
+// Events are received through the UeventSource interface. The netlink socket
+// based implementation is provided here; tests can substitute their own source
+// (see fake_uevent_source.h).
+
+#ifndef ECCLESIA_LIB_UEVENT_UEVENT_H_
+#define ECCLESIA_LIB_UEVENT_UEVENT_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+
+namespace ecclesia {
+
+// The action that triggered a uevent.
+enum class UeventAction {
+  kUnknown,
+  kAdd,
+  kRemove,
+  kChange,
+  kMove,
+  kOnline,
+  kOffline,
+  kBind,
+  kUnbind,
+};
+
+// Convert between actions and their string representation in uevents.
+UeventAction UeventActionFromString(absl::string_view action);
+absl::string_view UeventActionToString(UeventAction action);
+
+// A single uevent, as sent by the kernel.
+struct Uevent {
+  UeventAction action = UeventAction::kUnknown;
+  // The sysfs path of the device, relative to /sys.
+  std::string devpath;
+  // The subsystem the device belongs to, e.g. "pci" or "usb".
+  std::string subsystem;
+  // All of the KEY=VALUE pairs in the event, including the above.
+  absl::flat_hash_map<std::string, std::string> properties;
+};
+
+// Parse a raw uevent message, as received from the kernel. This consists of an
+// "action@devpath" header followed by NUL-separated KEY=VALUE pairs. Messages
+// rebroadcast by udev, which use a different binary format, are rejected.
+absl::StatusOr<Uevent> ParseUevent(absl::Span<const char> message);
+
+// Generic interface for a source of uevents.
+class UeventSource {
+ public:
+  UeventSource() {}
+  virtual ~UeventSource() = default;
+
+  // Wait for up to the given timeout for the next event. Returns:
+  //   * DeadlineExceeded, if no event arrived within the timeout
+  //   * ResourceExhausted, if events were dropped because they arrived faster
+  //     than they were being received; any state derived from events should be
+  //     considered stale
+  //   * some other error if the source was unable to receive events
+  virtual absl::StatusOr<Uevent> Receive(absl::Duration timeout) = 0;
+};
+
+// Source that receives uevents from the kernel over a netlink socket.
+class NetlinkUeventSource : public UeventSource {
+ public:
+  // Create a new source. This opens and binds the netlink socket, so events
+  // will be queued from the point this returns.
+  static absl::StatusOr<std::unique_ptr<NetlinkUeventSource>> Create();
+
+  // The object owns a socket so it cannot be copied.
+  NetlinkUeventSource(const NetlinkUeventSource &other) = delete;
+  NetlinkUeventSource &operator=(const NetlinkUeventSource &other) = delete;
+
+  ~NetlinkUeventSource() override;
+
+  absl::StatusOr<Uevent> Receive(absl::Duration timeout) override;
+
+ private:
+  explicit NetlinkUeventSource(int fd);
+
+  const int fd_;
+  std::vector<char> buffer_;
+};
+
+}  // namespace ecclesia
+
+#endif  // ECCLESIA_LIB_UEVENT_UEVENT_H_
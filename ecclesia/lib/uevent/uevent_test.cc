@@ -0,0 +1,90 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/lib/uevent/uevent.h"
+
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/types/span.h"
+#include "ecclesia/lib/testing/status.h"
+
+namespace ecclesia {
+namespace {
+
+using ::testing::Contains;
+using ::testing::Not;
+using ::testing::Pair;
+
+// Helper that parses a message given as a string with embedded NULs.
+absl::StatusOr<Uevent> Parse(const std::string &message) {
+  return ParseUevent(absl::MakeConstSpan(message.data(), message.size()));
+}
+
+TEST(ParseUeventTest, KernelMessage) {
+  static constexpr char kMessage[] =
+      "add@/devices/pci0000:00/0000:00:1c.0/0000:02:00.0\0"
+      "ACTION=add\0"
+      "DEVPATH=/devices/pci0000:00/0000:00:1c.0/0000:02:00.0\0"
+      "SUBSYSTEM=pci\0"
+      "PCI_SLOT_NAME=0000:02:00.0\0"
+      "SEQNUM=2170\0";
+
+  auto maybe_event = Parse(std::string(kMessage, sizeof(kMessage) - 1));
+  ASSERT_THAT(maybe_event, IsOk());
+  EXPECT_EQ(maybe_event->action, UeventAction::kAdd);
+  EXPECT_EQ(maybe_event->devpath,
+            "/devices/pci0000:00/0000:00:1c.0/0000:02:00.0");
+  EXPECT_EQ(maybe_event->subsystem, "pci");
+  EXPECT_THAT(maybe_event->properties,
+              Contains(Pair("PCI_SLOT_NAME", "0000:02:00.0")));
+  EXPECT_THAT(maybe_event->properties, Contains(Pair("SEQNUM", "2170")));
+}
+
+TEST(ParseUeventTest, HeaderOnly) {
+  auto maybe_event = Parse(std::string("remove@/devices/virtual/foo\0", 28));
+  ASSERT_THAT(maybe_event, IsOk());
+  EXPECT_EQ(maybe_event->action, UeventAction::kRemove);
+  EXPECT_EQ(maybe_event->devpath, "/devices/virtual/foo");
+  EXPECT_EQ(maybe_event->subsystem, "");
+}
+
+TEST(ParseUeventTest, UnknownAction) {
+  auto maybe_event = Parse(std::string("frobnicate@/devices/foo\0", 24));
+  ASSERT_THAT(maybe_event, IsOk());
+  EXPECT_EQ(maybe_event->action, UeventAction::kUnknown);
+}
+
+TEST(ParseUeventTest, BadMessages) {
+  EXPECT_THAT(Parse(""), Not(IsOk()));
+  EXPECT_THAT(Parse(std::string("no header\0ACTION=add\0", 22)), Not(IsOk()));
+  EXPECT_THAT(Parse(std::string("libudev\0\xfe\xed\xca\xfe", 12)),
+              Not(IsOk()));
+}
+
+TEST(UeventActionTest, RoundTrip) {
+  for (UeventAction action :
+       {UeventAction::kAdd, UeventAction::kRemove, UeventAction::kChange,
+        UeventAction::kMove, UeventAction::kOnline, UeventAction::kOffline,
+        UeventAction::kBind, UeventAction::kUnbind}) {
+    EXPECT_EQ(UeventActionFromString(UeventActionToString(action)), action);
+  }
+  EXPECT_EQ(UeventActionToString(UeventAction::kUnknown), "unknown");
+}
+
+}  // namespace
+}  // namespace ecclesia
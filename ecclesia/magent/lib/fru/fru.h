@@ -88,7 +88,7 @@ class FruField {
   Type GetType() const { return type_; }
   void SetType(Type type) { type_ = type; }
   std::vector<unsigned char> GetData() const { return data_; }
-  void SetData(absl::Span<unsigned char> data) {
+  void SetData(absl::Span<const unsigned char> data) {
     data_.resize(data.size());
     std::copy(data.begin(), data.end(), data_.begin());
   }
@@ -0,0 +1,301 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/lib/fru/fru_view.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "ecclesia/lib/codec/text.h"
+#include "ecclesia/lib/logging/logging.h"
+#include "ecclesia/magent/lib/fru/common_header.emb.h"
+#include "ecclesia/magent/lib/fru/fru.h"
+#include "runtime/cpp/emboss_prelude.h"
+
+namespace ecclesia {
+namespace {
+
+// The only supported format version, for both the common header and the info
+// areas.
+constexpr uint8_t kFormatVersion = 1;
+
+// 1/1/96 0:00 GMT in Unix epoch seconds.
+constexpr time_t kFruEpoch = 820454400;
+
+// The size of the fixed header at the start of each info area, before the
+// first field.
+constexpr size_t kChassisHeaderSize = 3;  // Version, length and type.
+constexpr size_t kBoardHeaderSize = 6;    // Version, length, language, date.
+constexpr size_t kProductHeaderSize = 3;  // Version, length and language.
+
+// Find the info area starting at the given offset in the image, verifying its
+// format version, length and checksum.
+absl::StatusOr<absl::Span<const uint8_t>> GetInfoArea(
+    absl::Span<const uint8_t> image, size_t area_offset, absl::string_view name,
+    size_t header_size) {
+  // We need at least two bytes to check format version and info area length.
+  if (area_offset + 1 >= image.size()) {
+    return absl::InternalError(absl::StrFormat(
+        "FRU %s info area offset %u is outside of the image (size %u)", name,
+        area_offset, image.size()));
+  }
+  if (image[area_offset] != kFormatVersion) {
+    return absl::InternalError(
+        absl::StrFormat("FRU %s info area has unsupported format version %u",
+                        name, image[area_offset]));
+  }
+  size_t size = FruChunksToBytes(image[area_offset + 1]);
+  // The area must be able to hold the header and the checksum byte.
+  if (size < header_size + 1 || area_offset + size > image.size()) {
+    return absl::InternalError(absl::StrFormat(
+        "FRU %s info area length %u is invalid for an image of size %u", name,
+        size, image.size()));
+  }
+  absl::Span<const uint8_t> area = image.subspan(area_offset, size);
+  uint8_t checksum = FruChecksumFromBytes(area.data(), 0, area.size());
+  if (checksum != 0) {
+    return absl::InternalError(absl::StrFormat(
+        "FRU %s info area checksum invalid (should be 0, is %u)", name,
+        checksum));
+  }
+  return area;
+}
+
+// Read the standard fields of an info area, which follow the header. Returns
+// the bytes which remain after the standard fields, for the custom fields.
+absl::StatusOr<absl::Span<const uint8_t>> ReadStandardFields(
+    absl::Span<const uint8_t> area, absl::string_view name, size_t header_size,
+    absl::Span<FruFieldView *const> fields) {
+  // The last byte of the area is the checksum, not a field.
+  FruFieldReader reader(
+      area.subspan(header_size, area.size() - header_size - 1));
+  for (FruFieldView *field : fields) {
+    if (!reader.Next(field)) {
+      return absl::InternalError(absl::StrFormat(
+          "field count in FRU %s info area is too small", name));
+    }
+  }
+  return reader.remaining();
+}
+
+}  // namespace
+
+absl::StatusOr<absl::string_view> FruFieldView::Decode(
+    DecodeBuffer *buffer) const {
+  absl::StatusOr<size_t> maybe_size;
+  switch (type_) {
+    case FruField::kTypeBcdPlus:
+      maybe_size = ParseBcdPlus(data_, absl::MakeSpan(*buffer));
+      break;
+    case FruField::kType6BitAscii:
+      maybe_size = ParseSixBitAscii(data_, absl::MakeSpan(*buffer));
+      break;
+    default:
+      return absl::string_view(reinterpret_cast<const char *>(data_.data()),
+                               data_.size());
+  }
+  if (!maybe_size.ok()) return maybe_size.status();
+  return absl::string_view(buffer->data(), *maybe_size);
+}
+
+std::string FruFieldView::ToString() const {
+  DecodeBuffer buffer;
+  absl::StatusOr<absl::string_view> maybe_value = Decode(&buffer);
+  if (!maybe_value.ok()) {
+    ErrorLog() << maybe_value.status().message();
+    return "";
+  }
+  return std::string(*maybe_value);
+}
+
+FruField FruFieldView::ToFruField() const {
+  FruField field;
+  field.SetType(type_);
+  field.SetData(data_);
+  return field;
+}
+
+bool FruFieldReader::Next(FruFieldView *field) {
+  if (remaining_.empty() || remaining_[0] == kFruNoMoreFields) return false;
+  size_t field_len = FruLengthFromTypelenByte(remaining_[0]);
+  if (field_len >= remaining_.size()) {
+    ErrorLog() << "FRU field length " << field_len
+               << " overruns the end of its area";
+    remaining_ = {};
+    return false;
+  }
+  *field = FruFieldView(FruField::Type(FruTypeFromTypelenByte(remaining_[0])),
+                        remaining_.subspan(1, field_len));
+  remaining_.remove_prefix(1 + field_len);
+  return true;
+}
+
+absl::Status DecodeCustomField(const FruFieldView &field,
+                               FruFieldView::DecodeBuffer *buffer,
+                               CustomFieldType *type,
+                               absl::string_view *value) {
+  absl::StatusOr<absl::string_view> maybe_raw_data = field.Decode(buffer);
+  if (!maybe_raw_data.ok()) return maybe_raw_data.status();
+  absl::string_view raw_data = *maybe_raw_data;
+
+  // A Platforms-defined custom field uses the first byte to specify field type,
+  // and the remaining bytes for actual field value.
+  if (raw_data.size() < 2) {
+    return absl::UnknownError(
+        "Custom field is too short to be a Platforms-defined field");
+  }
+
+  const uint8_t type_id = raw_data[0];
+  if (type_id >= CustomFieldType::kEnd) {
+    return absl::UnknownError(absl::StrFormat(
+        "Cannot recognize the field type (%u) from custom field", type_id));
+  }
+
+  *type = static_cast<CustomFieldType>(type_id);
+  *value = raw_data.substr(1);
+  return absl::OkStatus();
+}
+
+absl::StatusOr<absl::string_view> FruInfoAreaView::GetCustomField(
+    CustomFieldType type, FruFieldView::DecodeBuffer *buffer) const {
+  FruFieldReader reader = custom_fields();
+  FruFieldView field;
+  while (reader.Next(&field)) {
+    CustomFieldType field_type;
+    absl::string_view value;
+    if (DecodeCustomField(field, buffer, &field_type, &value).ok() &&
+        field_type == type) {
+      return value;
+    }
+  }
+  return absl::NotFoundError(
+      absl::StrFormat("Cannot find field: %d from Fru Area", type));
+}
+
+absl::StatusOr<FruChassisInfoView> FruChassisInfoView::Parse(
+    absl::Span<const uint8_t> image, size_t area_offset) {
+  absl::StatusOr<absl::Span<const uint8_t>> maybe_area =
+      GetInfoArea(image, area_offset, "chassis", kChassisHeaderSize);
+  if (!maybe_area.ok()) return maybe_area.status();
+
+  FruChassisInfoView view;
+  view.image_ = *maybe_area;
+  view.type_ = ChassisInfoArea::Type(view.image_[2]);
+  FruFieldView *const fields[] = {&view.part_number_, &view.serial_number_};
+  absl::StatusOr<absl::Span<const uint8_t>> maybe_custom =
+      ReadStandardFields(view.image_, "chassis", kChassisHeaderSize, fields);
+  if (!maybe_custom.ok()) return maybe_custom.status();
+  view.custom_ = *maybe_custom;
+  return view;
+}
+
+absl::StatusOr<FruBoardInfoView> FruBoardInfoView::Parse(
+    absl::Span<const uint8_t> image, size_t area_offset) {
+  absl::StatusOr<absl::Span<const uint8_t>> maybe_area =
+      GetInfoArea(image, area_offset, "board", kBoardHeaderSize);
+  if (!maybe_area.ok()) return maybe_area.status();
+
+  FruBoardInfoView view;
+  view.image_ = *maybe_area;
+  view.language_code_ = view.image_[2];
+  // Manufacture date is the number of minutes from 0:00 hrs 1/1/1996, stored
+  // as 3 bytes in little endian order.
+  uint32_t manufacture_date_mins =
+      view.image_[3] | (view.image_[4] << 8) | (view.image_[5] << 16);
+  view.manufacture_date_ = kFruEpoch + (manufacture_date_mins * 60);
+  FruFieldView *const fields[] = {&view.manufacturer_, &view.product_name_,
+                                  &view.serial_number_, &view.part_number_,
+                                  &view.file_id_};
+  absl::StatusOr<absl::Span<const uint8_t>> maybe_custom =
+      ReadStandardFields(view.image_, "board", kBoardHeaderSize, fields);
+  if (!maybe_custom.ok()) return maybe_custom.status();
+  view.custom_ = *maybe_custom;
+  return view;
+}
+
+absl::StatusOr<FruProductInfoView> FruProductInfoView::Parse(
+    absl::Span<const uint8_t> image, size_t area_offset) {
+  absl::StatusOr<absl::Span<const uint8_t>> maybe_area =
+      GetInfoArea(image, area_offset, "product", kProductHeaderSize);
+  if (!maybe_area.ok()) return maybe_area.status();
+
+  FruProductInfoView view;
+  view.image_ = *maybe_area;
+  view.language_code_ = view.image_[2];
+  FruFieldView *const fields[] = {
+      &view.manufacturer_,    &view.product_name_,  &view.part_number_,
+      &view.product_version_, &view.serial_number_, &view.asset_tag_,
+      &view.file_id_};
+  absl::StatusOr<absl::Span<const uint8_t>> maybe_custom =
+      ReadStandardFields(view.image_, "product", kProductHeaderSize, fields);
+  if (!maybe_custom.ok()) return maybe_custom.status();
+  view.custom_ = *maybe_custom;
+  return view;
+}
+
+absl::StatusOr<FruImageView> FruImageView::Parse(
+    absl::Span<const uint8_t> image) {
+  if (image.size() < CommonHeader::IntrinsicSizeInBytes()) {
+    return absl::InternalError("FRU image is too small");
+  }
+  auto common_header =
+      MakeCommonHeaderView(image.data(), CommonHeader::IntrinsicSizeInBytes());
+  if (common_header.format_version().Read() != kFormatVersion) {
+    return absl::InternalError(
+        absl::StrFormat("FRU common header has unsupported format version %u",
+                        common_header.format_version().Read()));
+  }
+  uint8_t checksum = FruChecksumFromBytes(
+      image.data(), 0, CommonHeader::IntrinsicSizeInBytes());
+  if (checksum != 0) {
+    return absl::InternalError(absl::StrFormat(
+        "FRU common header has invalid checksum (should be 0, is %u)",
+        checksum));
+  }
+
+  FruImageView view;
+  if (uint8_t offset = common_header.chassis_info_area_starting_offset().Read();
+      offset > 0) {
+    absl::StatusOr<FruChassisInfoView> maybe_chassis =
+        FruChassisInfoView::Parse(image, FruChunksToBytes(offset));
+    if (!maybe_chassis.ok()) return maybe_chassis.status();
+    view.chassis_info_ = *maybe_chassis;
+  }
+  if (uint8_t offset = common_header.board_info_area_starting_offset().Read();
+      offset > 0) {
+    absl::StatusOr<FruBoardInfoView> maybe_board =
+        FruBoardInfoView::Parse(image, FruChunksToBytes(offset));
+    if (!maybe_board.ok()) return maybe_board.status();
+    view.board_info_ = *maybe_board;
+  }
+  if (uint8_t offset = common_header.product_info_area_starting_offset().Read();
+      offset > 0) {
+    absl::StatusOr<FruProductInfoView> maybe_product =
+        FruProductInfoView::Parse(image, FruChunksToBytes(offset));
+    if (!maybe_product.ok()) return maybe_product.status();
+    view.product_info_ = *maybe_product;
+  }
+  return view;
+}
+
+}  // namespace ecclesia
@@ -0,0 +1,228 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Read-only views of FRU images. The owning classes in fru.h copy every field
+// of an image into its own buffer, which is wasteful when all a caller wants
+// is to pull a few strings out of each of hundreds of FRUs. The views here
+// instead parse an image in place: every field is a span over the original
+// image and 6-bit ASCII and BCD plus fields are only decoded when asked for,
+// into a caller-provided buffer. Parsing an image allocates nothing.
+//
+// The image must outlive any views made from it. The views cannot be used to
+// modify or construct a FRU; use the classes in fru.h for that.
+
+#ifndef ECCLESIA_MAGENT_LIB_FRU_FRU_VIEW_H_
+#define ECCLESIA_MAGENT_LIB_FRU_FRU_VIEW_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "ecclesia/magent/lib/fru/fru.h"
+
+namespace ecclesia {
+
+// A single field within a FRU image.
+class FruFieldView {
+ public:
+  // A buffer large enough to hold any decoded field. The longest possible
+  // field is 63 bytes of BCD plus, which decodes to 126 characters.
+  using DecodeBuffer = std::array<char, 126>;
+
+  FruFieldView() : type_(FruField::kTypeBinary) {}
+  FruFieldView(FruField::Type type, absl::Span<const uint8_t> data)
+      : type_(type), data_(data) {}
+
+  FruField::Type type() const { return type_; }
+  absl::Span<const uint8_t> data() const { return data_; }
+  bool empty() const { return data_.empty(); }
+
+  // Returns the contents of the field as text. Binary and language-based
+  // fields are returned directly out of the image. BCD plus and 6-bit ASCII
+  // fields are decoded into the given buffer and the returned view refers to
+  // the buffer, so it is only valid until the buffer is reused.
+  absl::StatusOr<absl::string_view> Decode(DecodeBuffer *buffer) const;
+
+  // Equivalent to FruField::GetDataAsString: returns the decoded field as a
+  // new string, or an empty string if the field cannot be decoded.
+  std::string ToString() const;
+
+  // Makes an owning copy of the field.
+  FruField ToFruField() const;
+
+ private:
+  FruField::Type type_;
+  absl::Span<const uint8_t> data_;
+};
+
+// Iterates over a sequence of fields in an info area. Iteration stops at the
+// end-of-fields marker, the end of the area, or at the first field which does
+// not fit within the area.
+class FruFieldReader {
+ public:
+  FruFieldReader() = default;
+  explicit FruFieldReader(absl::Span<const uint8_t> fields)
+      : remaining_(fields) {}
+
+  // Reads the next field into the given view. Returns false when there are no
+  // more fields.
+  bool Next(FruFieldView *field);
+
+  // The bytes following the last field that was read.
+  absl::Span<const uint8_t> remaining() const { return remaining_; }
+
+ private:
+  absl::Span<const uint8_t> remaining_;
+};
+
+// Decodes a Platforms-defined custom field, the same as DecodeCustomField in
+// fru.h. The returned value refers to either the image or the given buffer.
+absl::Status DecodeCustomField(const FruFieldView &field,
+                               FruFieldView::DecodeBuffer *buffer,
+                               CustomFieldType *type, absl::string_view *value);
+
+// Common functionality shared by all of the info area views.
+class FruInfoAreaView {
+ public:
+  // The raw bytes of the entire area, including the header and checksum.
+  absl::Span<const uint8_t> image() const { return image_; }
+
+  // Returns a reader over the custom fields which follow the standard fields.
+  FruFieldReader custom_fields() const { return FruFieldReader(custom_); }
+
+  // Get a Platforms-defined custom field from the area. If multiple fields
+  // match the type, returns the first one.
+  absl::StatusOr<absl::string_view> GetCustomField(
+      CustomFieldType type, FruFieldView::DecodeBuffer *buffer) const;
+
+ protected:
+  FruInfoAreaView() = default;
+
+  absl::Span<const uint8_t> image_;
+  absl::Span<const uint8_t> custom_;
+};
+
+// A view of the chassis info area of a FRU.
+class FruChassisInfoView : public FruInfoAreaView {
+ public:
+  // Parse the area which starts at the given offset in the image.
+  static absl::StatusOr<FruChassisInfoView> Parse(
+      absl::Span<const uint8_t> image, size_t area_offset);
+
+  ChassisInfoArea::Type type() const { return type_; }
+  const FruFieldView &part_number() const { return part_number_; }
+  const FruFieldView &serial_number() const { return serial_number_; }
+
+ private:
+  FruChassisInfoView() = default;
+
+  ChassisInfoArea::Type type_ = ChassisInfoArea::kUnknown;
+  FruFieldView part_number_;
+  FruFieldView serial_number_;
+};
+
+// A view of the board info area of a FRU.
+class FruBoardInfoView : public FruInfoAreaView {
+ public:
+  // Parse the area which starts at the given offset in the image.
+  static absl::StatusOr<FruBoardInfoView> Parse(absl::Span<const uint8_t> image,
+                                                size_t area_offset);
+
+  uint8_t language_code() const { return language_code_; }
+  time_t manufacture_date() const { return manufacture_date_; }
+  const FruFieldView &manufacturer() const { return manufacturer_; }
+  const FruFieldView &product_name() const { return product_name_; }
+  const FruFieldView &serial_number() const { return serial_number_; }
+  const FruFieldView &part_number() const { return part_number_; }
+  const FruFieldView &file_id() const { return file_id_; }
+
+ private:
+  FruBoardInfoView() = default;
+
+  uint8_t language_code_ = 0;
+  time_t manufacture_date_ = 0;
+  FruFieldView manufacturer_;
+  FruFieldView product_name_;
+  FruFieldView serial_number_;
+  FruFieldView part_number_;
+  FruFieldView file_id_;
+};
+
+// A view of the product info area of a FRU.
+class FruProductInfoView : public FruInfoAreaView {
+ public:
+  // Parse the area which starts at the given offset in the image.
+  static absl::StatusOr<FruProductInfoView> Parse(
+      absl::Span<const uint8_t> image, size_t area_offset);
+
+  uint8_t language_code() const { return language_code_; }
+  const FruFieldView &manufacturer() const { return manufacturer_; }
+  const FruFieldView &product_name() const { return product_name_; }
+  const FruFieldView &part_number() const { return part_number_; }
+  const FruFieldView &product_version() const { return product_version_; }
+  const FruFieldView &serial_number() const { return serial_number_; }
+  const FruFieldView &asset_tag() const { return asset_tag_; }
+  const FruFieldView &file_id() const { return file_id_; }
+
+ private:
+  FruProductInfoView() = default;
+
+  uint8_t language_code_ = 0;
+  FruFieldView manufacturer_;
+  FruFieldView product_name_;
+  FruFieldView part_number_;
+  FruFieldView product_version_;
+  FruFieldView serial_number_;
+  FruFieldView asset_tag_;
+  FruFieldView file_id_;
+};
+
+// A view of an entire FRU image. As with Fru::FillFromImage, the image must
+// start with a valid common header and any info area it points at must parse
+// successfully. Internal use and multirecord areas are not parsed.
+class FruImageView {
+ public:
+  static absl::StatusOr<FruImageView> Parse(absl::Span<const uint8_t> image);
+
+  // The info areas present in the image.
+  const absl::optional<FruChassisInfoView> &chassis_info() const {
+    return chassis_info_;
+  }
+  const absl::optional<FruBoardInfoView> &board_info() const {
+    return board_info_;
+  }
+  const absl::optional<FruProductInfoView> &product_info() const {
+    return product_info_;
+  }
+
+ private:
+  FruImageView() = default;
+
+  absl::optional<FruChassisInfoView> chassis_info_;
+  absl::optional<FruBoardInfoView> board_info_;
+  absl::optional<FruProductInfoView> product_info_;
+};
+
+}  // namespace ecclesia
+
+#endif  // ECCLESIA_MAGENT_LIB_FRU_FRU_VIEW_H_
@@ -0,0 +1,283 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/lib/fru/fru_view.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "ecclesia/lib/testing/status.h"
+#include "ecclesia/magent/lib/fru/fru.h"
+
+namespace ecclesia {
+namespace {
+
+using ::testing::Not;
+
+// This is a known-good FRU from cglr46, with only a board area.
+constexpr uint8_t kPrefabFruData[] = {
+    0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0xfe, 0x01, 0x07, 0x00,
+    0xb3, 0x1e, 0x63, 0xc7, 0x51, 0x75, 0x61, 0x6e, 0x74, 0x61, 0x00,
+    0xc7, 0x49, 0x63, 0x61, 0x72, 0x75, 0x73, 0x00, 0xcb, 0x30, 0x38,
+    0x31, 0x39, 0x30, 0x30, 0x30, 0x30, 0x34, 0x33, 0x00, 0xcb, 0x47,
+    0x4b, 0x30, 0x38, 0x43, 0x33, 0x41, 0x30, 0x36, 0x36, 0x00, 0x00,
+    0xc1, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc8,
+};
+
+// This is a known problematic FRU where the board area is not terminated by a
+// 0xc1 field.
+constexpr uint8_t kNoAreaTerminationFruData[] = {
+    0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0xfe, 0x01, 0x07, 0x19,
+    0x31, 0x7e, 0x86, 0xc7, 0x51, 0x75, 0x61, 0x6e, 0x74, 0x61, 0x00,
+    0xc9, 0x4c, 0x65, 0x61, 0x66, 0x4c, 0x6f, 0x63, 0x6b, 0x00, 0xd0,
+    0x50, 0x46, 0x4c, 0x51, 0x53, 0x48, 0x31, 0x32, 0x33, 0x39, 0x30,
+    0x30, 0x30, 0x31, 0x31, 0x00, 0xcc, 0x34, 0x32, 0x30, 0x30, 0x30,
+    0x33, 0x31, 0x31, 0x2d, 0x30, 0x31, 0x00, 0x00, 0x6b,
+};
+
+// 1/1/96 0:00 GMT in Unix epoch seconds.
+constexpr time_t kFruEpoch = 820454400;
+
+FruField FruFieldFromString(const std::string &str) {
+  FruField f;
+  f.SetData(str);
+  f.SetType(FruField::kTypeLanguageBased);
+  return f;
+}
+
+FruField FruFieldFromRawData(std::vector<unsigned char> data,
+                             FruField::Type type) {
+  FruField f;
+  f.SetData(data);
+  f.SetType(type);
+  return f;
+}
+
+// Decodes a field, expecting it to succeed.
+std::string Decoded(const FruFieldView &field) {
+  FruFieldView::DecodeBuffer buffer;
+  absl::StatusOr<absl::string_view> maybe_value = field.Decode(&buffer);
+  EXPECT_THAT(maybe_value, IsOk());
+  return maybe_value.ok() ? std::string(*maybe_value) : "";
+}
+
+TEST(FruViewTest, ParseGoldenImage) {
+  absl::StatusOr<FruImageView> maybe_view = FruImageView::Parse(kPrefabFruData);
+  ASSERT_THAT(maybe_view, IsOk());
+  EXPECT_FALSE(maybe_view->chassis_info().has_value());
+  EXPECT_FALSE(maybe_view->product_info().has_value());
+  ASSERT_TRUE(maybe_view->board_info().has_value());
+
+  const FruBoardInfoView &board = *maybe_view->board_info();
+  EXPECT_EQ(board.image().data(), &kPrefabFruData[8]);
+  EXPECT_EQ(board.image().size(), 56);
+  EXPECT_EQ(Decoded(board.manufacturer()), std::string("Quanta\0", 7));
+  EXPECT_EQ(Decoded(board.product_name()), std::string("Icarus\0", 7));
+  EXPECT_EQ(Decoded(board.serial_number()), std::string("0819000043\0", 11));
+  EXPECT_EQ(Decoded(board.part_number()), std::string("GK08C3A066\0", 11));
+  EXPECT_TRUE(board.file_id().empty());
+  EXPECT_EQ(board.manufacture_date(), kFruEpoch + 0x631eb3 * 60);
+
+  // The fields refer directly into the image.
+  EXPECT_EQ(board.manufacturer().data().data(), &kPrefabFruData[15]);
+
+  // There are no custom fields.
+  FruFieldReader reader = board.custom_fields();
+  FruFieldView field;
+  EXPECT_FALSE(reader.Next(&field));
+}
+
+TEST(FruViewTest, ParseNoAreaTerminationImage) {
+  absl::StatusOr<FruImageView> maybe_view =
+      FruImageView::Parse(kNoAreaTerminationFruData);
+  ASSERT_THAT(maybe_view, IsOk());
+  ASSERT_TRUE(maybe_view->board_info().has_value());
+
+  const FruBoardInfoView &board = *maybe_view->board_info();
+  EXPECT_EQ(Decoded(board.manufacturer()), std::string("Quanta\0", 7));
+  EXPECT_EQ(Decoded(board.product_name()), std::string("LeafLock\0", 9));
+  EXPECT_EQ(Decoded(board.serial_number()),
+            std::string("PFLQSH123900011\0", 16));
+  EXPECT_EQ(Decoded(board.part_number()), std::string("42000311-01\0", 12));
+  EXPECT_EQ(board.manufacture_date(), kFruEpoch + 0x867e31 * 60);
+}
+
+// Test that the views read the same data as an image generated by
+// Fru::GetImage, including fields which need decoding.
+TEST(FruViewTest, ParseGetImage) {
+  Fru fru;
+  auto *cia = new ChassisInfoArea;
+  cia->set_type(ChassisInfoArea::kRackMountChassis);
+  cia->set_part_number(FruFieldFromString("chassis-part"));
+  cia->set_serial_number(
+      FruFieldFromRawData({0x12, 0x34, 0xab}, FruField::kTypeBcdPlus));
+  fru.SetChassisInfoArea(cia);
+
+  auto *bia = new BoardInfoArea;
+  bia->set_language_code(25);
+  bia->set_manufacture_date(kFruEpoch + 1000 * 60);
+  bia->set_manufacturer(FruFieldFromString("Board Corp"));
+  bia->set_product_name(
+      FruFieldFromRawData({0x37, 0x9a, 0x7f}, FruField::kType6BitAscii));
+  bia->set_serial_number(FruFieldFromString("SN1234"));
+  bia->set_part_number(FruFieldFromString("PN5678"));
+  bia->set_file_id(
+      FruFieldFromRawData({0x00, 0xff, 0x10}, FruField::kTypeBinary));
+  fru.SetBoardInfoArea(bia);
+
+  auto *pia = new ProductInfoArea;
+  pia->set_language_code(25);
+  pia->set_manufacturer(FruFieldFromString("Product Corp"));
+  pia->set_product_name(FruFieldFromString("Widget"));
+  pia->set_part_number(FruFieldFromString("W-1"));
+  pia->set_product_version(FruFieldFromString("v2"));
+  pia->set_serial_number(FruFieldFromString("WS-9"));
+  pia->set_asset_tag(FruFieldFromString("asset"));
+  pia->set_file_id(FruFieldFromString("file"));
+  pia->set_custom_fields({FruFieldFromString("custom1"),
+                          FruFieldFromString("custom2")});
+  fru.SetProductInfoArea(pia);
+
+  std::vector<unsigned char> image;
+  fru.GetImage(&image);
+
+  absl::StatusOr<FruImageView> maybe_view = FruImageView::Parse(image);
+  ASSERT_THAT(maybe_view, IsOk());
+  ASSERT_TRUE(maybe_view->chassis_info().has_value());
+  ASSERT_TRUE(maybe_view->board_info().has_value());
+  ASSERT_TRUE(maybe_view->product_info().has_value());
+
+  const FruChassisInfoView &chassis = *maybe_view->chassis_info();
+  EXPECT_EQ(chassis.type(), ChassisInfoArea::kRackMountChassis);
+  EXPECT_EQ(Decoded(chassis.part_number()), "chassis-part");
+  EXPECT_EQ(chassis.serial_number().type(), FruField::kTypeBcdPlus);
+  EXPECT_EQ(Decoded(chassis.serial_number()), "1234 -");
+
+  const FruBoardInfoView &board = *maybe_view->board_info();
+  EXPECT_EQ(board.language_code(), 25);
+  EXPECT_EQ(board.manufacture_date(), kFruEpoch + 1000 * 60);
+  EXPECT_EQ(Decoded(board.manufacturer()), "Board Corp");
+  EXPECT_EQ(board.product_name().type(), FruField::kType6BitAscii);
+  EXPECT_EQ(Decoded(board.product_name()), "WHY?");
+  EXPECT_EQ(board.product_name().ToString(),
+            bia->product_name().GetDataAsString());
+  EXPECT_EQ(Decoded(board.serial_number()), "SN1234");
+  EXPECT_EQ(Decoded(board.part_number()), "PN5678");
+  EXPECT_TRUE(board.file_id().ToFruField().Equals(bia->file_id()));
+
+  const FruProductInfoView &product = *maybe_view->product_info();
+  EXPECT_EQ(product.language_code(), 25);
+  EXPECT_EQ(Decoded(product.manufacturer()), "Product Corp");
+  EXPECT_EQ(Decoded(product.product_name()), "Widget");
+  EXPECT_EQ(Decoded(product.part_number()), "W-1");
+  EXPECT_EQ(Decoded(product.product_version()), "v2");
+  EXPECT_EQ(Decoded(product.serial_number()), "WS-9");
+  EXPECT_EQ(Decoded(product.asset_tag()), "asset");
+  EXPECT_EQ(Decoded(product.file_id()), "file");
+
+  std::vector<std::string> custom_fields;
+  FruFieldReader reader = product.custom_fields();
+  FruFieldView field;
+  while (reader.Next(&field)) custom_fields.push_back(field.ToString());
+  EXPECT_THAT(custom_fields, ::testing::ElementsAre("custom1", "custom2"));
+}
+
+TEST(FruViewTest, GetCustomField) {
+  ProductInfoArea pia;
+  pia.set_custom_fields(
+      {FruFieldFromString("XY"),
+       FruFieldFromString(
+           absl::StrFormat("%c%s", CustomFieldType::kFabId, "ABCD")),
+       FruFieldFromString(
+           absl::StrFormat("%c%s", CustomFieldType::kFirmwareId, "PL00"))});
+  std::vector<unsigned char> image;
+  pia.GetImage(&image);
+
+  absl::StatusOr<FruProductInfoView> maybe_view =
+      FruProductInfoView::Parse(image, 0);
+  ASSERT_THAT(maybe_view, IsOk());
+
+  FruFieldView::DecodeBuffer buffer;
+  EXPECT_THAT(maybe_view->GetCustomField(CustomFieldType::kFabId, &buffer),
+              IsOkAndHolds("ABCD"));
+  EXPECT_THAT(
+      maybe_view->GetCustomField(CustomFieldType::kFirmwareId, &buffer),
+      IsOkAndHolds("PL00"));
+  EXPECT_TRUE(absl::IsNotFound(
+      maybe_view
+          ->GetCustomField(CustomFieldType::kUnknownCustomFieldType, &buffer)
+          .status()));
+}
+
+TEST(FruViewTest, InvalidCommonHeader) {
+  std::vector<uint8_t> image(std::begin(kPrefabFruData),
+                             std::end(kPrefabFruData));
+  EXPECT_THAT(FruImageView::Parse(absl::MakeConstSpan(image).first(7)),
+              Not(IsOk()));
+
+  // Break the checksum.
+  image[7] += 1;
+  EXPECT_THAT(FruImageView::Parse(image), Not(IsOk()));
+
+  // Change the version, and fix up the checksum.
+  image[0] += 1;
+  image[7] -= 2;
+  EXPECT_THAT(FruImageView::Parse(image), Not(IsOk()));
+}
+
+TEST(FruViewTest, InvalidBoardArea) {
+  std::vector<uint8_t> image(std::begin(kPrefabFruData),
+                             std::end(kPrefabFruData));
+
+  // The area is longer than the image.
+  EXPECT_THAT(FruBoardInfoView::Parse(absl::MakeConstSpan(image).first(60), 8),
+              Not(IsOk()));
+  // The area starts past the end of the image.
+  EXPECT_THAT(FruBoardInfoView::Parse(image, 64), Not(IsOk()));
+
+  // Break the area checksum.
+  image.back() += 1;
+  EXPECT_THAT(FruBoardInfoView::Parse(image, 8), Not(IsOk()));
+  EXPECT_THAT(FruImageView::Parse(image), Not(IsOk()));
+
+  // Make the manufacturer field overrun the area, and fix up the checksum.
+  image[14] += 0x3f - 7;
+  image.back() -= 1 + 0x3f - 7;
+  EXPECT_THAT(FruBoardInfoView::Parse(image, 8), Not(IsOk()));
+}
+
+TEST(FruViewTest, InvalidEncodedField) {
+  // 0xef is not valid BCD plus.
+  constexpr uint8_t kInvalidBcd[] = {0x12, 0xef};
+  FruFieldView field(FruField::kTypeBcdPlus, kInvalidBcd);
+  FruFieldView::DecodeBuffer buffer;
+  EXPECT_THAT(field.Decode(&buffer), Not(IsOk()));
+  EXPECT_EQ(field.ToString(), "");
+}
+
+}  // namespace
+}  // namespace ecclesia
@@ -0,0 +1,243 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/lib/io/pci_caps.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "ecclesia/lib/codec/endian.h"
+#include "ecclesia/magent/lib/io/pci.h"
+#include "ecclesia/magent/lib/io/pci_regs.h"
+
+namespace ecclesia {
+namespace {
+
+// Standard sizes of config space, from largest to smallest. The first is the
+// PCI Express extended config space, the second the conventional PCI config
+// space and the last is the size that sysfs exposes to unprivileged readers.
+constexpr size_t kConfigSpaceSizes[] = {4096, 256, 64};
+
+// Standard capabilities must live above the header and within the first 256
+// bytes. Each capability is at least 2 bytes, which bounds the list length.
+constexpr uint16_t kPciCapStartReg = 0x40;
+constexpr uint16_t kPciCapEndReg = 0x100;
+constexpr int kMaxStandardCapabilities = (kPciCapEndReg - kPciCapStartReg) / 2;
+
+// Extended capabilities are dword-sized and aligned.
+constexpr int kMaxExtendedCapabilities =
+    (kPcieExtCapEndReg - kPcieExtCapStartReg) / 4;
+
+}  // namespace
+
+absl::optional<uint16_t> PciCapabilityList::FindCapability(uint8_t id) const {
+  for (const PciCapability &cap : standard) {
+    if (cap.id == id) return cap.offset;
+  }
+  return absl::nullopt;
+}
+
+absl::optional<uint16_t> PciCapabilityList::FindExtendedCapability(
+    uint16_t id) const {
+  for (const PciExtendedCapability &cap : extended) {
+    if (cap.id == id) return cap.offset;
+  }
+  return absl::nullopt;
+}
+
+absl::StatusOr<PciConfigSnapshot> PciConfigSnapshot::ReadFrom(
+    const PciRegion &region) {
+  absl::Status status = absl::InvalidArgumentError(
+      absl::StrFormat("region of size %d is too small", region.Size()));
+  for (size_t size : kConfigSpaceSizes) {
+    if (size > region.Size()) continue;
+    std::vector<char> data(size);
+    status = region.ReadBytes(0, absl::MakeSpan(data));
+    if (status.ok()) return PciConfigSnapshot(std::move(data));
+    // There is no point in trying a smaller read if the device doesn't exist.
+    if (absl::IsNotFound(status)) break;
+  }
+  return status;
+}
+
+PciConfigSnapshot::PciConfigSnapshot(std::vector<char> data)
+    : PciRegion(data.size()), data_(std::move(data)) {}
+
+absl::StatusOr<uint8_t> PciConfigSnapshot::Read8(size_t offset) const {
+  if (offset + sizeof(uint8_t) > data_.size()) {
+    return absl::OutOfRangeError(
+        absl::StrFormat("offset %#x is outside of config snapshot", offset));
+  }
+  return LittleEndian::Load8(&data_[offset]);
+}
+
+absl::Status PciConfigSnapshot::Write8(size_t offset, uint8_t data) {
+  return absl::FailedPreconditionError("config snapshots are read-only");
+}
+
+absl::StatusOr<uint16_t> PciConfigSnapshot::Read16(size_t offset) const {
+  if (offset + sizeof(uint16_t) > data_.size()) {
+    return absl::OutOfRangeError(
+        absl::StrFormat("offset %#x is outside of config snapshot", offset));
+  }
+  return LittleEndian::Load16(&data_[offset]);
+}
+
+absl::Status PciConfigSnapshot::Write16(size_t offset, uint16_t data) {
+  return absl::FailedPreconditionError("config snapshots are read-only");
+}
+
+absl::StatusOr<uint32_t> PciConfigSnapshot::Read32(size_t offset) const {
+  if (offset + sizeof(uint32_t) > data_.size()) {
+    return absl::OutOfRangeError(
+        absl::StrFormat("offset %#x is outside of config snapshot", offset));
+  }
+  return LittleEndian::Load32(&data_[offset]);
+}
+
+absl::Status PciConfigSnapshot::Write32(size_t offset, uint32_t data) {
+  return absl::FailedPreconditionError("config snapshots are read-only");
+}
+
+absl::Status PciConfigSnapshot::ReadBytes(uint64_t offset,
+                                          absl::Span<char> value) const {
+  if (offset > data_.size() || value.size() > data_.size() - offset) {
+    return absl::OutOfRangeError(absl::StrFormat(
+        "%d bytes at offset %#x is outside of config snapshot", value.size(),
+        offset));
+  }
+  std::memcpy(value.data(), &data_[offset], value.size());
+  return absl::OkStatus();
+}
+
+absl::Status PciConfigSnapshot::WriteBytes(uint64_t offset,
+                                           absl::Span<const char> value) {
+  return absl::FailedPreconditionError("config snapshots are read-only");
+}
+
+PciCapabilityList PciConfigSnapshot::Capabilities() const {
+  PciCapabilityList caps;
+
+  // Walk the standard list, if the device says it has one.
+  auto maybe_status = Read16(kPciStatusReg);
+  auto maybe_pointer = Read8(kPciCapPointerReg);
+  if (maybe_status.ok() && (*maybe_status & kPciStatusCapabilitiesList) &&
+      maybe_pointer.ok()) {
+    // The bottom two bits of capability pointers are reserved.
+    uint16_t offset = *maybe_pointer & ~0x3;
+    absl::flat_hash_set<uint16_t> visited;
+    while (offset >= kPciCapStartReg && offset < kPciCapEndReg &&
+           caps.standard.size() < kMaxStandardCapabilities &&
+           visited.insert(offset).second) {
+      auto maybe_id = Read8(offset + kPciCapListIdOffset);
+      auto maybe_next = Read8(offset + kPciCapListNextOffset);
+      if (!maybe_id.ok() || !maybe_next.ok()) break;
+      caps.standard.push_back({*maybe_id, offset});
+      offset = *maybe_next & ~0x3;
+    }
+  }
+
+  // Walk the extended list. It always starts at a fixed offset and is only
+  // present if the snapshot includes the extended config space. An all-zero
+  // header indicates there are no extended capabilities.
+  uint16_t offset = kPcieExtCapStartReg;
+  absl::flat_hash_set<uint16_t> visited;
+  while (offset >= kPcieExtCapStartReg && offset < kPcieExtCapEndReg &&
+         caps.extended.size() < kMaxExtendedCapabilities &&
+         visited.insert(offset).second) {
+    auto maybe_header = Read32(offset);
+    if (!maybe_header.ok() || *maybe_header == 0 ||
+        *maybe_header == 0xffffffff) {
+      break;
+    }
+    uint32_t header = *maybe_header;
+    caps.extended.push_back(
+        {static_cast<uint16_t>(header & kPcieExtCapHeaderIdMask),
+         static_cast<uint8_t>((header >> kPcieExtCapHeaderVersionShift) &
+                              kPcieExtCapHeaderVersionMask),
+         offset});
+    offset = (header >> kPcieExtCapHeaderNextShift) & kPcieExtCapHeaderNextMask;
+  }
+
+  return caps;
+}
+
+absl::StatusOr<PcieLinkStatus> PciConfigSnapshot::LinkStatus() const {
+  absl::optional<uint16_t> cap = Capabilities().FindCapability(kPciCapIdPcie);
+  if (!cap.has_value()) {
+    return absl::NotFoundError("device has no PCI Express capability");
+  }
+  auto maybe_link_status = Read16(*cap + kPciCapPcieLinkStatusOffset);
+  if (!maybe_link_status.ok()) return maybe_link_status.status();
+  uint16_t link_status = *maybe_link_status;
+  return PcieLinkStatus{
+      .speed = static_cast<int>(link_status & kPciCapPcieLinkStatusSpeedMask),
+      .width = static_cast<int>(
+          (link_status & kPciCapPcieLinkStatusWidthMask) >> 4),
+      .link_active =
+          (link_status & kPciCapPcieLinkStatusDataLinkLayerLinkActiveMask) != 0,
+  };
+}
+
+absl::StatusOr<PcieAerStatus> PciConfigSnapshot::AerStatus() const {
+  absl::optional<uint16_t> cap =
+      Capabilities().FindExtendedCapability(kPcieExtCapIdAer);
+  if (!cap.has_value()) {
+    return absl::NotFoundError("device has no AER capability");
+  }
+  PcieAerStatus aer;
+  for (auto [reg, field] : {
+           std::make_pair(kPcieExtCapAerUncorrectableStatus,
+                          &aer.uncorrectable_status),
+           std::make_pair(kPcieExtCapAerUncorrectableMask,
+                          &aer.uncorrectable_mask),
+           std::make_pair(kPcieExtCapAerUncorrectableSeverity,
+                          &aer.uncorrectable_severity),
+           std::make_pair(kPcieExtCapAerCorrectableStatus,
+                          &aer.correctable_status),
+           std::make_pair(kPcieExtCapAerCorrectableMask,
+                          &aer.correctable_mask),
+       }) {
+    auto maybe_value = Read32(*cap + reg);
+    if (!maybe_value.ok()) return maybe_value.status();
+    *field = *maybe_value;
+  }
+  return aer;
+}
+
+absl::StatusOr<uint64_t> PciConfigSnapshot::SerialNumber() const {
+  absl::optional<uint16_t> cap =
+      Capabilities().FindExtendedCapability(kPcieExtCapIdDsn);
+  if (!cap.has_value()) {
+    return absl::NotFoundError("device has no serial number capability");
+  }
+  auto maybe_lower = Read32(*cap + kPcieExtCapDsnLower);
+  if (!maybe_lower.ok()) return maybe_lower.status();
+  auto maybe_upper = Read32(*cap + kPcieExtCapDsnUpper);
+  if (!maybe_upper.ok()) return maybe_upper.status();
+  return (static_cast<uint64_t>(*maybe_upper) << 32) | *maybe_lower;
+}
+
+}  // namespace ecclesia
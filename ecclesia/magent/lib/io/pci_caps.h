@@ -0,0 +1,125 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Provides support for walking the capability lists of a PCI device. Rather
+// than doing a separate read for every capability header, the walker operates
+// on a snapshot of config space that is captured with a single bulk read from
+// an underlying PciRegion.
+
+#ifndef ECCLESIA_MAGENT_LIB_IO_PCI_CAPS_H_
+#define ECCLESIA_MAGENT_LIB_IO_PCI_CAPS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "ecclesia/magent/lib/io/pci.h"
+
+namespace ecclesia {
+
+// A capability from the standard (non-extended) capability list.
+struct PciCapability {
+  uint8_t id;
+  uint16_t offset;
+};
+
+// A capability from the PCI Express extended capability list.
+struct PciExtendedCapability {
+  uint16_t id;
+  uint8_t version;
+  uint16_t offset;
+};
+
+// The layout of all of the capabilities found in a device's config space.
+struct PciCapabilityList {
+  std::vector<PciCapability> standard;
+  std::vector<PciExtendedCapability> extended;
+
+  // Find the offset of the first capability with the given ID. Returns nullopt
+  // if the device does not have the capability.
+  absl::optional<uint16_t> FindCapability(uint8_t id) const;
+  absl::optional<uint16_t> FindExtendedCapability(uint16_t id) const;
+};
+
+// Decoded contents of the PCI Express link status register.
+struct PcieLinkStatus {
+  // The raw link speed encoding, 1 = 2.5GT/s, 2 = 5.0GT/s, etc.
+  int speed;
+  // The negotiated link width, in lanes.
+  int width;
+  bool link_active;
+};
+
+// Error status registers from the Advanced Error Reporting capability.
+struct PcieAerStatus {
+  uint32_t uncorrectable_status;
+  uint32_t uncorrectable_mask;
+  uint32_t uncorrectable_severity;
+  uint32_t correctable_status;
+  uint32_t correctable_mask;
+};
+
+// An in-memory copy of a device's config space. This is itself a PciRegion so
+// it can be wrapped in a PciConfigSpace to read header fields without going
+// back to the underlying device. It is read-only; writes always fail.
+class PciConfigSnapshot : public PciRegion {
+ public:
+  // Capture a snapshot of the given region. The full region is read with a
+  // single bulk read. If that fails (e.g. because only the standard 256-byte
+  // config space is exposed) then smaller standard sizes are tried.
+  static absl::StatusOr<PciConfigSnapshot> ReadFrom(const PciRegion &region);
+
+  // Construct a snapshot directly from a block of config space data.
+  explicit PciConfigSnapshot(std::vector<char> data);
+
+  PciConfigSnapshot(PciConfigSnapshot &&other) = default;
+
+  absl::StatusOr<uint8_t> Read8(size_t offset) const override;
+  absl::Status Write8(size_t offset, uint8_t data) override;
+
+  absl::StatusOr<uint16_t> Read16(size_t offset) const override;
+  absl::Status Write16(size_t offset, uint16_t data) override;
+
+  absl::StatusOr<uint32_t> Read32(size_t offset) const override;
+  absl::Status Write32(size_t offset, uint32_t data) override;
+
+  absl::Status ReadBytes(uint64_t offset,
+                         absl::Span<char> value) const override;
+  absl::Status WriteBytes(uint64_t offset,
+                          absl::Span<const char> value) override;
+
+  // Walk both the standard and the extended capability lists. Malformed lists
+  // (pointers out of range, or loops) are truncated at the point where they
+  // become invalid rather than treated as an error.
+  PciCapabilityList Capabilities() const;
+
+  // Decode commonly used capability registers. These return a not found error
+  // if the device does not have the relevant capability.
+  absl::StatusOr<PcieLinkStatus> LinkStatus() const;
+  absl::StatusOr<PcieAerStatus> AerStatus() const;
+  absl::StatusOr<uint64_t> SerialNumber() const;
+
+ private:
+  std::vector<char> data_;
+};
+
+}  // namespace ecclesia
+
+#endif  // ECCLESIA_MAGENT_LIB_IO_PCI_CAPS_H_
@@ -0,0 +1,252 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/lib/io/pci_caps.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "ecclesia/lib/codec/endian.h"
+#include "ecclesia/lib/file/test_filesystem.h"
+#include "ecclesia/lib/testing/status.h"
+#include "ecclesia/magent/lib/io/pci.h"
+#include "ecclesia/magent/lib/io/pci_location.h"
+#include "ecclesia/magent/lib/io/pci_regs.h"
+#include "ecclesia/magent/lib/io/pci_sys.h"
+
+namespace ecclesia {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::Eq;
+using ::testing::IsEmpty;
+using ::testing::Not;
+
+// Matchers for checking capabilities.
+MATCHER_P2(IsCap, id, offset, "") {
+  return arg.id == id && arg.offset == offset;
+}
+MATCHER_P3(IsExtCap, id, version, offset, "") {
+  return arg.id == id && arg.version == version && arg.offset == offset;
+}
+
+// Helper for building up a synthetic config space.
+class ConfigBuilder {
+ public:
+  explicit ConfigBuilder(size_t size) : data_(size, 0) {}
+
+  ConfigBuilder &Set8(size_t offset, uint8_t value) {
+    LittleEndian::Store8(value, &data_[offset]);
+    return *this;
+  }
+  ConfigBuilder &Set16(size_t offset, uint16_t value) {
+    LittleEndian::Store16(value, &data_[offset]);
+    return *this;
+  }
+  ConfigBuilder &Set32(size_t offset, uint32_t value) {
+    LittleEndian::Store32(value, &data_[offset]);
+    return *this;
+  }
+
+  // Add a standard capability at the given offset, linking to next.
+  ConfigBuilder &AddCap(uint8_t offset, uint8_t id, uint8_t next) {
+    return Set8(offset + kPciCapListIdOffset, id)
+        .Set8(offset + kPciCapListNextOffset, next);
+  }
+  // Add an extended capability at the given offset, linking to next.
+  ConfigBuilder &AddExtCap(uint16_t offset, uint16_t id, uint8_t version,
+                           uint16_t next) {
+    return Set32(offset, id | (version << 16) | (next << 20));
+  }
+
+  std::vector<char> Build() const { return data_; }
+
+ private:
+  std::vector<char> data_;
+};
+
+// A config space for a typical PCI Express endpoint with several standard and
+// extended capabilities.
+std::vector<char> MakeEndpointConfig() {
+  return ConfigBuilder(4096)
+      .Set16(kPciVidReg, 0x8086)
+      .Set16(kPciDidReg, 0x1234)
+      .Set16(kPciStatusReg, kPciStatusCapabilitiesList)
+      .Set8(kPciCapPointerReg, 0x40)
+      .AddCap(0x40, kPciCapIdPowerManagement, 0x50)
+      .AddCap(0x50, kPciCapIdPcie, 0x70)
+      // Link active, x8, 8GT/s.
+      .Set16(0x50 + kPciCapPcieLinkStatusOffset, (1 << 13) | (8 << 4) | 3)
+      .AddCap(0x70, kPciCapIdMsix, 0x00)
+      .AddExtCap(0x100, kPcieExtCapIdAer, 2, 0x148)
+      .Set32(0x100 + kPcieExtCapAerUncorrectableStatus, 0x00100000)
+      .Set32(0x100 + kPcieExtCapAerUncorrectableMask, 0x00400000)
+      .Set32(0x100 + kPcieExtCapAerUncorrectableSeverity, 0x00462030)
+      .Set32(0x100 + kPcieExtCapAerCorrectableStatus, 0x00000041)
+      .Set32(0x100 + kPcieExtCapAerCorrectableMask, 0x00002000)
+      .AddExtCap(0x148, kPcieExtCapIdDsn, 1, 0x000)
+      .Set32(0x148 + kPcieExtCapDsnLower, 0x89abcdef)
+      .Set32(0x148 + kPcieExtCapDsnUpper, 0x01234567)
+      .Build();
+}
+
+TEST(PciConfigSnapshotTest, HeaderFieldsThroughConfigSpace) {
+  PciConfigSnapshot snapshot(MakeEndpointConfig());
+  PciConfigSpace config(&snapshot);
+
+  EXPECT_THAT(config.VendorId(), IsOkAndHolds(0x8086));
+  EXPECT_THAT(config.DeviceId(), IsOkAndHolds(0x1234));
+  EXPECT_THAT(config.WriteCommand(0x6), Not(IsOk()));
+}
+
+TEST(PciConfigSnapshotTest, ReadsOutOfRangeFail) {
+  PciConfigSnapshot snapshot(std::vector<char>(64));
+
+  EXPECT_THAT(snapshot.Read8(63), IsOk());
+  EXPECT_THAT(snapshot.Read8(64), Not(IsOk()));
+  EXPECT_THAT(snapshot.Read16(63), Not(IsOk()));
+  EXPECT_THAT(snapshot.Read32(61), Not(IsOk()));
+  char buffer[8];
+  EXPECT_THAT(snapshot.ReadBytes(60, absl::MakeSpan(buffer)), Not(IsOk()));
+}
+
+TEST(PciConfigSnapshotTest, WalkCapabilities) {
+  PciConfigSnapshot snapshot(MakeEndpointConfig());
+  PciCapabilityList caps = snapshot.Capabilities();
+
+  EXPECT_THAT(caps.standard,
+              ElementsAre(IsCap(kPciCapIdPowerManagement, 0x40),
+                          IsCap(kPciCapIdPcie, 0x50),
+                          IsCap(kPciCapIdMsix, 0x70)));
+  EXPECT_THAT(caps.extended, ElementsAre(IsExtCap(kPcieExtCapIdAer, 2, 0x100),
+                                         IsExtCap(kPcieExtCapIdDsn, 1, 0x148)));
+
+  EXPECT_THAT(caps.FindCapability(kPciCapIdPcie), Eq(0x50));
+  EXPECT_THAT(caps.FindCapability(kPciCapIdPcix), Eq(absl::nullopt));
+  EXPECT_THAT(caps.FindExtendedCapability(kPcieExtCapIdDsn), Eq(0x148));
+  EXPECT_THAT(caps.FindExtendedCapability(kSecondaryPcieExtCapId),
+              Eq(absl::nullopt));
+}
+
+TEST(PciConfigSnapshotTest, NoCapabilitiesWithoutStatusBit) {
+  std::vector<char> data = MakeEndpointConfig();
+  LittleEndian::Store16(0, &data[kPciStatusReg]);
+  PciConfigSnapshot snapshot(std::move(data));
+
+  EXPECT_THAT(snapshot.Capabilities().standard, IsEmpty());
+  EXPECT_THAT(snapshot.LinkStatus(), Not(IsOk()));
+}
+
+TEST(PciConfigSnapshotTest, NoExtendedCapabilitiesInSmallConfig) {
+  std::vector<char> data = MakeEndpointConfig();
+  data.resize(256);
+  PciConfigSnapshot snapshot(std::move(data));
+
+  PciCapabilityList caps = snapshot.Capabilities();
+  EXPECT_THAT(caps.standard, Not(IsEmpty()));
+  EXPECT_THAT(caps.extended, IsEmpty());
+  EXPECT_THAT(snapshot.AerStatus(), Not(IsOk()));
+  EXPECT_THAT(snapshot.SerialNumber(), Not(IsOk()));
+}
+
+TEST(PciConfigSnapshotTest, LoopingListsTerminate) {
+  PciConfigSnapshot snapshot(
+      ConfigBuilder(4096)
+          .Set16(kPciStatusReg, kPciStatusCapabilitiesList)
+          .Set8(kPciCapPointerReg, 0x40)
+          .AddCap(0x40, kPciCapIdPcie, 0x60)
+          .AddCap(0x60, kPciCapIdMsix, 0x40)
+          .AddExtCap(0x100, kPcieExtCapIdAer, 1, 0x200)
+          .AddExtCap(0x200, kPcieExtCapIdDsn, 1, 0x100)
+          .Build());
+  PciCapabilityList caps = snapshot.Capabilities();
+
+  EXPECT_THAT(caps.standard, ElementsAre(IsCap(kPciCapIdPcie, 0x40),
+                                         IsCap(kPciCapIdMsix, 0x60)));
+  EXPECT_THAT(caps.extended, ElementsAre(IsExtCap(kPcieExtCapIdAer, 1, 0x100),
+                                         IsExtCap(kPcieExtCapIdDsn, 1, 0x200)));
+}
+
+TEST(PciConfigSnapshotTest, DecodeRegisters) {
+  PciConfigSnapshot snapshot(MakeEndpointConfig());
+
+  auto maybe_link = snapshot.LinkStatus();
+  ASSERT_THAT(maybe_link, IsOk());
+  EXPECT_EQ(maybe_link->speed, 3);
+  EXPECT_EQ(maybe_link->width, 8);
+  EXPECT_TRUE(maybe_link->link_active);
+
+  auto maybe_aer = snapshot.AerStatus();
+  ASSERT_THAT(maybe_aer, IsOk());
+  EXPECT_EQ(maybe_aer->uncorrectable_status, 0x00100000);
+  EXPECT_EQ(maybe_aer->uncorrectable_mask, 0x00400000);
+  EXPECT_EQ(maybe_aer->uncorrectable_severity, 0x00462030);
+  EXPECT_EQ(maybe_aer->correctable_status, 0x00000041);
+  EXPECT_EQ(maybe_aer->correctable_mask, 0x00002000);
+
+  EXPECT_THAT(snapshot.SerialNumber(), IsOkAndHolds(0x0123456789abcdef));
+}
+
+class PciConfigSnapshotSysfsTest : public ::testing::Test {
+ protected:
+  PciConfigSnapshotSysfsTest() : fs_(GetTestTempdirPath()) {
+    fs_.CreateDir("/sys/bus/pci/devices/0000:01:00.0");
+  }
+
+  TestFilesystem fs_;
+};
+
+TEST_F(PciConfigSnapshotSysfsTest, ReadFullConfig) {
+  std::vector<char> data = MakeEndpointConfig();
+  fs_.CreateFile("/sys/bus/pci/devices/0000:01:00.0/config",
+                 std::string(data.begin(), data.end()));
+  SysPciRegion region(fs_.GetTruePath("/sys/bus/pci/devices"),
+                      PciLocation::Make<0, 1, 0, 0>());
+
+  auto maybe_snapshot = PciConfigSnapshot::ReadFrom(region);
+  ASSERT_THAT(maybe_snapshot, IsOk());
+  EXPECT_EQ(maybe_snapshot->Size(), 4096);
+  EXPECT_THAT(maybe_snapshot->SerialNumber(), IsOkAndHolds(0x0123456789abcdef));
+}
+
+TEST_F(PciConfigSnapshotSysfsTest, ReadFallsBackToSmallerConfig) {
+  std::vector<char> data = MakeEndpointConfig();
+  fs_.CreateFile("/sys/bus/pci/devices/0000:01:00.0/config",
+                 std::string(data.begin(), data.begin() + 64));
+  SysPciRegion region(fs_.GetTruePath("/sys/bus/pci/devices"),
+                      PciLocation::Make<0, 1, 0, 0>());
+
+  auto maybe_snapshot = PciConfigSnapshot::ReadFrom(region);
+  ASSERT_THAT(maybe_snapshot, IsOk());
+  EXPECT_EQ(maybe_snapshot->Size(), 64);
+  EXPECT_THAT(maybe_snapshot->Read16(kPciVidReg), IsOkAndHolds(0x8086));
+}
+
+TEST_F(PciConfigSnapshotSysfsTest, ReadMissingDeviceFails) {
+  SysPciRegion region(fs_.GetTruePath("/sys/bus/pci/devices"),
+                      PciLocation::Make<0, 2, 0, 0>());
+
+  EXPECT_TRUE(absl::IsNotFound(PciConfigSnapshot::ReadFrom(region).status()));
+}
+
+}  // namespace
+}  // namespace ecclesia
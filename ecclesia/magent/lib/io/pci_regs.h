@@ -44,6 +44,9 @@ constexpr int8_t kPciCapPointerReg = 0x34;
 constexpr int8_t kPciInterruptLineReg = 0x3c;
 constexpr int8_t kPciInterruptPinReg = 0x3d;
 
+// Status register bits.
+constexpr uint16_t kPciStatusCapabilitiesList = (1 << 4);
+
 // Type 0 Configuration Space.
 constexpr uint8_t kPciType0Bar0Reg = 0x10;
 constexpr uint8_t kPciType0Bar1Reg = 0x14;
@@ -123,12 +126,26 @@ constexpr uint8_t kPciCapIdMsixPbaOffset = 0x08;
 
 // Pci Express Extended Capabilities.
 constexpr uint16_t kPcieExtCapStartReg = 0x100;
+constexpr uint16_t kPcieExtCapEndReg = 0x1000;
+
+// Pci Express Extended Capability header accessors. The header is a 32-bit
+// value with the capability ID, version and the offset of the next capability.
+constexpr uint32_t kPcieExtCapHeaderIdMask = 0xffff;
+constexpr uint32_t kPcieExtCapHeaderVersionShift = 16;
+constexpr uint32_t kPcieExtCapHeaderVersionMask = 0xf;
+constexpr uint32_t kPcieExtCapHeaderNextShift = 20;
+constexpr uint32_t kPcieExtCapHeaderNextMask = 0xffc;
 
 // Pci Express Advanced Error Reporting Capability.
 constexpr uint16_t kPcieExtCapIdAer = 0x0001;
 constexpr uint16_t kPcieExtCapVersionAer = 0x1;
 constexpr uint16_t kPcieExtCapAerNoncomplexSize = 44;
 constexpr uint16_t kPcieExtCapAerComplexSize = 56;
+constexpr uint16_t kPcieExtCapAerUncorrectableStatus = 0x04;
+constexpr uint16_t kPcieExtCapAerUncorrectableMask = 0x08;
+constexpr uint16_t kPcieExtCapAerUncorrectableSeverity = 0x0c;
+constexpr uint16_t kPcieExtCapAerCorrectableStatus = 0x10;
+constexpr uint16_t kPcieExtCapAerCorrectableMask = 0x14;
 
 // Pci Express Device Serial Number Capability.
 constexpr uint16_t kPcieExtCapIdDsn = 0x0003;
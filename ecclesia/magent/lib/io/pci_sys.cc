@@ -20,6 +20,7 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <string>
 #include <utility>
 #include <vector>
@@ -32,13 +33,21 @@
 #include "absl/strings/strip.h"
 #include "absl/strings/substitute.h"
 #include "absl/types/optional.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/span.h"
 #include "ecclesia/lib/apifs/apifs.h"
+#include "ecclesia/lib/cache/rcu_snapshot.h"
 #include "ecclesia/lib/codec/endian.h"
 #include "ecclesia/lib/file/dir.h"
+#include "ecclesia/lib/file/mmap.h"
+#include "ecclesia/lib/file/path.h"
+#include "ecclesia/lib/logging/logging.h"
 #include "ecclesia/lib/types/fixed_range_int.h"
+#include "ecclesia/lib/uevent/invalidation_service.h"
 #include "ecclesia/magent/lib/io/pci.h"
+#include "ecclesia/magent/lib/io/pci_caps.h"
 #include "ecclesia/magent/lib/io/pci_location.h"
+#include "ecclesia/magent/lib/io/pci_topology.h"
 #include "re2/re2.h"
 
 namespace ecclesia {
@@ -127,6 +136,197 @@ absl::Status SysPciRegion::WriteBytes(uint64_t offset,
   return apifs_.SeekAndWrite(offset, value);
 }
 
+absl::StatusOr<SysPciMmioRegion> SysPciMmioRegion::Create(
+    const PciLocation &pci_loc, PciResources::BarNum bar_id,
+    MappedMemory::Type type) {
+  return Create(kSysPciRoot, pci_loc, bar_id, type);
+}
+
+absl::StatusOr<SysPciMmioRegion> SysPciMmioRegion::Create(
+    const std::string &sys_pci_devices_dir, const PciLocation &pci_loc,
+    PciResources::BarNum bar_id, MappedMemory::Type type) {
+  // The size of the resource file is the size of the BAR.
+  ApifsFile resource_file(absl::StrFormat("%s/%s/resource%d",
+                                          sys_pci_devices_dir,
+                                          absl::FormatStreamed(pci_loc),
+                                          bar_id.value()));
+  auto maybe_stat = resource_file.Stat();
+  if (!maybe_stat.ok()) return maybe_stat.status();
+  if (maybe_stat->st_size <= 0) {
+    return absl::FailedPreconditionError(absl::StrFormat(
+        "BAR resource %s has no memory to map", resource_file.GetPath()));
+  }
+
+  auto maybe_mapping = MappedMemory::Create(resource_file.GetPath(), 0,
+                                            maybe_stat->st_size, type);
+  if (!maybe_mapping.ok()) return maybe_mapping.status();
+  return SysPciMmioRegion(std::move(*maybe_mapping));
+}
+
+SysPciMmioRegion::SysPciMmioRegion(MappedMemory mapping)
+    : PciRegion(mapping.MemoryAsReadOnlySpan().size()),
+      mapping_(std::move(mapping)) {}
+
+absl::Status SysPciMmioRegion::CheckRange(uint64_t offset, size_t size) const {
+  if (offset > Size() || size > Size() - offset) {
+    return absl::OutOfRangeError(
+        absl::StrFormat("%d bytes at offset %#x is outside of a %d byte BAR",
+                        size, offset, Size()));
+  }
+  return absl::OkStatus();
+}
+
+template <typename IntType>
+absl::StatusOr<IntType> SysPciMmioRegion::ReadValue(size_t offset) const {
+  if (absl::Status status = CheckRange(offset, sizeof(IntType)); !status.ok()) {
+    return status;
+  }
+  if (offset % sizeof(IntType) != 0) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "offset %#x is not aligned for a %d byte access", offset,
+        sizeof(IntType)));
+  }
+  // Do a single access of the exact width and then decode the bytes read.
+  const char *base = mapping_.MemoryAsReadOnlySpan().data();
+  char buffer[sizeof(IntType)];
+  IntType raw = *reinterpret_cast<const volatile IntType *>(base + offset);
+  std::memcpy(buffer, &raw, sizeof(IntType));
+  if constexpr (sizeof(IntType) == sizeof(uint8_t)) {
+    return LittleEndian::Load8(buffer);
+  } else if constexpr (sizeof(IntType) == sizeof(uint16_t)) {
+    return LittleEndian::Load16(buffer);
+  } else if constexpr (sizeof(IntType) == sizeof(uint32_t)) {
+    return LittleEndian::Load32(buffer);
+  } else {
+    return LittleEndian::Load64(buffer);
+  }
+}
+
+template <typename IntType>
+absl::Status SysPciMmioRegion::WriteValue(size_t offset, IntType value) {
+  if (absl::Status status = CheckRange(offset, sizeof(IntType)); !status.ok()) {
+    return status;
+  }
+  if (offset % sizeof(IntType) != 0) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "offset %#x is not aligned for a %d byte access", offset,
+        sizeof(IntType)));
+  }
+  absl::Span<char> memory = mapping_.MemoryAsReadWriteSpan();
+  if (memory.empty()) {
+    return absl::FailedPreconditionError("BAR is mapped read-only");
+  }
+  // Encode the value and then do a single access of the exact width.
+  char buffer[sizeof(IntType)];
+  if constexpr (sizeof(IntType) == sizeof(uint8_t)) {
+    LittleEndian::Store8(value, buffer);
+  } else if constexpr (sizeof(IntType) == sizeof(uint16_t)) {
+    LittleEndian::Store16(value, buffer);
+  } else if constexpr (sizeof(IntType) == sizeof(uint32_t)) {
+    LittleEndian::Store32(value, buffer);
+  } else {
+    LittleEndian::Store64(value, buffer);
+  }
+  IntType raw;
+  std::memcpy(&raw, buffer, sizeof(IntType));
+  *reinterpret_cast<volatile IntType *>(memory.data() + offset) = raw;
+  return absl::OkStatus();
+}
+
+absl::StatusOr<uint8_t> SysPciMmioRegion::Read8(size_t offset) const {
+  return ReadValue<uint8_t>(offset);
+}
+
+absl::Status SysPciMmioRegion::Write8(size_t offset, uint8_t data) {
+  return WriteValue<uint8_t>(offset, data);
+}
+
+absl::StatusOr<uint16_t> SysPciMmioRegion::Read16(size_t offset) const {
+  return ReadValue<uint16_t>(offset);
+}
+
+absl::Status SysPciMmioRegion::Write16(size_t offset, uint16_t data) {
+  return WriteValue<uint16_t>(offset, data);
+}
+
+absl::StatusOr<uint32_t> SysPciMmioRegion::Read32(size_t offset) const {
+  return ReadValue<uint32_t>(offset);
+}
+
+absl::Status SysPciMmioRegion::Write32(size_t offset, uint32_t data) {
+  return WriteValue<uint32_t>(offset, data);
+}
+
+absl::StatusOr<uint64_t> SysPciMmioRegion::Read64(size_t offset) const {
+  return ReadValue<uint64_t>(offset);
+}
+
+absl::Status SysPciMmioRegion::Write64(size_t offset, uint64_t data) {
+  return WriteValue<uint64_t>(offset, data);
+}
+
+absl::Status SysPciMmioRegion::ReadBytes(uint64_t offset,
+                                         absl::Span<char> value) const {
+  if (absl::Status status = CheckRange(offset, value.size()); !status.ok()) {
+    return status;
+  }
+  const volatile char *src = mapping_.MemoryAsReadOnlySpan().data() + offset;
+  char *dst = value.data();
+  size_t remaining = value.size();
+  // Copy bytes until the source is dword aligned, then copy whole dwords, and
+  // finally pick up any trailing bytes.
+  while (remaining > 0 && (offset % sizeof(uint32_t)) != 0) {
+    *dst++ = *src++;
+    ++offset;
+    --remaining;
+  }
+  while (remaining >= sizeof(uint32_t)) {
+    uint32_t dword = *reinterpret_cast<const volatile uint32_t *>(src);
+    std::memcpy(dst, &dword, sizeof(dword));
+    src += sizeof(uint32_t);
+    dst += sizeof(uint32_t);
+    remaining -= sizeof(uint32_t);
+  }
+  while (remaining > 0) {
+    *dst++ = *src++;
+    --remaining;
+  }
+  return absl::OkStatus();
+}
+
+absl::Status SysPciMmioRegion::WriteBytes(uint64_t offset,
+                                          absl::Span<const char> value) {
+  if (absl::Status status = CheckRange(offset, value.size()); !status.ok()) {
+    return status;
+  }
+  absl::Span<char> memory = mapping_.MemoryAsReadWriteSpan();
+  if (memory.empty()) {
+    return absl::FailedPreconditionError("BAR is mapped read-only");
+  }
+  volatile char *dst = memory.data() + offset;
+  const char *src = value.data();
+  size_t remaining = value.size();
+  // Same strategy as for reads: align, copy dwords, then trailing bytes.
+  while (remaining > 0 && (offset % sizeof(uint32_t)) != 0) {
+    *dst++ = *src++;
+    ++offset;
+    --remaining;
+  }
+  while (remaining >= sizeof(uint32_t)) {
+    uint32_t dword;
+    std::memcpy(&dword, src, sizeof(dword));
+    *reinterpret_cast<volatile uint32_t *>(dst) = dword;
+    src += sizeof(uint32_t);
+    dst += sizeof(uint32_t);
+    remaining -= sizeof(uint32_t);
+  }
+  while (remaining > 0) {
+    *dst++ = *src++;
+    --remaining;
+  }
+  return absl::OkStatus();
+}
+
 SysfsPciResources::SysfsPciResources(PciLocation loc)
     : SysfsPciResources(kSysPciRoot, std::move(loc)) {}
 
@@ -190,18 +390,87 @@ SysfsPciDiscovery::SysfsPciDiscovery(const std::string &sys_pci_devices_dir)
 
 absl::StatusOr<std::vector<PciLocation>>
 SysfsPciDiscovery::EnumerateAllDevices() const {
-  std::vector<PciLocation> pci_locations;
+  auto maybe_iter = DirectoryIterator::Open(sys_pci_devices_dir_);
+  if (!maybe_iter.ok()) return maybe_iter.status();
 
-  absl::Status status = WithEachFileInDirectory(
-      sys_pci_devices_dir_, [&pci_locations](absl::string_view filename) {
-        auto maybe_loc = PciLocation::FromString(filename);
-        if (maybe_loc.has_value()) {
-          pci_locations.push_back(maybe_loc.value());
-        }
-      });
-  if (!status.ok()) return status;
+  std::vector<PciLocation> pci_locations;
+  DirectoryEntry entry;
+  while (maybe_iter->Next(&entry)) {
+    auto maybe_loc = PciLocation::FromString(entry.name);
+    if (maybe_loc.has_value()) {
+      pci_locations.push_back(maybe_loc.value());
+    }
+  }
+  if (!maybe_iter->status().ok()) return maybe_iter->status();
 
   std::sort(pci_locations.begin(), pci_locations.end());
   return pci_locations;
 }
+
+SysfsPciTopology::SysfsPciTopology() : SysfsPciTopology(kSysPciRoot) {}
+
+SysfsPciTopology::SysfsPciTopology(std::string sys_pci_devices_dir)
+    : SysfsPciTopology(std::move(sys_pci_devices_dir), nullptr) {}
+
+SysfsPciTopology::SysfsPciTopology(UeventInvalidationService *uevents)
+    : SysfsPciTopology(kSysPciRoot, uevents) {}
+
+SysfsPciTopology::SysfsPciTopology(std::string sys_pci_devices_dir,
+                                   UeventInvalidationService *uevents)
+    : sys_pci_devices_dir_(std::move(sys_pci_devices_dir)),
+      uevents_(uevents),
+      snapshot_(RcuSnapshot<PciTopology>::CreateStale()) {}
+
+RcuSnapshot<PciTopology> SysfsPciTopology::Read() const {
+  absl::MutexLock ml(&mutex_);
+  if (!snapshot_.IsFresh()) {
+    auto new_topology = RcuSnapshot<PciTopology>::Create(Build());
+    snapshot_ = std::move(new_topology.snapshot);
+    invalidator_ = std::move(new_topology.invalidator);
+    if (uevents_) uevents_->RegisterInvalidator("pci", this, invalidator_);
+  }
+  return snapshot_;
+}
+
+void SysfsPciTopology::Invalidate() {
+  absl::MutexLock ml(&mutex_);
+  invalidator_.InvalidateSnapshot();
+}
+
+PciTopology SysfsPciTopology::Build() const {
+  SysfsPciDiscovery discovery(sys_pci_devices_dir_);
+  auto maybe_locations = discovery.EnumerateAllDevices();
+  if (!maybe_locations.ok()) {
+    ErrorLog() << "unable to enumerate PCI devices: "
+               << maybe_locations.status();
+    return PciTopology();
+  }
+
+  std::vector<PciTopologyNode> nodes;
+  nodes.reserve(maybe_locations->size());
+  ApifsDirectory devices_dir(sys_pci_devices_dir_);
+  for (const PciLocation &location : *maybe_locations) {
+    PciTopologyNode node = {.location = location};
+
+    // Each entry in the devices directory is a link into the device tree, e.g.
+    // ../../../devices/pci0000:00/0000:00:01.0/0000:01:00.0, where the
+    // directory containing the device is the bridge it is behind.
+    std::string name = absl::StrFormat("%s", absl::FormatStreamed(location));
+    auto maybe_link = devices_dir.ReadLink(name);
+    if (maybe_link.ok()) {
+      node.parent =
+          PciLocation::FromString(GetBasename(GetDirname(*maybe_link)));
+    }
+
+    SysPciRegion region(sys_pci_devices_dir_, location);
+    auto maybe_config = PciConfigSnapshot::ReadFrom(region);
+    if (maybe_config.ok()) {
+      node.capabilities = maybe_config->Capabilities();
+    }
+
+    nodes.push_back(std::move(node));
+  }
+  return PciTopology(std::move(nodes));
+}
+
 }  // namespace ecclesia
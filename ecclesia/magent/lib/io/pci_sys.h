@@ -25,12 +25,19 @@
 #include <string>
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/span.h"
 #include "ecclesia/lib/apifs/apifs.h"
+#include "ecclesia/lib/cache/rcu_snapshot.h"
+#include "ecclesia/lib/cache/rcu_view.h"
+#include "ecclesia/lib/file/mmap.h"
+#include "ecclesia/lib/uevent/invalidation_service.h"
 #include "ecclesia/magent/lib/io/pci.h"
 #include "ecclesia/magent/lib/io/pci_location.h"
+#include "ecclesia/magent/lib/io/pci_topology.h"
 
 namespace ecclesia {
 
@@ -62,6 +69,66 @@ class SysPciRegion : public PciRegion {
   ApifsFile apifs_;
 };
 
+// A region for accessing the registers behind a memory BAR. The BAR is accessed
+// by memory mapping the sysfs resourceN file for the device, so after the
+// region is created register reads and writes are plain memory operations with
+// no system call overhead.
+//
+// All of the fixed-size accessors use a single volatile access of exactly the
+// requested width, and require that the offset be naturally aligned. This is
+// important for device registers where the access width can have side effects.
+class SysPciMmioRegion : public PciRegion {
+ public:
+  // Create a region covering the entirety of the given BAR. The mapping type
+  // controls whether writes are supported.
+  static absl::StatusOr<SysPciMmioRegion> Create(const PciLocation &pci_loc,
+                                                 PciResources::BarNum bar_id,
+                                                 MappedMemory::Type type);
+
+  // This factory allows customized sysfs PCI devices directory, mostly for
+  // testing purpose.
+  static absl::StatusOr<SysPciMmioRegion> Create(
+      const std::string &sys_pci_devices_dir, const PciLocation &pci_loc,
+      PciResources::BarNum bar_id, MappedMemory::Type type);
+
+  SysPciMmioRegion(SysPciMmioRegion &&other) = default;
+
+  absl::StatusOr<uint8_t> Read8(size_t offset) const override;
+  absl::Status Write8(size_t offset, uint8_t data) override;
+
+  absl::StatusOr<uint16_t> Read16(size_t offset) const override;
+  absl::Status Write16(size_t offset, uint16_t data) override;
+
+  absl::StatusOr<uint32_t> Read32(size_t offset) const override;
+  absl::Status Write32(size_t offset, uint32_t data) override;
+
+  // BARs are not limited to 32-bit registers, so 64-bit access is also
+  // provided. Note that not all devices support 64-bit accesses.
+  absl::StatusOr<uint64_t> Read64(size_t offset) const;
+  absl::Status Write64(size_t offset, uint64_t data);
+
+  // Bulk copies are done using the widest aligned access possible, dword
+  // accesses for the aligned part of the range and bytes at either end.
+  absl::Status ReadBytes(uint64_t offset,
+                         absl::Span<char> value) const override;
+  absl::Status WriteBytes(uint64_t offset,
+                          absl::Span<const char> value) override;
+
+ private:
+  explicit SysPciMmioRegion(MappedMemory mapping);
+
+  // Check that an access of the given size at the given offset is in range.
+  absl::Status CheckRange(uint64_t offset, size_t size) const;
+
+  // Implementations of the fixed-size accessors.
+  template <typename IntType>
+  absl::StatusOr<IntType> ReadValue(size_t offset) const;
+  template <typename IntType>
+  absl::Status WriteValue(size_t offset, IntType value);
+
+  MappedMemory mapping_;
+};
+
 class SysfsPciResources : public PciResources {
  public:
   explicit SysfsPciResources(PciLocation loc);
@@ -99,6 +166,48 @@ class SysfsPciDiscovery : public PciDiscoveryInterface {
   std::string sys_pci_devices_dir_;
 };
 
+// Provides a cached view of the PCI topology, built from sysfs. The tree is
+// built on the first Read and then shared by all subsequent readers until it
+// is invalidated, at which point the next Read will rebuild it. Invalidate is
+// intended to be called when devices are added or removed, e.g. in response to
+// PCI hotplug uevents.
+class SysfsPciTopology : public RcuView<PciTopology> {
+ public:
+  SysfsPciTopology();
+
+  // This constructor allows customized sysfs PCI devices directory, mostly for
+  // testing purpose.
+  explicit SysfsPciTopology(std::string sys_pci_devices_dir);
+
+  // Constructors which also register every topology that gets built with a
+  // uevent invalidation service, so that it is automatically invalidated by
+  // PCI hotplug events. The service must outlive this object.
+  explicit SysfsPciTopology(UeventInvalidationService *uevents);
+  SysfsPciTopology(std::string sys_pci_devices_dir,
+                   UeventInvalidationService *uevents);
+
+  // Copying this would result in two caches for the same underlying data.
+  SysfsPciTopology(const SysfsPciTopology &other) = delete;
+  SysfsPciTopology &operator=(const SysfsPciTopology &other) = delete;
+
+  RcuSnapshot<PciTopology> Read() const override;
+
+  // Mark the current topology as stale. Existing snapshots remain usable.
+  void Invalidate();
+
+ private:
+  // Scan sysfs and construct a new topology. Devices whose parents or config
+  // space cannot be read are still included, just with less information.
+  PciTopology Build() const;
+
+  std::string sys_pci_devices_dir_;
+  UeventInvalidationService *const uevents_;
+
+  mutable absl::Mutex mutex_;
+  mutable RcuSnapshot<PciTopology> snapshot_ ABSL_GUARDED_BY(mutex_);
+  mutable RcuInvalidator invalidator_ ABSL_GUARDED_BY(mutex_);
+};
+
 }  // namespace ecclesia
 
 #endif  // ECCLESIA_MAGENT_LIB_IO_PCI_SYS_H_
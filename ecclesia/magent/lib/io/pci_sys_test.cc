@@ -17,31 +17,44 @@
 #include "ecclesia/magent/lib/io/pci_sys.h"
 
 #include <cstdint>
+#include <string>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "ecclesia/lib/file/mmap.h"
 #include "ecclesia/lib/file/test_filesystem.h"
 #include "ecclesia/lib/testing/status.h"
+#include "ecclesia/lib/uevent/fake_uevent_source.h"
+#include "ecclesia/lib/uevent/invalidation_service.h"
+#include "ecclesia/lib/uevent/uevent.h"
 #include "ecclesia/magent/lib/io/pci.h"
 #include "ecclesia/magent/lib/io/pci_location.h"
+#include "ecclesia/magent/lib/io/pci_regs.h"
+#include "ecclesia/magent/lib/io/pci_topology.h"
 
 namespace ecclesia {
 namespace {
 
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
 using ::testing::Not;
 
 // Helper matchers that can check if a BarInfo is a memory or I/O BAR with the
 // given base address.
 MATCHER_P(IsMemoryBar, expected_address, "") {
   return arg.type == PciResources::kBarTypeMem &&
-         arg.address == expected_address;
+         arg.address == static_cast<uint64_t>(expected_address);
 }
 MATCHER_P(IsIoBar, expected_address, "") {
   return arg.type == PciResources::kBarTypeIo &&
-         arg.address == expected_address;
+         arg.address == static_cast<uint64_t>(expected_address);
 }
 
 constexpr absl::string_view kTestResourceFile =
@@ -206,5 +219,216 @@ TEST_F(PciSysTest, TestResourcesNotFound) {
   EXPECT_THAT(resources.GetBaseAddress<5>(), Not(IsOk()));
 }
 
+class PciMmioTest : public testing::Test {
+ public:
+  PciMmioTest() : fs_(GetTestTempdirPath()) {
+    fs_.CreateDir("/sys/bus/pci/devices/0001:02:03.4");
+    // Fill the BAR with a recognizable pattern, byte N = N & 0xff.
+    std::string bar(4096, '\0');
+    for (size_t i = 0; i < bar.size(); ++i) bar[i] = static_cast<char>(i);
+    fs_.CreateFile("/sys/bus/pci/devices/0001:02:03.4/resource0", bar);
+    fs_.CreateFile("/sys/bus/pci/devices/0001:02:03.4/resource1", "");
+  }
+
+ protected:
+  template <int BarId>
+  absl::StatusOr<SysPciMmioRegion> CreateRegion(MappedMemory::Type type) {
+    return SysPciMmioRegion::Create(fs_.GetTruePath("/sys/bus/pci/devices"),
+                                    PciLocation::Make<1, 2, 3, 4>(),
+                                    PciResources::BarNum::Make<BarId>(), type);
+  }
+
+  TestFilesystem fs_;
+};
+
+TEST_F(PciMmioTest, ReadRegisters) {
+  auto maybe_region = CreateRegion<0>(MappedMemory::Type::kReadOnly);
+  ASSERT_THAT(maybe_region, IsOk());
+  SysPciMmioRegion &region = *maybe_region;
+
+  EXPECT_EQ(region.Size(), 4096);
+  EXPECT_THAT(region.Read8(0x11), IsOkAndHolds(0x11));
+  EXPECT_THAT(region.Read16(0x12), IsOkAndHolds(0x1312));
+  EXPECT_THAT(region.Read32(0x14), IsOkAndHolds(0x17161514));
+  EXPECT_THAT(region.Read64(0x18), IsOkAndHolds(0x1f1e1d1c1b1a1918));
+
+  char buffer[11];
+  ASSERT_THAT(region.ReadBytes(0x21, absl::MakeSpan(buffer)), IsOk());
+  for (size_t i = 0; i < sizeof(buffer); ++i) {
+    EXPECT_EQ(buffer[i], 0x21 + i);
+  }
+}
+
+TEST_F(PciMmioTest, MisalignedAndOutOfRangeReadsFail) {
+  auto maybe_region = CreateRegion<0>(MappedMemory::Type::kReadOnly);
+  ASSERT_THAT(maybe_region, IsOk());
+  SysPciMmioRegion &region = *maybe_region;
+
+  EXPECT_TRUE(absl::IsInvalidArgument(region.Read16(0x11).status()));
+  EXPECT_TRUE(absl::IsInvalidArgument(region.Read32(0x12).status()));
+  EXPECT_TRUE(absl::IsInvalidArgument(region.Read64(0x14).status()));
+
+  EXPECT_THAT(region.Read8(4095), IsOk());
+  EXPECT_TRUE(absl::IsOutOfRange(region.Read8(4096).status()));
+  EXPECT_TRUE(absl::IsOutOfRange(region.Read64(4096).status()));
+  char buffer[8];
+  EXPECT_TRUE(
+      absl::IsOutOfRange(region.ReadBytes(4092, absl::MakeSpan(buffer))));
+}
+
+TEST_F(PciMmioTest, ReadOnlyWritesFail) {
+  auto maybe_region = CreateRegion<0>(MappedMemory::Type::kReadOnly);
+  ASSERT_THAT(maybe_region, IsOk());
+  SysPciMmioRegion &region = *maybe_region;
+
+  EXPECT_THAT(region.Write32(0x10, 0xdeadbeef), Not(IsOk()));
+  EXPECT_THAT(region.WriteBytes(0x10, absl::MakeConstSpan("abc", 3)),
+              Not(IsOk()));
+  EXPECT_THAT(region.Read32(0x10), IsOkAndHolds(0x13121110));
+}
+
+TEST_F(PciMmioTest, WriteRegisters) {
+  auto maybe_region = CreateRegion<0>(MappedMemory::Type::kReadWrite);
+  ASSERT_THAT(maybe_region, IsOk());
+  SysPciMmioRegion &region = *maybe_region;
+
+  EXPECT_THAT(region.Write8(0x1, 0xab), IsOk());
+  EXPECT_THAT(region.Write16(0x2, 0xcdef), IsOk());
+  EXPECT_THAT(region.Write32(0x4, 0x01234567), IsOk());
+  EXPECT_THAT(region.Write64(0x8, 0x0011223344556677), IsOk());
+  EXPECT_THAT(region.Read64(0x0), IsOkAndHolds(0x01234567cdefab00));
+  EXPECT_THAT(region.Read64(0x8), IsOkAndHolds(0x0011223344556677));
+
+  EXPECT_THAT(region.WriteBytes(0x103, absl::MakeConstSpan("abcdefghij", 10)),
+              IsOk());
+  char buffer[10];
+  ASSERT_THAT(region.ReadBytes(0x103, absl::MakeSpan(buffer)), IsOk());
+  EXPECT_EQ(absl::string_view(buffer, sizeof(buffer)), "abcdefghij");
+
+  // The writes should go through to the underlying resource file.
+  auto reopened = CreateRegion<0>(MappedMemory::Type::kReadOnly);
+  ASSERT_THAT(reopened, IsOk());
+  EXPECT_THAT(reopened->Read32(0x4), IsOkAndHolds(0x01234567));
+}
+
+TEST_F(PciMmioTest, CreateFailures) {
+  // Empty and missing BARs cannot be mapped.
+  EXPECT_THAT(CreateRegion<1>(MappedMemory::Type::kReadOnly), Not(IsOk()));
+  EXPECT_THAT(CreateRegion<2>(MappedMemory::Type::kReadOnly), Not(IsOk()));
+}
+
+class PciTopologyTest : public testing::Test {
+ public:
+  PciTopologyTest() : fs_(GetTestTempdirPath()) {
+    // A root port with an endpoint behind it, plus an integrated device.
+    AddDevice("pci0000:00/0000:00:01.0", /*with_pcie=*/true);
+    AddDevice("pci0000:00/0000:00:01.0/0000:01:00.0", /*with_pcie=*/true);
+    AddDevice("pci0000:00/0000:00:1f.0", /*with_pcie=*/false);
+  }
+
+ protected:
+  // Add a device into the devices tree at the given path along with a link to
+  // it from the bus directory, the way the kernel lays them out.
+  void AddDevice(absl::string_view path, bool with_pcie) {
+    std::string device_dir = absl::StrCat("/sys/devices/", path);
+    fs_.CreateDir(device_dir);
+
+    std::string config(256, '\0');
+    if (with_pcie) {
+      config[kPciStatusReg] = kPciStatusCapabilitiesList;
+      config[kPciCapPointerReg] = 0x40;
+      config[0x40 + kPciCapListIdOffset] = kPciCapIdPcie;
+    }
+    fs_.CreateFile(absl::StrCat(device_dir, "/config"), config);
+
+    fs_.CreateDir("/sys/bus/pci/devices");
+    fs_.CreateSymlink(absl::StrCat("../../../devices/", path),
+                      absl::StrCat("/sys/bus/pci/devices/",
+                                   path.substr(path.rfind('/') + 1)));
+  }
+
+  TestFilesystem fs_;
+};
+
+TEST_F(PciTopologyTest, BuildsTree) {
+  SysfsPciTopology sysfs_topology(fs_.GetTruePath("/sys/bus/pci/devices"));
+  auto topology = sysfs_topology.Read();
+
+  constexpr PciLocation kRootPort = PciLocation::Make<0, 0, 1, 0>();
+  constexpr PciLocation kEndpoint = PciLocation::Make<0, 1, 0, 0>();
+  constexpr PciLocation kIntegrated = PciLocation::Make<0, 0, 0x1f, 0>();
+
+  ASSERT_EQ(topology->Nodes().size(), 3);
+  std::vector<PciLocation> roots;
+  for (const PciTopologyNode *node : topology->Roots()) {
+    roots.push_back(node->location);
+  }
+  EXPECT_THAT(roots, ElementsAre(kRootPort, kIntegrated));
+
+  const PciTopologyNode *root_port = topology->Find(kRootPort);
+  ASSERT_NE(root_port, nullptr);
+  EXPECT_THAT(root_port->children, ElementsAre(kEndpoint));
+  EXPECT_EQ(root_port->capabilities.FindCapability(kPciCapIdPcie), 0x40);
+
+  const PciTopologyNode *endpoint = topology->Find(kEndpoint);
+  ASSERT_NE(endpoint, nullptr);
+  EXPECT_EQ(endpoint->parent, kRootPort);
+
+  const PciTopologyNode *integrated = topology->Find(kIntegrated);
+  ASSERT_NE(integrated, nullptr);
+  EXPECT_THAT(integrated->capabilities.standard, IsEmpty());
+}
+
+TEST_F(PciTopologyTest, CachedUntilInvalidated) {
+  SysfsPciTopology sysfs_topology(fs_.GetTruePath("/sys/bus/pci/devices"));
+  auto topology = sysfs_topology.Read();
+  EXPECT_EQ(topology->Nodes().size(), 3);
+
+  // Adding a device does not change the topology until it is invalidated.
+  AddDevice("pci0000:00/0000:00:01.0/0000:01:00.1", /*with_pcie=*/true);
+  EXPECT_EQ(sysfs_topology.Read(), topology);
+  EXPECT_TRUE(topology.IsFresh());
+
+  sysfs_topology.Invalidate();
+  EXPECT_FALSE(topology.IsFresh());
+  auto new_topology = sysfs_topology.Read();
+  EXPECT_NE(new_topology, topology);
+  EXPECT_EQ(new_topology->Nodes().size(), 4);
+  EXPECT_EQ(topology->Nodes().size(), 3);
+}
+
+TEST_F(PciTopologyTest, InvalidatedByUevents) {
+  auto *source = new FakeUeventSource();
+  UeventInvalidationService uevents(absl::WrapUnique(source));
+  SysfsPciTopology sysfs_topology(fs_.GetTruePath("/sys/bus/pci/devices"),
+                                  &uevents);
+  auto topology = sysfs_topology.Read();
+  EXPECT_EQ(topology->Nodes().size(), 3);
+
+  // Events for other subsystems don't affect the topology.
+  source->Push(UeventAction::kAdd, "usb", "/devices/usb1/1-1");
+  uevents.ProcessEvents(absl::ZeroDuration());
+  EXPECT_TRUE(topology.IsFresh());
+
+  AddDevice("pci0000:00/0000:00:01.0/0000:01:00.1", /*with_pcie=*/true);
+  source->Push(UeventAction::kAdd, "pci",
+               "/devices/pci0000:00/0000:00:01.0/0000:01:00.1");
+  uevents.ProcessEvents(absl::ZeroDuration());
+  EXPECT_FALSE(topology.IsFresh());
+  auto new_topology = sysfs_topology.Read();
+  EXPECT_EQ(new_topology->Nodes().size(), 4);
+
+  // The rebuilt topology is registered again for the next event.
+  source->Push(UeventAction::kRemove, "pci",
+               "/devices/pci0000:00/0000:00:01.0/0000:01:00.1");
+  uevents.ProcessEvents(absl::ZeroDuration());
+  EXPECT_FALSE(new_topology.IsFresh());
+}
+
+TEST_F(PciTopologyTest, MissingDirectoryIsEmpty) {
+  SysfsPciTopology sysfs_topology(fs_.GetTruePath("/sys/bus/nothing"));
+  EXPECT_THAT(sysfs_topology.Read()->Nodes(), IsEmpty());
+}
+
 }  // namespace
 }  // namespace ecclesia
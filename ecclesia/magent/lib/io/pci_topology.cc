@@ -0,0 +1,63 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/lib/io/pci_topology.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "ecclesia/magent/lib/io/pci_location.h"
+
+namespace ecclesia {
+
+PciTopology::PciTopology(std::vector<PciTopologyNode> nodes)
+    : nodes_(std::move(nodes)) {
+  std::sort(nodes_.begin(), nodes_.end(),
+            [](const PciTopologyNode &lhs, const PciTopologyNode &rhs) {
+              return lhs.location < rhs.location;
+            });
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    nodes_[i].children.clear();
+    index_.emplace(nodes_[i].location, i);
+  }
+  // Because the nodes are sorted, walking them in order populates each list of
+  // children in sorted order as well.
+  for (const PciTopologyNode &node : nodes_) {
+    if (!node.parent.has_value()) continue;
+    auto iter = index_.find(*node.parent);
+    if (iter != index_.end()) {
+      nodes_[iter->second].children.push_back(node.location);
+    }
+  }
+}
+
+const PciTopologyNode *PciTopology::Find(const PciLocation &location) const {
+  auto iter = index_.find(location);
+  if (iter == index_.end()) return nullptr;
+  return &nodes_[iter->second];
+}
+
+std::vector<const PciTopologyNode *> PciTopology::Roots() const {
+  std::vector<const PciTopologyNode *> roots;
+  for (const PciTopologyNode &node : nodes_) {
+    if (!node.parent.has_value()) roots.push_back(&node);
+  }
+  return roots;
+}
+
+}  // namespace ecclesia
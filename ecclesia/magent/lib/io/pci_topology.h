@@ -0,0 +1,81 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Defines a tree representation of the PCI hierarchy, with bridges as parents
+// of the devices behind them. The tree is an immutable value type, intended to
+// be built once and then shared (e.g. via an RcuSnapshot) between all of the
+// users that need to look up devices or their capabilities.
+
+#ifndef ECCLESIA_MAGENT_LIB_IO_PCI_TOPOLOGY_H_
+#define ECCLESIA_MAGENT_LIB_IO_PCI_TOPOLOGY_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "ecclesia/magent/lib/io/pci_caps.h"
+#include "ecclesia/magent/lib/io/pci_location.h"
+
+namespace ecclesia {
+
+struct PciTopologyNode {
+  PciLocation location;
+  // The bridge this device sits behind. Devices directly on a root bus have
+  // no parent.
+  absl::optional<PciLocation> parent;
+  // The devices directly behind this one, sorted by location. This is only
+  // non-empty for bridges. It is populated by the PciTopology constructor, any
+  // value provided by the caller is ignored.
+  std::vector<PciLocation> children;
+  // The capabilities the device had when the topology was built. Note that
+  // while the layout of capabilities is fixed the registers in them are not,
+  // so values like link status still need to be read from the device.
+  PciCapabilityList capabilities;
+};
+
+class PciTopology {
+ public:
+  // Construct an empty topology.
+  PciTopology() = default;
+
+  // Construct a topology from a set of nodes. Each node is expected to have
+  // its parent populated; the children will be derived from the parents.
+  explicit PciTopology(std::vector<PciTopologyNode> nodes);
+
+  PciTopology(const PciTopology &) = default;
+  PciTopology &operator=(const PciTopology &) = default;
+  PciTopology(PciTopology &&) = default;
+  PciTopology &operator=(PciTopology &&) = default;
+
+  // All of the nodes in the topology, sorted by location.
+  absl::Span<const PciTopologyNode> Nodes() const { return nodes_; }
+
+  // Find the node for the given device. Returns null if it is not present.
+  const PciTopologyNode *Find(const PciLocation &location) const;
+
+  // Find all the nodes with no parent.
+  std::vector<const PciTopologyNode *> Roots() const;
+
+ private:
+  std::vector<PciTopologyNode> nodes_;
+  absl::flat_hash_map<PciLocation, size_t> index_;
+};
+
+}  // namespace ecclesia
+
+#endif  // ECCLESIA_MAGENT_LIB_IO_PCI_TOPOLOGY_H_
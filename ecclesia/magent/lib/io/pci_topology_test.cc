@@ -0,0 +1,73 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/lib/io/pci_topology.h"
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "ecclesia/magent/lib/io/pci_location.h"
+
+namespace ecclesia {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+TEST(PciTopologyTest, EmptyTopology) {
+  PciTopology topology;
+  EXPECT_THAT(topology.Nodes(), IsEmpty());
+  EXPECT_THAT(topology.Roots(), IsEmpty());
+  EXPECT_EQ(topology.Find(PciLocation::Make<0, 0, 0, 0>()), nullptr);
+}
+
+TEST(PciTopologyTest, ChildrenDerivedFromParents) {
+  constexpr PciLocation kRoot = PciLocation::Make<0, 0, 0, 0>();
+  constexpr PciLocation kBridge = PciLocation::Make<0, 0, 1, 0>();
+  constexpr PciLocation kDevice0 = PciLocation::Make<0, 1, 0, 0>();
+  constexpr PciLocation kDevice1 = PciLocation::Make<0, 1, 0, 1>();
+
+  // Deliberately provide the nodes out of order.
+  std::vector<PciTopologyNode> nodes;
+  nodes.push_back({.location = kDevice1, .parent = kBridge});
+  nodes.push_back({.location = kBridge});
+  nodes.push_back({.location = kDevice0, .parent = kBridge});
+  nodes.push_back({.location = kRoot});
+  PciTopology topology(std::move(nodes));
+
+  ASSERT_EQ(topology.Nodes().size(), 4);
+  EXPECT_EQ(topology.Nodes()[0].location, kRoot);
+  EXPECT_EQ(topology.Nodes()[3].location, kDevice1);
+
+  std::vector<PciLocation> roots;
+  for (const PciTopologyNode *node : topology.Roots()) {
+    roots.push_back(node->location);
+  }
+  EXPECT_THAT(roots, ElementsAre(kRoot, kBridge));
+
+  const PciTopologyNode *bridge = topology.Find(kBridge);
+  ASSERT_NE(bridge, nullptr);
+  EXPECT_THAT(bridge->children, ElementsAre(kDevice0, kDevice1));
+
+  const PciTopologyNode *device = topology.Find(kDevice1);
+  ASSERT_NE(device, nullptr);
+  EXPECT_EQ(device->parent, kBridge);
+  EXPECT_THAT(device->children, IsEmpty());
+}
+
+}  // namespace
+}  // namespace ecclesia
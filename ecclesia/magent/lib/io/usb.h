@@ -23,6 +23,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "absl/status/status.h"
@@ -123,6 +124,16 @@ class UsbPortSequence {
   friend bool operator!=(const UsbPortSequence &lhs,
                          const UsbPortSequence &rhs);
 
+  // Support hashing of sequences for use as a key in hash maps. Only the
+  // populated entries of the array are hashed.
+  template <typename H>
+  friend H AbslHashValue(H h, const UsbPortSequence &seq) {
+    for (size_t i = 0; i < seq.size_; ++i) {
+      h = H::combine(std::move(h), seq.ports_[i].value);
+    }
+    return H::combine(std::move(h), seq.size_);
+  }
+
  private:
   // Unchecked constructor.
   constexpr UsbPortSequence(const StoredArray &ports, size_t size)
@@ -170,6 +181,12 @@ class UsbLocation {
   friend bool operator==(const UsbLocation &lhs, const UsbLocation &rhs);
   friend bool operator!=(const UsbLocation &lhs, const UsbLocation &rhs);
 
+  // Support hashing of locations for use as a key in hash maps.
+  template <typename H>
+  friend H AbslHashValue(H h, const UsbLocation &loc) {
+    return H::combine(std::move(h), loc.bus_, loc.ports_);
+  }
+
  private:
   // The number of the bus behind a single controller. 1-255.
   UsbBusLocation bus_;
@@ -18,6 +18,7 @@
 
 #include <cstddef>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/status/status.h"
@@ -28,9 +29,13 @@
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/optional.h"
 #include "ecclesia/lib/apifs/apifs.h"
-#include "ecclesia/lib/file/path.h"
+#include "ecclesia/lib/cache/rcu_snapshot.h"
+#include "ecclesia/lib/file/dir.h"
+#include "ecclesia/lib/logging/logging.h"
+#include "ecclesia/lib/uevent/invalidation_service.h"
 #include "ecclesia/magent/lib/io/usb.h"
 #include "re2/re2.h"
 
@@ -144,21 +149,22 @@ std::string UsbLocationToDirectory(const UsbLocation &loc) {
 
 absl::Status SysfsUsbDiscovery::EnumerateAllUsbDevices(
     std::vector<UsbLocation> *devices) const {
-  auto maybe_usb_device_entries = api_fs_.ListEntries();
-  if (!maybe_usb_device_entries.ok()) {
-    return maybe_usb_device_entries.status();
+  auto maybe_iter = DirectoryIterator::Open(api_fs_.GetPath());
+  if (!maybe_iter.ok()) {
+    return maybe_iter.status();
   }
 
   devices->clear();
 
-  for (absl::string_view entry : *maybe_usb_device_entries) {
-    auto maybe_usb_location = DirectoryToUsbLocation(GetBasename(entry));
+  DirectoryEntry entry;
+  while (maybe_iter->Next(&entry)) {
+    auto maybe_usb_location = DirectoryToUsbLocation(entry.name);
 
     if (maybe_usb_location.has_value()) {
       devices->push_back(maybe_usb_location.value());
     }
   }
-  return absl::OkStatus();
+  return maybe_iter->status();
 }
 
 absl::StatusOr<UsbSignature> SysfsUsbAccess::GetSignature() const {
@@ -177,4 +183,135 @@ absl::StatusOr<UsbSignature> SysfsUsbAccess::GetSignature() const {
   return signature;
 }
 
+UsbInventory::UsbInventory(std::vector<Device> devices)
+    : devices_(std::move(devices)) {
+  index_.reserve(devices_.size());
+  for (size_t i = 0; i < devices_.size(); ++i) {
+    index_.try_emplace(devices_[i].location, i);
+  }
+}
+
+const UsbInventory::Device *UsbInventory::Find(
+    const UsbLocation &location) const {
+  auto iter = index_.find(location);
+  if (iter == index_.end()) return nullptr;
+  return &devices_[iter->second];
+}
+
+std::vector<UsbLocation> UsbInventory::FindBySignature(
+    const UsbSignature &signature) const {
+  std::vector<UsbLocation> locations;
+  for (const Device &device : devices_) {
+    if (device.signature.has_value() &&
+        device.signature->vendor_id == signature.vendor_id &&
+        device.signature->product_id == signature.product_id) {
+      locations.push_back(device.location);
+    }
+  }
+  return locations;
+}
+
+SysfsUsbInventory::SysfsUsbInventory() : SysfsUsbInventory(kUsbDevicesDir) {}
+
+SysfsUsbInventory::SysfsUsbInventory(std::string sys_usb_devices_dir)
+    : SysfsUsbInventory(std::move(sys_usb_devices_dir), nullptr) {}
+
+SysfsUsbInventory::SysfsUsbInventory(UeventInvalidationService *uevents)
+    : SysfsUsbInventory(kUsbDevicesDir, uevents) {}
+
+SysfsUsbInventory::SysfsUsbInventory(std::string sys_usb_devices_dir,
+                                     UeventInvalidationService *uevents)
+    : sys_usb_devices_dir_(std::move(sys_usb_devices_dir)),
+      uevents_(uevents),
+      snapshot_(RcuSnapshot<UsbInventory>::CreateStale()) {}
+
+RcuSnapshot<UsbInventory> SysfsUsbInventory::Read() const {
+  absl::MutexLock ml(&mutex_);
+  if (!snapshot_.IsFresh()) {
+    auto new_inventory = RcuSnapshot<UsbInventory>::Create(Build());
+    snapshot_ = std::move(new_inventory.snapshot);
+    invalidator_ = std::move(new_inventory.invalidator);
+    if (uevents_) uevents_->RegisterInvalidator("usb", this, invalidator_);
+  }
+  return snapshot_;
+}
+
+void SysfsUsbInventory::Invalidate() {
+  absl::MutexLock ml(&mutex_);
+  invalidator_.InvalidateSnapshot();
+}
+
+absl::Status SysfsUsbInventory::EnumerateAllUsbDevices(
+    std::vector<UsbLocation> *devices) const {
+  RcuSnapshot<UsbInventory> inventory = Read();
+  devices->clear();
+  devices->reserve(inventory->Devices().size());
+  for (const UsbInventory::Device &device : inventory->Devices()) {
+    devices->push_back(device.location);
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<UsbSignature> SysfsUsbInventory::GetSignature(
+    const UsbLocation &location) const {
+  RcuSnapshot<UsbInventory> inventory = Read();
+  const UsbInventory::Device *device = inventory->Find(location);
+  if (!device) {
+    return absl::NotFoundError(absl::StrFormat(
+        "no usb device found at %s", UsbLocationToDirectory(location)));
+  }
+  if (!device->signature.has_value()) {
+    return absl::InternalError(absl::StrFormat(
+        "unable to read signature of usb device %s",
+        UsbLocationToDirectory(location)));
+  }
+  return *device->signature;
+}
+
+UsbInventory SysfsUsbInventory::Build() const {
+  auto maybe_iter = DirectoryIterator::Open(sys_usb_devices_dir_);
+  if (!maybe_iter.ok()) {
+    ErrorLog() << "unable to enumerate USB devices: " << maybe_iter.status();
+    known_devices_.clear();
+    return UsbInventory();
+  }
+
+  absl::flat_hash_map<std::string, KnownDevice> found_devices;
+  std::vector<UsbInventory::Device> devices;
+  DirectoryEntry entry;
+  while (maybe_iter->Next(&entry)) {
+    // Carry over devices which are still at the same sysfs entry. Devices
+    // whose signature could not be read are always re-read, since the read
+    // can fail if it races with the kernel populating a new device.
+    auto iter = known_devices_.find(entry.name);
+    if (iter != known_devices_.end() && iter->second.inode == entry.inode &&
+        iter->second.device.signature.has_value()) {
+      devices.push_back(iter->second.device);
+      found_devices.insert(known_devices_.extract(iter));
+      continue;
+    }
+
+    auto maybe_usb_location = DirectoryToUsbLocation(entry.name);
+    if (!maybe_usb_location.has_value()) continue;
+
+    UsbInventory::Device device = {.location = *maybe_usb_location};
+    SysfsUsbAccess access(
+        device.location,
+        ApifsDirectory(absl::StrCat(sys_usb_devices_dir_, "/", entry.name)));
+    auto maybe_signature = access.GetSignature();
+    if (maybe_signature.ok()) device.signature = *maybe_signature;
+
+    devices.push_back(device);
+    found_devices.try_emplace(entry.name, KnownDevice{entry.inode, device});
+  }
+  if (!maybe_iter->status().ok()) {
+    ErrorLog() << "error while enumerating USB devices: "
+               << maybe_iter->status();
+  }
+
+  // Anything which was not found again has been removed.
+  known_devices_ = std::move(found_devices);
+  return UsbInventory(std::move(devices));
+}
+
 }  // namespace ecclesia
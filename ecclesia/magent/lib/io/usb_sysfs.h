@@ -17,13 +17,22 @@
 #ifndef ECCLESIA_MAGENT_LIB_IO_USB_SYSFS_H_
 #define ECCLESIA_MAGENT_LIB_IO_USB_SYSFS_H_
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "ecclesia/lib/apifs/apifs.h"
+#include "ecclesia/lib/cache/rcu_snapshot.h"
+#include "ecclesia/lib/cache/rcu_view.h"
+#include "ecclesia/lib/uevent/invalidation_service.h"
 #include "ecclesia/magent/lib/io/usb.h"
 
 namespace ecclesia {
@@ -70,6 +79,101 @@ class SysfsUsbAccess : public UsbAccessInterface {
   UsbLocation usb_location_;
   ApifsDirectory api_fs_;
 };
+
+// An immutable snapshot of all of the USB devices in the system, along with
+// their signatures. Devices can be looked up by location in constant time.
+class UsbInventory {
+ public:
+  struct Device {
+    UsbLocation location;
+    // The signature of the device, if it could be read.
+    absl::optional<UsbSignature> signature;
+  };
+
+  UsbInventory() = default;
+  explicit UsbInventory(std::vector<Device> devices);
+
+  absl::Span<const Device> Devices() const { return devices_; }
+
+  // Find the device at the given location. Returns null if there is no device
+  // at that location.
+  const Device *Find(const UsbLocation &location) const;
+  const Device *Find(UsbBusLocation bus, const UsbPortSequence &ports) const {
+    return Find(UsbLocation(bus, ports));
+  }
+
+  // Find the locations of all devices with the given signature.
+  std::vector<UsbLocation> FindBySignature(const UsbSignature &signature) const;
+
+ private:
+  std::vector<Device> devices_;
+  absl::flat_hash_map<UsbLocation, size_t> index_;
+};
+
+// Cached view of the USB devices in sysfs. The inventory is only rebuilt after
+// it has been invalidated, and a rebuild only reads the signatures of devices
+// which were added since the previous inventory was built. Devices whose sysfs
+// entries are unchanged are carried over without being parsed or read again.
+//
+// This also implements the discovery interface, so it can be used as a drop-in
+// replacement for SysfsUsbDiscovery by code which enumerates devices often.
+class SysfsUsbInventory : public RcuView<UsbInventory>,
+                          public UsbDiscoveryInterface {
+ public:
+  SysfsUsbInventory();
+
+  // This constructor allows a customized sysfs USB devices directory, mostly
+  // for testing purpose.
+  explicit SysfsUsbInventory(std::string sys_usb_devices_dir);
+
+  // Constructors which also register every inventory that gets built with a
+  // uevent invalidation service, so that it is automatically invalidated when
+  // USB devices are added or removed. The service must outlive this object.
+  explicit SysfsUsbInventory(UeventInvalidationService *uevents);
+  SysfsUsbInventory(std::string sys_usb_devices_dir,
+                    UeventInvalidationService *uevents);
+
+  // Copying this would result in two caches for the same underlying data.
+  SysfsUsbInventory(const SysfsUsbInventory &other) = delete;
+  SysfsUsbInventory &operator=(const SysfsUsbInventory &other) = delete;
+
+  RcuSnapshot<UsbInventory> Read() const override;
+
+  // Mark the current inventory as stale. Existing snapshots remain usable.
+  void Invalidate();
+
+  absl::Status EnumerateAllUsbDevices(
+      std::vector<UsbLocation> *devices) const override;
+
+  // Look up the signature of the device at the given location from the
+  // current inventory. Returns NotFound if there is no such device.
+  absl::StatusOr<UsbSignature> GetSignature(const UsbLocation &location) const;
+
+ private:
+  // A device from a previous scan, and the inode of the sysfs entry it was
+  // found at. The kernel creates a new entry whenever a device is attached,
+  // so a matching inode means it is still the same device.
+  struct KnownDevice {
+    uint64_t inode;
+    UsbInventory::Device device;
+  };
+
+  // Scan sysfs and construct a new inventory, reusing devices from the
+  // previous scan where possible.
+  UsbInventory Build() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  std::string sys_usb_devices_dir_;
+  UeventInvalidationService *const uevents_;
+
+  mutable absl::Mutex mutex_;
+  mutable RcuSnapshot<UsbInventory> snapshot_ ABSL_GUARDED_BY(mutex_);
+  mutable RcuInvalidator invalidator_ ABSL_GUARDED_BY(mutex_);
+  // All of the devices found by the most recent scan, keyed by their sysfs
+  // directory name.
+  mutable absl::flat_hash_map<std::string, KnownDevice> known_devices_
+      ABSL_GUARDED_BY(mutex_);
+};
+
 }  // namespace ecclesia
 
 #endif  // ECCLESIA_MAGENT_LIB_IO_USB_SYSFS_H_
@@ -16,23 +16,35 @@
 
 #include "ecclesia/magent/lib/io/usb_sysfs.h"
 
+#include <unistd.h>
+
 #include <cstddef>
+#include <cstdio>
 #include <cstdint>
 #include <string>
 #include <vector>
 
+#include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "ecclesia/lib/apifs/apifs.h"
 #include "ecclesia/lib/file/test_filesystem.h"
+#include "ecclesia/lib/uevent/fake_uevent_source.h"
+#include "ecclesia/lib/uevent/invalidation_service.h"
+#include "ecclesia/lib/uevent/uevent.h"
 #include "ecclesia/magent/lib/io/usb.h"
 
 namespace ecclesia {
 namespace {
 
+using ::testing::IsEmpty;
+using ::testing::UnorderedElementsAre;
+
 class SysfsUsbTest : public testing::Test {
  protected:
   SysfsUsbTest()
@@ -146,5 +158,118 @@ TEST_F(SysfsUsbTest, TestDeviceEnumeration) {
   EXPECT_EQ(0x0002, maybe_usb_2_2_1_sig->product_id);
 }
 
+TEST_F(SysfsUsbTest, InventoryLookups) {
+  SysfsUsbInventory sysfs_inventory(usb_dir_);
+  auto inventory = sysfs_inventory.Read();
+  EXPECT_EQ(inventory->Devices().size(), 11);
+
+  const UsbInventory::Device *device =
+      inventory->Find(UsbLocation::Make<2, 2, 1>());
+  ASSERT_NE(device, nullptr);
+  ASSERT_TRUE(device->signature.has_value());
+  EXPECT_EQ(device->signature->vendor_id, 0x18d1);
+  EXPECT_EQ(device->signature->product_id, 0x0002);
+
+  device = inventory->Find(UsbBusLocation::Make<2>(),
+                           UsbPortSequence::Make<2, 5, 10>());
+  ASSERT_NE(device, nullptr);
+  EXPECT_EQ(device->location, (UsbLocation::Make<2, 2, 5, 10>()));
+
+  EXPECT_EQ(inventory->Find(UsbLocation::Make<2, 4>()), nullptr);
+  EXPECT_EQ(inventory->Find(UsbLocation::Make<4>()), nullptr);
+
+  EXPECT_THAT(inventory->FindBySignature({0x0424, 0x2517}),
+              UnorderedElementsAre(UsbLocation::Make<2, 1>(),
+                                   UsbLocation::Make<2, 2>(),
+                                   UsbLocation::Make<2, 3>()));
+  EXPECT_THAT(inventory->FindBySignature({0x0424, 0x0000}), IsEmpty());
+
+  std::vector<UsbLocation> usb_devices;
+  ASSERT_TRUE(sysfs_inventory.EnumerateAllUsbDevices(&usb_devices).ok());
+  EXPECT_EQ(usb_devices.size(), 11);
+
+  auto maybe_signature =
+      sysfs_inventory.GetSignature(UsbLocation::Make<2, 1>());
+  ASSERT_TRUE(maybe_signature.ok());
+  EXPECT_EQ(maybe_signature->vendor_id, 0x0424);
+  EXPECT_TRUE(absl::IsNotFound(
+      sysfs_inventory.GetSignature(UsbLocation::Make<2, 4>()).status()));
+}
+
+TEST_F(SysfsUsbTest, InventoryUpdatedIncrementally) {
+  SysfsUsbInventory sysfs_inventory(usb_dir_);
+  auto inventory = sysfs_inventory.Read();
+  EXPECT_EQ(inventory->Devices().size(), 11);
+
+  // Changing the underlying files does not affect a fresh inventory.
+  fs_.WriteFile("/sys/devices/pciXXXX:XX/0000:00:1a.2/usb2/2-1/idVendor",
+                "1234");
+  CreateDevice("2-3.1", 0x18d1, 0x0003, "0000:00:1a.2/usb2/2-3");
+  ASSERT_EQ(
+      unlink(fs_.GetTruePath(absl::StrCat(kUsbDevicesDir, "/2-2.15")).c_str()),
+      0);
+  EXPECT_TRUE(inventory.IsFresh());
+  EXPECT_EQ(sysfs_inventory.Read()->Devices().size(), 11);
+
+  // After invalidation the added and removed devices are picked up, but the
+  // devices which were already known are not read again.
+  sysfs_inventory.Invalidate();
+  EXPECT_FALSE(inventory.IsFresh());
+  auto new_inventory = sysfs_inventory.Read();
+  EXPECT_EQ(new_inventory->Devices().size(), 11);
+  EXPECT_EQ(new_inventory->Find(UsbLocation::Make<2, 2, 15>()), nullptr);
+
+  const UsbInventory::Device *device =
+      new_inventory->Find(UsbLocation::Make<2, 3, 1>());
+  ASSERT_NE(device, nullptr);
+  ASSERT_TRUE(device->signature.has_value());
+  EXPECT_EQ(device->signature->product_id, 0x0003);
+
+  device = new_inventory->Find(UsbLocation::Make<2, 1>());
+  ASSERT_NE(device, nullptr);
+  ASSERT_TRUE(device->signature.has_value());
+  EXPECT_EQ(device->signature->vendor_id, 0x0424);
+}
+
+TEST_F(SysfsUsbTest, InventoryRereadsReplacedDevices) {
+  SysfsUsbInventory sysfs_inventory(usb_dir_);
+  EXPECT_EQ(sysfs_inventory.Read()->Devices().size(), 11);
+
+  // Replace the 2-1 entry with a new device at the same location. The new
+  // entry is created first and renamed over the old one, the same as a device
+  // which is unplugged and a different one plugged in.
+  CreateDevice("replacement", 0x18d1, 0x0004, "0000:00:1a.2/usb2");
+  ASSERT_EQ(
+      rename(
+          fs_.GetTruePath(absl::StrCat(kUsbDevicesDir, "/replacement")).c_str(),
+          fs_.GetTruePath(absl::StrCat(kUsbDevicesDir, "/2-1")).c_str()),
+      0);
+
+  sysfs_inventory.Invalidate();
+  auto maybe_signature =
+      sysfs_inventory.GetSignature(UsbLocation::Make<2, 1>());
+  ASSERT_TRUE(maybe_signature.ok());
+  EXPECT_EQ(maybe_signature->vendor_id, 0x18d1);
+  EXPECT_EQ(maybe_signature->product_id, 0x0004);
+}
+
+TEST_F(SysfsUsbTest, InventoryInvalidatedByUevents) {
+  auto *source = new FakeUeventSource();
+  UeventInvalidationService uevents(absl::WrapUnique(source));
+  SysfsUsbInventory sysfs_inventory(usb_dir_, &uevents);
+  auto inventory = sysfs_inventory.Read();
+
+  source->Push(UeventAction::kAdd, "pci", "/devices/pci0000:00/0000:00:02.0");
+  uevents.ProcessEvents(absl::ZeroDuration());
+  EXPECT_TRUE(inventory.IsFresh());
+
+  CreateDevice("3-1", 0x18d1, 0x0005, "0000:00:1d.1/usb3");
+  source->Push(UeventAction::kAdd, "usb",
+               "/devices/pci0000:00/0000:00:1d.1/usb3/3-1");
+  uevents.ProcessEvents(absl::ZeroDuration());
+  EXPECT_FALSE(inventory.IsFresh());
+  EXPECT_NE(sysfs_inventory.Read()->Find(UsbLocation::Make<3, 1>()), nullptr);
+}
+
 }  // namespace
 }  // namespace ecclesia
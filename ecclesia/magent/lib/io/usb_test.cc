@@ -17,6 +17,7 @@
 #include "ecclesia/magent/lib/io/usb.h"
 
 #include "gtest/gtest.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/types/optional.h"
 
 namespace ecclesia {
@@ -73,5 +74,25 @@ TEST(UsbLocationTest, ValidateStaticFunctions) {
   EXPECT_EQ(kDevice.NumPorts(), 3);
 }
 
+TEST(UsbLocationTest, IsHashable) {
+  absl::flat_hash_map<UsbLocation, int> usb_map;
+
+  // Sequences which share a prefix, or which differ only in the bus, must all
+  // be distinct keys.
+  usb_map[UsbLocation::Make<1>()] = 0;
+  usb_map[UsbLocation::Make<2>()] = 1;
+  usb_map[UsbLocation::Make<1, 1>()] = 2;
+  usb_map[UsbLocation::Make<1, 1, 1>()] = 3;
+  usb_map[UsbLocation::Make<2, 1, 1>()] = 4;
+  usb_map[UsbLocation::Make<1, 1, 2>()] = 5;
+  EXPECT_EQ(usb_map.size(), 6);
+
+  // Equivalent sequences constructed in different ways are the same key.
+  auto maybe_seq = UsbPortSequence::TryMake({1, 2});
+  ASSERT_TRUE(maybe_seq.has_value());
+  EXPECT_EQ(usb_map[UsbLocation(UsbBusLocation::Make<1>(), *maybe_seq)], 5);
+  EXPECT_EQ(usb_map.size(), 6);
+}
+
 }  // namespace
 }  // namespace ecclesia
@@ -30,6 +30,96 @@
 
 namespace ecclesia {
 
+// IPMI network functions from the spec.
+enum class IpmiNetworkFunction : uint8_t {
+  kChassis = 0x00,
+  kBridge = 0x02,
+  kSensorOrEvent = 0x04,
+  kApp = 0x6,
+  kFirmware = 0x8,
+  kStorage = 0x0a,
+  kTransport = 0x0c,
+  kGroup = 0x2c,
+  kOem = 0x2e,
+};
+
+// IPMI commands from the spec.
+enum class IpmiCommand : uint8_t {
+  kGetDeviceId = 0x1,
+  kGetFruInfo = 0x10,
+  kReadFruData = 0x11,
+  kGetSdrRepositoryInfo = 0x20,
+  kReserveSdrRepository = 0x22,
+  kGetSdr = 0x23,
+  kGetSensorReading = 0x2d,
+};
+
+class IpmiPair {
+ public:
+  constexpr IpmiPair(IpmiNetworkFunction netfn, IpmiCommand cmd)
+      : network_function_(netfn), command_(cmd) {}
+
+  IpmiPair(const IpmiPair &) = delete;
+  IpmiPair &operator=(const IpmiPair &) = delete;
+
+  IpmiNetworkFunction network_function() const { return network_function_; }
+  IpmiCommand command() const { return command_; }
+
+ private:
+  IpmiNetworkFunction network_function_;
+  IpmiCommand command_;
+};
+
+// Get FRU Inventory Area Info Command: ipmi spec #589
+// NetFn: Storage, CMD: 10h
+inline constexpr IpmiPair kGetFruInfo{IpmiNetworkFunction::kStorage,
+                                      IpmiCommand::kGetFruInfo};
+
+// Get SDR Repository Info Command: ipmi spec #33.9
+// NetFn: Storage, CMD: 20h
+inline constexpr IpmiPair kGetSdrRepositoryInfo{
+    IpmiNetworkFunction::kStorage, IpmiCommand::kGetSdrRepositoryInfo};
+
+// Reserve SDR Repository Command: ipmi spec #33.11
+// NetFn: Storage, CMD: 22h
+inline constexpr IpmiPair kReserveSdrRepository{
+    IpmiNetworkFunction::kStorage, IpmiCommand::kReserveSdrRepository};
+
+// Get SDR Command: ipmi spec #33.12
+// NetFn: Storage, CMD: 23h
+inline constexpr IpmiPair kGetSdr{IpmiNetworkFunction::kStorage,
+                                  IpmiCommand::kGetSdr};
+
+// Read FRU Data Command: ipmi spec #34.2
+// NetFn: Storage, CMD: 11h
+inline constexpr IpmiPair kReadFruData{IpmiNetworkFunction::kStorage,
+                                       IpmiCommand::kReadFruData};
+
+// Get Sensor Reading Command: ipmi spec #35.14
+// NetFn: Sensor/Event, CMD: 2Dh
+inline constexpr IpmiPair kGetSensorReading{
+    IpmiNetworkFunction::kSensorOrEvent, IpmiCommand::kGetSensorReading};
+
+struct IpmiRequest {
+  IpmiNetworkFunction network_function;
+  IpmiCommand command;
+  absl::Span<const uint8_t> data;
+
+  explicit IpmiRequest(const IpmiPair &netfn_cmd)
+      : network_function(netfn_cmd.network_function()),
+        command(netfn_cmd.command()) {}
+
+  IpmiRequest(const IpmiPair &netfn_cmd, absl::Span<const uint8_t> data)
+      : network_function(netfn_cmd.network_function()),
+        command(netfn_cmd.command()),
+        data(data) {}
+};
+
+struct IpmiResponse {
+  int ccode;
+  std::vector<uint8_t> data;
+};
+
 class IpmiInterface {
  public:
   struct EntityIdentifier {
@@ -59,6 +149,33 @@ class IpmiInterface {
     uint16_t fru_id;
   };
 
+  // Information about the SDR repository, from the Get SDR Repository Info
+  // command. The timestamps change whenever records are added or erased, and
+  // so they can be used to tell if the repository has changed.
+  struct SdrRepositoryInfo {
+    uint8_t version;
+    uint16_t record_count;
+    uint32_t most_recent_addition;
+    uint32_t most_recent_erase;
+
+    bool operator==(const SdrRepositoryInfo &other) const {
+      return std::tie(version, record_count, most_recent_addition,
+                      most_recent_erase) ==
+             std::tie(other.version, other.record_count,
+                      other.most_recent_addition, other.most_recent_erase);
+    }
+    bool operator!=(const SdrRepositoryInfo &other) const {
+      return !(*this == other);
+    }
+  };
+
+  // A single record read out of the SDR repository. The data contains the
+  // entire record, including the 5 byte record header.
+  struct SdrRecord {
+    uint16_t record_id;
+    std::vector<uint8_t> data;
+  };
+
   IpmiInterface() {}
   virtual ~IpmiInterface() {}
 
@@ -72,6 +189,21 @@ class IpmiInterface {
 
   // Gets the FRU size
   virtual absl::Status GetFruSize(uint16_t fru_id, uint16_t *size) = 0;
+
+  // Gets the SDR repository info.
+  virtual absl::Status GetSdrRepositoryInfo(SdrRepositoryInfo *info) = 0;
+
+  // Reserves the SDR repository. The reservation is cancelled by the BMC when
+  // the repository is modified, or when anyone else makes a reservation.
+  virtual absl::Status ReserveSdrRepository(uint16_t *reservation_id) = 0;
+
+  // Reads the SDR record with the given ID, and the ID of the record after it
+  // in the repository. Record ID 0 is the first record, and 0xFFFF as the next
+  // ID indicates the last record. If the reservation has been cancelled then
+  // an aborted error is returned.
+  virtual absl::Status GetSdrRecord(uint16_t reservation_id, uint16_t record_id,
+                                    SdrRecord *record,
+                                    uint16_t *next_record_id) = 0;
 };
 
 }  // namespace ecclesia
@@ -19,6 +19,7 @@
 
 #include "gmock/gmock.h"
 #include "ecclesia/magent/lib/ipmi/ipmi.h"
+#include "ecclesia/magent/lib/ipmi/request_engine.h"
 
 namespace ecclesia {
 
@@ -28,6 +29,19 @@ class MockIpmiInterface : public IpmiInterface {
   MOCK_METHOD(absl::Status, ReadFru,
               (uint16_t, size_t, absl::Span<unsigned char>), (override));
   MOCK_METHOD(absl::Status, GetFruSize, (uint16_t, uint16_t *), (override));
+  MOCK_METHOD(absl::Status, GetSdrRepositoryInfo, (SdrRepositoryInfo *),
+              (override));
+  MOCK_METHOD(absl::Status, ReserveSdrRepository, (uint16_t *), (override));
+  MOCK_METHOD(absl::Status, GetSdrRecord,
+              (uint16_t, uint16_t, SdrRecord *, uint16_t *), (override));
+};
+
+class MockIpmiPipelinedTransport : public IpmiPipelinedTransport {
+ public:
+  MOCK_METHOD(int, MaxInFlight, (), (const, override));
+  MOCK_METHOD(absl::Status, Send, (uint8_t, const IpmiRequest &), (override));
+  MOCK_METHOD(absl::Status, Receive, (absl::Time, uint8_t *, IpmiResponse *),
+              (override));
 };
 
 // This is to faciliate mocking up ReadFru method.
@@ -19,6 +19,7 @@
 #include <string.h>
 #include <sys/socket.h>
 
+#include <algorithm>
 #include <any>
 #include <cstddef>
 #include <cstdint>
@@ -29,19 +30,22 @@
 #include <utility>
 #include <vector>
 
-#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
+#include "ecclesia/lib/codec/endian.h"
 #include "ecclesia/lib/logging/globals.h"
 #include "ecclesia/lib/logging/logging.h"
 #include "ecclesia/magent/config.pb.h"
 #include "ecclesia/magent/lib/fru/fru.h"
 #include "ecclesia/magent/lib/ipmi/ipmi.h"
 #include "ecclesia/magent/lib/ipmi/ipmitool_interface.h"
+#include "ecclesia/magent/lib/ipmi/sdr_cache.h"
 
 extern "C" {
 #include "include/ipmitool/ipmi.h"
@@ -76,6 +80,16 @@ constexpr uint8_t IPMI_INVALID_CMD_COMPLETION_CODE = 0xC1;
 constexpr uint8_t IPMI_TIMEOUT_COMPLETION_CODE = 0xC3;
 constexpr uint8_t IPMI_UNKNOWN_ERR_COMPLETION_CODE = 0xff;
 
+// Completion code for a cancelled SDR repository reservation.
+constexpr uint8_t kIpmiReservationCancelledCompletionCode = 0xC5;
+
+// The number of bytes to request with Get SDR to read an entire record.
+constexpr uint8_t kGetSdrEntireRecord = 0xFF;
+
+// The number of bytes of a record to request at a time when reading it in
+// pieces. This fits in the response of every system interface.
+constexpr uint8_t kGetSdrPartialReadSize = 16;
+
 void IpmitoolInterface::SessionSetKgkey(std::any intf, const uint8_t *kgkey) {
   if (!intf.has_value()) {
     FatalLog() << "intf is empty.";
@@ -224,34 +238,34 @@ void IpmitoolInterface::SdrEnd(std::any intf, std::any i) {
 
 class IpmitoolImpl : public IpmiInterface {
  public:
-  struct FreeDeleter {
-    inline void operator()(void *ptr) const { free(ptr); }
-  };
-
-  template <typename T>
-  using SdrRecordUniquePtr = std::unique_ptr<T, FreeDeleter>;
-
-  explicit IpmitoolImpl(
-      absl::optional<ecclesia::MagentConfig::IpmiCredential> cred)
-      : cred_(std::move(cred)), intf_(GetIpmiIntf()) {}
+  IpmitoolImpl(absl::optional<ecclesia::MagentConfig::IpmiCredential> cred,
+               IpmiSdrCache::Options sdr_cache_options)
+      : cred_(std::move(cred)),
+        intf_(GetIpmiIntf()),
+        sdr_cache_(this, std::move(sdr_cache_options)) {}
 
   std::vector<BmcFruInterfaceInfo> GetAllFrus() override {
-    if (frus_cache_.empty()) {
-      if (!FindAllFrus().ok()) return {};
+    if (!intf_) {
+      ErrorLog() << "Ipmi interface: intf_ is nullptr.";
+      return {};
+    }
+    absl::StatusOr<std::shared_ptr<const IpmiSdrCache::Records>>
+        maybe_records = sdr_cache_.GetRecords();
+    if (!maybe_records.ok()) {
+      ErrorLog() << "Unable to read the SDR repository: "
+                 << maybe_records.status().message();
+      return {};
     }
 
     std::vector<BmcFruInterfaceInfo> frus;
-    for (const auto &fru_pair : frus_cache_) {
-      BmcFruInterfaceInfo fru;
-      fru.record_id = fru_pair.first;
-      auto entity = fru_pair.second->entity;
-      EntityIdentifier fru_entity = {
-          entity.id,
-          static_cast<uint8_t>((entity.logical << 7) | entity.instance)};
-      fru.entity = fru_entity;
-      fru.name = ReadFruName(fru_pair.second.get());
-      fru.fru_id = fru_pair.second->device_id;
-      frus.push_back(fru);
+    for (const SdrRecord &record : **maybe_records) {
+      absl::optional<BmcFruInterfaceInfo> fru = GetFruFromSdrRecord(record);
+      if (!fru.has_value()) continue;
+      // Log the board info of each FRU the first time it is found.
+      if (logged_frus_.insert(fru->record_id).second) {
+        printBoardInfo(fru->fru_id, fru->name);
+      }
+      frus.push_back(*std::move(fru));
     }
     return frus;
   }
@@ -288,16 +302,101 @@ class IpmitoolImpl : public IpmiInterface {
     return GetFruInfo(intf_, fru_id, size, nullptr);
   }
 
+  absl::Status GetSdrRepositoryInfo(SdrRepositoryInfo *info) override {
+    IpmiResponse rsp;
+    absl::Status status = Send(IpmiRequest(kGetSdrRepositoryInfo), &rsp);
+    if (!status.ok()) {
+      return status;
+    }
+    // The response is the version, the record count, the free space, the two
+    // timestamps and the operation support flags.
+    if (rsp.data.size() < 14) {
+      return absl::InternalError(absl::StrFormat(
+          "Get SDR Repository Info response is too short: %d bytes",
+          rsp.data.size()));
+    }
+    info->version = rsp.data[0];
+    info->record_count = LittleEndian::Load16(&rsp.data[1]);
+    info->most_recent_addition = LittleEndian::Load32(&rsp.data[5]);
+    info->most_recent_erase = LittleEndian::Load32(&rsp.data[9]);
+    return absl::OkStatus();
+  }
+
+  absl::Status ReserveSdrRepository(uint16_t *reservation_id) override {
+    IpmiResponse rsp;
+    absl::Status status = Send(IpmiRequest(kReserveSdrRepository), &rsp);
+    if (!status.ok()) {
+      return status;
+    }
+    if (rsp.data.size() < 2) {
+      return absl::InternalError(
+          "Reserve SDR Repository response is too short");
+    }
+    *reservation_id = LittleEndian::Load16(&rsp.data[0]);
+    return absl::OkStatus();
+  }
+
+  absl::Status GetSdrRecord(uint16_t reservation_id, uint16_t record_id,
+                            SdrRecord *record,
+                            uint16_t *next_record_id) override {
+    // Try to read the entire record in one command. Not every interface can
+    // return that many bytes in a response, and so if that fails the record
+    // is read in pieces instead, and all later records are read that way too.
+    if (!sdr_partial_reads_) {
+      absl::Status status = GetSdr(reservation_id, record_id, 0,
+                                   kGetSdrEntireRecord, &record->data,
+                                   next_record_id);
+      if (status.ok() || absl::IsAborted(status)) {
+        record->record_id = record_id;
+        return status;
+      }
+    }
+
+    std::vector<uint8_t> header;
+    absl::Status status =
+        GetSdr(reservation_id, record_id, 0, kSdrRecordHeaderSize, &header,
+               next_record_id);
+    if (!status.ok()) {
+      return status;
+    }
+    if (header.size() != kSdrRecordHeaderSize) {
+      return absl::InternalError(absl::StrFormat(
+          "Get SDR returned a %d byte header for record %d", header.size(),
+          record_id));
+    }
+    size_t size = kSdrRecordHeaderSize + header[kSdrRecordHeaderSize - 1];
+    record->record_id = record_id;
+    record->data = std::move(header);
+    while (record->data.size() < size) {
+      uint8_t offset = record->data.size();
+      uint8_t count =
+          std::min<size_t>(kGetSdrPartialReadSize, size - record->data.size());
+      std::vector<uint8_t> piece;
+      status = GetSdr(reservation_id, record_id, offset, count, &piece,
+                      next_record_id);
+      if (!status.ok()) {
+        return status;
+      }
+      if (piece.empty()) {
+        return absl::InternalError(absl::StrFormat(
+            "Get SDR returned no data for record %d at offset %d", record_id,
+            offset));
+      }
+      record->data.insert(record->data.end(), piece.begin(), piece.end());
+    }
+    sdr_partial_reads_ = true;
+    return absl::OkStatus();
+  }
+
  private:
-  // A map of FRU numbers to SDR records for them. This map is only modified
-  // during construction and then serves as a cache of the read FRU
-  // information.
-  absl::flat_hash_map<uint16_t,
-                      SdrRecordUniquePtr<struct sdr_record_fru_locator>>
-      frus_cache_;
   absl::optional<ecclesia::MagentConfig::IpmiCredential> cred_;
   ipmi_intf *intf_;
   IpmitoolInterface ipmitool_intf_;
+  IpmiSdrCache sdr_cache_;
+  // The record IDs of the FRUs whose board info has already been logged.
+  absl::flat_hash_set<uint16_t> logged_frus_;
+  // Set once reading an entire SDR record in one command has failed.
+  bool sdr_partial_reads_ = false;
 
   ipmi_intf *GetIpmiIntf() {
     if (cred_ == absl::nullopt) {
@@ -385,7 +484,7 @@ class IpmitoolImpl : public IpmiInterface {
 
   absl::Status SendWithRetry(const IpmiRequest &request, int retries,
                              IpmiResponse *response) {
-    ipmi_rs *resp;
+    ipmi_rs *resp = nullptr;
     int tries = retries + 1;
     std::vector<uint8_t> buffer(kMinimumIpmiPacketLength + request.data.size());
     buffer[0] = static_cast<uint8_t>(request.network_function);
@@ -404,6 +503,9 @@ class IpmitoolImpl : public IpmiInterface {
     }
 
     if (!result.ok()) {
+      // Pass along the completion code if there was a response, so that
+      // callers can recognize specific failures.
+      response->ccode = resp ? resp->ccode : IPMI_UNKNOWN_ERR_COMPLETION_CODE;
       return absl::InternalError(
           absl::StrCat("Failed to send IPMI command after ", count, " tries."));
     }
@@ -449,8 +551,39 @@ class IpmitoolImpl : public IpmiInterface {
     return absl::OkStatus();
   }
 
+  // Sends a Get SDR command, reading count bytes of a record starting from the
+  // given offset. A cancelled reservation is reported as an aborted error.
+  absl::Status GetSdr(uint16_t reservation_id, uint16_t record_id,
+                      uint8_t offset, uint8_t count, std::vector<uint8_t> *data,
+                      uint16_t *next_record_id) {
+    uint8_t buffer[6];
+    LittleEndian::Store16(reservation_id, &buffer[0]);
+    LittleEndian::Store16(record_id, &buffer[2]);
+    buffer[4] = offset;
+    buffer[5] = count;
+    IpmiRequest req(kGetSdr, absl::MakeSpan(buffer));
+
+    IpmiResponse rsp;
+    absl::Status status = Send(req, &rsp);
+    if (!status.ok()) {
+      if (rsp.ccode == kIpmiReservationCancelledCompletionCode) {
+        return absl::AbortedError(absl::StrFormat(
+            "SDR reservation %d was cancelled reading record %d",
+            reservation_id, record_id));
+      }
+      return status;
+    }
+    if (rsp.data.size() < 2) {
+      return absl::InternalError(absl::StrFormat(
+          "Get SDR response for record %d is too short", record_id));
+    }
+    *next_record_id = LittleEndian::Load16(&rsp.data[0]);
+    data->assign(rsp.data.begin() + 2, rsp.data.end());
+    return absl::OkStatus();
+  }
+
   // A helper function to print the Board info given a FRU ID and its name.
-  void printBoardInfo(uint16_t fru_id, uint8_t fru_id_string[16]) {
+  void printBoardInfo(uint16_t fru_id, absl::string_view fru_name) {
     std::vector<uint8_t> data(72);
     absl::Status status = ReadFru(fru_id, 0, absl::MakeSpan(data));
     if (!status.ok()) {
@@ -461,7 +594,7 @@ class IpmitoolImpl : public IpmiInterface {
     BoardInfoArea bia;
     bia.FillFromImage(fru_image, 8);
 
-    InfoLog() << "FRU Device Description: " << fru_id_string << " (ID "
+    InfoLog() << "FRU Device Description: " << fru_name << " (ID "
               << (int)fru_id << ")";
     time_t t = bia.manufacture_date();
     InfoLog() << "Board Mfg Date        : " << asctime(localtime(&t));
@@ -475,47 +608,6 @@ class IpmitoolImpl : public IpmiInterface {
               << bia.part_number().GetDataAsString();
   }
 
-  absl::Status FindAllFrus() {
-    if (!intf_) {
-      return absl::InternalError("Ipmi interface: intf_ is nullptr.");
-    }
-
-    struct ipmi_sdr_iterator *itr = nullptr;
-    if ((itr = std::any_cast<struct ipmi_sdr_iterator *>(
-             ipmitool_intf_.SdrStart(intf_, 0))) == nullptr) {
-      return absl::InternalError("Unable to open SDR for reading.");
-    }
-
-    absl::Status status;
-    struct sdr_get_rs *header;
-    struct sdr_record_fru_locator *fru;
-    while ((header = std::any_cast<struct sdr_get_rs *>(
-                ipmitool_intf_.SdrGetNextHeader(intf_, itr))) != nullptr) {
-      if (header->type == SDR_RECORD_TYPE_FRU_DEVICE_LOCATOR) {
-        fru = reinterpret_cast<struct sdr_record_fru_locator *>(
-            ipmitool_intf_.SdrGetRecord(intf_, header, itr));
-        if (fru == nullptr || !fru->logical) {
-          if (fru) {
-            free(fru);
-            fru = nullptr;
-          }
-          InfoLog() << "Fail to get logical frus.";
-          continue;
-        }
-        printBoardInfo(fru->device_id, fru->id_string);
-
-        // We need this line because sdr_get_rs is packed.
-        uint16_t id = header->id;
-        frus_cache_.emplace(
-            id, SdrRecordUniquePtr<struct sdr_record_fru_locator>(fru));
-      }
-    }
-    // Frees the memory allocated by SdrStart
-    ipmitool_intf_.SdrEnd(intf_, itr);
-
-    return status;
-  }
-
   std::string IpmiResponseToString(uint8_t code) {
     const struct valstr *curr = &completion_code_vals[0];
 
@@ -552,14 +644,14 @@ class IpmitoolImpl : public IpmiInterface {
     intf->my_addr = IPMI_BMC_SLAVE_ADDR;
     intf->target_addr = IPMI_BMC_SLAVE_ADDR;
   }
-
-  std::string ReadFruName(struct sdr_record_fru_locator *fru) {
-    return std::string(reinterpret_cast<const char *>(fru->id_string),
-                       fru->id_code & 0x1f);
-  }
 };
 
 Ipmitool::Ipmitool(absl::optional<ecclesia::MagentConfig::IpmiCredential> cred)
-    : ipmi_impl_(absl::make_unique<IpmitoolImpl>(cred)) {}
+    : Ipmitool(std::move(cred), IpmiSdrCache::Options()) {}
+
+Ipmitool::Ipmitool(absl::optional<ecclesia::MagentConfig::IpmiCredential> cred,
+                   IpmiSdrCache::Options sdr_cache_options)
+    : ipmi_impl_(absl::make_unique<IpmitoolImpl>(
+          std::move(cred), std::move(sdr_cache_options))) {}
 
 }  // namespace ecclesia
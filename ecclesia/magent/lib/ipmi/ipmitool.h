@@ -31,6 +31,7 @@
 #include "absl/types/span.h"
 #include "ecclesia/magent/config.pb.h"
 #include "ecclesia/magent/lib/ipmi/ipmi.h"
+#include "ecclesia/magent/lib/ipmi/sdr_cache.h"
 
 namespace ecclesia {
 
@@ -43,71 +44,14 @@ extern const uint8_t IPMI_INVALID_CMD_COMPLETION_CODE;
 extern const uint8_t IPMI_TIMEOUT_COMPLETION_CODE;
 extern const uint8_t IPMI_UNKNOWN_ERR_COMPLETION_CODE;
 
-// IPMI network functions from the spec.
-enum class IpmiNetworkFunction : uint8_t {
-  kChassis = 0x00,
-  kBridge = 0x02,
-  kSensorOrEvent = 0x04,
-  kApp = 0x6,
-  kFirmware = 0x8,
-  kStorage = 0x0a,
-  kTransport = 0x0c,
-  kGroup = 0x2c,
-  kOem = 0x2e,
-};
-
-// IPMI commands from the spec.
-enum class IpmiCommand : uint8_t {
-  kGetDeviceId = 0x1,
-  kGetFruInfo = 0x10,
-};
-
-class IpmiPair {
- public:
-  constexpr IpmiPair(IpmiNetworkFunction netfn, IpmiCommand cmd)
-      : network_function_(netfn), command_(cmd) {}
-
-  IpmiPair(const IpmiPair &) = delete;
-  IpmiPair &operator=(const IpmiPair &) = delete;
-
-  IpmiNetworkFunction network_function() const { return network_function_; }
-  IpmiCommand command() const { return command_; }
-
- private:
-  IpmiNetworkFunction network_function_;
-  IpmiCommand command_;
-};
-
-// Get FRU Inventory Area Info Command: ipmi spec #589
-// NetFn: Storage, CMD: 10h
-inline constexpr IpmiPair kGetFruInfo{IpmiNetworkFunction::kStorage,
-                                      IpmiCommand::kGetFruInfo};
-
-struct IpmiRequest {
-  IpmiNetworkFunction network_function;
-  IpmiCommand command;
-  absl::Span<const uint8_t> data;
-
-  explicit IpmiRequest(const IpmiPair &netfn_cmd)
-      : network_function(netfn_cmd.network_function()),
-        command(netfn_cmd.command()) {}
-
-  IpmiRequest(const IpmiPair &netfn_cmd, absl::Span<const uint8_t> data)
-      : network_function(netfn_cmd.network_function()),
-        command(netfn_cmd.command()),
-        data(data) {}
-};
-
-struct IpmiResponse {
-  int ccode;
-  std::vector<uint8_t> data;
-};
-
 class Ipmitool : public IpmiInterface {
  public:
   // explicit Ipmitool(IpmiInterfaceOptions options);
   explicit Ipmitool(
       absl::optional<ecclesia::MagentConfig::IpmiCredential> cred);
+  // The SDR repository read by GetAllFrus is cached using the given options.
+  Ipmitool(absl::optional<ecclesia::MagentConfig::IpmiCredential> cred,
+           IpmiSdrCache::Options sdr_cache_options);
 
   std::vector<BmcFruInterfaceInfo> GetAllFrus() override {
     return ipmi_impl_->GetAllFrus();
@@ -122,6 +66,21 @@ class Ipmitool : public IpmiInterface {
     return ipmi_impl_->GetFruSize(fru_id, size);
   }
 
+  absl::Status GetSdrRepositoryInfo(SdrRepositoryInfo *info) override {
+    return ipmi_impl_->GetSdrRepositoryInfo(info);
+  }
+
+  absl::Status ReserveSdrRepository(uint16_t *reservation_id) override {
+    return ipmi_impl_->ReserveSdrRepository(reservation_id);
+  }
+
+  absl::Status GetSdrRecord(uint16_t reservation_id, uint16_t record_id,
+                            SdrRecord *record,
+                            uint16_t *next_record_id) override {
+    return ipmi_impl_->GetSdrRecord(reservation_id, record_id, record,
+                                    next_record_id);
+  }
+
  private:
   const std::unique_ptr<IpmiInterface> ipmi_impl_;
 };
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/lib/ipmi/openipmi_transport.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/ipmi.h>
+#include <linux/ipmi_msgdefs.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "ecclesia/lib/io/ioctl.h"
+#include "ecclesia/magent/lib/ipmi/ipmi.h"
+
+namespace ecclesia {
+namespace {
+
+// The completion code to report for a response which didn't have one.
+constexpr int kUnspecifiedErrorCompletionCode = 0xFF;
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<OpenIpmiTransport>> OpenIpmiTransport::Open(
+    const std::string &device_path, IoctlInterface *ioctl_intf,
+    int max_in_flight) {
+  int fd = open(device_path.c_str(), O_RDWR | O_CLOEXEC);
+  if (fd < 0) {
+    if (errno == ENOENT) {
+      return absl::NotFoundError(
+          absl::StrFormat("IPMI device not found at path: %s", device_path));
+    }
+    return absl::InternalError(absl::StrFormat(
+        "unable to open IPMI device at path: %s, errno: %d", device_path,
+        errno));
+  }
+  return absl::WrapUnique(new OpenIpmiTransport(fd, ioctl_intf, max_in_flight));
+}
+
+OpenIpmiTransport::OpenIpmiTransport(int fd, IoctlInterface *ioctl_intf,
+                                     int max_in_flight)
+    : fd_(fd), ioctl_(ioctl_intf), max_in_flight_(max_in_flight) {}
+
+OpenIpmiTransport::~OpenIpmiTransport() { close(fd_); }
+
+absl::Status OpenIpmiTransport::Send(uint8_t seq, const IpmiRequest &request) {
+  // All requests go to the BMC over the system interface.
+  struct ipmi_system_interface_addr addr = {};
+  addr.addr_type = IPMI_SYSTEM_INTERFACE_ADDR_TYPE;
+  addr.channel = IPMI_BMC_CHANNEL;
+  addr.lun = 0;
+
+  // The kernel interface takes a non-const pointer to the data.
+  std::vector<unsigned char> data(request.data.begin(), request.data.end());
+  struct ipmi_req req = {};
+  req.addr = reinterpret_cast<unsigned char *>(&addr);
+  req.addr_len = sizeof(addr);
+  req.msgid = seq;
+  req.msg.netfn = static_cast<uint8_t>(request.network_function);
+  req.msg.cmd = static_cast<uint8_t>(request.command);
+  req.msg.data = data.data();
+  req.msg.data_len = data.size();
+  if (ioctl_->Call(fd_, IPMICTL_SEND_COMMAND, &req) < 0) {
+    return absl::InternalError(absl::StrFormat(
+        "unable to send IPMI request %d, errno: %d", seq, errno));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status OpenIpmiTransport::Receive(absl::Time deadline, uint8_t *seq,
+                                        IpmiResponse *response) {
+  while (true) {
+    absl::Duration remaining = deadline - absl::Now();
+    int timeout_ms = remaining > absl::ZeroDuration()
+                         ? absl::ToInt64Milliseconds(absl::Ceil(
+                               remaining, absl::Milliseconds(1)))
+                         : 0;
+    struct pollfd pfd = {.fd = fd_, .events = POLLIN, .revents = 0};
+    int rc = poll(&pfd, 1, timeout_ms);
+    if (rc < 0) {
+      if (errno == EINTR) continue;
+      return absl::InternalError(
+          absl::StrFormat("unable to poll IPMI device, errno: %d", errno));
+    }
+    if (rc == 0) {
+      return absl::DeadlineExceededError("no IPMI response before deadline");
+    }
+
+    unsigned char buffer[IPMI_MAX_MSG_LENGTH];
+    struct ipmi_addr addr = {};
+    struct ipmi_recv recv = {};
+    recv.addr = reinterpret_cast<unsigned char *>(&addr);
+    recv.addr_len = sizeof(addr);
+    recv.msg.data = buffer;
+    recv.msg.data_len = sizeof(buffer);
+    if (ioctl_->Call(fd_, IPMICTL_RECEIVE_MSG_TRUNC, &recv) < 0) {
+      // Someone else may have consumed the message.
+      if (errno == EAGAIN || errno == EINTR) continue;
+      return absl::InternalError(absl::StrFormat(
+          "unable to receive IPMI response, errno: %d", errno));
+    }
+    // Only responses are of interest, not events or incoming commands.
+    if (recv.recv_type != IPMI_RESPONSE_RECV_TYPE) continue;
+
+    // The first byte of the response is the completion code.
+    *seq = recv.msgid;
+    size_t size = std::min<size_t>(recv.msg.data_len, sizeof(buffer));
+    if (size == 0) {
+      response->ccode = kUnspecifiedErrorCompletionCode;
+      response->data.clear();
+    } else {
+      response->ccode = buffer[0];
+      response->data.assign(buffer + 1, buffer + size);
+    }
+    return absl::OkStatus();
+  }
+}
+
+}  // namespace ecclesia
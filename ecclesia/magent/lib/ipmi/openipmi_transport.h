@@ -0,0 +1,71 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A pipelined IPMI transport using the in-band kernel interface, /dev/ipmiN.
+// The kernel driver allows many requests to be outstanding at once and hands
+// back the msgid of each request along with its response, which is used to
+// carry the sequence number.
+
+#ifndef ECCLESIA_MAGENT_LIB_IPMI_OPENIPMI_TRANSPORT_H_
+#define ECCLESIA_MAGENT_LIB_IPMI_OPENIPMI_TRANSPORT_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "ecclesia/lib/io/ioctl.h"
+#include "ecclesia/magent/lib/ipmi/ipmi.h"
+#include "ecclesia/magent/lib/ipmi/request_engine.h"
+
+namespace ecclesia {
+
+class OpenIpmiTransport : public IpmiPipelinedTransport {
+ public:
+  // The default number of requests to keep in flight. The driver queues them
+  // up for the system interface, which processes them one at a time, so this
+  // only needs to be deep enough to hide the latency of the round trips.
+  static constexpr int kDefaultMaxInFlight = 8;
+
+  // Opens the given IPMI device, e.g. "/dev/ipmi0". The ioctl interface must
+  // outlive the transport.
+  static absl::StatusOr<std::unique_ptr<OpenIpmiTransport>> Open(
+      const std::string &device_path, IoctlInterface *ioctl_intf,
+      int max_in_flight = kDefaultMaxInFlight);
+
+  OpenIpmiTransport(const OpenIpmiTransport &other) = delete;
+  OpenIpmiTransport &operator=(const OpenIpmiTransport &other) = delete;
+
+  ~OpenIpmiTransport() override;
+
+  int MaxInFlight() const override { return max_in_flight_; }
+  absl::Status Send(uint8_t seq, const IpmiRequest &request) override;
+  absl::Status Receive(absl::Time deadline, uint8_t *seq,
+                       IpmiResponse *response) override;
+
+ private:
+  OpenIpmiTransport(int fd, IoctlInterface *ioctl_intf, int max_in_flight);
+
+  const int fd_;
+  IoctlInterface *const ioctl_;
+  const int max_in_flight_;
+};
+
+}  // namespace ecclesia
+
+#endif  // ECCLESIA_MAGENT_LIB_IPMI_OPENIPMI_TRANSPORT_H_
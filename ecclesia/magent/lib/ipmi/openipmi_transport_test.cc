@@ -0,0 +1,145 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/lib/ipmi/openipmi_transport.h"
+
+#include <linux/ipmi.h>
+#include <sys/ioctl.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "ecclesia/lib/file/test_filesystem.h"
+#include "ecclesia/lib/io/ioctl.h"
+#include "ecclesia/lib/testing/status.h"
+#include "ecclesia/magent/lib/ipmi/ipmi.h"
+
+namespace ecclesia {
+namespace {
+
+using ::testing::_;
+using ::testing::ElementsAre;
+using ::testing::Eq;
+using ::testing::Matcher;
+using ::testing::Return;
+
+class MockIoctl : public IoctlInterface {
+ public:
+  MOCK_METHOD(int, Call, (int, unsigned long, intptr_t), (override));
+  MOCK_METHOD(int, Call, (int, unsigned long, void *), (override));
+};
+
+// The transport is pointed at a regular file, which is always readable, so
+// that all of the actual IPMI work is done by the mocked ioctls.
+class OpenIpmiTransportTest : public ::testing::Test {
+ protected:
+  OpenIpmiTransportTest() : fs_(GetTestTempdirPath()) {
+    fs_.CreateFile("/ipmi0", "");
+    auto maybe_transport =
+        OpenIpmiTransport::Open(fs_.GetTruePath("/ipmi0"), &ioctl_);
+    EXPECT_THAT(maybe_transport, IsOk());
+    if (maybe_transport.ok()) transport_ = std::move(*maybe_transport);
+  }
+
+  TestFilesystem fs_;
+  MockIoctl ioctl_;
+  std::unique_ptr<OpenIpmiTransport> transport_;
+};
+
+TEST_F(OpenIpmiTransportTest, OpenMissingDevice) {
+  EXPECT_TRUE(absl::IsNotFound(
+      OpenIpmiTransport::Open(fs_.GetTruePath("/ipmi1"), &ioctl_).status()));
+}
+
+TEST_F(OpenIpmiTransportTest, Send) {
+  ASSERT_NE(transport_, nullptr);
+  EXPECT_CALL(ioctl_,
+              Call(_, Eq(IPMICTL_SEND_COMMAND), Matcher<void *>(_)))
+      .WillOnce([](int, unsigned long, void *argp) {
+        auto *req = static_cast<struct ipmi_req *>(argp);
+        auto *addr =
+            reinterpret_cast<struct ipmi_system_interface_addr *>(req->addr);
+        EXPECT_EQ(addr->addr_type, IPMI_SYSTEM_INTERFACE_ADDR_TYPE);
+        EXPECT_EQ(addr->channel, IPMI_BMC_CHANNEL);
+        EXPECT_EQ(req->msgid, 17);
+        EXPECT_EQ(req->msg.netfn, 0x04);
+        EXPECT_EQ(req->msg.cmd, 0x2d);
+        EXPECT_EQ(req->msg.data_len, 1);
+        EXPECT_EQ(req->msg.data[0], 0x33);
+        return 0;
+      });
+  uint8_t sensor = 0x33;
+  EXPECT_THAT(
+      transport_->Send(17, IpmiRequest(kGetSensorReading, {&sensor, 1})),
+      IsOk());
+}
+
+TEST_F(OpenIpmiTransportTest, Receive) {
+  ASSERT_NE(transport_, nullptr);
+  EXPECT_CALL(ioctl_,
+              Call(_, Eq(IPMICTL_RECEIVE_MSG_TRUNC), Matcher<void *>(_)))
+      .WillOnce([](int, unsigned long, void *argp) {
+        // An asynchronous event, which should be skipped.
+        auto *recv = static_cast<struct ipmi_recv *>(argp);
+        recv->recv_type = IPMI_ASYNC_EVENT_RECV_TYPE;
+        recv->msgid = 0;
+        recv->msg.data_len = 0;
+        return 0;
+      })
+      .WillOnce([](int, unsigned long, void *argp) {
+        auto *recv = static_cast<struct ipmi_recv *>(argp);
+        recv->recv_type = IPMI_RESPONSE_RECV_TYPE;
+        recv->msgid = 17;
+        const unsigned char data[] = {0x00, 0x42, 0x40};
+        std::memcpy(recv->msg.data, data, sizeof(data));
+        recv->msg.data_len = sizeof(data);
+        return 0;
+      });
+  uint8_t seq;
+  IpmiResponse response;
+  EXPECT_THAT(transport_->Receive(absl::Now() + absl::Seconds(1), &seq,
+                                  &response),
+              IsOk());
+  EXPECT_EQ(seq, 17);
+  EXPECT_EQ(response.ccode, 0);
+  EXPECT_THAT(response.data, ElementsAre(0x42, 0x40));
+}
+
+TEST_F(OpenIpmiTransportTest, ReceiveFailure) {
+  ASSERT_NE(transport_, nullptr);
+  EXPECT_CALL(ioctl_,
+              Call(_, Eq(IPMICTL_RECEIVE_MSG_TRUNC), Matcher<void *>(_)))
+      .WillOnce([](int, unsigned long, void *) {
+        errno = EIO;
+        return -1;
+      });
+  uint8_t seq;
+  IpmiResponse response;
+  EXPECT_FALSE(
+      transport_->Receive(absl::Now() + absl::Seconds(1), &seq, &response)
+          .ok());
+}
+
+}  // namespace
+}  // namespace ecclesia
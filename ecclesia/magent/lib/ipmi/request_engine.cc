@@ -0,0 +1,279 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/lib/ipmi/request_engine.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "ecclesia/lib/codec/endian.h"
+#include "ecclesia/lib/time/clock.h"
+#include "ecclesia/magent/lib/ipmi/ipmi.h"
+
+namespace ecclesia {
+namespace {
+
+// Completion codes which indicate that the request should be sent again.
+constexpr int kNodeBusyCompletionCode = 0xC0;
+constexpr int kTimeoutCompletionCode = 0xC3;
+
+bool IsRetryable(const IpmiResponse &response) {
+  return response.ccode == kNodeBusyCompletionCode ||
+         response.ccode == kTimeoutCompletionCode;
+}
+
+// A region of a FRU which still needs to be read.
+struct FruRegion {
+  size_t offset;
+  size_t size;
+};
+
+}  // namespace
+
+IpmiRequestEngine::IpmiRequestEngine(IpmiPipelinedTransport *transport,
+                                     Options options, Clock *clock)
+    : transport_(transport), options_(std::move(options)), clock_(clock) {}
+
+std::vector<absl::StatusOr<IpmiResponse>> IpmiRequestEngine::SendAll(
+    absl::Span<const IpmiRequest> requests) {
+  std::vector<absl::StatusOr<IpmiResponse>> results(
+      requests.size(), absl::UnknownError("IPMI request was not sent"));
+
+  // The requests which still need to be sent, and which attempt it will be.
+  std::deque<std::pair<size_t, int>> to_send;
+  for (size_t i = 0; i < requests.size(); ++i) to_send.emplace_back(i, 0);
+
+  // The requests which have been sent, keyed by their sequence number.
+  struct InFlight {
+    size_t index;
+    int attempt;
+    absl::Time deadline;
+  };
+  absl::flat_hash_map<uint8_t, InFlight> in_flight;
+  // Sequence numbers of requests which timed out. These are not reused while
+  // there are others available, in case their responses show up late.
+  absl::flat_hash_set<uint8_t> abandoned;
+
+  const size_t max_in_flight = std::clamp(transport_->MaxInFlight(), 1,
+                                          kIpmiSequenceNumbers);
+
+  // Finds a sequence number that is not in use.
+  auto allocate_seq = [&]() -> absl::optional<uint8_t> {
+    for (int pass = 0; pass < 2; ++pass) {
+      for (int i = 0; i < kIpmiSequenceNumbers; ++i) {
+        uint8_t seq = (next_seq_ + i) % kIpmiSequenceNumbers;
+        if (!in_flight.contains(seq) && !abandoned.contains(seq)) {
+          next_seq_ = (seq + 1) % kIpmiSequenceNumbers;
+          return seq;
+        }
+      }
+      abandoned.clear();
+    }
+    return absl::nullopt;
+  };
+
+  // Handles a request that did not get a usable response.
+  auto retry_or_fail = [&](size_t index, int attempt, absl::Status status) {
+    if (attempt < options_.retries) {
+      to_send.emplace_back(index, attempt + 1);
+    } else {
+      results[index] = std::move(status);
+    }
+  };
+
+  while (!to_send.empty() || !in_flight.empty()) {
+    // Fill up the pipeline with as many requests as it can take.
+    while (!to_send.empty() && in_flight.size() < max_in_flight) {
+      absl::optional<uint8_t> seq = allocate_seq();
+      if (!seq.has_value()) break;
+      auto [index, attempt] = to_send.front();
+      to_send.pop_front();
+      absl::Status status = transport_->Send(*seq, requests[index]);
+      if (!status.ok()) {
+        retry_or_fail(index, attempt, std::move(status));
+        continue;
+      }
+      in_flight.emplace(*seq, InFlight{.index = index,
+                                       .attempt = attempt,
+                                       .deadline = clock_->Now() +
+                                                   options_.timeout});
+    }
+    if (in_flight.empty()) continue;
+
+    absl::Time deadline = absl::InfiniteFuture();
+    for (const auto &[seq, request] : in_flight) {
+      deadline = std::min(deadline, request.deadline);
+    }
+    uint8_t seq;
+    IpmiResponse response;
+    absl::Status status = transport_->Receive(deadline, &seq, &response);
+    if (status.ok()) {
+      auto iter = in_flight.find(seq);
+      // Ignore responses which don't match anything, they're late responses
+      // to requests that were already given up on.
+      if (iter == in_flight.end()) continue;
+      InFlight request = iter->second;
+      in_flight.erase(iter);
+      if (IsRetryable(response) && request.attempt < options_.retries) {
+        to_send.emplace_back(request.index, request.attempt + 1);
+      } else {
+        results[request.index] = std::move(response);
+      }
+    } else if (absl::IsDeadlineExceeded(status)) {
+      // Give up on everything whose deadline has passed. The transport has
+      // waited until at least the earliest deadline.
+      absl::Time now = std::max(clock_->Now(), deadline);
+      for (auto iter = in_flight.begin(); iter != in_flight.end();) {
+        if (iter->second.deadline > now) {
+          ++iter;
+          continue;
+        }
+        abandoned.insert(iter->first);
+        retry_or_fail(iter->second.index, iter->second.attempt,
+                      absl::DeadlineExceededError(absl::StrFormat(
+                          "no response to IPMI request with sequence %d",
+                          iter->first)));
+        in_flight.erase(iter++);
+      }
+    } else {
+      // The transport itself has failed, so nothing else is going to work.
+      for (const auto &[seq, request] : in_flight) {
+        results[request.index] = status;
+      }
+      for (const auto &[index, attempt] : to_send) {
+        results[index] = status;
+      }
+      break;
+    }
+  }
+  return results;
+}
+
+std::vector<absl::StatusOr<IpmiRequestEngine::SensorReading>>
+IpmiRequestEngine::ReadSensors(absl::Span<const uint8_t> sensor_numbers) {
+  std::vector<IpmiRequest> requests;
+  requests.reserve(sensor_numbers.size());
+  for (size_t i = 0; i < sensor_numbers.size(); ++i) {
+    requests.emplace_back(kGetSensorReading, sensor_numbers.subspan(i, 1));
+  }
+  std::vector<absl::StatusOr<IpmiResponse>> responses = SendAll(requests);
+
+  std::vector<absl::StatusOr<SensorReading>> readings;
+  readings.reserve(responses.size());
+  for (size_t i = 0; i < responses.size(); ++i) {
+    if (!responses[i].ok()) {
+      readings.push_back(responses[i].status());
+      continue;
+    }
+    const IpmiResponse &response = *responses[i];
+    if (response.ccode != 0) {
+      readings.push_back(absl::InternalError(absl::StrFormat(
+          "Get Sensor Reading for sensor %d failed with completion code %#x",
+          sensor_numbers[i], response.ccode)));
+      continue;
+    }
+    // The response is the reading and the status flags, optionally followed
+    // by one or two bytes of asserted states.
+    if (response.data.size() < 2) {
+      readings.push_back(absl::InternalError(absl::StrFormat(
+          "Get Sensor Reading response for sensor %d is too short",
+          sensor_numbers[i])));
+      continue;
+    }
+    SensorReading reading = {
+        .raw_value = response.data[0],
+        .scanning_enabled = (response.data[1] & 0x40) != 0,
+        .reading_available = (response.data[1] & 0x20) == 0,
+        .state = 0};
+    if (response.data.size() >= 3) reading.state = response.data[2];
+    if (response.data.size() >= 4) reading.state |= response.data[3] << 8;
+    readings.push_back(reading);
+  }
+  return readings;
+}
+
+absl::Status IpmiRequestEngine::ReadFru(uint8_t fru_id, size_t offset,
+                                        absl::Span<unsigned char> data) {
+  // Read FRU Data only has a 16-bit offset.
+  if (offset + data.size() > 0x10000) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "FRU read of %d bytes at offset %d is out of range", data.size(),
+        offset));
+  }
+  const size_t chunk_size = std::max(options_.fru_chunk_size, 1);
+
+  // The BMC is allowed to return fewer bytes than were asked for, so keep
+  // requesting whatever is left until everything has been read.
+  std::vector<FruRegion> pending;
+  for (size_t start = 0; start < data.size(); start += chunk_size) {
+    pending.push_back({start, std::min(chunk_size, data.size() - start)});
+  }
+  while (!pending.empty()) {
+    std::vector<std::array<uint8_t, 4>> buffers(pending.size());
+    std::vector<IpmiRequest> requests;
+    requests.reserve(pending.size());
+    for (size_t i = 0; i < pending.size(); ++i) {
+      buffers[i][0] = fru_id;
+      LittleEndian::Store16(offset + pending[i].offset, &buffers[i][1]);
+      buffers[i][3] = pending[i].size;
+      requests.emplace_back(kReadFruData, buffers[i]);
+    }
+    std::vector<absl::StatusOr<IpmiResponse>> responses = SendAll(requests);
+
+    std::vector<FruRegion> remaining;
+    for (size_t i = 0; i < responses.size(); ++i) {
+      const FruRegion &region = pending[i];
+      if (!responses[i].ok()) return responses[i].status();
+      const IpmiResponse &response = *responses[i];
+      if (response.ccode != 0) {
+        return absl::InternalError(absl::StrFormat(
+            "Read FRU Data for FRU %d at offset %d failed with completion "
+            "code %#x",
+            fru_id, offset + region.offset, response.ccode));
+      }
+      // The response is the number of bytes returned, followed by the data.
+      size_t count = response.data.empty() ? 0 : response.data[0];
+      if (count == 0 || count > region.size ||
+          response.data.size() < count + 1) {
+        return absl::InternalError(absl::StrFormat(
+            "Read FRU Data for FRU %d at offset %d returned a bad response",
+            fru_id, offset + region.offset));
+      }
+      std::memcpy(&data[region.offset], &response.data[1], count);
+      if (count < region.size) {
+        remaining.push_back({region.offset + count, region.size - count});
+      }
+    }
+    pending = std::move(remaining);
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace ecclesia
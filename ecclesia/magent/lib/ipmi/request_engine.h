@@ -0,0 +1,129 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// An engine for sending many IPMI requests at once. Sending requests one at a
+// time through a synchronous interface costs a full round trip to the BMC for
+// each one, so reading N sensors or N chunks of a FRU takes N round trips. The
+// engine instead keeps as many requests in flight as the transport allows and
+// matches up the responses as they arrive, so that the round trips overlap.
+//
+// Requests are tagged with a sequence number which the transport carries
+// along with the request and hands back with its response. This maps onto the
+// rqSeq field of LAN messages and the msgid of the in-band kernel interface.
+
+#ifndef ECCLESIA_MAGENT_LIB_IPMI_REQUEST_ENGINE_H_
+#define ECCLESIA_MAGENT_LIB_IPMI_REQUEST_ENGINE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "ecclesia/lib/time/clock.h"
+#include "ecclesia/magent/lib/ipmi/ipmi.h"
+
+namespace ecclesia {
+
+// The number of distinct sequence numbers. LAN messages only have six bits for
+// the sequence number, so no transport can use more than this.
+inline constexpr int kIpmiSequenceNumbers = 64;
+
+// A transport which can have multiple requests outstanding at once.
+class IpmiPipelinedTransport {
+ public:
+  virtual ~IpmiPipelinedTransport() = default;
+
+  // The maximum number of requests which can be in flight at once.
+  virtual int MaxInFlight() const = 0;
+
+  // Sends a request tagged with the given sequence number. This must not
+  // block waiting for the response.
+  virtual absl::Status Send(uint8_t seq, const IpmiRequest &request) = 0;
+
+  // Waits until the deadline for a response to any outstanding request, and
+  // returns it along with the sequence number of its request. If no response
+  // arrives before the deadline this returns a deadline exceeded error.
+  virtual absl::Status Receive(absl::Time deadline, uint8_t *seq,
+                               IpmiResponse *response) = 0;
+};
+
+// Sends batches of requests over a pipelined transport. The engine is not
+// thread-safe; each batch is sent and completed by the calling thread.
+class IpmiRequestEngine {
+ public:
+  struct Options {
+    // How long to wait for the response to each request.
+    absl::Duration timeout = absl::Seconds(1);
+    // How many times to resend a request which times out, or which the BMC
+    // reports as busy or timed out.
+    int retries = 1;
+    // The number of bytes to read from a FRU with each Read FRU Data command.
+    // The response has to fit in the smallest system interface buffers.
+    int fru_chunk_size = 32;
+  };
+
+  // The reading of a sensor, from the Get Sensor Reading command.
+  struct SensorReading {
+    // The raw reading, which needs to be converted using the sensor's SDR.
+    uint8_t raw_value;
+    bool scanning_enabled;
+    // Indicates if the reading is valid; it is not while the sensor is still
+    // initializing.
+    bool reading_available;
+    // The threshold or discrete states that are asserted, if any.
+    uint16_t state;
+  };
+
+  // The transport and clock must outlive the engine.
+  IpmiRequestEngine(IpmiPipelinedTransport *transport, Options options,
+                    Clock *clock = Clock::RealClock());
+
+  IpmiRequestEngine(const IpmiRequestEngine &other) = delete;
+  IpmiRequestEngine &operator=(const IpmiRequestEngine &other) = delete;
+
+  // Sends all of the requests and waits for their responses. The results are
+  // in the same order as the requests. A response with a non-zero completion
+  // code is still returned as a response; errors are only used for requests
+  // that never got one.
+  std::vector<absl::StatusOr<IpmiResponse>> SendAll(
+      absl::Span<const IpmiRequest> requests);
+
+  // Reads all of the given sensors.
+  std::vector<absl::StatusOr<SensorReading>> ReadSensors(
+      absl::Span<const uint8_t> sensor_numbers);
+
+  // Reads data from a FRU, starting at the given offset. The number of bytes
+  // read is equal to the size of the data. The data is read in chunks, all of
+  // which are requested at once.
+  absl::Status ReadFru(uint8_t fru_id, size_t offset,
+                       absl::Span<unsigned char> data);
+
+ private:
+  IpmiPipelinedTransport *const transport_;
+  const Options options_;
+  Clock *const clock_;
+  // The sequence number to try for the next request. This keeps advancing
+  // across calls so that a late response to a request which timed out is
+  // unlikely to be mistaken for the response to a new one.
+  uint8_t next_seq_ = 0;
+};
+
+}  // namespace ecclesia
+
+#endif  // ECCLESIA_MAGENT_LIB_IPMI_REQUEST_ENGINE_H_
@@ -0,0 +1,381 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/lib/ipmi/request_engine.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "ecclesia/lib/testing/status.h"
+#include "ecclesia/lib/time/clock_fake.h"
+#include "ecclesia/magent/lib/ipmi/ipmi.h"
+#include "ecclesia/magent/lib/ipmi/ipmi_mock.h"
+
+namespace ecclesia {
+namespace {
+
+using ::testing::_;
+using ::testing::DoAll;
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+using ::testing::Return;
+using ::testing::SetArgPointee;
+
+// A request as seen by the fake transport.
+struct SentRequest {
+  uint8_t seq;
+  IpmiNetworkFunction network_function;
+  IpmiCommand command;
+  std::vector<uint8_t> data;
+};
+
+// A fake transport that simulates a BMC. Responses are produced by a handler,
+// which can return nullopt to drop a request. The responses are returned in
+// the reverse order of the requests, to check that they are matched up.
+class FakeTransport : public IpmiPipelinedTransport {
+ public:
+  using Handler =
+      std::function<absl::optional<IpmiResponse>(const SentRequest &)>;
+
+  FakeTransport(FakeClock *clock, int max_in_flight, Handler handler)
+      : clock_(clock),
+        max_in_flight_(max_in_flight),
+        handler_(std::move(handler)) {}
+
+  int MaxInFlight() const override { return max_in_flight_; }
+
+  absl::Status Send(uint8_t seq, const IpmiRequest &request) override {
+    if (!send_status_.ok()) return send_status_;
+    SentRequest sent = {
+        .seq = seq,
+        .network_function = request.network_function,
+        .command = request.command,
+        .data = std::vector<uint8_t>(request.data.begin(), request.data.end())};
+    sent_.push_back(sent);
+    outstanding_.push_back(std::move(sent));
+    max_outstanding_ = std::max(max_outstanding_, outstanding_.size());
+    return absl::OkStatus();
+  }
+
+  absl::Status Receive(absl::Time deadline, uint8_t *seq,
+                       IpmiResponse *response) override {
+    while (!outstanding_.empty()) {
+      SentRequest request = std::move(outstanding_.back());
+      outstanding_.pop_back();
+      absl::optional<IpmiResponse> maybe_response = handler_(request);
+      if (!maybe_response.has_value()) continue;
+      *seq = request.seq;
+      *response = std::move(*maybe_response);
+      return absl::OkStatus();
+    }
+    clock_->AdvanceTime(deadline - clock_->Now());
+    return absl::DeadlineExceededError("timed out");
+  }
+
+  void set_send_status(absl::Status status) { send_status_ = status; }
+  const std::vector<SentRequest> &sent() const { return sent_; }
+  size_t max_outstanding() const { return max_outstanding_; }
+
+ private:
+  FakeClock *clock_;
+  int max_in_flight_;
+  Handler handler_;
+  absl::Status send_status_;
+  std::vector<SentRequest> outstanding_;
+  std::vector<SentRequest> sent_;
+  size_t max_outstanding_ = 0;
+};
+
+// A handler that echoes the request data back in the response.
+absl::optional<IpmiResponse> Echo(const SentRequest &request) {
+  return IpmiResponse{.ccode = 0, .data = request.data};
+}
+
+TEST(IpmiRequestEngineTest, KeepsRequestsInFlight) {
+  FakeClock clock;
+  FakeTransport transport(&clock, 4, Echo);
+  IpmiRequestEngine engine(&transport, {}, &clock);
+
+  std::vector<uint8_t> payloads(20);
+  std::iota(payloads.begin(), payloads.end(), 0);
+  std::vector<IpmiRequest> requests;
+  for (size_t i = 0; i < payloads.size(); ++i) {
+    requests.emplace_back(kGetSensorReading,
+                          absl::MakeConstSpan(payloads).subspan(i, 1));
+  }
+  std::vector<absl::StatusOr<IpmiResponse>> results = engine.SendAll(requests);
+  ASSERT_EQ(results.size(), payloads.size());
+  for (size_t i = 0; i < results.size(); ++i) {
+    ASSERT_THAT(results[i], IsOk());
+    EXPECT_THAT(results[i]->data, ElementsAre(payloads[i]));
+  }
+  EXPECT_EQ(transport.sent().size(), payloads.size());
+  EXPECT_EQ(transport.max_outstanding(), 4);
+}
+
+TEST(IpmiRequestEngineTest, EmptyBatch) {
+  FakeClock clock;
+  FakeTransport transport(&clock, 4, Echo);
+  IpmiRequestEngine engine(&transport, {}, &clock);
+  EXPECT_TRUE(engine.SendAll({}).empty());
+}
+
+TEST(IpmiRequestEngineTest, TimedOutRequestsAreRetried) {
+  FakeClock clock;
+  absl::Time start = clock.Now();
+  int attempts = 0;
+  FakeTransport transport(&clock, 4, [&](const SentRequest &request) {
+    // Drop the first attempt.
+    if (attempts++ == 0) return absl::optional<IpmiResponse>();
+    return Echo(request);
+  });
+  IpmiRequestEngine engine(&transport, {.timeout = absl::Seconds(2)}, &clock);
+
+  uint8_t sensor = 7;
+  std::vector<absl::StatusOr<IpmiResponse>> results =
+      engine.SendAll({IpmiRequest(kGetSensorReading, {&sensor, 1})});
+  ASSERT_THAT(results, ElementsAre(IsOk()));
+  EXPECT_EQ(attempts, 2);
+  EXPECT_EQ(clock.Now() - start, absl::Seconds(2));
+  // The retry should not reuse the sequence number of the dropped request.
+  ASSERT_EQ(transport.sent().size(), 2);
+  EXPECT_NE(transport.sent()[0].seq, transport.sent()[1].seq);
+}
+
+TEST(IpmiRequestEngineTest, LateResponsesAreIgnored) {
+  FakeClock clock;
+  MockIpmiPipelinedTransport transport;
+  EXPECT_CALL(transport, MaxInFlight()).WillRepeatedly(Return(1));
+  IpmiRequestEngine engine(&transport, {}, &clock);
+
+  // The first attempt goes out with sequence 0 and times out. The retry uses
+  // sequence 1, and the late response to the first attempt is dropped.
+  EXPECT_CALL(transport, Send(0, _)).WillOnce(Return(absl::OkStatus()));
+  EXPECT_CALL(transport, Send(1, _)).WillOnce(Return(absl::OkStatus()));
+  EXPECT_CALL(transport, Receive(_, _, _))
+      .WillOnce(Return(absl::DeadlineExceededError("timed out")))
+      .WillOnce(DoAll(SetArgPointee<1>(0),
+                      SetArgPointee<2>(IpmiResponse{.ccode = 0xCB}),
+                      Return(absl::OkStatus())))
+      .WillOnce(DoAll(SetArgPointee<1>(1),
+                      SetArgPointee<2>(IpmiResponse{.ccode = 0}),
+                      Return(absl::OkStatus())));
+
+  uint8_t sensor = 7;
+  std::vector<absl::StatusOr<IpmiResponse>> results =
+      engine.SendAll({IpmiRequest(kGetSensorReading, {&sensor, 1})});
+  ASSERT_THAT(results, ElementsAre(IsOk()));
+  EXPECT_EQ(results[0]->ccode, 0);
+}
+
+TEST(IpmiRequestEngineTest, AbandonedSequenceNumbersAreReusedWhenExhausted) {
+  FakeClock clock;
+  MockIpmiPipelinedTransport transport;
+  EXPECT_CALL(transport, MaxInFlight())
+      .WillRepeatedly(Return(kIpmiSequenceNumbers));
+  IpmiRequestEngine engine(&transport, {.retries = 0}, &clock);
+
+  // Every sequence number is used up by requests that time out, so the last
+  // request has to go out with one of the abandoned numbers.
+  constexpr size_t kNumRequests = kIpmiSequenceNumbers + 1;
+  std::vector<uint8_t> seqs;
+  EXPECT_CALL(transport, Send(_, _))
+      .Times(kNumRequests)
+      .WillRepeatedly([&seqs](uint8_t seq, const IpmiRequest &) {
+        seqs.push_back(seq);
+        return absl::OkStatus();
+      });
+  EXPECT_CALL(transport, Receive(_, _, _))
+      .WillOnce(Return(absl::DeadlineExceededError("timed out")))
+      .WillOnce(DoAll(SetArgPointee<1>(0),
+                      SetArgPointee<2>(IpmiResponse{.ccode = 0}),
+                      Return(absl::OkStatus())));
+
+  uint8_t sensor = 7;
+  std::vector<IpmiRequest> requests(
+      kNumRequests, IpmiRequest(kGetSensorReading, {&sensor, 1}));
+  std::vector<absl::StatusOr<IpmiResponse>> results = engine.SendAll(requests);
+  ASSERT_EQ(results.size(), kNumRequests);
+  for (size_t i = 0; i + 1 < kNumRequests; ++i) {
+    EXPECT_TRUE(absl::IsDeadlineExceeded(results[i].status()));
+  }
+  EXPECT_THAT(results.back(), IsOk());
+  ASSERT_EQ(seqs.size(), kNumRequests);
+  EXPECT_EQ(seqs.back(), 0);
+}
+
+TEST(IpmiRequestEngineTest, TimeoutAfterRetries) {
+  FakeClock clock;
+  FakeTransport transport(&clock, 4, [](const SentRequest &) {
+    return absl::optional<IpmiResponse>();
+  });
+  IpmiRequestEngine engine(&transport, {.retries = 2}, &clock);
+
+  uint8_t sensor = 7;
+  std::vector<absl::StatusOr<IpmiResponse>> results =
+      engine.SendAll({IpmiRequest(kGetSensorReading, {&sensor, 1})});
+  ASSERT_EQ(results.size(), 1);
+  EXPECT_TRUE(absl::IsDeadlineExceeded(results[0].status()));
+  EXPECT_EQ(transport.sent().size(), 3);
+}
+
+TEST(IpmiRequestEngineTest, BusyRequestsAreRetried) {
+  FakeClock clock;
+  int attempts = 0;
+  FakeTransport transport(&clock, 4, [&](const SentRequest &request) {
+    if (attempts++ == 0) {
+      return absl::optional<IpmiResponse>(IpmiResponse{.ccode = 0xC0});
+    }
+    return Echo(request);
+  });
+  IpmiRequestEngine engine(&transport, {}, &clock);
+
+  uint8_t sensor = 7;
+  std::vector<absl::StatusOr<IpmiResponse>> results =
+      engine.SendAll({IpmiRequest(kGetSensorReading, {&sensor, 1})});
+  ASSERT_THAT(results, ElementsAre(IsOk()));
+  EXPECT_EQ(results[0]->ccode, 0);
+  EXPECT_EQ(attempts, 2);
+}
+
+TEST(IpmiRequestEngineTest, CompletionCodesAreReturned) {
+  FakeClock clock;
+  FakeTransport transport(&clock, 4, [](const SentRequest &) {
+    return absl::optional<IpmiResponse>(IpmiResponse{.ccode = 0xCB});
+  });
+  IpmiRequestEngine engine(&transport, {}, &clock);
+
+  uint8_t sensor = 7;
+  std::vector<absl::StatusOr<IpmiResponse>> results =
+      engine.SendAll({IpmiRequest(kGetSensorReading, {&sensor, 1})});
+  ASSERT_THAT(results, ElementsAre(IsOk()));
+  EXPECT_EQ(results[0]->ccode, 0xCB);
+  EXPECT_EQ(transport.sent().size(), 1);
+}
+
+TEST(IpmiRequestEngineTest, SendFailures) {
+  FakeClock clock;
+  FakeTransport transport(&clock, 4, Echo);
+  transport.set_send_status(absl::InternalError("broken"));
+  IpmiRequestEngine engine(&transport, {}, &clock);
+
+  uint8_t sensor = 7;
+  std::vector<absl::StatusOr<IpmiResponse>> results =
+      engine.SendAll({IpmiRequest(kGetSensorReading, {&sensor, 1})});
+  ASSERT_EQ(results.size(), 1);
+  EXPECT_TRUE(absl::IsInternal(results[0].status()));
+}
+
+TEST(IpmiRequestEngineTest, ReadSensors) {
+  FakeClock clock;
+  FakeTransport transport(&clock, 4, [](const SentRequest &request) {
+    EXPECT_EQ(request.network_function, IpmiNetworkFunction::kSensorOrEvent);
+    EXPECT_EQ(request.command, IpmiCommand::kGetSensorReading);
+    switch (request.data[0]) {
+      case 1:
+        return absl::optional<IpmiResponse>(
+            IpmiResponse{.ccode = 0, .data = {0x42, 0x40, 0x01, 0x80}});
+      case 2:
+        return absl::optional<IpmiResponse>(
+            IpmiResponse{.ccode = 0, .data = {0x00, 0x60}});
+      default:
+        return absl::optional<IpmiResponse>(IpmiResponse{.ccode = 0xCB});
+    }
+  });
+  IpmiRequestEngine engine(&transport, {}, &clock);
+
+  std::vector<uint8_t> sensors = {1, 2, 3};
+  auto readings = engine.ReadSensors(sensors);
+  ASSERT_EQ(readings.size(), 3);
+  ASSERT_THAT(readings[0], IsOk());
+  EXPECT_EQ(readings[0]->raw_value, 0x42);
+  EXPECT_TRUE(readings[0]->scanning_enabled);
+  EXPECT_TRUE(readings[0]->reading_available);
+  EXPECT_EQ(readings[0]->state, 0x8001);
+  ASSERT_THAT(readings[1], IsOk());
+  EXPECT_FALSE(readings[1]->reading_available);
+  EXPECT_EQ(readings[1]->state, 0);
+  EXPECT_FALSE(readings[2].ok());
+}
+
+// Simulates Read FRU Data on a FRU with the given contents. The BMC returns at
+// most max_read bytes per request.
+FakeTransport::Handler FruHandler(const std::vector<uint8_t> &fru,
+                                  size_t max_read) {
+  return [&fru, max_read](const SentRequest &request) {
+    EXPECT_EQ(request.network_function, IpmiNetworkFunction::kStorage);
+    EXPECT_EQ(request.command, IpmiCommand::kReadFruData);
+    EXPECT_EQ(request.data[0], 5);
+    size_t offset = request.data[1] | request.data[2] << 8;
+    size_t count = std::min<size_t>(request.data[3], max_read);
+    IpmiResponse response = {.ccode = 0,
+                             .data = {static_cast<uint8_t>(count)}};
+    response.data.insert(response.data.end(), fru.begin() + offset,
+                         fru.begin() + offset + count);
+    return absl::optional<IpmiResponse>(std::move(response));
+  };
+}
+
+TEST(IpmiRequestEngineTest, ReadFruInChunks) {
+  std::vector<uint8_t> fru(300);
+  std::iota(fru.begin(), fru.end(), 0);
+  FakeClock clock;
+  FakeTransport transport(&clock, 8, FruHandler(fru, 32));
+  IpmiRequestEngine engine(&transport, {.fru_chunk_size = 32}, &clock);
+
+  std::vector<unsigned char> data(200);
+  EXPECT_THAT(engine.ReadFru(5, 50, absl::MakeSpan(data)), IsOk());
+  EXPECT_THAT(data, ElementsAreArray(fru.begin() + 50, fru.begin() + 250));
+  EXPECT_EQ(transport.sent().size(), 7);
+  EXPECT_EQ(transport.max_outstanding(), 7);
+}
+
+TEST(IpmiRequestEngineTest, ReadFruShortReads) {
+  std::vector<uint8_t> fru(100);
+  std::iota(fru.begin(), fru.end(), 0);
+  FakeClock clock;
+  FakeTransport transport(&clock, 8, FruHandler(fru, 20));
+  IpmiRequestEngine engine(&transport, {.fru_chunk_size = 32}, &clock);
+
+  std::vector<unsigned char> data(100);
+  EXPECT_THAT(engine.ReadFru(5, 0, absl::MakeSpan(data)), IsOk());
+  EXPECT_THAT(data, ElementsAreArray(fru));
+}
+
+TEST(IpmiRequestEngineTest, ReadFruFailure) {
+  FakeClock clock;
+  FakeTransport transport(&clock, 8, [](const SentRequest &) {
+    return absl::optional<IpmiResponse>(IpmiResponse{.ccode = 0x81});
+  });
+  IpmiRequestEngine engine(&transport, {}, &clock);
+
+  std::vector<unsigned char> data(64);
+  EXPECT_FALSE(engine.ReadFru(5, 0, absl::MakeSpan(data)).ok());
+  EXPECT_FALSE(engine.ReadFru(5, 0xFFF0, absl::MakeSpan(data)).ok());
+}
+
+}  // namespace
+}  // namespace ecclesia
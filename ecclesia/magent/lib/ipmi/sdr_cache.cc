@@ -0,0 +1,260 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/lib/ipmi/sdr_cache.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "ecclesia/lib/codec/endian.h"
+#include "ecclesia/lib/logging/globals.h"
+#include "ecclesia/lib/logging/logging.h"
+#include "ecclesia/magent/lib/ipmi/ipmi.h"
+
+namespace ecclesia {
+namespace {
+
+// How many times to try reading the repository before giving up, when the
+// reservation keeps getting cancelled.
+constexpr int kMaxReadAttempts = 3;
+
+// The cache file starts with a header containing a magic value, the version
+// of the file format and the repository info. It is followed by each record
+// as its ID, the size of its data, and the data. All integers are stored in
+// little endian.
+constexpr absl::string_view kCacheFileMagic = "ESDR";
+constexpr uint8_t kCacheFileVersion = 1;
+constexpr size_t kCacheFileHeaderSize = 20;
+constexpr size_t kCacheFileRecordHeaderSize = 4;
+
+// Offsets of the fields used from a FRU device locator record.
+constexpr size_t kFruLocatorRecordTypeOffset = 3;
+constexpr size_t kFruLocatorDeviceIdOffset = 6;
+constexpr size_t kFruLocatorAccessOffset = 7;
+constexpr size_t kFruLocatorEntityIdOffset = 12;
+constexpr size_t kFruLocatorEntityInstanceOffset = 13;
+constexpr size_t kFruLocatorIdCodeOffset = 15;
+constexpr size_t kFruLocatorIdStringOffset = 16;
+
+// Indicates if the repository maintains the timestamps that are used to tell
+// when it has changed.
+bool HasTimestamps(const IpmiInterface::SdrRepositoryInfo &info) {
+  return info.most_recent_addition != kSdrTimestampUnspecified &&
+         info.most_recent_erase != kSdrTimestampUnspecified;
+}
+
+// Parse the contents of a cache file. Returns nullopt if the contents are not
+// a valid cache file.
+absl::optional<IpmiSdrCache::Records> ParseCacheFile(
+    absl::string_view contents, IpmiInterface::SdrRepositoryInfo *info) {
+  if (contents.size() < kCacheFileHeaderSize ||
+      contents.substr(0, kCacheFileMagic.size()) != kCacheFileMagic ||
+      LittleEndian::Load8(&contents[4]) != kCacheFileVersion) {
+    return absl::nullopt;
+  }
+  info->version = LittleEndian::Load8(&contents[5]);
+  info->record_count = LittleEndian::Load16(&contents[6]);
+  info->most_recent_addition = LittleEndian::Load32(&contents[8]);
+  info->most_recent_erase = LittleEndian::Load32(&contents[12]);
+  uint32_t num_records = LittleEndian::Load32(&contents[16]);
+  contents.remove_prefix(kCacheFileHeaderSize);
+
+  IpmiSdrCache::Records records;
+  for (uint32_t i = 0; i < num_records; ++i) {
+    if (contents.size() < kCacheFileRecordHeaderSize) return absl::nullopt;
+    IpmiInterface::SdrRecord record;
+    record.record_id = LittleEndian::Load16(&contents[0]);
+    uint16_t size = LittleEndian::Load16(&contents[2]);
+    contents.remove_prefix(kCacheFileRecordHeaderSize);
+    if (contents.size() < size) return absl::nullopt;
+    record.data.assign(contents.begin(), contents.begin() + size);
+    contents.remove_prefix(size);
+    records.push_back(std::move(record));
+  }
+  if (!contents.empty()) return absl::nullopt;
+  return records;
+}
+
+// Serialize records into the cache file format.
+std::string SerializeCacheFile(const IpmiInterface::SdrRepositoryInfo &info,
+                               const IpmiSdrCache::Records &records) {
+  size_t size = kCacheFileHeaderSize;
+  for (const IpmiInterface::SdrRecord &record : records) {
+    size += kCacheFileRecordHeaderSize + record.data.size();
+  }
+  std::string contents(size, '\0');
+  contents.replace(0, kCacheFileMagic.size(), kCacheFileMagic.data(),
+                   kCacheFileMagic.size());
+  LittleEndian::Store8(kCacheFileVersion, &contents[4]);
+  LittleEndian::Store8(info.version, &contents[5]);
+  LittleEndian::Store16(info.record_count, &contents[6]);
+  LittleEndian::Store32(info.most_recent_addition, &contents[8]);
+  LittleEndian::Store32(info.most_recent_erase, &contents[12]);
+  LittleEndian::Store32(records.size(), &contents[16]);
+  size_t offset = kCacheFileHeaderSize;
+  for (const IpmiInterface::SdrRecord &record : records) {
+    LittleEndian::Store16(record.record_id, &contents[offset]);
+    LittleEndian::Store16(record.data.size(), &contents[offset + 2]);
+    offset += kCacheFileRecordHeaderSize;
+    contents.replace(offset, record.data.size(),
+                     reinterpret_cast<const char *>(record.data.data()),
+                     record.data.size());
+    offset += record.data.size();
+  }
+  return contents;
+}
+
+}  // namespace
+
+absl::optional<IpmiInterface::BmcFruInterfaceInfo> GetFruFromSdrRecord(
+    const IpmiInterface::SdrRecord &record) {
+  const std::vector<uint8_t> &data = record.data;
+  if (data.size() < kFruLocatorIdStringOffset ||
+      data[kFruLocatorRecordTypeOffset] != kSdrRecordTypeFruDeviceLocator) {
+    return absl::nullopt;
+  }
+  // Only logical FRU devices can be read with the Read FRU Data command.
+  if (!(data[kFruLocatorAccessOffset] & 0x80)) return absl::nullopt;
+
+  IpmiInterface::BmcFruInterfaceInfo fru;
+  fru.record_id = record.record_id;
+  fru.entity = {data[kFruLocatorEntityIdOffset],
+                data[kFruLocatorEntityInstanceOffset]};
+  size_t name_size = std::min<size_t>(data[kFruLocatorIdCodeOffset] & 0x1f,
+                                      data.size() - kFruLocatorIdStringOffset);
+  fru.name.assign(data.begin() + kFruLocatorIdStringOffset,
+                  data.begin() + kFruLocatorIdStringOffset + name_size);
+  fru.fru_id = data[kFruLocatorDeviceIdOffset];
+  return fru;
+}
+
+IpmiSdrCache::IpmiSdrCache(IpmiInterface *ipmi, Options options)
+    : ipmi_(ipmi), options_(std::move(options)) {}
+
+absl::StatusOr<std::shared_ptr<const IpmiSdrCache::Records>>
+IpmiSdrCache::GetRecords() {
+  absl::MutexLock ml(&mutex_);
+  if (!loaded_from_file_) {
+    loaded_from_file_ = true;
+    LoadFromFile();
+  }
+
+  IpmiInterface::SdrRepositoryInfo info;
+  absl::Status status = ipmi_->GetSdrRepositoryInfo(&info);
+  if (!status.ok()) return status;
+  if (records_ && HasTimestamps(info) && info == info_) return records_;
+
+  absl::StatusOr<Records> maybe_records = ReadRepository(&info);
+  if (!maybe_records.ok()) return maybe_records.status();
+  info_ = info;
+  records_ = std::make_shared<const Records>(std::move(*maybe_records));
+  SaveToFile();
+  return records_;
+}
+
+absl::StatusOr<IpmiSdrCache::Records> IpmiSdrCache::ReadRepository(
+    IpmiInterface::SdrRepositoryInfo *info) {
+  absl::Status status;
+  for (int attempt = 0; attempt < kMaxReadAttempts; ++attempt) {
+    // If the repository was modified during an earlier attempt then the info
+    // has to be refreshed as well.
+    if (attempt > 0) {
+      status = ipmi_->GetSdrRepositoryInfo(info);
+      if (!status.ok()) return status;
+    }
+    uint16_t reservation_id;
+    status = ipmi_->ReserveSdrRepository(&reservation_id);
+    if (!status.ok()) return status;
+
+    Records records;
+    records.reserve(info->record_count);
+    uint16_t record_id = kFirstSdrRecordId;
+    while (record_id != kLastSdrRecordId) {
+      // A well-formed repository can't have more records than there are IDs,
+      // so more than that indicates the next record IDs form a cycle.
+      if (records.size() >= kLastSdrRecordId) {
+        return absl::InternalError("SDR repository record IDs form a cycle");
+      }
+      IpmiInterface::SdrRecord record;
+      status =
+          ipmi_->GetSdrRecord(reservation_id, record_id, &record, &record_id);
+      if (!status.ok()) break;
+      records.push_back(std::move(record));
+    }
+    if (status.ok()) return records;
+    if (!absl::IsAborted(status)) return status;
+    InfoLog() << "SDR repository reservation was cancelled, reading again";
+  }
+  return absl::AbortedError(absl::StrFormat(
+      "SDR repository reservation was cancelled %d times", kMaxReadAttempts));
+}
+
+void IpmiSdrCache::LoadFromFile() {
+  if (options_.cache_path.empty()) return;
+
+  std::ifstream file(options_.cache_path, std::ios::binary);
+  if (!file.is_open()) return;
+  std::string contents((std::istreambuf_iterator<char>(file)),
+                       std::istreambuf_iterator<char>());
+
+  IpmiInterface::SdrRepositoryInfo info;
+  absl::optional<Records> records = ParseCacheFile(contents, &info);
+  if (!records.has_value()) {
+    WarningLog() << "ignoring invalid SDR cache file: "
+                 << options_.cache_path;
+    return;
+  }
+  info_ = info;
+  records_ = std::make_shared<const Records>(std::move(*records));
+}
+
+void IpmiSdrCache::SaveToFile() {
+  if (options_.cache_path.empty()) return;
+
+  // Write the new contents to a temporary file and then rename it over the
+  // cache file, so that a partially written file is never loaded.
+  std::string temp_path = absl::StrCat(options_.cache_path, ".tmp");
+  std::string contents = SerializeCacheFile(info_, *records_);
+  {
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    if (!file.write(contents.data(), contents.size()) || !file.flush()) {
+      WarningLog() << "unable to write SDR cache file: " << temp_path;
+      return;
+    }
+  }
+  if (std::rename(temp_path.c_str(), options_.cache_path.c_str()) != 0) {
+    WarningLog() << "unable to replace SDR cache file: "
+                 << options_.cache_path;
+    std::remove(temp_path.c_str());
+  }
+}
+
+}  // namespace ecclesia
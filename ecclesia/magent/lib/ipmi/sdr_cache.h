@@ -0,0 +1,108 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A cache of the BMC's SDR repository. Reading the repository takes a Get SDR
+// round trip per record, which over a slow KCS or LAN interface adds up to
+// seconds for the whole thing. The cache keeps the records in memory, and
+// optionally in a file so that they can be reused across restarts, and only
+// reads the repository again when it has changed.
+//
+// Changes are detected using the Get SDR Repository Info command: the BMC
+// updates the most recent addition and erase timestamps whenever records are
+// added or erased. The repository is read under a reservation, which the BMC
+// cancels if the repository is modified part way through, in which case the
+// read is restarted.
+
+#ifndef ECCLESIA_MAGENT_LIB_IPMI_SDR_CACHE_H_
+#define ECCLESIA_MAGENT_LIB_IPMI_SDR_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "ecclesia/magent/lib/ipmi/ipmi.h"
+
+namespace ecclesia {
+
+// Record IDs with special meaning to the Get SDR command.
+inline constexpr uint16_t kFirstSdrRecordId = 0x0000;
+inline constexpr uint16_t kLastSdrRecordId = 0xFFFF;
+
+// Every SDR record starts with a header of this size: the record ID, the SDR
+// version, the record type and the length of the rest of the record.
+inline constexpr size_t kSdrRecordHeaderSize = 5;
+
+// Timestamps in the SDR repository info with this value are unspecified.
+inline constexpr uint32_t kSdrTimestampUnspecified = 0xFFFFFFFF;
+
+// The record type of FRU device locator records.
+inline constexpr uint8_t kSdrRecordTypeFruDeviceLocator = 0x11;
+
+// Extracts the FRU information from a FRU device locator record. Returns
+// nullopt if the record is not a locator for a logical FRU device.
+absl::optional<IpmiInterface::BmcFruInterfaceInfo> GetFruFromSdrRecord(
+    const IpmiInterface::SdrRecord &record);
+
+class IpmiSdrCache {
+ public:
+  struct Options {
+    // If non-empty, the records are also saved to this file whenever the
+    // repository is read, and loaded from it on first use.
+    std::string cache_path;
+  };
+
+  using Records = std::vector<IpmiInterface::SdrRecord>;
+
+  // The IPMI interface must outlive the cache.
+  IpmiSdrCache(IpmiInterface *ipmi, Options options);
+
+  IpmiSdrCache(const IpmiSdrCache &other) = delete;
+  IpmiSdrCache &operator=(const IpmiSdrCache &other) = delete;
+
+  // Returns all of the records in the SDR repository. This costs a Get SDR
+  // Repository Info command if the cached records are still current, and a
+  // full read of the repository if they are not. Repositories which do not
+  // maintain the timestamps cannot be validated and so are always read.
+  absl::StatusOr<std::shared_ptr<const Records>> GetRecords();
+
+ private:
+  // Read the entire repository, restarting if the reservation is cancelled.
+  // The repository info is updated to match the records that were read.
+  absl::StatusOr<Records> ReadRepository(
+      IpmiInterface::SdrRepositoryInfo *info);
+
+  // Load and save the records from and to the cache file.
+  void LoadFromFile() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void SaveToFile() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  IpmiInterface *const ipmi_;
+  const Options options_;
+
+  absl::Mutex mutex_;
+  bool loaded_from_file_ ABSL_GUARDED_BY(mutex_) = false;
+  IpmiInterface::SdrRepositoryInfo info_ ABSL_GUARDED_BY(mutex_) = {};
+  std::shared_ptr<const Records> records_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace ecclesia
+
+#endif  // ECCLESIA_MAGENT_LIB_IPMI_SDR_CACHE_H_
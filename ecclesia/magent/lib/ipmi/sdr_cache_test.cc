@@ -0,0 +1,280 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/lib/ipmi/sdr_cache.h"
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "ecclesia/lib/file/test_filesystem.h"
+#include "ecclesia/lib/testing/status.h"
+#include "ecclesia/magent/lib/ipmi/ipmi.h"
+#include "ecclesia/magent/lib/ipmi/ipmi_mock.h"
+
+namespace ecclesia {
+namespace {
+
+using ::testing::_;
+using ::testing::ElementsAre;
+using ::testing::Field;
+using ::testing::NiceMock;
+
+// Construct a FRU device locator record for a logical FRU device.
+IpmiInterface::SdrRecord FruLocatorRecord(uint16_t record_id, uint8_t fru_id,
+                                          uint8_t entity_id,
+                                          const std::string &name) {
+  std::vector<uint8_t> data = {
+      static_cast<uint8_t>(record_id & 0xff),
+      static_cast<uint8_t>(record_id >> 8),
+      0x51,  // SDR version
+      kSdrRecordTypeFruDeviceLocator,
+      static_cast<uint8_t>(11 + name.size()),
+      0x20,    // Device access address
+      fru_id,  // FRU device ID
+      0x80,    // Logical FRU device
+      0x00,    // Channel
+      0x00,    // Reserved
+      0x10,    // Device type
+      0x00,    // Device type modifier
+      entity_id,
+      0x01,  // Entity instance
+      0x00,  // OEM
+      static_cast<uint8_t>(0xc0 | name.size())};
+  data.insert(data.end(), name.begin(), name.end());
+  return {.record_id = record_id, .data = std::move(data)};
+}
+
+// A fake SDR repository, served through a mock IPMI interface.
+class FakeSdrRepository {
+ public:
+  explicit FakeSdrRepository(NiceMock<MockIpmiInterface> *ipmi) {
+    ON_CALL(*ipmi, GetSdrRepositoryInfo(_))
+        .WillByDefault([this](IpmiInterface::SdrRepositoryInfo *info) {
+          *info = info_;
+          return absl::OkStatus();
+        });
+    ON_CALL(*ipmi, ReserveSdrRepository(_))
+        .WillByDefault([this](uint16_t *reservation_id) {
+          *reservation_id = ++reservation_id_;
+          return absl::OkStatus();
+        });
+    ON_CALL(*ipmi, GetSdrRecord(_, _, _, _))
+        .WillByDefault([this](uint16_t reservation_id, uint16_t record_id,
+                              IpmiInterface::SdrRecord *record,
+                              uint16_t *next_record_id) {
+          ++records_read_;
+          if (cancel_reservation_after_ > 0 &&
+              --cancel_reservation_after_ == 0) {
+            ++reservation_id_;
+          }
+          if (reservation_id != reservation_id_) {
+            return absl::AbortedError("reservation cancelled");
+          }
+          if (record_id == kFirstSdrRecordId && !records_.empty()) {
+            record_id = records_.front().record_id;
+          }
+          for (size_t i = 0; i < records_.size(); ++i) {
+            if (records_[i].record_id == record_id) {
+              *record = records_[i];
+              *next_record_id = i + 1 < records_.size()
+                                    ? records_[i + 1].record_id
+                                    : kLastSdrRecordId;
+              return absl::OkStatus();
+            }
+          }
+          return absl::NotFoundError("no such record");
+        });
+  }
+
+  // Add a record to the repository, updating the addition timestamp.
+  void AddRecord(IpmiInterface::SdrRecord record) {
+    records_.push_back(std::move(record));
+    info_.record_count = records_.size();
+    info_.most_recent_addition += 1;
+  }
+
+  // Make the BMC cancel the reservation after the given number of reads.
+  void CancelReservationAfter(int reads) { cancel_reservation_after_ = reads; }
+
+  void SetTimestampsUnspecified() {
+    info_.most_recent_addition = kSdrTimestampUnspecified;
+    info_.most_recent_erase = kSdrTimestampUnspecified;
+  }
+
+  int records_read() const { return records_read_; }
+
+ private:
+  IpmiInterface::SdrRepositoryInfo info_ = {.version = 0x51,
+                                            .record_count = 0,
+                                            .most_recent_addition = 1000,
+                                            .most_recent_erase = 0};
+  std::vector<IpmiInterface::SdrRecord> records_;
+  uint16_t reservation_id_ = 0;
+  int cancel_reservation_after_ = 0;
+  int records_read_ = 0;
+};
+
+class IpmiSdrCacheTest : public ::testing::Test {
+ protected:
+  IpmiSdrCacheTest() : repository_(&ipmi_) {
+    repository_.AddRecord(FruLocatorRecord(0x0010, 1, 0x07, "board"));
+    repository_.AddRecord(FruLocatorRecord(0x0020, 2, 0x1d, "fan"));
+    repository_.AddRecord(FruLocatorRecord(0x0030, 3, 0x0a, "psu"));
+  }
+
+  // Returns the IDs of all the records returned by the cache.
+  std::vector<uint16_t> GetRecordIds(IpmiSdrCache &cache) {
+    std::vector<uint16_t> ids;
+    auto maybe_records = cache.GetRecords();
+    EXPECT_THAT(maybe_records, IsOk());
+    if (!maybe_records.ok()) return ids;
+    for (const IpmiInterface::SdrRecord &record : **maybe_records) {
+      ids.push_back(record.record_id);
+    }
+    return ids;
+  }
+
+  NiceMock<MockIpmiInterface> ipmi_;
+  FakeSdrRepository repository_;
+};
+
+TEST_F(IpmiSdrCacheTest, ReadsRepositoryOnce) {
+  IpmiSdrCache cache(&ipmi_, {});
+  EXPECT_THAT(GetRecordIds(cache), ElementsAre(0x0010, 0x0020, 0x0030));
+  EXPECT_EQ(repository_.records_read(), 3);
+  EXPECT_THAT(GetRecordIds(cache), ElementsAre(0x0010, 0x0020, 0x0030));
+  EXPECT_EQ(repository_.records_read(), 3);
+}
+
+TEST_F(IpmiSdrCacheTest, ReadsAgainWhenRepositoryChanges) {
+  IpmiSdrCache cache(&ipmi_, {});
+  EXPECT_THAT(GetRecordIds(cache), ElementsAre(0x0010, 0x0020, 0x0030));
+  repository_.AddRecord(FruLocatorRecord(0x0040, 4, 0x0a, "psu2"));
+  EXPECT_THAT(GetRecordIds(cache),
+              ElementsAre(0x0010, 0x0020, 0x0030, 0x0040));
+  EXPECT_EQ(repository_.records_read(), 7);
+}
+
+TEST_F(IpmiSdrCacheTest, RestartsWhenReservationCancelled) {
+  repository_.CancelReservationAfter(2);
+  IpmiSdrCache cache(&ipmi_, {});
+  EXPECT_THAT(GetRecordIds(cache), ElementsAre(0x0010, 0x0020, 0x0030));
+  EXPECT_EQ(repository_.records_read(), 5);
+}
+
+TEST_F(IpmiSdrCacheTest, UnspecifiedTimestampsAlwaysRead) {
+  repository_.SetTimestampsUnspecified();
+  IpmiSdrCache cache(&ipmi_, {});
+  EXPECT_THAT(GetRecordIds(cache), ElementsAre(0x0010, 0x0020, 0x0030));
+  EXPECT_THAT(GetRecordIds(cache), ElementsAre(0x0010, 0x0020, 0x0030));
+  EXPECT_EQ(repository_.records_read(), 6);
+}
+
+TEST_F(IpmiSdrCacheTest, RepositoryInfoFailure) {
+  EXPECT_CALL(ipmi_, GetSdrRepositoryInfo(_))
+      .WillOnce([](IpmiInterface::SdrRepositoryInfo *) {
+        return absl::InternalError("no BMC");
+      });
+  IpmiSdrCache cache(&ipmi_, {});
+  EXPECT_FALSE(cache.GetRecords().ok());
+  EXPECT_EQ(repository_.records_read(), 0);
+}
+
+TEST_F(IpmiSdrCacheTest, CacheFileReusedAcrossInstances) {
+  std::string path = GetTestTempdirPath("sdr_cache_reused");
+  {
+    IpmiSdrCache cache(&ipmi_, {.cache_path = path});
+    EXPECT_THAT(GetRecordIds(cache), ElementsAre(0x0010, 0x0020, 0x0030));
+  }
+  IpmiSdrCache cache(&ipmi_, {.cache_path = path});
+  auto maybe_records = cache.GetRecords();
+  ASSERT_THAT(maybe_records, IsOk());
+  EXPECT_EQ(repository_.records_read(), 3);
+  ASSERT_EQ((*maybe_records)->size(), 3);
+  EXPECT_EQ((*maybe_records)->at(1).data,
+            FruLocatorRecord(0x0020, 2, 0x1d, "fan").data);
+}
+
+TEST_F(IpmiSdrCacheTest, StaleCacheFileIgnored) {
+  std::string path = GetTestTempdirPath("sdr_cache_stale");
+  {
+    IpmiSdrCache cache(&ipmi_, {.cache_path = path});
+    EXPECT_THAT(GetRecordIds(cache), ElementsAre(0x0010, 0x0020, 0x0030));
+  }
+  repository_.AddRecord(FruLocatorRecord(0x0040, 4, 0x0a, "psu2"));
+  IpmiSdrCache cache(&ipmi_, {.cache_path = path});
+  EXPECT_THAT(GetRecordIds(cache),
+              ElementsAre(0x0010, 0x0020, 0x0030, 0x0040));
+  EXPECT_EQ(repository_.records_read(), 7);
+}
+
+TEST_F(IpmiSdrCacheTest, CorruptCacheFileIgnored) {
+  std::string path = GetTestTempdirPath("sdr_cache_corrupt");
+  {
+    IpmiSdrCache cache(&ipmi_, {.cache_path = path});
+    EXPECT_THAT(GetRecordIds(cache), ElementsAre(0x0010, 0x0020, 0x0030));
+  }
+  // Chop the end off of the file.
+  std::string contents;
+  {
+    std::ifstream file(path, std::ios::binary);
+    contents.assign(std::istreambuf_iterator<char>(file),
+                    std::istreambuf_iterator<char>());
+  }
+  {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(contents.data(), contents.size() - 3);
+  }
+  IpmiSdrCache cache(&ipmi_, {.cache_path = path});
+  EXPECT_THAT(GetRecordIds(cache), ElementsAre(0x0010, 0x0020, 0x0030));
+  EXPECT_EQ(repository_.records_read(), 6);
+}
+
+TEST(GetFruFromSdrRecordTest, FruDeviceLocator) {
+  auto fru = GetFruFromSdrRecord(FruLocatorRecord(0x0020, 2, 0x1d, "fan"));
+  ASSERT_TRUE(fru.has_value());
+  EXPECT_EQ(fru->record_id, 0x0020);
+  EXPECT_EQ(fru->fru_id, 2);
+  EXPECT_EQ(fru->entity, (IpmiInterface::EntityIdentifier{0x1d, 0x01}));
+  EXPECT_EQ(fru->name, "fan");
+}
+
+TEST(GetFruFromSdrRecordTest, OtherRecordsIgnored) {
+  IpmiInterface::SdrRecord record = FruLocatorRecord(0x0020, 2, 0x1d, "fan");
+  // A physical FRU device can't be read.
+  record.data[7] = 0x00;
+  EXPECT_FALSE(GetFruFromSdrRecord(record).has_value());
+  // Neither can something that isn't a FRU.
+  record.data[3] = 0x01;
+  EXPECT_FALSE(GetFruFromSdrRecord(record).has_value());
+  // Truncated records should also be rejected.
+  record = FruLocatorRecord(0x0020, 2, 0x1d, "fan");
+  record.data.resize(10);
+  EXPECT_FALSE(GetFruFromSdrRecord(record).has_value());
+}
+
+}  // namespace
+}  // namespace ecclesia
@@ -31,6 +31,7 @@
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
 #include "ecclesia/lib/codec/endian.h"
+#include "ecclesia/magent/lib/nvme/nvme_buffer_pool.h"
 #include "ecclesia/magent/lib/nvme/nvme_types.h"
 
 namespace ecclesia {
@@ -181,10 +182,14 @@ class DeviceSelfTestLog {
  public:
   static absl::StatusOr<std::unique_ptr<DeviceSelfTestLog>> Parse(
       absl::string_view buf) {
+    return Parse(NvmeBufferLease::Copy(buf));
+  }
+  static absl::StatusOr<std::unique_ptr<DeviceSelfTestLog>> Parse(
+      NvmeBufferLease buf) {
     if (buf.size() != kDeviceSelfTestLogFormatSize) {
       return absl::InternalError("Unexpected error.");
     }
-    return absl::WrapUnique(new DeviceSelfTestLog(buf));
+    return absl::WrapUnique(new DeviceSelfTestLog(std::move(buf)));
   }
 
   enum CurrentSelfTestStatusResult : uint8_t {
@@ -239,12 +244,12 @@ class DeviceSelfTestLog {
   }
 
  protected:
-  explicit DeviceSelfTestLog(absl::string_view buf)
-      : data_(buf),
+  explicit DeviceSelfTestLog(NvmeBufferLease buf)
+      : data_(std::move(buf)),
         log_(reinterpret_cast<const DeviceSelfTestLogFormat *>(data_.data())) {}
 
  private:
-  const std::string data_;
+  const NvmeBufferLease data_;
   const DeviceSelfTestLogFormat *const log_;
 };
 }  // namespace ecclesia
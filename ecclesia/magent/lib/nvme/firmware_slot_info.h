@@ -21,12 +21,14 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "ecclesia/magent/lib/nvme/nvme_buffer_pool.h"
 #include "ecclesia/magent/lib/nvme/nvme_types.h"
 
 namespace ecclesia {
@@ -38,10 +40,14 @@ class FirmwareSlotInfo {
   //   buf: Data buffer returned from GetLogPage(Log Identifier 03h).
   static absl::StatusOr<std::unique_ptr<FirmwareSlotInfo>> Parse(
       absl::string_view buf) {
+    return Parse(NvmeBufferLease::Copy(buf));
+  }
+  static absl::StatusOr<std::unique_ptr<FirmwareSlotInfo>> Parse(
+      NvmeBufferLease buf) {
     if (buf.size() != kFirmwareSlotInfoFormatSize) {
       return absl::InternalError("Unexpected error.");
     }
-    return absl::WrapUnique(new FirmwareSlotInfo(buf));
+    return absl::WrapUnique(new FirmwareSlotInfo(std::move(buf)));
   }
 
   FirmwareSlotInfo(const FirmwareSlotInfo &) = delete;
@@ -88,13 +94,13 @@ class FirmwareSlotInfo {
   }
 
  protected:
-  explicit FirmwareSlotInfo(absl::string_view buf)
-      : data_(buf),
+  explicit FirmwareSlotInfo(NvmeBufferLease buf)
+      : data_(std::move(buf)),
         firmware_slot_info_(
             reinterpret_cast<const FirmwareSlotInfoFormat *>(data_.data())) {}
 
  private:
-  const std::string data_;
+  const NvmeBufferLease data_;
   const FirmwareSlotInfoFormat *const firmware_slot_info_;
 };
 
@@ -19,12 +19,14 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "absl/base/macros.h"
 #include "absl/numeric/int128.h"
 #include "absl/strings/ascii.h"
 #include "absl/strings/string_view.h"
 #include "ecclesia/lib/codec/endian.h"
+#include "ecclesia/magent/lib/nvme/nvme_buffer_pool.h"
 #include "ecclesia/magent/lib/nvme/nvme_types.h"
 
 namespace ecclesia {
@@ -32,12 +34,20 @@ namespace ecclesia {
 std::unique_ptr<IdentifyController> IdentifyController::Parse(
     const std::string &buf) {
   if (buf.size() != kIdentifyControllerSize) return nullptr;
-  return std::unique_ptr<IdentifyController>(new IdentifyController(buf));
+  return Parse(NvmeBufferLease::Copy(buf));
 }
 
-IdentifyController::IdentifyController(const std::string &buf)
-    : data_(buf),
-      identify_(reinterpret_cast<IdentifyControllerFormat *>(&data_[0])) {}
+std::unique_ptr<IdentifyController> IdentifyController::Parse(
+    NvmeBufferLease buf) {
+  if (buf.size() != kIdentifyControllerSize) return nullptr;
+  return std::unique_ptr<IdentifyController>(
+      new IdentifyController(std::move(buf)));
+}
+
+IdentifyController::IdentifyController(NvmeBufferLease buf)
+    : data_(std::move(buf)),
+      identify_(
+          reinterpret_cast<const IdentifyControllerFormat *>(data_.data())) {}
 
 uint16_t IdentifyController::controller_id() const {
   return LittleEndian::Load16(identify_->cntlid);
@@ -22,6 +22,7 @@
 #include <string>
 
 #include "absl/numeric/int128.h"
+#include "ecclesia/magent/lib/nvme/nvme_buffer_pool.h"
 #include "ecclesia/magent/lib/nvme/nvme_types.h"
 
 namespace ecclesia {
@@ -35,6 +36,7 @@ class IdentifyController {
   // Arguments:
   //   buf: Data buffer returned from IdentifyController request.
   static std::unique_ptr<IdentifyController> Parse(const std::string &buf);
+  static std::unique_ptr<IdentifyController> Parse(NvmeBufferLease buf);
 
   IdentifyController(const IdentifyController &) = delete;
   IdentifyController &operator=(const IdentifyController &) = delete;
@@ -67,10 +69,10 @@ class IdentifyController {
   uint32_t sanitize_capabilities() const;
 
  protected:
-  explicit IdentifyController(const std::string &buf);
+  explicit IdentifyController(NvmeBufferLease buf);
 
  private:
-  std::string data_;
+  NvmeBufferLease data_;
   const IdentifyControllerFormat *const identify_;
 };
 
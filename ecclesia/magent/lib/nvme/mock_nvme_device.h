@@ -25,11 +25,13 @@
 #include "gmock/gmock.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "ecclesia/magent/lib/nvme/controller_registers.h"
 #include "ecclesia/magent/lib/nvme/device_self_test_log.h"
 #include "ecclesia/magent/lib/nvme/firmware_slot_info.h"
 #include "ecclesia/magent/lib/nvme/identify_controller.h"
 #include "ecclesia/magent/lib/nvme/identify_namespace.h"
+#include "ecclesia/magent/lib/nvme/nvme_access.h"
 #include "ecclesia/magent/lib/nvme/nvme_device.h"
 #include "ecclesia/magent/lib/nvme/nvme_types.h"
 #include "ecclesia/magent/lib/nvme/sanitize_log_page.h"
@@ -37,6 +39,29 @@
 
 namespace ecclesia {
 
+class MockNvmeAccessInterface : public NvmeAccessInterface {
+ public:
+  // By default batches of commands are executed one at a time through
+  // ExecuteAdminCommand, the same as the base class does. Tests which care
+  // about how commands are batched can set their own expectations.
+  MockNvmeAccessInterface() {
+    ON_CALL(*this, ExecuteAdminCommands)
+        .WillByDefault([this](absl::Span<nvme_passthru_cmd *const> cmds) {
+          return NvmeAccessInterface::ExecuteAdminCommands(cmds);
+        });
+  }
+
+  MOCK_METHOD(absl::Status, ExecuteAdminCommand, (nvme_passthru_cmd * cmd),
+              (const, override));
+  MOCK_METHOD(std::vector<absl::Status>, ExecuteAdminCommands,
+              (absl::Span<nvme_passthru_cmd *const> cmds), (const, override));
+  // MOCK_METHOD(absl::Status, RescanNamespaces, (), (override));
+  MOCK_METHOD(absl::Status, ResetSubsystem, (), (override));
+  MOCK_METHOD(absl::Status, ResetController, (), (override));
+  MOCK_METHOD(absl::StatusOr<ControllerRegisters>, GetControllerRegisters, (),
+              (const, override));
+};
+
 class MockNvmeDevice : public NvmeDeviceInterface {
  public:
   MOCK_METHOD(absl::StatusOr<std::unique_ptr<IdentifyController>>, Identify, (),
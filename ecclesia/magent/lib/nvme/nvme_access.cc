@@ -0,0 +1,98 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/lib/nvme/nvme_access.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "ecclesia/magent/lib/thread_pool/thread_pool.h"
+
+namespace ecclesia {
+
+std::vector<absl::Status> NvmeAccessInterface::ExecuteAdminCommands(
+    absl::Span<nvme_passthru_cmd *const> cmds) const {
+  std::vector<absl::Status> results;
+  results.reserve(cmds.size());
+  for (nvme_passthru_cmd *cmd : cmds) {
+    results.push_back(ExecuteAdminCommand(cmd));
+  }
+  return results;
+}
+
+namespace {
+
+// The state shared between the caller of ExecuteAdminBatches and the work it
+// schedules on the pool. Work which starts after every batch has been claimed
+// returns without touching anything else, so it can safely outlive the call.
+struct AdminBatchWork {
+  explicit AdminBatchWork(absl::Span<const NvmeAdminBatch> batches_in)
+      : batches(batches_in),
+        remaining(batches_in.size()),
+        results(batches_in.size()) {}
+
+  // Claim and execute batches until there are none left.
+  void Run() {
+    for (size_t i = next_batch++; i < batches.size(); i = next_batch++) {
+      std::vector<absl::Status> statuses =
+          batches[i].access->ExecuteAdminCommands(batches[i].cmds);
+      absl::MutexLock ml(&mutex);
+      results[i] = std::move(statuses);
+      --remaining;
+    }
+  }
+
+  bool Done() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex) {
+    return remaining == 0;
+  }
+
+  const absl::Span<const NvmeAdminBatch> batches;
+  std::atomic<size_t> next_batch = 0;
+
+  absl::Mutex mutex;
+  size_t remaining ABSL_GUARDED_BY(mutex);
+  std::vector<std::vector<absl::Status>> results ABSL_GUARDED_BY(mutex);
+};
+
+}  // namespace
+
+std::vector<std::vector<absl::Status>> ExecuteAdminBatches(
+    absl::Span<const NvmeAdminBatch> batches, ThreadPool &pool,
+    int max_parallelism) {
+  auto work = std::make_shared<AdminBatchWork>(batches);
+
+  // The calling thread acts as one of the workers.
+  size_t num_threads =
+      std::min<size_t>(batches.size(), std::max(max_parallelism, 1));
+  for (size_t i = 1; i < num_threads; ++i) {
+    pool.Schedule([work]() { work->Run(); });
+  }
+  work->Run();
+
+  absl::MutexLock ml(&work->mutex);
+  work->mutex.Await(absl::Condition(work.get(), &AdminBatchWork::Done));
+  return std::move(work->results);
+}
+
+}  // namespace ecclesia
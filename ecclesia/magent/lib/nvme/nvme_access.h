@@ -17,9 +17,13 @@
 #ifndef ECCLESIA_MAGENT_LIB_NVME_NVME_ACCESS_H_
 #define ECCLESIA_MAGENT_LIB_NVME_NVME_ACCESS_H_
 
+#include <vector>
+
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "ecclesia/magent/lib/nvme/controller_registers.h"
+#include "ecclesia/magent/lib/thread_pool/thread_pool.h"
 
 struct nvme_passthru_cmd;
 
@@ -32,6 +36,14 @@ class NvmeAccessInterface {
   // Executes a single NVM-Express command.
   virtual absl::Status ExecuteAdminCommand(nvme_passthru_cmd *cmd) const = 0;
 
+  // Executes a sequence of NVM-Express commands back to back, returning the
+  // status of each command in the same order. Every command is executed, even
+  // if an earlier one fails. The default implementation executes each command
+  // with ExecuteAdminCommand; implementations can override this to avoid
+  // repeating per-command setup.
+  virtual std::vector<absl::Status> ExecuteAdminCommands(
+      absl::Span<nvme_passthru_cmd *const> cmds) const;
+
   // Disable this feature becasue linux/nvme_ioctl.h in kokoro build image
   // ubuntu1604 is not up to date. After we migrate to a more robust build env,
   // this can re-enabled.
@@ -49,6 +61,26 @@ class NvmeAccessInterface {
       const = 0;
 };
 
+// A sequence of commands to be executed on a single device.
+struct NvmeAdminBatch {
+  const NvmeAccessInterface *access;
+  absl::Span<nvme_passthru_cmd *const> cmds;
+};
+
+// Executes several batches of commands, each of which is for a different
+// device. The commands within a batch are executed in order with
+// ExecuteAdminCommands, but the batches themselves are executed in parallel on
+// the calling thread and the threads of the given pool, with up to
+// max_parallelism batches in flight at once. Returns the statuses for each
+// batch, in the same order as the batches.
+//
+// The pool is expected to be long-lived and shared with other work, so this
+// does not wait for all of its scheduled work to start; the calling thread
+// picks up any batches the pool has not gotten to.
+std::vector<std::vector<absl::Status>> ExecuteAdminBatches(
+    absl::Span<const NvmeAdminBatch> batches, ThreadPool &pool,
+    int max_parallelism = 8);
+
 }  // namespace ecclesia
 
 #endif  // ECCLESIA_MAGENT_LIB_NVME_NVME_ACCESS_H_
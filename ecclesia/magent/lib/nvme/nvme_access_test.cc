@@ -0,0 +1,152 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/lib/nvme/nvme_access.h"
+
+#include <linux/nvme_ioctl.h>
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/notification.h"
+#include "ecclesia/lib/file/test_filesystem.h"
+#include "ecclesia/magent/lib/nvme/mock_nvme_device.h"
+#include "ecclesia/magent/lib/nvme/nvme_linux_access.h"
+#include "ecclesia/magent/lib/thread_pool/thread_pool.h"
+
+namespace ecclesia {
+namespace {
+
+using ::testing::_;
+using ::testing::ElementsAre;
+using ::testing::Field;
+using ::testing::InSequence;
+using ::testing::Pointee;
+using ::testing::Return;
+
+TEST(ExecuteAdminCommandsTest, DefaultExecutesEveryCommandInOrder) {
+  MockNvmeAccessInterface access;
+  {
+    InSequence seq;
+    EXPECT_CALL(access, ExecuteAdminCommand(
+                            Pointee(Field(&nvme_passthru_cmd::opcode, 1))))
+        .WillOnce(Return(absl::OkStatus()));
+    EXPECT_CALL(access, ExecuteAdminCommand(
+                            Pointee(Field(&nvme_passthru_cmd::opcode, 2))))
+        .WillOnce(Return(absl::InternalError("failed")));
+    EXPECT_CALL(access, ExecuteAdminCommand(
+                            Pointee(Field(&nvme_passthru_cmd::opcode, 3))))
+        .WillOnce(Return(absl::OkStatus()));
+  }
+
+  nvme_passthru_cmd cmds[3] = {};
+  for (int i = 0; i < 3; ++i) cmds[i].opcode = i + 1;
+  nvme_passthru_cmd *cmd_ptrs[3] = {&cmds[0], &cmds[1], &cmds[2]};
+  std::vector<absl::Status> results = access.ExecuteAdminCommands(cmd_ptrs);
+  ASSERT_EQ(results.size(), 3);
+  EXPECT_TRUE(results[0].ok());
+  EXPECT_EQ(results[1].code(), absl::StatusCode::kInternal);
+  EXPECT_TRUE(results[2].ok());
+}
+
+TEST(ExecuteAdminBatchesTest, ResultsMatchBatches) {
+  // Use more devices than threads, to make sure that every batch is run.
+  constexpr int kNumDevices = 5;
+  MockNvmeAccessInterface access[kNumDevices];
+  nvme_passthru_cmd cmds[kNumDevices][2] = {};
+  nvme_passthru_cmd *cmd_ptrs[kNumDevices][2];
+  std::vector<NvmeAdminBatch> batches;
+  for (int i = 0; i < kNumDevices; ++i) {
+    cmd_ptrs[i][0] = &cmds[i][0];
+    cmd_ptrs[i][1] = &cmds[i][1];
+    batches.push_back({&access[i], cmd_ptrs[i]});
+    if (i == kNumDevices - 1) continue;
+    EXPECT_CALL(access[i], ExecuteAdminCommand(_))
+        .Times(2)
+        .WillRepeatedly([i](nvme_passthru_cmd *cmd) {
+          cmd->result = i;
+          return absl::OkStatus();
+        });
+  }
+  // The last device fails all of its commands.
+  EXPECT_CALL(access[kNumDevices - 1], ExecuteAdminCommands(_))
+      .WillOnce(Return(std::vector<absl::Status>(
+          2, absl::UnavailableError("device is gone"))));
+
+  ThreadPool pool(1);
+  auto results = ExecuteAdminBatches(batches, pool, /*max_parallelism=*/2);
+  ASSERT_EQ(results.size(), kNumDevices);
+  for (int i = 0; i < kNumDevices - 1; ++i) {
+    EXPECT_THAT(results[i], ElementsAre(absl::OkStatus(), absl::OkStatus()));
+    EXPECT_EQ(cmds[i][0].result, i);
+    EXPECT_EQ(cmds[i][1].result, i);
+  }
+  EXPECT_EQ(results[kNumDevices - 1].size(), 2);
+  EXPECT_EQ(results[kNumDevices - 1][0].code(), absl::StatusCode::kUnavailable);
+}
+
+TEST(ExecuteAdminBatchesTest, NoBatches) {
+  ThreadPool pool(1);
+  EXPECT_TRUE(ExecuteAdminBatches({}, pool).empty());
+}
+
+TEST(ExecuteAdminBatchesTest, DoesNotWaitForBusyPool) {
+  MockNvmeAccessInterface access[2];
+  nvme_passthru_cmd cmds[2] = {};
+  nvme_passthru_cmd *cmd_ptrs[2] = {&cmds[0], &cmds[1]};
+  std::vector<NvmeAdminBatch> batches = {{&access[0], {&cmd_ptrs[0], 1}},
+                                         {&access[1], {&cmd_ptrs[1], 1}}};
+  for (MockNvmeAccessInterface &a : access) {
+    EXPECT_CALL(a, ExecuteAdminCommand(_)).WillOnce(Return(absl::OkStatus()));
+  }
+
+  // Keep the only thread in the pool busy until the batches are done, so that
+  // they all have to be executed by the calling thread.
+  ThreadPool pool(1);
+  absl::Notification release_pool;
+  pool.Schedule([&release_pool]() { release_pool.WaitForNotification(); });
+  auto results = ExecuteAdminBatches(batches, pool, /*max_parallelism=*/2);
+  release_pool.Notify();
+  EXPECT_THAT(results, ElementsAre(ElementsAre(absl::OkStatus()),
+                                   ElementsAre(absl::OkStatus())));
+}
+
+TEST(NvmeLinuxAccessTest, InvalidDevicesFailEveryCommand) {
+  TestFilesystem fs(GetTestTempdirPath());
+  fs.CreateDir("/dev");
+  fs.CreateFile("/dev/nvme0", "not a device");
+
+  nvme_passthru_cmd cmds[2] = {};
+  nvme_passthru_cmd *cmd_ptrs[2] = {&cmds[0], &cmds[1]};
+
+  NvmeLinuxAccess missing(fs.GetTruePath("/dev/nvme1"));
+  std::vector<absl::Status> results = missing.ExecuteAdminCommands(cmd_ptrs);
+  ASSERT_EQ(results.size(), 2);
+  EXPECT_EQ(results[0].code(), absl::StatusCode::kFailedPrecondition);
+  EXPECT_EQ(results[1].code(), absl::StatusCode::kFailedPrecondition);
+
+  NvmeLinuxAccess not_device(fs.GetTruePath("/dev/nvme0"));
+  EXPECT_EQ(not_device.ExecuteAdminCommand(&cmds[0]).code(),
+            absl::StatusCode::kFailedPrecondition);
+  results = not_device.ExecuteAdminCommands(cmd_ptrs);
+  ASSERT_EQ(results.size(), 2);
+  EXPECT_EQ(results[1].code(), absl::StatusCode::kFailedPrecondition);
+}
+
+}  // namespace
+}  // namespace ecclesia
@@ -0,0 +1,172 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/lib/nvme/nvme_buffer_pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "ecclesia/lib/logging/logging.h"
+
+namespace ecclesia {
+namespace {
+
+// Round a buffer size up to a whole number of aligned blocks. Zero-sized
+// buffers still get one block so that every lease has a valid address.
+size_t CapacityForSize(size_t size) {
+  if (size == 0) return NvmeBufferPool::kAlignment;
+  return (size + NvmeBufferPool::kAlignment - 1) /
+         NvmeBufferPool::kAlignment * NvmeBufferPool::kAlignment;
+}
+
+// Allocate an aligned buffer. Callers write through the buffer immediately, so
+// running out of memory here is treated as fatal.
+char *AllocateBuffer(size_t capacity) {
+  char *buffer = static_cast<char *>(
+      aligned_alloc(NvmeBufferPool::kAlignment, capacity));
+  Check(buffer != nullptr, "aligned buffer allocation succeeded")
+      << "capacity: " << capacity;
+  return buffer;
+}
+
+}  // namespace
+
+NvmeBufferLease NvmeBufferLease::Copy(absl::string_view data) {
+  size_t capacity = CapacityForSize(data.size());
+  char *buffer = AllocateBuffer(capacity);
+  memcpy(buffer, data.data(), data.size());
+  return NvmeBufferLease(nullptr, buffer, capacity, data.size());
+}
+
+NvmeBufferLease::NvmeBufferLease(NvmeBufferLease &&other)
+    : pool_(std::move(other.pool_)),
+      buffer_(other.buffer_),
+      capacity_(other.capacity_),
+      size_(other.size_) {
+  other.pool_ = nullptr;
+  other.buffer_ = nullptr;
+  other.capacity_ = 0;
+  other.size_ = 0;
+}
+
+NvmeBufferLease &NvmeBufferLease::operator=(NvmeBufferLease &&other) {
+  if (this != &other) {
+    Release();
+    pool_ = std::move(other.pool_);
+    buffer_ = other.buffer_;
+    capacity_ = other.capacity_;
+    size_ = other.size_;
+    other.pool_ = nullptr;
+    other.buffer_ = nullptr;
+    other.capacity_ = 0;
+    other.size_ = 0;
+  }
+  return *this;
+}
+
+void NvmeBufferLease::Release() {
+  if (buffer_ == nullptr) return;
+  if (pool_) {
+    pool_->Return(buffer_, capacity_);
+    pool_ = nullptr;
+  } else {
+    free(buffer_);
+  }
+  buffer_ = nullptr;
+  capacity_ = 0;
+  size_ = 0;
+}
+
+NvmeBufferPool::NvmeBufferPool(size_t max_free_per_size)
+    : max_free_per_size_(max_free_per_size) {
+  // Reserve the full capacity of every free list up front, so that returning a
+  // buffer to the pool never needs to allocate.
+  for (std::vector<char *> &free_list : free_) {
+    free_list.reserve(max_free_per_size_);
+  }
+}
+
+std::shared_ptr<NvmeBufferPool> NvmeBufferPool::Create(
+    size_t max_free_per_size) {
+  return std::shared_ptr<NvmeBufferPool>(
+      new NvmeBufferPool(max_free_per_size));
+}
+
+std::shared_ptr<NvmeBufferPool> NvmeBufferPool::Default() {
+  static auto &pool = *new std::shared_ptr<NvmeBufferPool>(Create());
+  return pool;
+}
+
+NvmeBufferPool::~NvmeBufferPool() {
+  absl::MutexLock ml(&mutex_);
+  for (std::vector<char *> &free_list : free_) {
+    for (char *buffer : free_list) free(buffer);
+  }
+}
+
+NvmeBufferLease NvmeBufferPool::Lease(size_t size) {
+  size_t capacity = CapacityForSize(size);
+  char *buffer = nullptr;
+  {
+    absl::MutexLock ml(&mutex_);
+    if (capacity <= kMaxPooledSize) {
+      std::vector<char *> &free_list = free_[capacity / kAlignment - 1];
+      if (!free_list.empty()) {
+        buffer = free_list.back();
+        free_list.pop_back();
+      }
+    }
+    if (buffer == nullptr) ++num_allocations_;
+  }
+  if (buffer == nullptr) buffer = AllocateBuffer(capacity);
+  memset(buffer, 0, size);
+  return NvmeBufferLease(shared_from_this(), buffer, capacity, size);
+}
+
+void NvmeBufferPool::Return(char *buffer, size_t capacity) {
+  if (capacity <= kMaxPooledSize) {
+    absl::MutexLock ml(&mutex_);
+    std::vector<char *> &free_list = free_[capacity / kAlignment - 1];
+    if (free_list.size() < max_free_per_size_) {
+      free_list.push_back(buffer);
+      return;
+    }
+  }
+  free(buffer);
+}
+
+size_t NvmeBufferPool::NumAllocations() const {
+  absl::MutexLock ml(&mutex_);
+  return num_allocations_;
+}
+
+size_t NvmeBufferPool::NumFreeBuffers() const {
+  absl::MutexLock ml(&mutex_);
+  size_t count = 0;
+  for (const std::vector<char *> &free_list : free_) {
+    count += free_list.size();
+  }
+  return count;
+}
+
+}  // namespace ecclesia
@@ -0,0 +1,154 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This library provides a pool of reusable buffers for the data transferred by
+// NVMe admin commands. Each command needs a buffer for the device to write its
+// response into; allocating a fresh one for every command means that periodic
+// polling (e.g. reading the SMART log of every drive every few seconds) does a
+// steady stream of allocations and copies for no real benefit.
+//
+// Buffers are leased from the pool and returned to it automatically when the
+// lease is destroyed. The parsers for the various NVMe data structures can
+// take ownership of a lease and provide a view directly onto the buffer, so
+// the data is never copied after the device writes it.
+
+#ifndef ECCLESIA_MAGENT_LIB_NVME_NVME_BUFFER_POOL_H_
+#define ECCLESIA_MAGENT_LIB_NVME_NVME_BUFFER_POOL_H_
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+
+namespace ecclesia {
+
+class NvmeBufferPool;
+
+// A buffer leased from an NvmeBufferPool. Leases are move-only; when a lease is
+// destroyed the buffer is returned to the pool that it came from. A lease will
+// keep its pool alive, so it is safe for a lease to outlive the last external
+// reference to the pool.
+class NvmeBufferLease {
+ public:
+  // Construct an empty lease, which holds no buffer.
+  NvmeBufferLease() = default;
+
+  // Construct a standalone lease, not associated with any pool, which holds a
+  // copy of the given data. This is useful for parsing data that was not read
+  // from a device (e.g. in tests).
+  static NvmeBufferLease Copy(absl::string_view data);
+
+  NvmeBufferLease(const NvmeBufferLease &other) = delete;
+  NvmeBufferLease &operator=(const NvmeBufferLease &other) = delete;
+
+  NvmeBufferLease(NvmeBufferLease &&other);
+  NvmeBufferLease &operator=(NvmeBufferLease &&other);
+
+  ~NvmeBufferLease() { Release(); }
+
+  // Accessors for the contents of the buffer. The data is aligned to
+  // NvmeBufferPool::kAlignment and its address is stable for the lifetime of
+  // the lease, including across moves.
+  char *data() { return buffer_; }
+  const char *data() const { return buffer_; }
+  size_t size() const { return size_; }
+  absl::string_view AsStringView() const {
+    return absl::string_view(buffer_, size_);
+  }
+
+ private:
+  friend class NvmeBufferPool;
+
+  NvmeBufferLease(std::shared_ptr<NvmeBufferPool> pool, char *buffer,
+                  size_t capacity, size_t size)
+      : pool_(std::move(pool)),
+        buffer_(buffer),
+        capacity_(capacity),
+        size_(size) {}
+
+  // Return the buffer to the pool (or free it, for a standalone lease) and
+  // leave the lease empty.
+  void Release();
+
+  // The pool the buffer came from. Null for standalone and empty leases.
+  std::shared_ptr<NvmeBufferPool> pool_;
+  char *buffer_ = nullptr;
+  size_t capacity_ = 0;
+  size_t size_ = 0;
+};
+
+// A pool of aligned buffers. Buffer capacities are rounded up to a multiple of
+// kAlignment and the pool keeps a separate free list for each capacity, up to
+// kMaxPooledSize. Larger buffers are allocated and freed for each lease.
+//
+// The pool is thread-safe, so a single pool can be shared by all of the
+// devices in the system. It must be owned by a shared_ptr.
+class NvmeBufferPool : public std::enable_shared_from_this<NvmeBufferPool> {
+ public:
+  // The alignment of all buffers, which is the minimum memory page size that
+  // an NVMe controller can use.
+  static constexpr size_t kAlignment = 4096;
+  // The largest buffer that will be kept in the pool once released.
+  static constexpr size_t kMaxPooledSize = 16 * kAlignment;
+
+  // Create a new pool. At most max_free_per_size released buffers of each
+  // capacity are kept for reuse; any beyond that are freed.
+  static std::shared_ptr<NvmeBufferPool> Create(
+      size_t max_free_per_size = 64);
+
+  // The process-wide pool used by default by all NVMe devices.
+  static std::shared_ptr<NvmeBufferPool> Default();
+
+  NvmeBufferPool(const NvmeBufferPool &other) = delete;
+  NvmeBufferPool &operator=(const NvmeBufferPool &other) = delete;
+
+  ~NvmeBufferPool();
+
+  // Lease a buffer of the given size. The contents of the buffer are zeroed.
+  NvmeBufferLease Lease(size_t size);
+
+  // Statistics, mostly useful for testing. The number of buffers that have
+  // been allocated over the lifetime of the pool, and the number of released
+  // buffers currently available for reuse.
+  size_t NumAllocations() const;
+  size_t NumFreeBuffers() const;
+
+ private:
+  friend class NvmeBufferLease;
+
+  static constexpr size_t kNumSizes = kMaxPooledSize / kAlignment;
+
+  explicit NvmeBufferPool(size_t max_free_per_size);
+
+  // Return a buffer to the pool.
+  void Return(char *buffer, size_t capacity);
+
+  const size_t max_free_per_size_;
+
+  mutable absl::Mutex mutex_;
+  // Free buffers, indexed by (capacity / kAlignment) - 1.
+  std::array<std::vector<char *>, kNumSizes> free_ ABSL_GUARDED_BY(mutex_);
+  size_t num_allocations_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace ecclesia
+
+#endif  // ECCLESIA_MAGENT_LIB_NVME_NVME_BUFFER_POOL_H_
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/lib/nvme/nvme_buffer_pool.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/string_view.h"
+
+namespace ecclesia {
+namespace {
+
+TEST(NvmeBufferPoolTest, LeaseIsAlignedAndZeroed) {
+  auto pool = NvmeBufferPool::Create();
+  NvmeBufferLease lease = pool->Lease(512);
+  ASSERT_NE(lease.data(), nullptr);
+  EXPECT_EQ(lease.size(), 512);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(lease.data()) %
+                NvmeBufferPool::kAlignment,
+            0);
+  EXPECT_EQ(lease.AsStringView(), std::string(512, '\0'));
+}
+
+TEST(NvmeBufferPoolTest, ReleasedBufferIsReused) {
+  auto pool = NvmeBufferPool::Create();
+  const char *first;
+  {
+    NvmeBufferLease lease = pool->Lease(512);
+    first = lease.data();
+    lease.data()[0] = 'x';
+  }
+  EXPECT_EQ(pool->NumFreeBuffers(), 1);
+
+  // Repeatedly leasing buffers of the same capacity should not allocate, and
+  // the reused buffer should be zeroed again.
+  for (int i = 0; i < 10; ++i) {
+    NvmeBufferLease lease = pool->Lease(4096);
+    EXPECT_EQ(lease.data(), first);
+    EXPECT_EQ(lease.data()[0], '\0');
+  }
+  EXPECT_EQ(pool->NumAllocations(), 1);
+}
+
+TEST(NvmeBufferPoolTest, DifferentCapacitiesUseDifferentBuffers) {
+  auto pool = NvmeBufferPool::Create();
+  { NvmeBufferLease lease = pool->Lease(4096); }
+  { NvmeBufferLease lease = pool->Lease(8192); }
+  EXPECT_EQ(pool->NumAllocations(), 2);
+  EXPECT_EQ(pool->NumFreeBuffers(), 2);
+}
+
+TEST(NvmeBufferPoolTest, LargeBuffersAreNotPooled) {
+  auto pool = NvmeBufferPool::Create();
+  {
+    NvmeBufferLease lease = pool->Lease(NvmeBufferPool::kMaxPooledSize + 1);
+    EXPECT_EQ(lease.size(), NvmeBufferPool::kMaxPooledSize + 1);
+  }
+  EXPECT_EQ(pool->NumFreeBuffers(), 0);
+}
+
+TEST(NvmeBufferPoolTest, FreeListsAreBounded) {
+  auto pool = NvmeBufferPool::Create(/*max_free_per_size=*/2);
+  {
+    NvmeBufferLease a = pool->Lease(512);
+    NvmeBufferLease b = pool->Lease(512);
+    NvmeBufferLease c = pool->Lease(512);
+  }
+  EXPECT_EQ(pool->NumAllocations(), 3);
+  EXPECT_EQ(pool->NumFreeBuffers(), 2);
+}
+
+TEST(NvmeBufferPoolTest, MovedLeaseKeepsBuffer) {
+  auto pool = NvmeBufferPool::Create();
+  NvmeBufferLease lease = pool->Lease(64);
+  const char *data = lease.data();
+
+  NvmeBufferLease moved = std::move(lease);
+  EXPECT_EQ(moved.data(), data);
+  EXPECT_EQ(moved.size(), 64);
+  EXPECT_EQ(pool->NumFreeBuffers(), 0);
+
+  // Assigning over a lease returns its old buffer to the pool.
+  moved = pool->Lease(64);
+  EXPECT_NE(moved.data(), data);
+  EXPECT_EQ(pool->NumFreeBuffers(), 1);
+}
+
+TEST(NvmeBufferPoolTest, LeaseOutlivesPool) {
+  auto pool = NvmeBufferPool::Create();
+  NvmeBufferLease lease = pool->Lease(64);
+  pool.reset();
+  lease.data()[0] = 'x';
+  EXPECT_EQ(lease.AsStringView()[0], 'x');
+}
+
+TEST(NvmeBufferLeaseTest, CopyIsStandalone) {
+  NvmeBufferLease lease = NvmeBufferLease::Copy("abcdef");
+  EXPECT_EQ(lease.AsStringView(), "abcdef");
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(lease.data()) %
+                NvmeBufferPool::kAlignment,
+            0);
+}
+
+TEST(NvmeBufferLeaseTest, DefaultIsEmpty) {
+  NvmeBufferLease lease;
+  EXPECT_EQ(lease.data(), nullptr);
+  EXPECT_EQ(lease.size(), 0);
+  EXPECT_EQ(lease.AsStringView(), absl::string_view());
+}
+
+}  // namespace
+}  // namespace ecclesia
@@ -33,22 +33,38 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "ecclesia/magent/lib/nvme/controller_registers.h"
 #include "ecclesia/magent/lib/nvme/device_self_test_log.h"
 #include "ecclesia/magent/lib/nvme/firmware_slot_info.h"
 #include "ecclesia/magent/lib/nvme/identify_controller.h"
 #include "ecclesia/magent/lib/nvme/identify_namespace.h"
 #include "ecclesia/magent/lib/nvme/nvme_access.h"
+#include "ecclesia/magent/lib/nvme/nvme_buffer_pool.h"
 #include "ecclesia/magent/lib/nvme/nvme_types.h"
 #include "ecclesia/magent/lib/nvme/sanitize_log_page.h"
 #include "ecclesia/magent/lib/nvme/smart_log_page.h"
 
 namespace ecclesia {
+namespace {
+
+// Construct the array of command pointers used to submit a batch of commands.
+std::vector<nvme_passthru_cmd *> CommandPointers(
+    absl::Span<nvme_passthru_cmd> cmds) {
+  std::vector<nvme_passthru_cmd *> cmd_ptrs;
+  cmd_ptrs.reserve(cmds.size());
+  for (nvme_passthru_cmd &cmd : cmds) cmd_ptrs.push_back(&cmd);
+  return cmd_ptrs;
+}
+
+}  // namespace
 
 class NvmeDevice : public NvmeDeviceInterface {
  public:
-  explicit NvmeDevice(std::unique_ptr<NvmeAccessInterface> access)
-      : access_(std::move(access)) {}
+  NvmeDevice(std::unique_ptr<NvmeAccessInterface> access,
+             std::shared_ptr<NvmeBufferPool> pool)
+      : access_(std::move(access)), pool_(std::move(pool)) {}
 
   absl::StatusOr<std::unique_ptr<IdentifyController>> Identify()
       const override {
@@ -56,12 +72,12 @@ class NvmeDevice : public NvmeDeviceInterface {
     static constexpr uint8_t kCnsIdentifyController = 0x01;
 
     // A buffer to hold the response structure which will be parsed.
-    std::string buffer(kIdentifyControllerSize, '\0');
+    NvmeBufferLease buffer = pool_->Lease(kIdentifyControllerSize);
 
     nvme_passthru_cmd cmd = {
         .opcode = kNvmeOpcodeAdminIdentify,
         .nsid = 0,
-        .addr = reinterpret_cast<uint64_t>(buffer.c_str()),
+        .addr = reinterpret_cast<uint64_t>(buffer.data()),
         .data_len = kIdentifyControllerSize,
         .cdw10 = kCnsIdentifyController,
         .cdw11 = 0,
@@ -77,7 +93,7 @@ class NvmeDevice : public NvmeDeviceInterface {
                        "Failed to execute IdentifyController command"));
     }
 
-    auto identify = IdentifyController::Parse(buffer);
+    auto identify = IdentifyController::Parse(std::move(buffer));
 
     if (identify == nullptr) {
       return absl::InternalError(
@@ -93,12 +109,12 @@ class NvmeDevice : public NvmeDeviceInterface {
     static constexpr uint8_t kCnsIdentifyListNs = 0x02;
 
     // A buffer to hold the response structure which will be parsed.
-    std::string buffer(kIdentifyListNamespaceSize, '\0');
+    NvmeBufferLease buffer = pool_->Lease(kIdentifyListNamespaceSize);
 
     nvme_passthru_cmd cmd = {
         .opcode = kNvmeOpcodeAdminIdentify,
         .nsid = 0,
-        .addr = reinterpret_cast<uint64_t>(buffer.c_str()),
+        .addr = reinterpret_cast<uint64_t>(buffer.data()),
         .data_len = kIdentifyListNamespaceSize,
         .cdw10 = kCnsIdentifyListNs,
         .cdw11 = 0,
@@ -114,20 +130,21 @@ class NvmeDevice : public NvmeDeviceInterface {
                        "Failed to execute IdentifyListNamespaces command"));
     }
 
-    return ParseIdentifyListNamespace(buffer);
+    return ParseIdentifyListNamespace(buffer.AsStringView());
   }
 
-  absl::StatusOr<std::string> InternalIdentifyNamespace(uint32_t namespace_id) {
+  absl::StatusOr<NvmeBufferLease> InternalIdentifyNamespace(
+      uint32_t namespace_id) {
     static constexpr uint8_t kNvmeOpcodeAdminIdentify = 0x06;
     static constexpr uint8_t kCnsIdentifyNs = 0x00;
 
     // A buffer to hold the response structure which will be parsed.
-    std::string buffer(kIdentifyNamespaceSize, '\0');
+    NvmeBufferLease buffer = pool_->Lease(kIdentifyNamespaceSize);
 
     nvme_passthru_cmd cmd = {
         .opcode = kNvmeOpcodeAdminIdentify,
         .nsid = namespace_id,
-        .addr = reinterpret_cast<uint64_t>(buffer.c_str()),
+        .addr = reinterpret_cast<uint64_t>(buffer.data()),
         .data_len = kIdentifyNamespaceSize,
         .cdw10 = kCnsIdentifyNs,
         .cdw11 = 0,
@@ -151,14 +168,17 @@ class NvmeDevice : public NvmeDeviceInterface {
       uint32_t namespace_id) override {
     auto ret = InternalIdentifyNamespace(namespace_id);
     if (!ret.ok()) return ret.status();
-    return IdentifyNamespace::Parse(ret.value());
+    return IdentifyNamespace::Parse(ret->AsStringView());
   }
 
+  absl::StatusOr<std::map<uint32_t, IdentifyNamespace>> GetNamespacesInfo(
+      const std::set<uint32_t> &namespace_ids) override;
+
   absl::StatusOr<std::vector<LBAFormat>> GetSupportedLbaFormats() override {
     static constexpr uint32_t kAllNamespaces = 0xFFFFFFFF;
     auto ret = InternalIdentifyNamespace(kAllNamespaces);
     if (!ret.ok()) return ret.status();
-    return IdentifyNamespace::GetSupportedLbaFormats(ret.value());
+    return IdentifyNamespace::GetSupportedLbaFormats(ret->AsStringView());
   }
 
   absl::StatusOr<std::unique_ptr<SmartLogPageInterface>> SmartLog()
@@ -173,7 +193,7 @@ class NvmeDevice : public NvmeDeviceInterface {
                        "Failed to execute kSmartLogPage command."));
     }
 
-    auto smart_log = SmartLogPage::Parse(ret.value());
+    auto smart_log = SmartLogPage::Parse(std::move(ret.value()));
     if (smart_log == nullptr) {
       return absl::InternalError(
           "Failed to parse returned IdentifyController response.");
@@ -181,6 +201,19 @@ class NvmeDevice : public NvmeDeviceInterface {
     return smart_log;
   }
 
+  absl::StatusOr<SmartLogPage> SmartLogView() const override {
+    static constexpr uint32_t kAllNamespaces = -1;
+    auto ret = GetLogPage(LogPageIdentifier::kSmart, kSmartLogPageSize,
+                          kAllNamespaces);
+    if (!ret.ok()) {
+      return absl::Status(
+          ret.status().code(),
+          absl::StrCat(ret.status().message(), ";",
+                       "Failed to execute kSmartLogPage command."));
+    }
+    return SmartLogPage::ParseView(std::move(ret.value()));
+  }
+
   absl::StatusOr<std::unique_ptr<SanitizeLogPageInterface>> SanitizeStatusLog()
       const override {
     static constexpr uint32_t kAllNamespaces = -1;
@@ -193,7 +226,7 @@ class NvmeDevice : public NvmeDeviceInterface {
                        "Failed to execute kSanitizeLogPage command."));
     }
 
-    return SanitizeLogPage::Parse(ret.value());
+    return SanitizeLogPage::Parse(std::move(ret.value()));
   }
 
   absl::StatusOr<std::vector<ErrorLogInfoEntry>> ErrorInformation()
@@ -473,14 +506,17 @@ class NvmeDevice : public NvmeDeviceInterface {
     kSanitizeStatus = 0x81,
   };
 
-  // Execute the GetLogPage command.
-  absl::StatusOr<std::string> GetLogPage(LogPageIdentifier id, uint32_t len,
-                                         uint32_t nsid) const;
+  // Execute the GetLogPage command. Log pages larger than the maximum data
+  // transfer size are fetched with a batch of commands, one for each chunk.
+  absl::StatusOr<NvmeBufferLease> GetLogPage(LogPageIdentifier id,
+                                             uint32_t len,
+                                             uint32_t nsid) const;
 
-  // GetLogPage with an offset within the log page to get the data from.
-  absl::Status GetLogPageWithOffset(LogPageIdentifier id, uint32_t len,
-                                    uint32_t nsid, uint32_t offset,
-                                    uint8_t *buf) const;
+  // Construct a GetLogPage command with an offset within the log page to get
+  // the data from.
+  static nvme_passthru_cmd MakeGetLogPageCommand(LogPageIdentifier id,
+                                                 uint32_t len, uint32_t nsid,
+                                                 uint32_t offset, uint8_t *buf);
 
   // Some basic sanity check so commands don't go forever.
   // Note that commands may get blocked behind others in the queue (e.g.
@@ -489,6 +525,9 @@ class NvmeDevice : public NvmeDeviceInterface {
 
   // Interface for sending commands to the device (e.g. via Linux ioctl).
   const std::unique_ptr<NvmeAccessInterface> access_;
+
+  // Pool of buffers for the data transferred by admin commands.
+  const std::shared_ptr<NvmeBufferPool> pool_;
 };
 
 absl::StatusOr<std::set<uint32_t>>
@@ -534,9 +573,20 @@ NvmeDeviceInterface::EnumerateAllNamespacesAndInfo() {
   }
   auto namespaces = std::move(ret.value());
 
+  return GetNamespacesInfo(namespaces);
+}
+
+absl::StatusOr<SmartLogPage> NvmeDeviceInterface::SmartLogView() const {
+  return absl::UnimplementedError(
+      "SmartLogView is not supported by this device");
+}
+
+absl::StatusOr<std::map<uint32_t, IdentifyNamespace>>
+NvmeDeviceInterface::GetNamespacesInfo(
+    const std::set<uint32_t> &namespace_ids) {
   std::map<uint32_t, IdentifyNamespace> ns_with_info;
 
-  for (uint32_t nsid : namespaces) {
+  for (uint32_t nsid : namespace_ids) {
     auto ret = GetNamespaceInfo(nsid);
     if (!ret.ok()) {
       return absl::Status(
@@ -589,16 +639,68 @@ absl::StatusOr<uint8_t> NvmeDeviceInterface::IndexOfFormatWithLbaSize(
   return best_matching_format_index;
 }
 
-absl::Status NvmeDevice::GetLogPageWithOffset(LogPageIdentifier id,
-                                              uint32_t len, uint32_t nsid,
-                                              uint32_t offset,
-                                              uint8_t *buf) const {
+absl::StatusOr<std::map<uint32_t, IdentifyNamespace>>
+NvmeDevice::GetNamespacesInfo(const std::set<uint32_t> &namespace_ids) {
+  static constexpr uint8_t kNvmeOpcodeAdminIdentify = 0x06;
+  static constexpr uint8_t kCnsIdentifyNs = 0x00;
+
+  // Issue all of the IdentifyNamespace commands as a single batch, with each
+  // command using its own section of one large buffer.
+  NvmeBufferLease buffer =
+      pool_->Lease(namespace_ids.size() * kIdentifyNamespaceSize);
+  std::vector<nvme_passthru_cmd> cmds;
+  cmds.reserve(namespace_ids.size());
+  for (uint32_t namespace_id : namespace_ids) {
+    cmds.push_back({
+        .opcode = kNvmeOpcodeAdminIdentify,
+        .nsid = namespace_id,
+        .addr = reinterpret_cast<uint64_t>(
+            buffer.data() + cmds.size() * kIdentifyNamespaceSize),
+        .data_len = kIdentifyNamespaceSize,
+        .cdw10 = kCnsIdentifyNs,
+        .cdw11 = 0,
+        .cdw12 = 0,
+        .cdw13 = 0,
+        .timeout_ms = kTimeoutMs,
+    });
+  }
+  std::vector<absl::Status> results =
+      access_->ExecuteAdminCommands(CommandPointers(absl::MakeSpan(cmds)));
+
+  std::map<uint32_t, IdentifyNamespace> ns_with_info;
+  size_t index = 0;
+  for (uint32_t namespace_id : namespace_ids) {
+    if (!results[index].ok()) {
+      std::stringstream stream;
+      stream << "Failed to execute IdentifyNamespace command for namespace_id "
+             << namespace_id << " (0x" << std::hex << namespace_id << ")";
+      return absl::Status(
+          results[index].code(),
+          absl::StrCat(results[index].message(), ";", stream.str(), ";",
+                       "Could not get info about namespace ", namespace_id));
+    }
+    auto ns_info = IdentifyNamespace::Parse(absl::string_view(
+        buffer.data() + index * kIdentifyNamespaceSize,
+        kIdentifyNamespaceSize));
+    if (!ns_info.ok()) return ns_info.status();
+    ns_with_info.insert({namespace_id, std::move(ns_info.value())});
+    ++index;
+  }
+
+  return ns_with_info;
+}
+
+nvme_passthru_cmd NvmeDevice::MakeGetLogPageCommand(LogPageIdentifier id,
+                                                    uint32_t len,
+                                                    uint32_t nsid,
+                                                    uint32_t offset,
+                                                    uint8_t *buf) {
   static constexpr uint8_t kNvmeOpcodeGetLogPage = 0x2;
   const uint32_t numd = (len >> 2) - 1;
   const uint16_t numdl = numd & 0xffff;
   const uint16_t numdu = numd >> 16;
 
-  nvme_passthru_cmd cmd = {
+  return {
       .opcode = kNvmeOpcodeGetLogPage,
       .nsid = nsid,
       .addr = reinterpret_cast<uint64_t>(buf),
@@ -609,19 +711,11 @@ absl::Status NvmeDevice::GetLogPageWithOffset(LogPageIdentifier id,
       .cdw13 = 0,
       .timeout_ms = kTimeoutMs,
   };
-
-  if (auto status = access_->ExecuteAdminCommand(&cmd); !status.ok()) {
-    return absl::Status(status.code(),
-                        absl::StrCat(status.message(), ";",
-                                     "Failed to execute GetLogPage command."));
-  }
-
-  return absl::OkStatus();
 }
 
-absl::StatusOr<std::string> NvmeDevice::GetLogPage(LogPageIdentifier id,
-                                                   uint32_t len,
-                                                   uint32_t nsid) const {
+absl::StatusOr<NvmeBufferLease> NvmeDevice::GetLogPage(LogPageIdentifier id,
+                                                       uint32_t len,
+                                                       uint32_t nsid) const {
   // In reality this value should be derived from controller PCIe register
   // CAP.MPSMIN. Until we add the ability to read CAP.MPSMIN, we can safely
   // assume the minimum possible value.
@@ -648,26 +742,54 @@ absl::StatusOr<std::string> NvmeDevice::GetLogPage(LogPageIdentifier id,
         kMinimumMemoryPageSize;
   }
 
-  size_t offset = 0;
-  std::string buffer(len, '\0');
-  do {
-    size_t chunk_size =
-        len <= max_data_transfer_size ? len : max_data_transfer_size;
-    if (auto status = GetLogPageWithOffset(
-            id, chunk_size, nsid, offset,
-            reinterpret_cast<uint8_t *>(buffer.data() + offset));
-        !status.ok()) {
+  NvmeBufferLease buffer = pool_->Lease(len);
+
+  // The common case is a log page which fits into a single transfer, which is
+  // issued directly to avoid having to allocate a batch.
+  if (len <= max_data_transfer_size) {
+    nvme_passthru_cmd cmd = MakeGetLogPageCommand(
+        id, len, nsid, 0, reinterpret_cast<uint8_t *>(buffer.data()));
+    if (auto status = access_->ExecuteAdminCommand(&cmd); !status.ok()) {
       return absl::Status(
           status.code(),
           absl::StrCat(status.message(), ";",
+                       "Failed to execute GetLogPage command.", ";",
                        absl::StrFormat("Failed to get %d bytes from offset %d "
                                        "for log page identifier "
                                        "0x%x.",
-                                       chunk_size, offset, id)));
+                                       len, 0, id)));
     }
+    return buffer;
+  }
+
+  // Build the commands for all of the chunks up front, so that they can be
+  // executed back to back as a single batch.
+  std::vector<nvme_passthru_cmd> cmds;
+  size_t offset = 0;
+  do {
+    size_t chunk_size =
+        len <= max_data_transfer_size ? len : max_data_transfer_size;
+    cmds.push_back(MakeGetLogPageCommand(
+        id, chunk_size, nsid, offset,
+        reinterpret_cast<uint8_t *>(buffer.data() + offset)));
     len -= chunk_size;
     offset += chunk_size;
   } while (len > 0);
+
+  std::vector<absl::Status> results =
+      access_->ExecuteAdminCommands(CommandPointers(absl::MakeSpan(cmds)));
+  for (size_t i = 0; i < results.size(); ++i) {
+    if (!results[i].ok()) {
+      return absl::Status(
+          results[i].code(),
+          absl::StrCat(results[i].message(), ";",
+                       "Failed to execute GetLogPage command.", ";",
+                       absl::StrFormat("Failed to get %d bytes from offset %d "
+                                       "for log page identifier "
+                                       "0x%x.",
+                                       cmds[i].data_len, cmds[i].cdw12, id)));
+    }
+  }
   return buffer;
 }
 
@@ -690,11 +812,11 @@ absl::StatusOr<std::vector<ErrorLogInfoEntry>> NvmeDevice::ErrorInformation()
   if (!ret2.ok()) {
     return absl::Status(ret2.status().code(), ret2.status().message());
   }
-  std::string buffer = std::move(ret2.value());
+  NvmeBufferLease buffer = std::move(ret2.value());
   if (len != buffer.size()) return absl::InternalError("Unexpected error.");
   // Determine the number of valid entries
   const ErrorLogInfoEntry *entries =
-      reinterpret_cast<ErrorLogInfoEntry *>(buffer.data());
+      reinterpret_cast<const ErrorLogInfoEntry *>(buffer.data());
   uint16_t index = 0;
   uint16_t num_entries_valid = 0;
   while (index < identify->max_error_log_page_entries()) {
@@ -717,8 +839,7 @@ NvmeDevice::FirmwareSlotInformation() const {
   if (!ret.ok()) {
     return absl::Status(ret.status().code(), ret.status().message());
   }
-  auto buffer = std::move(ret.value());
-  return FirmwareSlotInfo::Parse(buffer);
+  return FirmwareSlotInfo::Parse(std::move(ret.value()));
 }
 
 absl::StatusOr<std::unique_ptr<DeviceSelfTestLog>>
@@ -729,15 +850,20 @@ NvmeDevice::GetDeviceSelfTestLog() const {
   if (!ret.ok()) {
     return absl::Status(ret.status().code(), ret.status().message());
   }
-  auto buffer = std::move(ret.value());
-  return DeviceSelfTestLog::Parse(buffer);
+  return DeviceSelfTestLog::Parse(std::move(ret.value()));
 }
 
 // Create device interface using given access and transport interface.
 std::unique_ptr<NvmeDeviceInterface> CreateNvmeDevice(
     std::unique_ptr<NvmeAccessInterface> access) {
+  return CreateNvmeDevice(std::move(access), NvmeBufferPool::Default());
+}
+
+std::unique_ptr<NvmeDeviceInterface> CreateNvmeDevice(
+    std::unique_ptr<NvmeAccessInterface> access,
+    std::shared_ptr<NvmeBufferPool> pool) {
   return std::unique_ptr<NvmeDeviceInterface>(
-      new NvmeDevice(std::move(access)));
+      new NvmeDevice(std::move(access), std::move(pool)));
 }
 
 }  // namespace ecclesia
@@ -31,6 +31,7 @@
 #include "ecclesia/magent/lib/nvme/identify_controller.h"
 #include "ecclesia/magent/lib/nvme/identify_namespace.h"
 #include "ecclesia/magent/lib/nvme/nvme_access.h"
+#include "ecclesia/magent/lib/nvme/nvme_buffer_pool.h"
 #include "ecclesia/magent/lib/nvme/nvme_types.h"
 #include "ecclesia/magent/lib/nvme/sanitize_log_page.h"
 #include "ecclesia/magent/lib/nvme/smart_log_page.h"
@@ -57,6 +58,12 @@ class NvmeDeviceInterface {
   virtual absl::StatusOr<IdentifyNamespace> GetNamespaceInfo(
       uint32_t namespace_id) = 0;
 
+  // Executes IdentifyNamespace commands for all of the provided namespace_ids.
+  // Map key is the namespace id (nsid). Fails if any of the commands fail. The
+  // default implementation calls GetNamespaceInfo for each namespace in turn.
+  virtual absl::StatusOr<std::map<uint32_t, IdentifyNamespace>>
+  GetNamespacesInfo(const std::set<uint32_t> &namespace_ids);
+
   // Gets the table of supported LBA formats from the device.  Order matters:
   // the index of each entry is the same as reported by the device, so it is
   // suitable for passing to CreateNamespace.
@@ -66,6 +73,12 @@ class NvmeDeviceInterface {
   virtual absl::StatusOr<std::unique_ptr<SmartLogPageInterface>> SmartLog()
       const = 0;
 
+  // Executes the SmartLogPage command on the device, returning a page which
+  // views the leased buffer the device wrote into. Once the buffer pool has
+  // warmed up this does no allocation, so it should be preferred for periodic
+  // polling. The default implementation returns an Unimplemented error.
+  virtual absl::StatusOr<SmartLogPage> SmartLogView() const;
+
   // Executes the Sanitize Status Log Page command on the device.
   virtual absl::StatusOr<std::unique_ptr<SanitizeLogPageInterface>>
   SanitizeStatusLog() const = 0;
@@ -151,9 +164,14 @@ class NvmeDeviceInterface {
       const = 0;
 };
 
-// Create device interface using given access and transport interface.
+// Create device interface using given access and transport interface. The
+// buffers for admin commands are leased from the given pool, or from the
+// process-wide default pool if none is specified.
 std::unique_ptr<NvmeDeviceInterface> CreateNvmeDevice(
     std::unique_ptr<NvmeAccessInterface> access);
+std::unique_ptr<NvmeDeviceInterface> CreateNvmeDevice(
+    std::unique_ptr<NvmeAccessInterface> access,
+    std::shared_ptr<NvmeBufferPool> pool);
 
 }  // namespace ecclesia
 
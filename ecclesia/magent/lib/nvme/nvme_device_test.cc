@@ -17,6 +17,7 @@
 #include "ecclesia/magent/lib/nvme/nvme_device.h"
 
 #include <linux/nvme_ioctl.h>
+#include <string.h>
 
 #include <cstdint>
 #include <iterator>
@@ -30,33 +31,30 @@
 #include "gtest/gtest.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "ecclesia/magent/lib/nvme/controller_registers.h"
 #include "ecclesia/magent/lib/nvme/identify_namespace.h"
 #include "ecclesia/magent/lib/nvme/mock_nvme_device.h"
 #include "ecclesia/magent/lib/nvme/nvme_access.h"
+#include "ecclesia/magent/lib/nvme/nvme_buffer_pool.h"
 #include "ecclesia/magent/lib/nvme/nvme_types.h"
+#include "ecclesia/magent/lib/nvme/smart_log_page.h"
 
 namespace ecclesia {
 namespace {
 
+using ::testing::_;
 using ::testing::AllOf;
+using ::testing::ElementsAre;
 using ::testing::Field;
 using ::testing::HasSubstr;
+using ::testing::Key;
 using ::testing::Pointee;
 using ::testing::Return;
+using ::testing::SizeIs;
 
 const uint8_t kNvmeOpcodeSanitizeNvm = 0x84;
-
-class MockNvmeAccessInterface : public NvmeAccessInterface {
- public:
-  MOCK_METHOD(absl::Status, ExecuteAdminCommand, (nvme_passthru_cmd * cmd),
-              (const, override));
-  // MOCK_METHOD(absl::Status, RescanNamespaces, (), (override));
-  MOCK_METHOD(absl::Status, ResetSubsystem, (), (override));
-  MOCK_METHOD(absl::Status, ResetController, (), (override));
-  MOCK_METHOD(absl::StatusOr<ControllerRegisters>, GetControllerRegisters, (),
-              (const, override));
-};
+const uint32_t kCnsIdentifyListNs = 0x02;
 
 // Check that operator== works as expected.
 TEST(IdentifyNamespaceOperatorEqualsTest, AllFieldsAreConsidered) {
@@ -171,6 +169,115 @@ TEST(EnumerateAllNamespacesAndInfoTest, IdentifySeveralNamespacesWithInfo) {
   EXPECT_THAT(ret.value(), expected);
 }
 
+// Fill in the data buffer of an IdentifyNamespace command with a namespace
+// whose capacity is derived from its nsid, using 4k blocks.
+absl::Status FillIdentifyNamespace(nvme_passthru_cmd *cmd) {
+  if (cmd->data_len != kIdentifyNamespaceSize) {
+    return absl::InternalError("unexpected data length");
+  }
+  IdentifyNamespaceFormat idns = {};
+  idns.capacity = cmd->nsid * 0x1000;
+  idns.formatted_lba_size = 0;
+  idns.lba_format[0].data_size = 12;
+  memcpy(reinterpret_cast<void *>(cmd->addr), &idns, sizeof(idns));
+  return absl::OkStatus();
+}
+
+TEST(EnumerateAllNamespacesAndInfoTest, IdentifyNamespacesAreBatched) {
+  auto access = absl::make_unique<MockNvmeAccessInterface>();
+  EXPECT_CALL(*access, ExecuteAdminCommand(Pointee(Field(
+                           &nvme_passthru_cmd::cdw10, kCnsIdentifyListNs))))
+      .WillOnce([](nvme_passthru_cmd *cmd) {
+        uint32_t *nsids = reinterpret_cast<uint32_t *>(cmd->addr);
+        nsids[0] = 1;
+        nsids[1] = 2;
+        nsids[2] = 7;
+        return absl::OkStatus();
+      });
+  EXPECT_CALL(*access, ExecuteAdminCommands(SizeIs(3)))
+      .WillOnce([](absl::Span<nvme_passthru_cmd *const> cmds) {
+        std::vector<absl::Status> results;
+        for (nvme_passthru_cmd *cmd : cmds) {
+          results.push_back(FillIdentifyNamespace(cmd));
+        }
+        return results;
+      });
+  auto nvme = CreateNvmeDevice(std::move(access));
+
+  auto ret = nvme->EnumerateAllNamespacesAndInfo();
+  ASSERT_TRUE(ret.ok());
+  EXPECT_THAT(ret.value(), ElementsAre(Key(1), Key(2), Key(7)));
+  EXPECT_EQ(ret.value()[1].capacity_bytes, 0x1000 * 4096);
+  EXPECT_EQ(ret.value()[2].capacity_bytes, 0x2000 * 4096);
+  EXPECT_EQ(ret.value()[7].capacity_bytes, 0x7000 * 4096);
+  EXPECT_EQ(ret.value()[7].formatted_lba_size_bytes, 4096);
+}
+
+TEST(EnumerateAllNamespacesAndInfoTest, BatchedIdentifyErrorPropagates) {
+  auto access = absl::make_unique<MockNvmeAccessInterface>();
+  EXPECT_CALL(*access, ExecuteAdminCommands(SizeIs(2)))
+      .WillOnce([](absl::Span<nvme_passthru_cmd *const> cmds) {
+        std::vector<absl::Status> results;
+        results.push_back(FillIdentifyNamespace(cmds[0]));
+        results.push_back(absl::UnavailableError("BOGUS ERROR"));
+        return results;
+      });
+  auto nvme = CreateNvmeDevice(std::move(access));
+
+  auto ret = nvme->GetNamespacesInfo({1, 2});
+  EXPECT_EQ(ret.status().code(), absl::StatusCode::kUnavailable);
+  EXPECT_THAT(ret.status().ToString(), HasSubstr("namespace 2"));
+}
+
+TEST(LogPageTest, SmallLogPageIsSingleCommand) {
+  auto access = absl::make_unique<MockNvmeAccessInterface>();
+  EXPECT_CALL(*access, ExecuteAdminCommand(AllOf(
+                           Pointee(Field(&nvme_passthru_cmd::opcode, 0x02)),
+                           Pointee(Field(&nvme_passthru_cmd::data_len,
+                                         kFirmwareSlotInfoFormatSize)))))
+      .WillOnce(Return(absl::OkStatus()));
+  EXPECT_CALL(*access, ExecuteAdminCommands(_)).Times(0);
+  auto nvme = CreateNvmeDevice(std::move(access));
+
+  EXPECT_TRUE(nvme->FirmwareSlotInformation().ok());
+}
+
+TEST(LogPageTest, SmartLogViewReusesPooledBuffer) {
+  auto pool = NvmeBufferPool::Create();
+  auto access = absl::make_unique<MockNvmeAccessInterface>();
+  EXPECT_CALL(*access, ExecuteAdminCommand(Pointee(Field(
+                           &nvme_passthru_cmd::data_len, kSmartLogPageSize))))
+      .Times(10)
+      .WillRepeatedly([](nvme_passthru_cmd *cmd) {
+        // Composite temperature of 314K.
+        uint8_t *data = reinterpret_cast<uint8_t *>(cmd->addr);
+        data[1] = 0x3a;
+        data[2] = 0x01;
+        return absl::OkStatus();
+      });
+  auto nvme = CreateNvmeDevice(std::move(access), pool);
+
+  for (int i = 0; i < 10; ++i) {
+    absl::StatusOr<SmartLogPage> smart = nvme->SmartLogView();
+    ASSERT_TRUE(smart.ok());
+    EXPECT_EQ(smart->composite_temperature_kelvins(), 314);
+  }
+  // Every poll after the first should have reused the same buffer.
+  EXPECT_EQ(pool->NumAllocations(), 1);
+  EXPECT_EQ(pool->NumFreeBuffers(), 1);
+}
+
+TEST(LogPageTest, LogPageErrorPropagates) {
+  auto access = absl::make_unique<MockNvmeAccessInterface>();
+  EXPECT_CALL(*access, ExecuteAdminCommand(_))
+      .WillOnce(Return(absl::InternalError("SOME ERRORS")));
+  auto nvme = CreateNvmeDevice(std::move(access));
+
+  auto ret = nvme->SmartLog();
+  EXPECT_EQ(ret.status().code(), absl::StatusCode::kInternal);
+  EXPECT_THAT(ret.status().ToString(), HasSubstr("SOME ERRORS"));
+}
+
 TEST(IndexOfFormatWithLbaSizeTest, FindMatching) {
   MockNvmeDevice nvme;
 
@@ -23,17 +23,21 @@
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include <cstddef>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 #include "ecclesia/lib/cleanup/cleanup.h"
 #include "ecclesia/lib/file/mmap.h"
 #include "ecclesia/lib/logging/globals.h"
@@ -45,15 +49,20 @@
 
 namespace ecclesia {
 
-absl::Status NvmeLinuxAccess::ExecuteAdminCommand(
-    nvme_passthru_cmd *cmd) const {
-  int fd = open(devpath_.c_str(), O_RDONLY, 0);
+NvmeLinuxAccess::Descriptor::~Descriptor() { close(fd_); }
+
+absl::StatusOr<std::shared_ptr<const NvmeLinuxAccess::Descriptor>>
+NvmeLinuxAccess::GetDescriptor() const {
+  absl::MutexLock ml(&desc_mutex_);
+  if (desc_) return desc_;
+
+  int fd = open(devpath_.c_str(), O_RDONLY | O_CLOEXEC, 0);
   if (fd < 0) {
     return absl::Status(absl::StatusCode::kFailedPrecondition,
                         absl::StrFormat("Couldn't open device at path %s: %s",
                                         devpath_, strerror(errno)));
   }
-  auto fd_closer = FdCloser(fd);
+  auto desc = std::make_shared<const Descriptor>(fd);
 
   struct stat nvme_stat;
   int err = fstat(fd, &nvme_stat);
@@ -65,17 +74,64 @@ absl::Status NvmeLinuxAccess::ExecuteAdminCommand(
     return absl::Status(absl::StatusCode::kFailedPrecondition,
                         "not a block or character device");
   }
-  err = ioctl(fd, NVME_IOCTL_ADMIN_CMD, cmd);
+  desc_ = desc;
+  return desc;
+}
+
+void NvmeLinuxAccess::DropDescriptor(
+    const std::shared_ptr<const Descriptor> &desc) const {
+  absl::MutexLock ml(&desc_mutex_);
+  if (desc_ == desc) desc_ = nullptr;
+}
+
+absl::Status NvmeLinuxAccess::ExecuteOnDescriptor(const Descriptor &desc,
+                                                  nvme_passthru_cmd *cmd,
+                                                  bool *device_removed) {
+  int err = ioctl(desc.fd(), NVME_IOCTL_ADMIN_CMD, cmd);
   if (err < 0) {
+    if (errno == ENODEV || errno == ENXIO) *device_removed = true;
     return absl::InternalError(
         absl::StrCat("ioctl failed with POSIX errno: ", errno));
-  } else if (err != 0) {
-    return absl::InternalError(
-        absl::StrCat("ioctl failed with Generic Command Status number: ", err));
+  }
+  if (err != 0) {
+    return absl::InternalError(absl::StrCat(
+        "ioctl failed with Generic Command Status number: ", err));
   }
   return absl::OkStatus();
 }
 
+absl::Status NvmeLinuxAccess::ExecuteAdminCommand(
+    nvme_passthru_cmd *cmd) const {
+  auto maybe_desc = GetDescriptor();
+  if (!maybe_desc.ok()) return maybe_desc.status();
+  std::shared_ptr<const Descriptor> desc = std::move(*maybe_desc);
+
+  bool device_removed = false;
+  absl::Status status = ExecuteOnDescriptor(*desc, cmd, &device_removed);
+  // If the device has been removed then the descriptor is no longer usable.
+  // Drop it so that the next command will try to open the device again.
+  if (device_removed) DropDescriptor(desc);
+  return status;
+}
+
+std::vector<absl::Status> NvmeLinuxAccess::ExecuteAdminCommands(
+    absl::Span<nvme_passthru_cmd *const> cmds) const {
+  auto maybe_desc = GetDescriptor();
+  if (!maybe_desc.ok()) {
+    return std::vector<absl::Status>(cmds.size(), maybe_desc.status());
+  }
+  std::shared_ptr<const Descriptor> desc = std::move(*maybe_desc);
+
+  std::vector<absl::Status> results;
+  results.reserve(cmds.size());
+  bool device_removed = false;
+  for (nvme_passthru_cmd *cmd : cmds) {
+    results.push_back(ExecuteOnDescriptor(*desc, cmd, &device_removed));
+  }
+  if (device_removed) DropDescriptor(desc);
+  return results;
+}
+
 /*
 absl::Status NvmeLinuxAccess::RescanNamespaces() {
   InfoLog() << "Refreshing block device at " << devpath_;
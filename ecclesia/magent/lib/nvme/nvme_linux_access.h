@@ -19,9 +19,13 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 #include "ecclesia/magent/lib/nvme/controller_registers.h"
 #include "ecclesia/magent/lib/nvme/nvme_access.h"
 #include "ecclesia/magent/lib/nvme/nvme_device.h"
@@ -30,13 +34,25 @@ struct nvme_passthru_cmd;
 
 namespace ecclesia {
 
+// Access to an NVMe device through the Linux kernel. The device is opened and
+// validated the first time an admin command is executed, and the descriptor is
+// then kept open for subsequent commands. If the device goes away the
+// descriptor is dropped and the device will be reopened by the next command.
 class NvmeLinuxAccess : public NvmeAccessInterface {
  public:
   explicit NvmeLinuxAccess(const std::string &devpath) : devpath_(devpath) {}
 
+  // The object can own a file descriptor so it cannot be copied.
+  NvmeLinuxAccess(const NvmeLinuxAccess &other) = delete;
+  NvmeLinuxAccess &operator=(const NvmeLinuxAccess &other) = delete;
+
   // Executes a single NVM-Express command.
   absl::Status ExecuteAdminCommand(nvme_passthru_cmd *cmd) const override;
 
+  // Executes a sequence of NVM-Express commands using a single descriptor.
+  std::vector<absl::Status> ExecuteAdminCommands(
+      absl::Span<nvme_passthru_cmd *const> cmds) const override;
+
   // Disable this feature becasue linux/nvme_ioctl.h in kokoro build image
   // ubuntu1604 is not up to date. After we migrate to a more robust build env,
   // this can re-enabled.
@@ -52,7 +68,37 @@ class NvmeLinuxAccess : public NvmeAccessInterface {
   absl::StatusOr<ControllerRegisters> GetControllerRegisters() const override;
 
  private:
+  // An open and validated descriptor for the device. This is reference counted
+  // so that it can be dropped while commands are still using it.
+  class Descriptor {
+   public:
+    explicit Descriptor(int fd) : fd_(fd) {}
+    Descriptor(const Descriptor &other) = delete;
+    Descriptor &operator=(const Descriptor &other) = delete;
+    ~Descriptor();
+
+    int fd() const { return fd_; }
+
+   private:
+    const int fd_;
+  };
+
+  // Get the descriptor for the device, opening and validating it if necessary.
+  absl::StatusOr<std::shared_ptr<const Descriptor>> GetDescriptor() const;
+
+  // Drop the given descriptor if it is still the current one.
+  void DropDescriptor(const std::shared_ptr<const Descriptor> &desc) const;
+
+  // Execute a single command using the given descriptor. If the command fails
+  // because the device has gone away then device_removed will be set.
+  static absl::Status ExecuteOnDescriptor(const Descriptor &desc,
+                                          nvme_passthru_cmd *cmd,
+                                          bool *device_removed);
+
   const std::string devpath_;
+
+  mutable absl::Mutex desc_mutex_;
+  mutable std::shared_ptr<const Descriptor> desc_ ABSL_GUARDED_BY(desc_mutex_);
 };
 
 // Create device interface using Linux kernel IOCTL and PCie transport.
@@ -0,0 +1,434 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/lib/nvme/nvme_smart_history.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/numeric/int128.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "ecclesia/lib/logging/globals.h"
+#include "ecclesia/lib/logging/logging.h"
+#include "ecclesia/magent/lib/nvme/nvme_device.h"
+#include "ecclesia/magent/lib/nvme/smart_log_page.h"
+
+namespace ecclesia {
+namespace {
+
+// The number of samples stored in each block of the ring. Each block starts
+// with a complete sample, so this trades off the size of a history against
+// how much memory is reclaimed at a time.
+constexpr size_t kSamplesPerBlock = 64;
+
+// Truncate a 128-bit counter to 64 bits, saturating rather than wrapping.
+uint64_t Saturate(absl::uint128 value) {
+  if (absl::Uint128High64(value) != 0) return UINT64_MAX;
+  return absl::Uint128Low64(value);
+}
+
+// Timestamps are stored with microsecond precision.
+absl::Time TruncateToMicros(absl::Time timestamp) {
+  return absl::FromUnixMicros(absl::ToUnixMicros(timestamp));
+}
+
+// Signed values are zigzag encoded so that small negative deltas also produce
+// small varints.
+uint64_t ZigZagEncode(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+int64_t ZigZagDecode(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Append an unsigned LEB128 varint to a buffer.
+void PutVarint(uint64_t value, std::string *buffer) {
+  while (value >= 0x80) {
+    buffer->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  buffer->push_back(static_cast<char>(value));
+}
+
+// Read an unsigned LEB128 varint from a buffer, advancing the position. The
+// buffers are only ever written by PutVarint so they are assumed to be valid.
+uint64_t GetVarint(absl::string_view buffer, size_t *pos) {
+  uint64_t value = 0;
+  int shift = 0;
+  uint8_t byte;
+  do {
+    byte = static_cast<uint8_t>(buffer[(*pos)++]);
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  return value;
+}
+
+}  // namespace
+
+NvmeSmartSample NvmeSmartSample::FromSmartLog(
+    absl::Time timestamp, const SmartLogPageInterface &smart_log) {
+  NvmeSmartSample sample;
+  sample.timestamp = timestamp;
+  sample.set_value(SmartField::kCriticalWarning, smart_log.critical_warning());
+  sample.set_value(SmartField::kCompositeTemperatureKelvins,
+                   smart_log.composite_temperature_kelvins());
+  sample.set_value(SmartField::kAvailableSpare, smart_log.available_spare());
+  sample.set_value(SmartField::kAvailableSpareThreshold,
+                   smart_log.available_spare_threshold());
+  sample.set_value(SmartField::kPercentUsed, smart_log.percent_used());
+  sample.set_value(SmartField::kDataUnitsRead,
+                   Saturate(smart_log.data_units_read()));
+  sample.set_value(SmartField::kDataUnitsWritten,
+                   Saturate(smart_log.data_units_written()));
+  sample.set_value(SmartField::kHostReads, Saturate(smart_log.host_reads()));
+  sample.set_value(SmartField::kHostWrites, Saturate(smart_log.host_writes()));
+  sample.set_value(SmartField::kControllerBusyTimeMinutes,
+                   Saturate(smart_log.controller_busy_time_minutes()));
+  sample.set_value(SmartField::kPowerCycles,
+                   Saturate(smart_log.power_cycles()));
+  sample.set_value(SmartField::kPowerOnHours,
+                   Saturate(smart_log.power_on_hours()));
+  sample.set_value(SmartField::kUnsafeShutdowns,
+                   Saturate(smart_log.unsafe_shutdowns()));
+  sample.set_value(SmartField::kMediaErrors,
+                   Saturate(smart_log.media_errors()));
+  sample.set_value(SmartField::kNumErrLogEntries,
+                   Saturate(smart_log.num_err_log_entries()));
+  sample.set_value(SmartField::kWarningTempTimeMinutes,
+                   smart_log.warning_temp_time_minutes());
+  sample.set_value(SmartField::kCriticalCompTimeMinutes,
+                   smart_log.critical_comp_time_minutes());
+  return sample;
+}
+
+// A block of consecutive samples. The first sample is stored in full, and each
+// following sample is encoded relative to the one before it as:
+//   - the change in the sampling interval, in microseconds, as a varint; for a
+//     sampler running on a fixed interval this is usually zero
+//   - a varint bitmask of the fields which changed
+//   - for each changed field, the change in its value as a varint
+class NvmeSmartHistory::Block {
+ public:
+  size_t count() const { return count_; }
+  bool full() const { return count_ == kSamplesPerBlock; }
+  const NvmeSmartSample &first() const { return first_; }
+  const NvmeSmartSample &last() const { return last_; }
+
+  size_t EncodedBytes() const {
+    return count_ == 0 ? 0 : sizeof(first_) + data_.size();
+  }
+
+  // Empty the block so it can be reused. This keeps the encoding buffer, so
+  // a ring which has wrapped around does not allocate.
+  void Clear() {
+    data_.clear();
+    count_ = 0;
+  }
+
+  void Append(const NvmeSmartSample &sample) {
+    if (count_ == 0) {
+      first_ = sample;
+      last_ = sample;
+      last_interval_us_ = 0;
+      count_ = 1;
+      return;
+    }
+
+    int64_t interval_us = absl::ToInt64Microseconds(sample.timestamp -
+                                                    last_.timestamp);
+    PutVarint(ZigZagEncode(interval_us - last_interval_us_), &data_);
+    last_interval_us_ = interval_us;
+
+    uint64_t changed = 0;
+    for (int i = 0; i < kNumSmartFields; ++i) {
+      if (sample.values[i] != last_.values[i]) changed |= uint64_t{1} << i;
+    }
+    PutVarint(changed, &data_);
+    for (int i = 0; i < kNumSmartFields; ++i) {
+      if (changed & (uint64_t{1} << i)) {
+        PutVarint(ZigZagEncode(
+                      static_cast<int64_t>(sample.values[i] - last_.values[i])),
+                  &data_);
+      }
+    }
+
+    last_ = sample;
+    ++count_;
+  }
+
+  // Decode every sample in the block, in order, passing each one to func.
+  template <typename F>
+  void ForEach(F func) const {
+    if (count_ == 0) return;
+    NvmeSmartSample sample = first_;
+    func(sample);
+    int64_t interval_us = 0;
+    size_t pos = 0;
+    for (size_t n = 1; n < count_; ++n) {
+      interval_us += ZigZagDecode(GetVarint(data_, &pos));
+      sample.timestamp += absl::Microseconds(interval_us);
+      uint64_t changed = GetVarint(data_, &pos);
+      for (int i = 0; i < kNumSmartFields; ++i) {
+        if (changed & (uint64_t{1} << i)) {
+          sample.values[i] += static_cast<uint64_t>(
+              ZigZagDecode(GetVarint(data_, &pos)));
+        }
+      }
+      func(sample);
+    }
+  }
+
+ private:
+  NvmeSmartSample first_;
+  NvmeSmartSample last_;
+  int64_t last_interval_us_ = 0;
+  std::string data_;
+  size_t count_ = 0;
+};
+
+NvmeSmartHistory::NvmeSmartHistory(size_t capacity)
+    // One extra block is needed so that evicting the oldest block still leaves
+    // at least capacity samples.
+    : blocks_((std::max<size_t>(capacity, 1) + kSamplesPerBlock - 1) /
+                  kSamplesPerBlock +
+              1) {}
+
+NvmeSmartHistory::~NvmeSmartHistory() = default;
+
+absl::Status NvmeSmartHistory::Append(const NvmeSmartSample &sample) {
+  NvmeSmartSample truncated = sample;
+  truncated.timestamp = TruncateToMicros(sample.timestamp);
+
+  absl::MutexLock ml(&mutex_);
+  if (num_used_ > 0) {
+    const Block &newest = blocks_[(oldest_ + num_used_ - 1) % blocks_.size()];
+    if (truncated.timestamp < newest.last().timestamp) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "smart sample at %s is older than the latest sample at %s",
+          absl::FormatTime(truncated.timestamp),
+          absl::FormatTime(newest.last().timestamp)));
+    }
+    if (!newest.full()) {
+      blocks_[(oldest_ + num_used_ - 1) % blocks_.size()].Append(truncated);
+      ++size_;
+      return absl::OkStatus();
+    }
+  }
+
+  // Start a new block, evicting the oldest one if the ring is full.
+  if (num_used_ == blocks_.size()) {
+    size_ -= blocks_[oldest_].count();
+    blocks_[oldest_].Clear();
+    oldest_ = (oldest_ + 1) % blocks_.size();
+    --num_used_;
+  }
+  Block &block = blocks_[(oldest_ + num_used_) % blocks_.size()];
+  block.Append(truncated);
+  ++num_used_;
+  ++size_;
+  return absl::OkStatus();
+}
+
+size_t NvmeSmartHistory::size() const {
+  absl::ReaderMutexLock ml(&mutex_);
+  return size_;
+}
+
+size_t NvmeSmartHistory::EncodedBytes() const {
+  absl::ReaderMutexLock ml(&mutex_);
+  size_t bytes = 0;
+  for (const Block &block : blocks_) bytes += block.EncodedBytes();
+  return bytes;
+}
+
+absl::optional<NvmeSmartSample> NvmeSmartHistory::Latest() const {
+  absl::ReaderMutexLock ml(&mutex_);
+  if (num_used_ == 0) return absl::nullopt;
+  return blocks_[(oldest_ + num_used_ - 1) % blocks_.size()].last();
+}
+
+template <typename F>
+void NvmeSmartHistory::ForEachInRange(absl::Time start, absl::Time end,
+                                      F func) const {
+  for (size_t i = 0; i < num_used_; ++i) {
+    const Block &block = blocks_[(oldest_ + i) % blocks_.size()];
+    // Skip over whole blocks which are outside of the range without decoding
+    // them. The blocks are in order so nothing after this can be in range.
+    if (block.last().timestamp < start) continue;
+    if (block.first().timestamp > end) break;
+    block.ForEach([&](const NvmeSmartSample &sample) {
+      if (sample.timestamp >= start && sample.timestamp <= end) func(sample);
+    });
+  }
+}
+
+std::vector<NvmeSmartSample> NvmeSmartHistory::Range(absl::Time start,
+                                                     absl::Time end) const {
+  std::vector<NvmeSmartSample> samples;
+  absl::ReaderMutexLock ml(&mutex_);
+  ForEachInRange(start, end, [&](const NvmeSmartSample &sample) {
+    samples.push_back(sample);
+  });
+  return samples;
+}
+
+absl::StatusOr<NvmeSmartHistory::FieldSummary> NvmeSmartHistory::Summarize(
+    SmartField field, absl::Time start, absl::Time end) const {
+  FieldSummary summary = {};
+  absl::ReaderMutexLock ml(&mutex_);
+  ForEachInRange(start, end, [&](const NvmeSmartSample &sample) {
+    uint64_t value = sample.value(field);
+    if (summary.num_samples == 0) {
+      summary.min = summary.max = summary.first = value;
+      summary.first_timestamp = sample.timestamp;
+    }
+    summary.min = std::min(summary.min, value);
+    summary.max = std::max(summary.max, value);
+    summary.last = value;
+    summary.last_timestamp = sample.timestamp;
+    ++summary.num_samples;
+  });
+  if (summary.num_samples == 0) {
+    return absl::NotFoundError(
+        absl::StrFormat("no smart samples between %s and %s",
+                        absl::FormatTime(start), absl::FormatTime(end)));
+  }
+  return summary;
+}
+
+absl::StatusOr<double> NvmeSmartHistory::Rate(SmartField field,
+                                              absl::Time start,
+                                              absl::Time end) const {
+  absl::StatusOr<FieldSummary> maybe_summary = Summarize(field, start, end);
+  if (!maybe_summary.ok()) return maybe_summary.status();
+  absl::Duration elapsed =
+      maybe_summary->last_timestamp - maybe_summary->first_timestamp;
+  if (elapsed <= absl::ZeroDuration()) {
+    return absl::NotFoundError(absl::StrFormat(
+        "not enough smart samples between %s and %s to compute a rate",
+        absl::FormatTime(start), absl::FormatTime(end)));
+  }
+  double change = static_cast<double>(maybe_summary->last) -
+                  static_cast<double>(maybe_summary->first);
+  return change / absl::ToDoubleSeconds(elapsed);
+}
+
+struct NvmeSmartHistorySampler::Drive {
+  Drive(std::string name_in, std::unique_ptr<NvmeDeviceInterface> device_in,
+        size_t capacity)
+      : name(std::move(name_in)),
+        device(std::move(device_in)),
+        history(capacity) {}
+
+  const std::string name;
+  const std::unique_ptr<NvmeDeviceInterface> device;
+  NvmeSmartHistory history;
+};
+
+NvmeSmartHistorySampler::NvmeSmartHistorySampler()
+    : NvmeSmartHistorySampler(Options()) {}
+
+NvmeSmartHistorySampler::NvmeSmartHistorySampler(const Options &options)
+    : options_(options) {}
+
+NvmeSmartHistorySampler::~NvmeSmartHistorySampler() {
+  stop_.Notify();
+  if (thread_.joinable()) thread_.join();
+}
+
+const NvmeSmartHistory *NvmeSmartHistorySampler::AddDrive(
+    std::string name, std::unique_ptr<NvmeDeviceInterface> device) {
+  absl::MutexLock ml(&mutex_);
+  drives_.push_back(absl::make_unique<Drive>(std::move(name), std::move(device),
+                                             options_.capacity));
+  return &drives_.back()->history;
+}
+
+const NvmeSmartHistory *NvmeSmartHistorySampler::GetHistory(
+    absl::string_view name) const {
+  absl::MutexLock ml(&mutex_);
+  for (const auto &drive : drives_) {
+    if (drive->name == name) return &drive->history;
+  }
+  return nullptr;
+}
+
+std::vector<absl::Status> NvmeSmartHistorySampler::SampleAll() {
+  std::vector<Drive *> drives;
+  {
+    absl::MutexLock ml(&mutex_);
+    for (const auto &drive : drives_) drives.push_back(drive.get());
+  }
+
+  std::vector<absl::Status> results;
+  results.reserve(drives.size());
+  for (Drive *drive : drives) {
+    absl::Status status = SampleDrive(drive);
+    if (!status.ok()) {
+      status = absl::Status(
+          status.code(),
+          absl::StrFormat("drive %s: %s", drive->name, status.message()));
+    }
+    results.push_back(std::move(status));
+  }
+  return results;
+}
+
+absl::Status NvmeSmartHistorySampler::SampleDrive(Drive *drive) {
+  absl::Time now = options_.clock->Now();
+  // Prefer the view of the log page, which avoids allocating, and fall back
+  // to a regular read for devices which don't support it.
+  absl::StatusOr<SmartLogPage> maybe_view = drive->device->SmartLogView();
+  if (maybe_view.ok()) {
+    return drive->history.Append(
+        NvmeSmartSample::FromSmartLog(now, *maybe_view));
+  }
+  if (!absl::IsUnimplemented(maybe_view.status())) return maybe_view.status();
+
+  auto maybe_smart = drive->device->SmartLog();
+  if (!maybe_smart.ok()) return maybe_smart.status();
+  return drive->history.Append(
+      NvmeSmartSample::FromSmartLog(now, **maybe_smart));
+}
+
+void NvmeSmartHistorySampler::Start() {
+  thread_ = std::thread([this]() {
+    do {
+      std::vector<absl::Status> results = SampleAll();
+      for (const absl::Status &status : results) {
+        if (!status.ok()) {
+          WarningLog() << "nvme smart history sampling failed: " << status;
+        }
+      }
+    } while (!stop_.WaitForNotificationWithTimeout(options_.interval));
+  });
+}
+
+}  // namespace ecclesia
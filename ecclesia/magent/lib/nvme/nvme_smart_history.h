@@ -0,0 +1,236 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This library provides support for keeping a history of the SMART health
+// information of NVMe drives. Every read of the SMART log is a point in time;
+// clients that want trends (wear rate, temperature excursions, growth in media
+// errors) would otherwise have to poll frequently, with every poll turning
+// into an admin command to the drive.
+//
+// Instead a sampler reads the SMART log of each drive on a fixed interval and
+// appends it to a per-drive history, which can then serve range queries and
+// rates from memory. The history is a fixed-size ring of blocks. Within each
+// block samples are stored as deltas from the previous sample, and only the
+// fields that actually changed are stored at all. Since most SMART fields are
+// counters that rarely change, a typical sample costs a few bytes.
+
+#ifndef ECCLESIA_MAGENT_LIB_NVME_NVME_SMART_HISTORY_H_
+#define ECCLESIA_MAGENT_LIB_NVME_NVME_SMART_HISTORY_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "ecclesia/lib/time/clock.h"
+#include "ecclesia/magent/lib/nvme/nvme_device.h"
+#include "ecclesia/magent/lib/nvme/smart_log_page.h"
+
+namespace ecclesia {
+
+// The SMART fields which are recorded in the history.
+enum class SmartField : int {
+  kCriticalWarning = 0,
+  kCompositeTemperatureKelvins,
+  kAvailableSpare,
+  kAvailableSpareThreshold,
+  kPercentUsed,
+  kDataUnitsRead,
+  kDataUnitsWritten,
+  kHostReads,
+  kHostWrites,
+  kControllerBusyTimeMinutes,
+  kPowerCycles,
+  kPowerOnHours,
+  kUnsafeShutdowns,
+  kMediaErrors,
+  kNumErrLogEntries,
+  kWarningTempTimeMinutes,
+  kCriticalCompTimeMinutes,
+};
+inline constexpr int kNumSmartFields = 17;
+
+// The values of all the recorded SMART fields at a single point in time. The
+// 128-bit counters in the log page are truncated to 64 bits, which is far more
+// than any real device will ever reach.
+struct NvmeSmartSample {
+  // Extract a sample from a SMART log page.
+  static NvmeSmartSample FromSmartLog(absl::Time timestamp,
+                                      const SmartLogPageInterface &smart_log);
+
+  uint64_t value(SmartField field) const {
+    return values[static_cast<int>(field)];
+  }
+  void set_value(SmartField field, uint64_t value) {
+    values[static_cast<int>(field)] = value;
+  }
+
+  bool operator==(const NvmeSmartSample &other) const {
+    return timestamp == other.timestamp && values == other.values;
+  }
+  bool operator!=(const NvmeSmartSample &other) const {
+    return !(*this == other);
+  }
+
+  absl::Time timestamp;
+  std::array<uint64_t, kNumSmartFields> values = {};
+};
+
+// A fixed-size history of SMART samples for a single drive. Timestamps are
+// stored with microsecond precision. This class is thread-safe.
+class NvmeSmartHistory {
+ public:
+  // Summary of a single field over a range of samples.
+  struct FieldSummary {
+    size_t num_samples;
+    uint64_t min;
+    uint64_t max;
+    // The first and last values in the range, and when they were sampled.
+    uint64_t first;
+    uint64_t last;
+    absl::Time first_timestamp;
+    absl::Time last_timestamp;
+  };
+
+  // Construct a history which retains at least the given number of the most
+  // recent samples. Memory is reclaimed a block of samples at a time, so a few
+  // more samples than this may be retained.
+  explicit NvmeSmartHistory(size_t capacity);
+
+  NvmeSmartHistory(const NvmeSmartHistory &other) = delete;
+  NvmeSmartHistory &operator=(const NvmeSmartHistory &other) = delete;
+
+  ~NvmeSmartHistory();
+
+  // Append a new sample to the history, evicting the oldest samples if the
+  // history is full. Samples must be appended in timestamp order; a sample
+  // older than the latest one is rejected.
+  absl::Status Append(const NvmeSmartSample &sample);
+
+  // The number of samples currently retained.
+  size_t size() const;
+
+  // The number of bytes used to hold the encoded samples.
+  size_t EncodedBytes() const;
+
+  // Returns the most recent sample, if there is one.
+  absl::optional<NvmeSmartSample> Latest() const;
+
+  // Returns all of the samples with a timestamp in [start, end], oldest first.
+  std::vector<NvmeSmartSample> Range(absl::Time start, absl::Time end) const;
+
+  // Summarize a field over the samples with a timestamp in [start, end].
+  // Returns NotFound if there are no samples in the range.
+  absl::StatusOr<FieldSummary> Summarize(SmartField field, absl::Time start,
+                                         absl::Time end) const;
+
+  // Returns the average rate of change of a field, per second, between the
+  // first and last samples in [start, end]. Returns NotFound if there are
+  // fewer than two samples with distinct timestamps in the range.
+  absl::StatusOr<double> Rate(SmartField field, absl::Time start,
+                              absl::Time end) const;
+
+ private:
+  class Block;
+
+  // Call the given function for every sample with a timestamp in [start, end]
+  // in order, oldest first.
+  template <typename F>
+  void ForEachInRange(absl::Time start, absl::Time end, F func) const
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+
+  mutable absl::Mutex mutex_;
+  // The ring of blocks. The oldest block is at oldest_, and blocks are filled
+  // in order from there; only the newest block can be partially full.
+  std::vector<Block> blocks_ ABSL_GUARDED_BY(mutex_);
+  size_t oldest_ ABSL_GUARDED_BY(mutex_) = 0;
+  size_t num_used_ ABSL_GUARDED_BY(mutex_) = 0;
+  size_t size_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+// Samples the SMART log of a set of drives on a fixed interval and records
+// them into a history for each drive.
+class NvmeSmartHistorySampler {
+ public:
+  struct Options {
+    // How often to sample each drive.
+    absl::Duration interval = absl::Minutes(1);
+    // The number of samples to retain for each drive. The default is one day
+    // at the default interval.
+    size_t capacity = 24 * 60;
+    // The clock used to timestamp samples.
+    Clock *clock = Clock::RealClock();
+  };
+
+  NvmeSmartHistorySampler();
+  explicit NvmeSmartHistorySampler(const Options &options);
+
+  // The sampler can own a thread, so it cannot be copied.
+  NvmeSmartHistorySampler(const NvmeSmartHistorySampler &other) = delete;
+  NvmeSmartHistorySampler &operator=(const NvmeSmartHistorySampler &other) =
+      delete;
+
+  // Stops the background thread, if it was started.
+  ~NvmeSmartHistorySampler();
+
+  // Add a drive to be sampled. Returns the history the samples will be
+  // recorded in, which remains valid for the lifetime of the sampler.
+  const NvmeSmartHistory *AddDrive(
+      std::string name, std::unique_ptr<NvmeDeviceInterface> device);
+
+  // Look up the history for the drive with the given name. Returns null if
+  // there is no such drive.
+  const NvmeSmartHistory *GetHistory(absl::string_view name) const;
+
+  // Sample every drive once. Returns the status of each sample, in the order
+  // the drives were added. This can be used to drive the sampler directly,
+  // instead of using a background thread.
+  std::vector<absl::Status> SampleAll();
+
+  // Start a background thread which samples all of the drives on the
+  // configured interval until the sampler is destroyed. Must be called at
+  // most once.
+  void Start();
+
+ private:
+  struct Drive;
+
+  // Sample a single drive and record it in its history.
+  absl::Status SampleDrive(Drive *drive);
+
+  const Options options_;
+
+  mutable absl::Mutex mutex_;
+  std::vector<std::unique_ptr<Drive>> drives_ ABSL_GUARDED_BY(mutex_);
+
+  absl::Notification stop_;
+  std::thread thread_;
+};
+
+}  // namespace ecclesia
+
+#endif  // ECCLESIA_MAGENT_LIB_NVME_NVME_SMART_HISTORY_H_
@@ -0,0 +1,249 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/lib/nvme/nvme_smart_history.h"
+
+#include <linux/nvme_ioctl.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/time/time.h"
+#include "ecclesia/lib/codec/endian.h"
+#include "ecclesia/lib/testing/status.h"
+#include "ecclesia/lib/time/clock_fake.h"
+#include "ecclesia/magent/lib/nvme/mock_nvme_device.h"
+#include "ecclesia/magent/lib/nvme/nvme_device.h"
+#include "ecclesia/magent/lib/nvme/nvme_types.h"
+
+namespace ecclesia {
+namespace {
+
+using ::testing::_;
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+using ::testing::HasSubstr;
+using ::testing::Not;
+using ::testing::SizeIs;
+
+const absl::Time kStart = absl::FromUnixSeconds(1600000000);
+
+// Construct a sample from a drive that is being written to at a steady rate,
+// with a temperature that goes up and down.
+NvmeSmartSample MakeSample(int i) {
+  NvmeSmartSample sample;
+  sample.timestamp = kStart + absl::Minutes(i);
+  sample.set_value(SmartField::kCompositeTemperatureKelvins,
+                   310 + (i % 10 < 5 ? i % 10 : 10 - i % 10));
+  sample.set_value(SmartField::kAvailableSpare, 100);
+  sample.set_value(SmartField::kAvailableSpareThreshold, 10);
+  sample.set_value(SmartField::kDataUnitsWritten, 1000000 + 60 * i);
+  sample.set_value(SmartField::kHostWrites, 5000000 + 600 * i);
+  sample.set_value(SmartField::kPowerOnHours, 400 + i / 60);
+  sample.set_value(SmartField::kPowerCycles, 4);
+  return sample;
+}
+
+TEST(NvmeSmartHistoryTest, EmptyHistory) {
+  NvmeSmartHistory history(10);
+  EXPECT_EQ(history.size(), 0);
+  EXPECT_EQ(history.Latest(), absl::nullopt);
+  EXPECT_THAT(history.Range(absl::InfinitePast(), absl::InfiniteFuture()),
+              SizeIs(0));
+  EXPECT_TRUE(absl::IsNotFound(
+      history
+          .Summarize(SmartField::kPercentUsed, absl::InfinitePast(),
+                     absl::InfiniteFuture())
+          .status()));
+}
+
+TEST(NvmeSmartHistoryTest, SamplesRoundTrip) {
+  NvmeSmartHistory history(1000);
+  std::vector<NvmeSmartSample> expected;
+  for (int i = 0; i < 500; ++i) {
+    NvmeSmartSample sample = MakeSample(i);
+    // Make the sampling interval irregular, and have a counter which wraps.
+    sample.timestamp += absl::Milliseconds((i * 7919) % 1000);
+    sample.set_value(SmartField::kMediaErrors, UINT64_MAX - 250 + i);
+    ASSERT_THAT(history.Append(sample), IsOk());
+    expected.push_back(sample);
+  }
+
+  EXPECT_EQ(history.size(), 500);
+  EXPECT_EQ(history.Latest(), expected.back());
+  EXPECT_THAT(history.Range(absl::InfinitePast(), absl::InfiniteFuture()),
+              ElementsAreArray(expected));
+}
+
+TEST(NvmeSmartHistoryTest, TimestampsAreTruncatedToMicroseconds) {
+  NvmeSmartHistory history(10);
+  NvmeSmartSample sample = MakeSample(0);
+  sample.timestamp += absl::Nanoseconds(1500);
+  ASSERT_THAT(history.Append(sample), IsOk());
+  EXPECT_EQ(history.Latest()->timestamp, kStart + absl::Microseconds(1));
+}
+
+TEST(NvmeSmartHistoryTest, RejectsOutOfOrderSamples) {
+  NvmeSmartHistory history(10);
+  ASSERT_THAT(history.Append(MakeSample(5)), IsOk());
+  EXPECT_TRUE(absl::IsInvalidArgument(history.Append(MakeSample(4))));
+  // Samples with the same timestamp are allowed.
+  EXPECT_THAT(history.Append(MakeSample(5)), IsOk());
+  EXPECT_EQ(history.size(), 2);
+}
+
+TEST(NvmeSmartHistoryTest, EvictsOldestSamples) {
+  NvmeSmartHistory history(100);
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_THAT(history.Append(MakeSample(i)), IsOk());
+  }
+
+  // At least the most recent 100 samples are retained, and the history is
+  // not allowed to grow without bound.
+  size_t size = history.size();
+  EXPECT_GE(size, 100);
+  EXPECT_LT(size, 200);
+  std::vector<NvmeSmartSample> expected;
+  for (int i = 1000 - size; i < 1000; ++i) expected.push_back(MakeSample(i));
+  EXPECT_THAT(history.Range(absl::InfinitePast(), absl::InfiniteFuture()),
+              ElementsAreArray(expected));
+}
+
+TEST(NvmeSmartHistoryTest, StaticCountersAreCompact) {
+  NvmeSmartHistory history(1000);
+  NvmeSmartSample sample = MakeSample(0);
+  for (int i = 0; i < 1000; ++i) {
+    sample.timestamp = kStart + absl::Minutes(i);
+    sample.set_value(SmartField::kDataUnitsWritten, 1000000 + 60 * i);
+    ASSERT_THAT(history.Append(sample), IsOk());
+  }
+  // Each sample only changes its timestamp by the usual interval and one
+  // counter by a small amount, which should need only a few bytes.
+  EXPECT_LT(history.EncodedBytes(), 1000 * sizeof(NvmeSmartSample) / 10);
+}
+
+TEST(NvmeSmartHistoryTest, RangeQueries) {
+  NvmeSmartHistory history(1000);
+  for (int i = 0; i < 300; ++i) {
+    ASSERT_THAT(history.Append(MakeSample(i)), IsOk());
+  }
+
+  EXPECT_THAT(history.Range(kStart + absl::Minutes(100),
+                            kStart + absl::Minutes(102)),
+              ElementsAre(MakeSample(100), MakeSample(101), MakeSample(102)));
+  EXPECT_THAT(history.Range(kStart - absl::Hours(1), kStart - absl::Minutes(1)),
+              SizeIs(0));
+  EXPECT_THAT(history.Range(kStart + absl::Hours(10), absl::InfiniteFuture()),
+              SizeIs(0));
+
+  auto maybe_summary =
+      history.Summarize(SmartField::kCompositeTemperatureKelvins,
+                        kStart + absl::Minutes(10), kStart + absl::Minutes(19));
+  ASSERT_THAT(maybe_summary, IsOk());
+  EXPECT_EQ(maybe_summary->num_samples, 10);
+  EXPECT_EQ(maybe_summary->min, 310);
+  EXPECT_EQ(maybe_summary->max, 315);
+  EXPECT_EQ(maybe_summary->first, 310);
+  EXPECT_EQ(maybe_summary->last, 311);
+  EXPECT_EQ(maybe_summary->first_timestamp, kStart + absl::Minutes(10));
+  EXPECT_EQ(maybe_summary->last_timestamp, kStart + absl::Minutes(19));
+}
+
+TEST(NvmeSmartHistoryTest, Rates) {
+  NvmeSmartHistory history(1000);
+  for (int i = 0; i < 300; ++i) {
+    ASSERT_THAT(history.Append(MakeSample(i)), IsOk());
+  }
+
+  // 60 data units are written every minute.
+  EXPECT_THAT(history.Rate(SmartField::kDataUnitsWritten, kStart,
+                           kStart + absl::Hours(1)),
+              IsOkAndHolds(1.0));
+  EXPECT_THAT(history.Rate(SmartField::kPowerCycles, absl::InfinitePast(),
+                           absl::InfiniteFuture()),
+              IsOkAndHolds(0.0));
+  // A single sample is not enough to compute a rate.
+  EXPECT_TRUE(absl::IsNotFound(
+      history.Rate(SmartField::kDataUnitsWritten, kStart, kStart).status()));
+}
+
+// Fill in the SMART log page for a GetLogPage command with the given
+// temperature and number of data units written.
+absl::Status FillSmartLog(nvme_passthru_cmd *cmd, uint16_t temperature,
+                          uint64_t data_units_written) {
+  SmartLogPageFormat *page = reinterpret_cast<SmartLogPageFormat *>(cmd->addr);
+  LittleEndian::Store16(temperature, page->temperature);
+  LittleEndian::Store64(data_units_written, page->data_units_written);
+  return absl::OkStatus();
+}
+
+TEST(NvmeSmartHistorySamplerTest, SamplesDrives) {
+  FakeClock clock(kStart);
+  NvmeSmartHistorySampler sampler(
+      {.interval = absl::Minutes(1), .capacity = 100, .clock = &clock});
+
+  auto access = absl::make_unique<MockNvmeAccessInterface>();
+  uint64_t data_units_written = 1000;
+  EXPECT_CALL(*access, ExecuteAdminCommand(_))
+      .WillRepeatedly([&](nvme_passthru_cmd *cmd) {
+        data_units_written += 60;
+        return FillSmartLog(cmd, 320, data_units_written);
+      });
+  const NvmeSmartHistory *history =
+      sampler.AddDrive("nvme0", CreateNvmeDevice(std::move(access)));
+  EXPECT_EQ(sampler.GetHistory("nvme0"), history);
+  EXPECT_EQ(sampler.GetHistory("nvme1"), nullptr);
+
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_THAT(sampler.SampleAll(), ElementsAre(IsOk()));
+    clock.AdvanceTime(absl::Minutes(1));
+  }
+
+  ASSERT_EQ(history->size(), 10);
+  absl::optional<NvmeSmartSample> latest = history->Latest();
+  ASSERT_TRUE(latest.has_value());
+  EXPECT_EQ(latest->timestamp, kStart + absl::Minutes(9));
+  EXPECT_EQ(latest->value(SmartField::kCompositeTemperatureKelvins), 320);
+  EXPECT_EQ(latest->value(SmartField::kDataUnitsWritten), 1600);
+  EXPECT_THAT(history->Rate(SmartField::kDataUnitsWritten,
+                            absl::InfinitePast(), absl::InfiniteFuture()),
+              IsOkAndHolds(1.0));
+}
+
+TEST(NvmeSmartHistorySamplerTest, FailedSamplesAreReported) {
+  FakeClock clock(kStart);
+  NvmeSmartHistorySampler sampler({.clock = &clock});
+
+  auto drive = absl::make_unique<MockNvmeDevice>();
+  EXPECT_CALL(*drive, SmartLog()).WillOnce([]() {
+    return absl::InternalError("no smart log");
+  });
+  const NvmeSmartHistory *history = sampler.AddDrive("nvme3", std::move(drive));
+
+  std::vector<absl::Status> results = sampler.SampleAll();
+  ASSERT_THAT(results, SizeIs(1));
+  EXPECT_THAT(results[0], Not(IsOk()));
+  EXPECT_THAT(results[0].message(), HasSubstr("nvme3"));
+  EXPECT_EQ(history->size(), 0);
+}
+
+}  // namespace
+}  // namespace ecclesia
@@ -0,0 +1,178 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/lib/nvme/nvme_telemetry.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "ecclesia/lib/cache/rcu_snapshot.h"
+#include "ecclesia/magent/lib/nvme/nvme_device.h"
+#include "ecclesia/magent/lib/thread_pool/thread_pool.h"
+
+namespace ecclesia {
+
+// A drive that has been added to the collector. The drive is shared with any
+// reads that are in flight, so that a read which outlives its collection (or
+// the collector itself) can still finish safely.
+struct NvmeTelemetryCollector::Drive {
+  Drive(std::string name_in, std::unique_ptr<NvmeDeviceInterface> device_in)
+      : name(std::move(name_in)), device(std::move(device_in)) {}
+
+  const std::string name;
+  const std::unique_ptr<NvmeDeviceInterface> device;
+
+  absl::Mutex mutex;
+  // Indicates if a read from the drive is currently in flight.
+  bool busy ABSL_GUARDED_BY(mutex) = false;
+};
+
+// The results of reading from a single drive. This is shared between the read
+// and the collection waiting for it, since the collection can give up waiting.
+struct NvmeTelemetryCollector::PendingRead {
+  absl::Mutex mutex;
+  bool done ABSL_GUARDED_BY(mutex) = false;
+  NvmeDriveTelemetry telemetry ABSL_GUARDED_BY(mutex);
+};
+
+namespace {
+
+// Read all of the logs from a drive. Once the deadline has passed no one is
+// waiting for the results, so the remaining logs are skipped rather than
+// issuing more commands to a drive that is already slow.
+NvmeDriveTelemetry ReadDriveLogs(const NvmeDeviceInterface &device,
+                                 absl::Time deadline) {
+  static constexpr char kSkipped[] = "skipped after the drive deadline passed";
+
+  NvmeDriveTelemetry telemetry;
+  telemetry.timestamp = absl::Now();
+  telemetry.smart_log = device.SmartLog();
+  if (absl::Now() >= deadline) {
+    telemetry.error_information = absl::DeadlineExceededError(kSkipped);
+  } else {
+    telemetry.error_information = device.ErrorInformation();
+  }
+  if (absl::Now() >= deadline) {
+    telemetry.firmware_slot_info = absl::DeadlineExceededError(kSkipped);
+  } else {
+    telemetry.firmware_slot_info = device.FirmwareSlotInformation();
+  }
+  if (absl::Now() >= deadline) {
+    telemetry.self_test_log = absl::DeadlineExceededError(kSkipped);
+  } else {
+    telemetry.self_test_log = device.GetDeviceSelfTestLog();
+  }
+  return telemetry;
+}
+
+}  // namespace
+
+NvmeTelemetryCollector::NvmeTelemetryCollector()
+    : NvmeTelemetryCollector(Options()) {}
+
+NvmeTelemetryCollector::NvmeTelemetryCollector(const Options &options)
+    : options_(options),
+      pool_(absl::make_unique<ThreadPool>(
+          std::max(options.max_parallelism, 1))) {}
+
+NvmeTelemetryCollector::~NvmeTelemetryCollector() = default;
+
+void NvmeTelemetryCollector::AddDrive(
+    std::string name, std::unique_ptr<NvmeDeviceInterface> device) {
+  absl::MutexLock ml(&drives_mutex_);
+  drives_.push_back(std::make_shared<Drive>(std::move(name), std::move(device)));
+}
+
+RcuSnapshot<NvmeFleetTelemetry> NvmeTelemetryCollector::Collect() {
+  absl::MutexLock cl(&collect_mutex_);
+
+  std::vector<std::shared_ptr<Drive>> drives;
+  {
+    absl::MutexLock ml(&drives_mutex_);
+    drives = drives_;
+  }
+
+  NvmeFleetTelemetry fleet;
+  fleet.timestamp = absl::Now();
+  const absl::Time deadline = fleet.timestamp + options_.drive_deadline;
+
+  // Start a read on every drive that isn't still busy.
+  std::vector<std::shared_ptr<PendingRead>> reads(drives.size());
+  for (size_t i = 0; i < drives.size(); ++i) {
+    std::shared_ptr<Drive> drive = drives[i];
+    {
+      absl::MutexLock ml(&drive->mutex);
+      if (drive->busy) continue;
+      drive->busy = true;
+    }
+    auto read = std::make_shared<PendingRead>();
+    reads[i] = read;
+    pool_->Schedule([drive, read, deadline]() {
+      NvmeDriveTelemetry telemetry = ReadDriveLogs(*drive->device, deadline);
+      {
+        absl::MutexLock ml(&read->mutex);
+        read->telemetry = std::move(telemetry);
+        read->done = true;
+      }
+      absl::MutexLock ml(&drive->mutex);
+      drive->busy = false;
+    });
+  }
+
+  // Gather up the results, giving up on any drive that misses the deadline.
+  fleet.drives.reserve(drives.size());
+  for (size_t i = 0; i < drives.size(); ++i) {
+    NvmeDriveTelemetry telemetry;
+    if (!reads[i]) {
+      telemetry.status = absl::UnavailableError(absl::StrFormat(
+          "drive %s is still busy with an earlier collection",
+          drives[i]->name));
+    } else {
+      PendingRead &read = *reads[i];
+      absl::MutexLock ml(&read.mutex);
+      if (read.mutex.AwaitWithDeadline(absl::Condition(&read.done),
+                                       deadline)) {
+        telemetry = std::move(read.telemetry);
+      } else {
+        telemetry.status = absl::DeadlineExceededError(
+            absl::StrFormat("drive %s did not respond within %s",
+                            drives[i]->name,
+                            absl::FormatDuration(options_.drive_deadline)));
+      }
+    }
+    telemetry.name = drives[i]->name;
+    fleet.drives.push_back(std::move(telemetry));
+  }
+
+  store_.Update(std::move(fleet));
+  return store_.Read();
+}
+
+RcuSnapshot<NvmeFleetTelemetry> NvmeTelemetryCollector::Read() const {
+  return store_.Read();
+}
+
+}  // namespace ecclesia
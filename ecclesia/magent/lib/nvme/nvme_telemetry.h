@@ -0,0 +1,136 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This library provides support for collecting the health logs from many NVMe
+// drives at once. Reading the logs from one drive at a time means that the
+// whole collection is only as fast as the sum of all the drives, and a single
+// drive that stops responding will block the collection forever.
+//
+// The collector instead reads the logs from all of its drives in parallel,
+// and gives each drive a deadline to finish by. Drives which miss the deadline
+// are reported with an error and the collection continues without them. The
+// results of each collection are published as a snapshot which readers can
+// hold on to without blocking future collections.
+
+#ifndef ECCLESIA_MAGENT_LIB_NVME_NVME_TELEMETRY_H_
+#define ECCLESIA_MAGENT_LIB_NVME_NVME_TELEMETRY_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "ecclesia/lib/cache/rcu_snapshot.h"
+#include "ecclesia/lib/cache/rcu_store.h"
+#include "ecclesia/lib/cache/rcu_view.h"
+#include "ecclesia/magent/lib/nvme/device_self_test_log.h"
+#include "ecclesia/magent/lib/nvme/firmware_slot_info.h"
+#include "ecclesia/magent/lib/nvme/nvme_device.h"
+#include "ecclesia/magent/lib/nvme/nvme_types.h"
+#include "ecclesia/magent/lib/nvme/smart_log_page.h"
+#include "ecclesia/magent/lib/thread_pool/thread_pool.h"
+
+namespace ecclesia {
+
+// The logs collected from a single drive. Each log has its own status, so that
+// a failure to read one log does not prevent the others from being reported.
+struct NvmeDriveTelemetry {
+  // The name the drive was added to the collector with.
+  std::string name;
+  // The status of the collection as a whole. This is DeadlineExceeded if the
+  // drive did not finish before its deadline, in which case none of the logs
+  // will be populated.
+  absl::Status status;
+  // The time the logs were collected.
+  absl::Time timestamp;
+
+  absl::StatusOr<std::unique_ptr<SmartLogPageInterface>> smart_log =
+      absl::UnknownError("not collected");
+  absl::StatusOr<std::vector<ErrorLogInfoEntry>> error_information =
+      absl::UnknownError("not collected");
+  absl::StatusOr<std::unique_ptr<FirmwareSlotInfo>> firmware_slot_info =
+      absl::UnknownError("not collected");
+  absl::StatusOr<std::unique_ptr<DeviceSelfTestLog>> self_test_log =
+      absl::UnknownError("not collected");
+};
+
+// The logs collected from every drive, in the order the drives were added.
+struct NvmeFleetTelemetry {
+  absl::Time timestamp;
+  std::vector<NvmeDriveTelemetry> drives;
+};
+
+class NvmeTelemetryCollector : public RcuView<NvmeFleetTelemetry> {
+ public:
+  struct Options {
+    // How long each drive has to return all of its logs, measured from the
+    // start of the collection.
+    absl::Duration drive_deadline = absl::Seconds(10);
+    // The maximum number of drives that will be read from at once.
+    int max_parallelism = 32;
+  };
+
+  NvmeTelemetryCollector();
+  explicit NvmeTelemetryCollector(const Options &options);
+
+  // Destroying the collector waits for any reads that are still in flight,
+  // including reads from drives which missed their deadline.
+  ~NvmeTelemetryCollector() override;
+
+  NvmeTelemetryCollector(const NvmeTelemetryCollector &other) = delete;
+  NvmeTelemetryCollector &operator=(const NvmeTelemetryCollector &other) =
+      delete;
+
+  // Add a drive to be included in future collections.
+  void AddDrive(std::string name, std::unique_ptr<NvmeDeviceInterface> device);
+
+  // Collect the logs from all drives and publish them as a new snapshot. This
+  // returns once every drive has either finished or passed its deadline.
+  //
+  // A drive which is still busy with the reads from an earlier collection is
+  // not read from again until they complete; it is reported as Unavailable.
+  RcuSnapshot<NvmeFleetTelemetry> Collect();
+
+  // Returns the most recently published snapshot. Before the first collection
+  // this is a snapshot with no drives.
+  RcuSnapshot<NvmeFleetTelemetry> Read() const override;
+
+ private:
+  struct Drive;
+  struct PendingRead;
+
+  const Options options_;
+
+  // Serializes collections.
+  absl::Mutex collect_mutex_;
+
+  absl::Mutex drives_mutex_;
+  std::vector<std::shared_ptr<Drive>> drives_ ABSL_GUARDED_BY(drives_mutex_);
+
+  RcuStore<NvmeFleetTelemetry> store_;
+
+  // Declared last so that it is destroyed, and waits for any in flight reads,
+  // before the rest of the collector.
+  std::unique_ptr<ThreadPool> pool_;
+};
+
+}  // namespace ecclesia
+
+#endif  // ECCLESIA_MAGENT_LIB_NVME_NVME_TELEMETRY_H_
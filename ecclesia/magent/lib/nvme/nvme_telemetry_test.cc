@@ -0,0 +1,133 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/lib/nvme/nvme_telemetry.h"
+
+#include <memory>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "ecclesia/lib/testing/status.h"
+#include "ecclesia/magent/lib/nvme/mock_nvme_device.h"
+#include "ecclesia/magent/lib/nvme/nvme_types.h"
+
+namespace ecclesia {
+namespace {
+
+using ::testing::Return;
+using ::testing::SizeIs;
+
+// Create a drive which successfully returns its error log, with a single entry
+// whose error count is the given value. All of the other logs fail.
+std::unique_ptr<MockNvmeDevice> MakeDrive(uint64_t error_count) {
+  auto drive = absl::make_unique<MockNvmeDevice>();
+  ErrorLogInfoEntry entry = {};
+  entry.error_count = error_count;
+  // The results of these logs can't be copied, so they can't use Return.
+  EXPECT_CALL(*drive, SmartLog()).WillRepeatedly([]() {
+    return absl::InternalError("no smart log");
+  });
+  EXPECT_CALL(*drive, ErrorInformation())
+      .WillRepeatedly(Return(std::vector<ErrorLogInfoEntry>{entry}));
+  EXPECT_CALL(*drive, FirmwareSlotInformation()).WillRepeatedly([]() {
+    return absl::NotFoundError("no firmware slots");
+  });
+  EXPECT_CALL(*drive, GetDeviceSelfTestLog()).WillRepeatedly([]() {
+    return absl::NotFoundError("no self test log");
+  });
+  return drive;
+}
+
+TEST(NvmeTelemetryCollectorTest, EmptyBeforeFirstCollection) {
+  NvmeTelemetryCollector collector;
+  collector.AddDrive("nvme0", MakeDrive(1));
+
+  EXPECT_THAT(collector.Read()->drives, SizeIs(0));
+}
+
+TEST(NvmeTelemetryCollectorTest, CollectsAllDrives) {
+  NvmeTelemetryCollector collector;
+  collector.AddDrive("nvme0", MakeDrive(1));
+  collector.AddDrive("nvme1", MakeDrive(2));
+
+  auto telemetry = collector.Collect();
+  ASSERT_THAT(telemetry->drives, SizeIs(2));
+  for (int i = 0; i < 2; ++i) {
+    const NvmeDriveTelemetry &drive = telemetry->drives[i];
+    EXPECT_THAT(drive.status, IsOk());
+    EXPECT_FALSE(drive.smart_log.ok());
+    ASSERT_THAT(drive.error_information, IsOk());
+    ASSERT_THAT(*drive.error_information, SizeIs(1));
+    EXPECT_EQ((*drive.error_information)[0].error_count, i + 1);
+    EXPECT_TRUE(absl::IsNotFound(drive.firmware_slot_info.status()));
+    EXPECT_TRUE(absl::IsNotFound(drive.self_test_log.status()));
+  }
+  EXPECT_EQ(telemetry->drives[0].name, "nvme0");
+  EXPECT_EQ(telemetry->drives[1].name, "nvme1");
+
+  // A new collection replaces the previous snapshot.
+  auto new_telemetry = collector.Collect();
+  EXPECT_FALSE(telemetry.IsFresh());
+  EXPECT_TRUE(new_telemetry.IsFresh());
+  EXPECT_THAT(collector.Read()->drives, SizeIs(2));
+}
+
+TEST(NvmeTelemetryCollectorTest, WedgedDriveDoesNotStallOthers) {
+  absl::Notification unwedge;
+  NvmeTelemetryCollector collector({.drive_deadline = absl::Milliseconds(100),
+                                    .max_parallelism = 4});
+  auto wedged = MakeDrive(1);
+  EXPECT_CALL(*wedged, SmartLog()).WillRepeatedly([&unwedge]() {
+    unwedge.WaitForNotification();
+    return absl::InternalError("no smart log");
+  });
+  collector.AddDrive("nvme0", std::move(wedged));
+  collector.AddDrive("nvme1", MakeDrive(2));
+
+  // The wedged drive misses its deadline, but the other drive is reported.
+  auto telemetry = collector.Collect();
+  ASSERT_THAT(telemetry->drives, SizeIs(2));
+  EXPECT_EQ(telemetry->drives[0].status.code(),
+            absl::StatusCode::kDeadlineExceeded);
+  EXPECT_THAT(telemetry->drives[1].status, IsOk());
+  EXPECT_THAT(telemetry->drives[1].error_information, IsOk());
+
+  // While the drive is still wedged, it is not read from again.
+  telemetry = collector.Collect();
+  ASSERT_THAT(telemetry->drives, SizeIs(2));
+  EXPECT_EQ(telemetry->drives[0].status.code(), absl::StatusCode::kUnavailable);
+  EXPECT_THAT(telemetry->drives[1].status, IsOk());
+
+  // Once it recovers it is included in collections again. The read that was
+  // abandoned may take a moment to finish up.
+  unwedge.Notify();
+  absl::Time give_up = absl::Now() + absl::Seconds(10);
+  do {
+    telemetry = collector.Collect();
+    ASSERT_THAT(telemetry->drives, SizeIs(2));
+  } while (!telemetry->drives[0].status.ok() && absl::Now() < give_up);
+  EXPECT_THAT(telemetry->drives[0].status, IsOk());
+  EXPECT_THAT(telemetry->drives[0].error_information, IsOk());
+}
+
+}  // namespace
+}  // namespace ecclesia
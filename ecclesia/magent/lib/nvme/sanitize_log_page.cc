@@ -19,26 +19,35 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "ecclesia/lib/codec/endian.h"
+#include "ecclesia/magent/lib/nvme/nvme_buffer_pool.h"
 #include "ecclesia/magent/lib/nvme/nvme_types.h"
 
 namespace ecclesia {
 
 absl::StatusOr<std::unique_ptr<SanitizeLogPageInterface>>
 SanitizeLogPage::Parse(const std::string &buf) {
+  return Parse(NvmeBufferLease::Copy(buf));
+}
+
+absl::StatusOr<std::unique_ptr<SanitizeLogPageInterface>>
+SanitizeLogPage::Parse(NvmeBufferLease buf) {
   if (buf.size() != kSanitizeLogPageSize) {
     return absl::InternalError(
         "The sanitize log page size must be equal to kSanitizeLogPageSize.");
   }
-  return std::unique_ptr<SanitizeLogPageInterface>(new SanitizeLogPage(buf));
+  return std::unique_ptr<SanitizeLogPageInterface>(
+      new SanitizeLogPage(std::move(buf)));
 }
 
-SanitizeLogPage::SanitizeLogPage(const std::string &buf)
-    : data_(buf),
-      sanitize_log_(reinterpret_cast<SanitizeLogPageFormat *>(&data_[0])) {}
+SanitizeLogPage::SanitizeLogPage(NvmeBufferLease buf)
+    : data_(std::move(buf)),
+      sanitize_log_(
+          reinterpret_cast<const SanitizeLogPageFormat *>(data_.data())) {}
 
 uint16_t SanitizeLogPage::progress() const {
   return LittleEndian::Load16(
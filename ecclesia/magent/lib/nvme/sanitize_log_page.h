@@ -22,6 +22,7 @@
 #include <string>
 
 #include "absl/status/statusor.h"
+#include "ecclesia/magent/lib/nvme/nvme_buffer_pool.h"
 
 namespace ecclesia {
 
@@ -87,6 +88,8 @@ class SanitizeLogPage : public SanitizeLogPageInterface {
   //   buf: Data buffer returned from Sanitize Status Log Page read request
   static absl::StatusOr<std::unique_ptr<SanitizeLogPageInterface>> Parse(
       const std::string &buf);
+  static absl::StatusOr<std::unique_ptr<SanitizeLogPageInterface>> Parse(
+      NvmeBufferLease buf);
 
   SanitizeLogPage(const SanitizeLogPage &) = delete;
   SanitizeLogPage &operator=(const SanitizeLogPage &) = delete;
@@ -107,10 +110,10 @@ class SanitizeLogPage : public SanitizeLogPageInterface {
   uint32_t estimate_crypto_erase_time() const override;
 
  protected:
-  explicit SanitizeLogPage(const std::string &buf);
+  explicit SanitizeLogPage(NvmeBufferLease buf);
 
  private:
-  std::string data_;
+  NvmeBufferLease data_;
   const SanitizeLogPageFormat *const sanitize_log_;
 };
 
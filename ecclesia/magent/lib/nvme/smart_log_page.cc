@@ -21,9 +21,14 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "absl/numeric/int128.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
 #include "ecclesia/lib/codec/endian.h"
+#include "ecclesia/magent/lib/nvme/nvme_buffer_pool.h"
 #include "ecclesia/magent/lib/nvme/nvme_types.h"
 
 namespace ecclesia {
@@ -31,12 +36,27 @@ namespace ecclesia {
 std::unique_ptr<SmartLogPageInterface> SmartLogPage::Parse(
     const std::string &buf) {
   if (buf.size() != kSmartLogPageSize) return nullptr;
-  return std::unique_ptr<SmartLogPage>(new SmartLogPage(buf));
+  return Parse(NvmeBufferLease::Copy(buf));
 }
 
-SmartLogPage::SmartLogPage(const std::string &buf)
-    : data_(buf),
-      smart_log_(reinterpret_cast<SmartLogPageFormat *>(&data_[0])) {}
+std::unique_ptr<SmartLogPageInterface> SmartLogPage::Parse(
+    NvmeBufferLease buf) {
+  if (buf.size() != kSmartLogPageSize) return nullptr;
+  return std::unique_ptr<SmartLogPage>(new SmartLogPage(std::move(buf)));
+}
+
+absl::StatusOr<SmartLogPage> SmartLogPage::ParseView(NvmeBufferLease buf) {
+  if (buf.size() != kSmartLogPageSize) {
+    return absl::InternalError(absl::StrFormat(
+        "smart log page has size %d, expected %d", buf.size(),
+        kSmartLogPageSize));
+  }
+  return SmartLogPage(std::move(buf));
+}
+
+SmartLogPage::SmartLogPage(NvmeBufferLease buf)
+    : data_(std::move(buf)),
+      smart_log_(reinterpret_cast<const SmartLogPageFormat *>(data_.data())) {}
 
 uint8_t SmartLogPage::critical_warning() const {
   return smart_log_->critical_warning;
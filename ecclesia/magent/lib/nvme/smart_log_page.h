@@ -22,6 +22,8 @@
 #include <string>
 
 #include "absl/numeric/int128.h"
+#include "absl/status/statusor.h"
+#include "ecclesia/magent/lib/nvme/nvme_buffer_pool.h"
 
 namespace ecclesia {
 
@@ -73,9 +75,20 @@ class SmartLogPage : public SmartLogPageInterface {
   // Arguments:
   //   buf: Data buffer returned from SMART Log Page read request
   static std::unique_ptr<SmartLogPageInterface> Parse(const std::string &buf);
+  static std::unique_ptr<SmartLogPageInterface> Parse(NvmeBufferLease buf);
+
+  // Parse a leased buffer into a SmartLogPage value which views the data in
+  // place. Unlike Parse this does no allocation, which makes it suitable for
+  // polling the log page of many devices.
+  static absl::StatusOr<SmartLogPage> ParseView(NvmeBufferLease buf);
 
   SmartLogPage(const SmartLogPage &) = delete;
   SmartLogPage &operator=(const SmartLogPage &) = delete;
+
+  // Moving the page does not move the underlying buffer, so views into it
+  // remain valid.
+  SmartLogPage(SmartLogPage &&) = default;
+
   uint8_t critical_warning() const override;
   uint16_t composite_temperature_kelvins() const override;
   uint8_t available_spare() const override;
@@ -99,10 +112,10 @@ class SmartLogPage : public SmartLogPageInterface {
   uint32_t thermal_transition_minutes(int limit) const override;
 
  protected:
-  explicit SmartLogPage(const std::string &buf);
+  explicit SmartLogPage(NvmeBufferLease buf);
 
  private:
-  std::string data_;
+  NvmeBufferLease data_;
   const SmartLogPageFormat *const smart_log_;
 };
 
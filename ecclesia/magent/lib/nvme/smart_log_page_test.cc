@@ -16,10 +16,15 @@
 
 #include "ecclesia/magent/lib/nvme/smart_log_page.h"
 
+#include <string.h>
+
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "gtest/gtest.h"
+#include "absl/status/statusor.h"
+#include "ecclesia/magent/lib/nvme/nvme_buffer_pool.h"
 
 namespace ecclesia {
 
@@ -133,4 +138,29 @@ TEST(SmartLogPageTest, ParseSmartData) {
   EXPECT_EQ(1, smart->unsafe_shutdowns());
 }
 
+TEST(SmartLogPageTest, ParseViewOfLeasedBuffer) {
+  auto pool = NvmeBufferPool::Create();
+  NvmeBufferLease buffer = pool->Lease(sizeof(kSmartLogData));
+  memcpy(buffer.data(), kSmartLogData, sizeof(kSmartLogData));
+
+  absl::StatusOr<SmartLogPage> smart =
+      SmartLogPage::ParseView(std::move(buffer));
+  ASSERT_TRUE(smart.ok());
+  EXPECT_EQ(314, smart->composite_temperature_kelvins());
+  EXPECT_EQ(408, smart->power_on_hours());
+
+  // The page should be a view of the leased buffer rather than a copy, and
+  // should keep viewing it after being moved.
+  SmartLogPage moved = std::move(*smart);
+  EXPECT_EQ(1027083, moved.host_reads());
+  EXPECT_EQ(pool->NumFreeBuffers(), 0);
+}
+
+TEST(SmartLogPageTest, ParseViewRejectsWrongSize) {
+  auto pool = NvmeBufferPool::Create();
+  EXPECT_FALSE(SmartLogPage::ParseView(pool->Lease(16)).ok());
+  // The rejected lease should still make it back to the pool.
+  EXPECT_EQ(pool->NumFreeBuffers(), 1);
+}
+
 }  // namespace ecclesia
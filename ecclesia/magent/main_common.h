@@ -29,6 +29,9 @@
 ABSL_FLAG(int, port, 3995, "Port number for the magent to listen on");
 ABSL_FLAG(std::string, assemblies_dir, "/etc/google/magent",
           "Path to a directory containing JSON Assemblies");
+ABSL_FLAG(bool, pretty_json, false,
+          "Indent Redfish responses to make them easier to read by hand. By "
+          "default responses are written without any whitespace.");
 
 namespace ecclesia {
 
@@ -15,6 +15,7 @@
  */
 
 // Redfish server for the Ecclesia Management Agent on Indus
+#include <cstdint>
 #include <cstdlib>
 #include <functional>
 #include <iostream>
@@ -29,8 +30,10 @@
 #include "absl/status/status.h"
 #include "absl/strings/match.h"
 #include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "ecclesia/lib/apifs/apifs.h"
@@ -38,6 +41,8 @@
 #include "ecclesia/lib/logging/logging.h"
 #include "ecclesia/lib/smbios/indus/platform_translator.h"
 #include "ecclesia/lib/types/fixed_range_int.h"
+#include "ecclesia/lib/uevent/invalidation_service.h"
+#include "ecclesia/lib/uevent/uevent.h"
 #include "ecclesia/magent/lib/eeprom/eeprom.h"
 #include "ecclesia/magent/lib/eeprom/smbus_eeprom.h"
 #include "ecclesia/magent/lib/io/pci_location.h"
@@ -46,6 +51,8 @@
 #include "ecclesia/magent/lib/ipmi/interface_options.h"
 #include "ecclesia/magent/lib/ipmi/ipmitool.h"
 #include "ecclesia/magent/main_common.h"
+#include "ecclesia/magent/redfish/core/json_writer.h"
+#include "ecclesia/magent/redfish/core/resource.h"
 #include "ecclesia/magent/redfish/indus/redfish_service.h"
 #include "ecclesia/magent/sysmodel/x86/fru.h"
 #include "ecclesia/magent/sysmodel/x86/sysmodel.h"
@@ -58,6 +65,19 @@ ABSL_FLAG(
     std::string, mobo_raw_fru_path, "",
     "Path to a file containing the raw EEPROM dump of the motherbord FRU. If "
     "left empty, magent will read the EEPROM directly via SMBUS.");
+ABSL_FLAG(std::string, ipmi_sdr_cache_path, "",
+          "Path to a file used to cache the BMC SDR repository across "
+          "restarts. If left empty, the repository is only cached in memory.");
+ABSL_FLAG(absl::Duration, fru_read_deadline, absl::Seconds(30),
+          "How long to spend reading FRUs in the background at startup. FRUs "
+          "which have not been read by then are reported as absent.");
+ABSL_FLAG(absl::Duration, sensor_sample_interval, absl::Seconds(5),
+          "How often to read the thermal sensors in the background. Requests "
+          "are served from the most recent readings.");
+ABSL_FLAG(std::string, sysmodel_snapshot_path, "",
+          "Path to a file used to save the system inventory, so that it can be "
+          "loaded quickly if magent restarts within the same boot. If left "
+          "empty, the inventory is always read from the hardware.");
 
 namespace {
 
@@ -209,7 +229,7 @@ int main(int argc, char** argv) {
         }));
   } else {
     fru_factories.push_back(ecclesia::SysmodelFruReaderFactory(
-        "motherboard",
+        "motherboard", "smbus",
         [&]() -> std::unique_ptr<ecclesia::SysmodelFruReaderIntf> {
           return absl::make_unique<ecclesia::SmbusEeprom2ByteAddrFruReader>(
               ecclesia::SmbusEeprom2ByteAddr::Option{
@@ -229,15 +249,40 @@ int main(int argc, char** argv) {
   }
 
   // Construct an IPMI interface to Sleipnir BMC and add FRUs if there is any.
-  ecclesia::Ipmitool ipmi(ecclesia::GetIpmiCredentialFromPb(kMagentConfigPath));
-  auto ipmi_frus = ipmi.GetAllFrus();
-  for (const auto& fru : ipmi_frus) {
-    fru_factories.push_back(ecclesia::SysmodelFruReaderFactory(
-        absl::StrCat("sleipnir_", fru.name),
-        [&]() -> std::unique_ptr<ecclesia::SysmodelFruReaderIntf> {
-          return absl::make_unique<ecclesia::IpmiSysmodelFruReader>(&ipmi,
-                                                                    fru.fru_id);
-        }));
+  // Listing the FRUs requires a round trip to the BMC, so it is done in the
+  // background along with the FRU reads rather than here.
+  ecclesia::Ipmitool ipmi(
+      ecclesia::GetIpmiCredentialFromPb(kMagentConfigPath),
+      {.cache_path = absl::GetFlag(FLAGS_ipmi_sdr_cache_path)});
+  std::vector<ecclesia::SysmodelFruDiscovery> fru_discoveries;
+  fru_discoveries.push_back(ecclesia::SysmodelFruDiscovery(
+      "ipmi", [&]() -> std::vector<ecclesia::SysmodelFruReaderFactory> {
+        std::vector<ecclesia::SysmodelFruReaderFactory> ipmi_factories;
+        for (const auto& fru : ipmi.GetAllFrus()) {
+          uint16_t fru_id = fru.fru_id;
+          ipmi_factories.push_back(ecclesia::SysmodelFruReaderFactory(
+              absl::StrCat("sleipnir_", fru.name), "ipmi",
+              [&ipmi, fru_id]()
+                  -> std::unique_ptr<ecclesia::SysmodelFruReaderIntf> {
+                return absl::make_unique<ecclesia::IpmiSysmodelFruReader>(
+                    &ipmi, fru_id);
+              }));
+        }
+        return ipmi_factories;
+      }));
+
+  // Invalidate the cached PCI and USB inventory when devices are hotplugged.
+  // Without the uevent socket the inventory is still served, but it is never
+  // rescanned.
+  std::unique_ptr<ecclesia::UeventInvalidationService> uevents;
+  if (auto maybe_source = ecclesia::NetlinkUeventSource::Create();
+      maybe_source.ok()) {
+    uevents = absl::make_unique<ecclesia::UeventInvalidationService>(
+        std::move(*maybe_source));
+    uevents->Start();
+  } else {
+    ecclesia::WarningLog() << "hotplug events are unavailable: "
+                           << maybe_source.status();
   }
 
   ecclesia::SysmodelParams params = {
@@ -248,17 +293,29 @@ int main(int argc, char** argv) {
       .mced_socket_path = absl::GetFlag(FLAGS_mced_socket_path),
       .sysfs_mem_file_path = kSysfsMemFilePath,
       .fru_factories = absl::MakeSpan(fru_factories),
+      .fru_discoveries = absl::MakeSpan(fru_discoveries),
+      .fru_deadline = absl::GetFlag(FLAGS_fru_read_deadline),
       .dimm_thermal_params = absl::MakeSpan(dimm_channel_info),
       .cpu_margin_params = absl::MakeSpan(cpu_margin_sensor_info),
+      .sensor_sample_interval = absl::GetFlag(FLAGS_sensor_sample_interval),
+      .snapshot_path = absl::GetFlag(FLAGS_sysmodel_snapshot_path),
+      .uevents = uevents.get(),
   };
 
   std::unique_ptr<ecclesia::SystemModel> system_model =
       absl::make_unique<ecclesia::SystemModel>(std::move(params));
 
+  if (absl::GetFlag(FLAGS_pretty_json)) {
+    ecclesia::SetJsonResponseStyle(ecclesia::JsonWriter::Style::kPretty);
+  }
   auto server = ecclesia::CreateServer(absl::GetFlag(FLAGS_port));
   ecclesia::IndusRedfishService redfish_service(
       server.get(), system_model.get(), absl::GetFlag(FLAGS_assemblies_dir));
 
+  // Only start serving once the system model has been fully initialized, so
+  // that no request ever sees a partially populated model.
+  system_model->WaitUntilReady();
+
   bool success = server->StartAcceptingRequests();
   if (server != nullptr && success) {
     server->WaitForTermination();
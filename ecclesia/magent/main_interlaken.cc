@@ -31,18 +31,24 @@
 #include "absl/strings/numbers.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "ecclesia/lib/apifs/apifs.h"
 #include "ecclesia/lib/io/ioctl.h"
+#include "ecclesia/lib/logging/logging.h"
 #include "ecclesia/lib/smbios/interlaken/platform_translator.h"
 #include "ecclesia/lib/types/fixed_range_int.h"
+#include "ecclesia/lib/uevent/invalidation_service.h"
+#include "ecclesia/lib/uevent/uevent.h"
 #include "ecclesia/magent/lib/eeprom/eeprom.h"
 #include "ecclesia/magent/lib/eeprom/smbus_eeprom.h"
 #include "ecclesia/magent/lib/io/pci_location.h"
 #include "ecclesia/magent/lib/io/smbus.h"
 #include "ecclesia/magent/lib/io/smbus_kernel_dev.h"
 #include "ecclesia/magent/main_common.h"
+#include "ecclesia/magent/redfish/core/json_writer.h"
+#include "ecclesia/magent/redfish/core/resource.h"
 #include "ecclesia/magent/redfish/interlaken/redfish_service.h"
 #include "ecclesia/magent/sysmodel/x86/fru.h"
 #include "ecclesia/magent/sysmodel/x86/sysmodel.h"
@@ -51,6 +57,13 @@
 
 ABSL_FLAG(std::string, mced_socket_path, "/var/run/mced2.socket",
           "Path to the mced unix domain socket");
+ABSL_FLAG(absl::Duration, sensor_sample_interval, absl::Seconds(5),
+          "How often to read the thermal sensors in the background. Requests "
+          "are served from the most recent readings.");
+ABSL_FLAG(std::string, sysmodel_snapshot_path, "",
+          "Path to a file used to save the system inventory, so that it can be "
+          "loaded quickly if magent restarts within the same boot. If left "
+          "empty, the inventory is always read from the hardware.");
 
 namespace {
 
@@ -212,6 +225,20 @@ int main(int argc, char **argv) {
                 }});
       }));
 
+  // Invalidate the cached PCI and USB inventory when devices are hotplugged.
+  // Without the uevent socket the inventory is still served, but it is never
+  // rescanned.
+  std::unique_ptr<ecclesia::UeventInvalidationService> uevents;
+  if (auto maybe_source = ecclesia::NetlinkUeventSource::Create();
+      maybe_source.ok()) {
+    uevents = absl::make_unique<ecclesia::UeventInvalidationService>(
+        std::move(*maybe_source));
+    uevents->Start();
+  } else {
+    ecclesia::WarningLog() << "hotplug events are unavailable: "
+                           << maybe_source.status();
+  }
+
   ecclesia::SysmodelParams params = {
       .field_translator =
           absl::make_unique<ecclesia::InterlakenSmbiosFieldTranslator>(),
@@ -222,15 +249,25 @@ int main(int argc, char **argv) {
       .fru_factories = absl::MakeSpan(fru_factories),
       .dimm_thermal_params = absl::MakeSpan(dimm_channel_info),
       .cpu_margin_params = absl::MakeSpan(cpu_margin_sensor_info),
+      .sensor_sample_interval = absl::GetFlag(FLAGS_sensor_sample_interval),
+      .snapshot_path = absl::GetFlag(FLAGS_sysmodel_snapshot_path),
+      .uevents = uevents.get(),
   };
 
   std::unique_ptr<ecclesia::SystemModel> system_model =
       absl::make_unique<ecclesia::SystemModel>(std::move(params));
 
+  if (absl::GetFlag(FLAGS_pretty_json)) {
+    ecclesia::SetJsonResponseStyle(ecclesia::JsonWriter::Style::kPretty);
+  }
   auto server = ecclesia::CreateServer(absl::GetFlag(FLAGS_port));
   ecclesia::InterlakenRedfishService redfish_service(
       server.get(), system_model.get(), absl::GetFlag(FLAGS_assemblies_dir));
 
+  // Only start serving once the system model has been fully initialized, so
+  // that no request ever sees a partially populated model.
+  system_model->WaitUntilReady();
+
   bool success = server->StartAcceptingRequests();
   if (server != nullptr && success) {
     server->WaitForTermination();
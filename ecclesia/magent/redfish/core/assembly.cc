@@ -30,9 +30,6 @@
 #include "ecclesia/magent/redfish/core/resource.h"
 #include "json/json.h"
 #include "json/value.h"
-#include "tensorflow_serving/util/net_http/server/public/httpserver_interface.h"
-#include "tensorflow_serving/util/net_http/server/public/server_request_interface.h"
-#include "re2/re2.h"
 
 namespace ecclesia {
 
@@ -92,20 +89,4 @@ Assembly::Assembly(absl::string_view assemblies_dir,
       assemblies_(
           GetAssemblies(assemblies_dir, std::move(assembly_modifiers))) {}
 
-void Assembly::RegisterRequestHandler(HTTPServerInterface *server) {
-  server->RegisterRequestDispatcher(
-      [this](ServerRequestInterface *http_request)
-          -> tensorflow::serving::net_http::RequestHandler {
-        RE2 regex(this->Uri());
-        if (RE2::FullMatch(http_request->uri_path(), regex)) {
-          return [this](ServerRequestInterface *req) {
-            this->RequestHandler(req);
-          };
-        } else {
-          return nullptr;
-        }
-      },
-      RequestHandlerOptions());
-}
-
 }  // namespace ecclesia
@@ -19,13 +19,19 @@
 
 #include <functional>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "ecclesia/lib/cache/rcu_snapshot.h"
+#include "ecclesia/lib/cache/rcu_store.h"
+#include "ecclesia/magent/redfish/core/json_helper.h"
+#include "ecclesia/magent/redfish/core/json_writer.h"
 #include "ecclesia/magent/redfish/core/resource.h"
 #include "json/value.h"
-#include "tensorflow_serving/util/net_http/server/public/httpserver_interface.h"
 #include "tensorflow_serving/util/net_http/server/public/response_code_enum.h"
 #include "tensorflow_serving/util/net_http/server/public/server_request_interface.h"
 
@@ -61,20 +67,42 @@ class Assembly : public Resource {
   Assembly(absl::string_view assemblies_dir,
            std::vector<AssemblyModifier> assembly_modifiers);
 
-  void RegisterRequestHandler(HTTPServerInterface *server) override;
+  // Applies a modifier to the assemblies after construction. This is for data
+  // which is not available yet when the resource starts serving, such as FRU
+  // info that is still being read. It is safe to call this concurrently with
+  // requests being served.
+  void ApplyModifier(const AssemblyModifier &modifier) {
+    absl::MutexLock ml(&modifier_mutex_);
+    absl::flat_hash_map<std::string, Json::Value> assemblies =
+        *assemblies_.Read();
+    modifier(assemblies);
+    assemblies_.Update(std::move(assemblies));
+  }
 
  private:
+  using AssemblyMap = absl::flat_hash_map<std::string, Json::Value>;
+
   void Get(ServerRequestInterface *req, const ParamsType &) override {
-    if (assemblies_.contains(req->uri_path())) {
-      JSONResponseOK(assemblies_.at(req->uri_path()), req);
-    } else {
+    RcuSnapshot<AssemblyMap> assemblies = assemblies_.Read();
+    auto iter = assemblies->find(req->uri_path());
+    if (iter == assemblies->end()) {
       req->ReplyWithStatus(HTTPStatusCode::NOT_FOUND);
+      return;
     }
+    // The cached responses are rebuilt whenever a modifier is applied.
+    CachedJSONResponse(req, [&](ResponseValidity *validity,
+                                JsonWriter *writer) {
+      *validity = ResponseValidity::WhileFresh(assemblies);
+      WriteJsonValue(iter->second, writer);
+    });
   }
 
   // Maintain a map of Assembly URI to the json response for the corresponding
-  // assembly resource
-  const absl::flat_hash_map<std::string, Json::Value> assemblies_;
+  // assembly resource. Modifiers are applied by replacing the whole map, and
+  // are serialized so that concurrent modifiers cannot lose each other's
+  // changes.
+  absl::Mutex modifier_mutex_;
+  RcuStore<AssemblyMap> assemblies_;
 };
 
 }  // namespace ecclesia
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/redfish/core/compression.h"
+
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "zlib.h"
+
+namespace ecclesia {
+namespace {
+
+// The zlib window size to use. Adding 16 gives a gzip wrapper instead of the
+// zlib wrapper used by the HTTP deflate coding.
+constexpr int kWindowBits = 15;
+constexpr int kGzipWindowBits = kWindowBits + 16;
+constexpr int kMemLevel = 8;
+
+// Parses the quality value from the parameters of an Accept-Encoding entry.
+// Entries without a valid q parameter have the default quality of 1.
+double ParseQuality(absl::string_view params) {
+  for (absl::string_view param : absl::StrSplit(params, ';')) {
+    param = absl::StripAsciiWhitespace(param);
+    double quality;
+    if ((absl::ConsumePrefix(&param, "q=") ||
+         absl::ConsumePrefix(&param, "Q=")) &&
+        absl::SimpleAtod(param, &quality)) {
+      return quality;
+    }
+  }
+  return 1.0;
+}
+
+}  // namespace
+
+absl::string_view ContentEncodingName(ContentEncoding encoding) {
+  switch (encoding) {
+    case ContentEncoding::kGzip:
+      return "gzip";
+    case ContentEncoding::kDeflate:
+      return "deflate";
+    case ContentEncoding::kIdentity:
+      break;
+  }
+  return "identity";
+}
+
+ContentEncoding NegotiateContentEncoding(absl::string_view accept_encoding) {
+  // Quality values for the supported encodings, where a negative value means
+  // the header did not mention them.
+  double gzip_quality = -1;
+  double deflate_quality = -1;
+  double wildcard_quality = -1;
+  for (absl::string_view entry : absl::StrSplit(accept_encoding, ',')) {
+    absl::string_view coding = entry;
+    absl::string_view params;
+    size_t semicolon = entry.find(';');
+    if (semicolon != absl::string_view::npos) {
+      coding = entry.substr(0, semicolon);
+      params = entry.substr(semicolon + 1);
+    }
+    coding = absl::StripAsciiWhitespace(coding);
+    double quality = ParseQuality(params);
+    if (absl::EqualsIgnoreCase(coding, "gzip") ||
+        absl::EqualsIgnoreCase(coding, "x-gzip")) {
+      gzip_quality = quality;
+    } else if (absl::EqualsIgnoreCase(coding, "deflate")) {
+      deflate_quality = quality;
+    } else if (coding == "*") {
+      wildcard_quality = quality;
+    }
+  }
+  if (gzip_quality < 0) gzip_quality = wildcard_quality;
+  if (deflate_quality < 0) deflate_quality = wildcard_quality;
+
+  if (gzip_quality > 0 && gzip_quality >= deflate_quality) {
+    return ContentEncoding::kGzip;
+  }
+  if (deflate_quality > 0) return ContentEncoding::kDeflate;
+  return ContentEncoding::kIdentity;
+}
+
+absl::StatusOr<std::string> CompressBody(absl::string_view data,
+                                         ContentEncoding encoding, int level) {
+  if (encoding == ContentEncoding::kIdentity) return std::string(data);
+
+  z_stream stream = {};
+  int window_bits =
+      encoding == ContentEncoding::kGzip ? kGzipWindowBits : kWindowBits;
+  int result = deflateInit2(&stream, level, Z_DEFLATED, window_bits, kMemLevel,
+                            Z_DEFAULT_STRATEGY);
+  if (result != Z_OK) {
+    return absl::InternalError(
+        absl::StrFormat("deflateInit2 failed with error %d", result));
+  }
+  // The whole body is compressed in one call, into a buffer large enough to
+  // hold the worst case.
+  std::string compressed(deflateBound(&stream, data.size()), '\0');
+  stream.next_in =
+      reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+  stream.avail_in = data.size();
+  stream.next_out = reinterpret_cast<Bytef *>(&compressed[0]);
+  stream.avail_out = compressed.size();
+  result = deflate(&stream, Z_FINISH);
+  deflateEnd(&stream);
+  if (result != Z_STREAM_END) {
+    return absl::InternalError(
+        absl::StrFormat("deflate failed with error %d", result));
+  }
+  compressed.resize(stream.total_out);
+  return compressed;
+}
+
+}  // namespace ecclesia
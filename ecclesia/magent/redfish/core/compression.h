@@ -0,0 +1,64 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Support for compressing HTTP response bodies. Clients say which content
+// codings they accept with the Accept-Encoding request header; this provides
+// a way to pick one of the supported codings from that header, and to
+// compress a body with it.
+//
+// Only gzip and deflate are supported, since those are what zlib provides and
+// are accepted by every HTTP client.
+
+#ifndef ECCLESIA_MAGENT_REDFISH_CORE_COMPRESSION_H_
+#define ECCLESIA_MAGENT_REDFISH_CORE_COMPRESSION_H_
+
+#include <cstddef>
+#include <string>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+namespace ecclesia {
+
+enum class ContentEncoding { kIdentity, kGzip, kDeflate };
+
+// Bodies smaller than this are not worth compressing; the saving is at most a
+// few hundred bytes and is outweighed by the cost of compressing them.
+inline constexpr size_t kMinCompressedBodySize = 1024;
+
+// zlib compression levels. Bodies which are compressed once and then cached
+// can afford the best compression, while bodies which are compressed on every
+// request should use the fastest.
+inline constexpr int kCachedCompressionLevel = 9;
+inline constexpr int kDynamicCompressionLevel = 1;
+
+// Returns the name of the encoding, as used in the Content-Encoding header.
+absl::string_view ContentEncodingName(ContentEncoding encoding);
+
+// Picks the encoding to use for a response, given the value of the request's
+// Accept-Encoding header. The supported encoding with the highest quality
+// value is chosen, preferring gzip when there is a tie. Returns kIdentity if
+// the client does not accept any of the supported encodings.
+ContentEncoding NegotiateContentEncoding(absl::string_view accept_encoding);
+
+// Compresses data with the given encoding and zlib compression level.
+// Compressing with kIdentity returns the data unchanged.
+absl::StatusOr<std::string> CompressBody(absl::string_view data,
+                                         ContentEncoding encoding, int level);
+
+}  // namespace ecclesia
+
+#endif  // ECCLESIA_MAGENT_REDFISH_CORE_COMPRESSION_H_
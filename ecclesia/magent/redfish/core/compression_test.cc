@@ -0,0 +1,123 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/redfish/core/compression.h"
+
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "zlib.h"
+
+namespace ecclesia {
+namespace {
+
+// Decompresses a gzip or zlib wrapped body, returning an empty string if it
+// cannot be decompressed.
+std::string Decompress(absl::string_view data) {
+  z_stream stream = {};
+  // Adding 32 to the window bits detects the gzip or zlib wrapper.
+  if (inflateInit2(&stream, 15 + 32) != Z_OK) return "";
+  std::string out(1 << 20, '\0');
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+  stream.avail_in = data.size();
+  stream.next_out = reinterpret_cast<Bytef *>(&out[0]);
+  stream.avail_out = out.size();
+  int result = inflate(&stream, Z_FINISH);
+  inflateEnd(&stream);
+  if (result != Z_STREAM_END) return "";
+  out.resize(stream.total_out);
+  return out;
+}
+
+TEST(NegotiateContentEncodingTest, NoHeader) {
+  EXPECT_EQ(NegotiateContentEncoding(""), ContentEncoding::kIdentity);
+  EXPECT_EQ(NegotiateContentEncoding("identity"), ContentEncoding::kIdentity);
+  EXPECT_EQ(NegotiateContentEncoding("br, zstd"), ContentEncoding::kIdentity);
+}
+
+TEST(NegotiateContentEncodingTest, PicksSupportedEncoding) {
+  EXPECT_EQ(NegotiateContentEncoding("gzip"), ContentEncoding::kGzip);
+  EXPECT_EQ(NegotiateContentEncoding("x-gzip"), ContentEncoding::kGzip);
+  EXPECT_EQ(NegotiateContentEncoding("GZIP"), ContentEncoding::kGzip);
+  EXPECT_EQ(NegotiateContentEncoding("deflate"), ContentEncoding::kDeflate);
+  EXPECT_EQ(NegotiateContentEncoding("br, deflate"), ContentEncoding::kDeflate);
+  EXPECT_EQ(NegotiateContentEncoding("*"), ContentEncoding::kGzip);
+}
+
+TEST(NegotiateContentEncodingTest, QualityValues) {
+  // Ties go to gzip.
+  EXPECT_EQ(NegotiateContentEncoding("deflate, gzip"), ContentEncoding::kGzip);
+  EXPECT_EQ(NegotiateContentEncoding("gzip;q=0.5, deflate"),
+            ContentEncoding::kDeflate);
+  EXPECT_EQ(NegotiateContentEncoding("gzip ; q=0.8, deflate;q=0.2"),
+            ContentEncoding::kGzip);
+  EXPECT_EQ(NegotiateContentEncoding("gzip;q=0"), ContentEncoding::kIdentity);
+  EXPECT_EQ(NegotiateContentEncoding("*;q=0.1, gzip;q=0"),
+            ContentEncoding::kDeflate);
+  EXPECT_EQ(NegotiateContentEncoding("*;q=0"), ContentEncoding::kIdentity);
+}
+
+TEST(CompressBodyTest, RoundTrips) {
+  std::string body;
+  for (int i = 0; i < 100; ++i) {
+    absl::StrAppend(&body, R"({"@odata.id":"/redfish/v1/Systems/system/)",
+                    "Memory/", i, R"("},)");
+  }
+
+  for (ContentEncoding encoding :
+       {ContentEncoding::kGzip, ContentEncoding::kDeflate}) {
+    for (int level : {kDynamicCompressionLevel, kCachedCompressionLevel}) {
+      absl::StatusOr<std::string> compressed =
+          CompressBody(body, encoding, level);
+      ASSERT_TRUE(compressed.ok()) << compressed.status();
+      EXPECT_LT(compressed->size(), body.size());
+      EXPECT_EQ(Decompress(*compressed), body);
+    }
+  }
+
+  // gzip bodies start with the gzip magic number, and deflate bodies with a
+  // zlib header.
+  EXPECT_EQ(CompressBody(body, ContentEncoding::kGzip, 1)->substr(0, 2),
+            "\x1f\x8b");
+  EXPECT_EQ(CompressBody(body, ContentEncoding::kDeflate, 1)->front(), '\x78');
+}
+
+TEST(CompressBodyTest, IdentityIsUnchanged) {
+  absl::StatusOr<std::string> body =
+      CompressBody("{}", ContentEncoding::kIdentity, 9);
+  ASSERT_TRUE(body.ok());
+  EXPECT_EQ(*body, "{}");
+}
+
+TEST(CompressBodyTest, EmptyBody) {
+  absl::StatusOr<std::string> compressed =
+      CompressBody("", ContentEncoding::kGzip, 9);
+  ASSERT_TRUE(compressed.ok());
+  EXPECT_EQ(Decompress(*compressed), "");
+}
+
+TEST(ContentEncodingNameTest, Names) {
+  EXPECT_EQ(ContentEncodingName(ContentEncoding::kIdentity), "identity");
+  EXPECT_EQ(ContentEncodingName(ContentEncoding::kGzip), "gzip");
+  EXPECT_EQ(ContentEncodingName(ContentEncoding::kDeflate), "deflate");
+}
+
+}  // namespace
+}  // namespace ecclesia
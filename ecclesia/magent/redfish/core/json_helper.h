@@ -20,6 +20,8 @@
 #include <cassert>
 #include <string>
 
+#include "absl/strings/string_view.h"
+#include "ecclesia/magent/redfish/core/json_writer.h"
 #include "ecclesia/magent/redfish/core/redfish_keywords.h"
 #include "json/value.h"
 
@@ -49,5 +51,72 @@ inline void AppendCollectionMember(Json::Value *array, const std::string &uri) {
   array->append(member);
 }
 
+// Helper functions to write Json using a JsonWriter
+
+// Write a collection member into the "Members" array currently being written
+inline void WriteCollectionMember(JsonWriter *writer, absl::string_view uri) {
+  writer->BeginObject();
+  writer->Key(kOdataId);
+  writer->String(uri);
+  writer->EndObject();
+}
+
+// Write a member with the given name that links to another resource, such as
+// "Metrics": {"@odata.id": uri}
+inline void WriteOdataLink(JsonWriter *writer, absl::string_view name,
+                           absl::string_view uri) {
+  writer->Key(name);
+  WriteCollectionMember(writer, uri);
+}
+
+// Write an existing json object. This is for responses whose content is built
+// or stored as Json::Value, such as the assemblies loaded from files.
+inline void WriteJsonValue(const Json::Value &json, JsonWriter *writer) {
+  switch (json.type()) {
+    case Json::nullValue:
+      writer->Null();
+      break;
+    case Json::intValue:
+      writer->Int(json.asLargestInt());
+      break;
+    case Json::uintValue:
+      writer->Uint(json.asLargestUInt());
+      break;
+    case Json::realValue:
+      writer->Double(json.asDouble());
+      break;
+    case Json::stringValue: {
+      const char *begin = nullptr;
+      const char *end = nullptr;
+      if (json.getString(&begin, &end)) {
+        writer->String(absl::string_view(begin, end - begin));
+      } else {
+        writer->String("");
+      }
+      break;
+    }
+    case Json::booleanValue:
+      writer->Bool(json.asBool());
+      break;
+    case Json::arrayValue:
+      writer->BeginArray();
+      for (const Json::Value &element : json) {
+        WriteJsonValue(element, writer);
+      }
+      writer->EndArray();
+      break;
+    case Json::objectValue:
+      writer->BeginObject();
+      for (auto iter = json.begin(); iter != json.end(); ++iter) {
+        const char *end = nullptr;
+        const char *begin = iter.memberName(&end);
+        writer->Key(absl::string_view(begin, end - begin));
+        WriteJsonValue(*iter, writer);
+      }
+      writer->EndObject();
+      break;
+  }
+}
+
 }  // namespace ecclesia
 #endif  // ECCLESIA_MAGENT_REDFISH_CORE_JSON_HELPER_H_
@@ -0,0 +1,190 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/redfish/core/json_writer.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+
+namespace ecclesia {
+namespace {
+
+// Matches the indentation used by Json::Value::toStyledString.
+constexpr absl::string_view kIndent = "   ";
+
+}  // namespace
+
+JsonWriter::JsonWriter(std::string *out, Style style)
+    : out_(out), style_(style) {
+  // Redfish resources rarely nest more than a handful of levels deep.
+  scopes_.reserve(8);
+}
+
+void JsonWriter::BeginObject() { BeginScope(true, '{'); }
+
+void JsonWriter::EndObject() { EndScope(true, '}'); }
+
+void JsonWriter::BeginArray() { BeginScope(false, '['); }
+
+void JsonWriter::EndArray() { EndScope(false, ']'); }
+
+void JsonWriter::Key(absl::string_view key) {
+  assert(!scopes_.empty() && scopes_.back().is_object && !after_key_);
+  Separate();
+  AppendQuoted(key);
+  out_->append(style_ == Style::kPretty ? " : " : ":");
+  after_key_ = true;
+}
+
+void JsonWriter::String(absl::string_view value) {
+  BeginValue();
+  AppendQuoted(value);
+}
+
+void JsonWriter::Int(int64_t value) {
+  BeginValue();
+  absl::StrAppend(out_, value);
+}
+
+void JsonWriter::Uint(uint64_t value) {
+  BeginValue();
+  absl::StrAppend(out_, value);
+}
+
+void JsonWriter::Double(double value) {
+  BeginValue();
+  if (!std::isfinite(value)) {
+    out_->append("null");
+    return;
+  }
+  // Use enough precision for the value to round trip. Integral values still
+  // get a decimal point so that they are read back as doubles.
+  size_t start = out_->size();
+  absl::StrAppendFormat(out_, "%.17g", value);
+  if (out_->find_first_of(".eE", start) == std::string::npos) {
+    out_->append(".0");
+  }
+}
+
+void JsonWriter::Bool(bool value) {
+  BeginValue();
+  out_->append(value ? "true" : "false");
+}
+
+void JsonWriter::Null() {
+  BeginValue();
+  out_->append("null");
+}
+
+void JsonWriter::RawValue(absl::string_view json) {
+  BeginValue();
+  out_->append(json.data(), json.size());
+}
+
+void JsonWriter::BeginValue() {
+  if (after_key_) {
+    // The key has already written the separator.
+    after_key_ = false;
+    return;
+  }
+  // Values inside an object must be preceded by a Key.
+  assert(scopes_.empty() || !scopes_.back().is_object);
+  Separate();
+}
+
+void JsonWriter::Separate() {
+  if (scopes_.empty()) return;
+  Scope &scope = scopes_.back();
+  if (!scope.empty) out_->push_back(',');
+  scope.empty = false;
+  Newline();
+}
+
+void JsonWriter::BeginScope(bool is_object, char open) {
+  BeginValue();
+  out_->push_back(open);
+  scopes_.push_back({.is_object = is_object, .empty = true});
+}
+
+void JsonWriter::EndScope(bool is_object, char close) {
+  assert(!scopes_.empty() && scopes_.back().is_object == is_object &&
+         !after_key_);
+  (void)is_object;
+  bool empty = scopes_.back().empty;
+  scopes_.pop_back();
+  if (!empty) Newline();
+  out_->push_back(close);
+}
+
+void JsonWriter::Newline() {
+  if (style_ != Style::kPretty) return;
+  out_->push_back('\n');
+  for (size_t i = 0; i < scopes_.size(); ++i) {
+    out_->append(kIndent.data(), kIndent.size());
+  }
+}
+
+void JsonWriter::AppendQuoted(absl::string_view value) {
+  static constexpr char kHexDigits[] = "0123456789abcdef";
+  out_->reserve(out_->size() + value.size() + 2);
+  out_->push_back('"');
+  // Copy runs of characters that need no escaping in one go.
+  size_t run_start = 0;
+  for (size_t i = 0; i < value.size(); ++i) {
+    unsigned char c = value[i];
+    if (c >= 0x20 && c != '"' && c != '\\') continue;
+    out_->append(value.data() + run_start, i - run_start);
+    run_start = i + 1;
+    switch (c) {
+      case '"':
+        out_->append("\\\"");
+        break;
+      case '\\':
+        out_->append("\\\\");
+        break;
+      case '\b':
+        out_->append("\\b");
+        break;
+      case '\f':
+        out_->append("\\f");
+        break;
+      case '\n':
+        out_->append("\\n");
+        break;
+      case '\r':
+        out_->append("\\r");
+        break;
+      case '\t':
+        out_->append("\\t");
+        break;
+      default:
+        out_->append("\\u00");
+        out_->push_back(kHexDigits[c >> 4]);
+        out_->push_back(kHexDigits[c & 0xf]);
+        break;
+    }
+  }
+  out_->append(value.data() + run_start, value.size() - run_start);
+  out_->push_back('"');
+}
+
+}  // namespace ecclesia
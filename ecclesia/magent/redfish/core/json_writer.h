@@ -0,0 +1,103 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A streaming JSON writer for building Redfish responses. Rather than building
+// a Json::Value tree and rendering it afterwards, callers emit the document as
+// a sequence of tokens which are appended directly to an output string. This
+// avoids allocating a node for every field of every response, and lets the
+// caller reuse the output buffer across responses.
+//
+// The writer is append-only and does not validate the structure of the
+// document beyond debug assertions; it is up to the caller to balance the
+// Begin and End calls and to write a key before every value in an object.
+
+#ifndef ECCLESIA_MAGENT_REDFISH_CORE_JSON_WRITER_H_
+#define ECCLESIA_MAGENT_REDFISH_CORE_JSON_WRITER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+
+namespace ecclesia {
+
+class JsonWriter {
+ public:
+  enum class Style {
+    // No whitespace at all between tokens.
+    kCompact,
+    // One member or element per line, indented by three spaces per level.
+    kPretty,
+  };
+
+  // Writes are appended to the end of the given string, which must outlive
+  // the writer. Any existing contents of the string are preserved.
+  explicit JsonWriter(std::string *out, Style style = Style::kCompact);
+
+  JsonWriter(const JsonWriter &other) = delete;
+  JsonWriter &operator=(const JsonWriter &other) = delete;
+
+  // Start and end a JSON object or array.
+  void BeginObject();
+  void EndObject();
+  void BeginArray();
+  void EndArray();
+
+  // Writes the key of the next member of the current object. Every value
+  // written inside an object must be preceded by a key.
+  void Key(absl::string_view key);
+
+  // Write scalar values. Doubles which are not finite are written as null,
+  // since JSON has no way of representing them.
+  void String(absl::string_view value);
+  void Int(int64_t value);
+  void Uint(uint64_t value);
+  void Double(double value);
+  void Bool(bool value);
+  void Null();
+
+  // Writes a value that has already been serialized as JSON, such as a
+  // fragment cached from an earlier response. The fragment is written as-is.
+  void RawValue(absl::string_view json);
+
+ private:
+  struct Scope {
+    bool is_object;
+    bool empty;
+  };
+
+  // Writes any separator and indentation needed before a value. Values that
+  // follow a key have already been separated by the key.
+  void BeginValue();
+  // Writes the separator and indentation needed before the next element of
+  // the current scope.
+  void Separate();
+  void BeginScope(bool is_object, char open);
+  void EndScope(bool is_object, char close);
+  void Newline();
+  void AppendQuoted(absl::string_view value);
+
+  std::string *const out_;
+  const Style style_;
+  std::vector<Scope> scopes_;
+  // Set after a key has been written, until its value is written.
+  bool after_key_ = false;
+};
+
+}  // namespace ecclesia
+
+#endif  // ECCLESIA_MAGENT_REDFISH_CORE_JSON_WRITER_H_
@@ -0,0 +1,263 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks comparing the two ways of serializing Redfish responses: building
+// a Json::Value and rendering it with toStyledString, versus writing the
+// response with a JsonWriter into a reused buffer. The responses mirror the
+// shape of the Thermal, Memory and Assembly resources. Each benchmark also
+// reports the size of the response it produces.
+
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "ecclesia/magent/redfish/core/json_helper.h"
+#include "ecclesia/magent/redfish/core/json_writer.h"
+#include "ecclesia/magent/redfish/core/redfish_keywords.h"
+#include "json/value.h"
+
+namespace ecclesia {
+namespace {
+
+// The number of DIMM thermal sensors on an Indus machine.
+constexpr int kNumThermalSensors = 24;
+// The number of components in the Indus chassis assembly.
+constexpr int kNumAssemblyComponents = 96;
+
+// Run the benchmark loop for a single style of serialization, recording the
+// size of the final response.
+template <typename SerializeFunc>
+void RunSerializeBenchmark(benchmark::State &state, SerializeFunc serialize) {
+  std::string buffer;
+  for (auto _ : state) {
+    buffer.clear();
+    serialize(&buffer);
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  state.counters["bytes_per_response"] = buffer.size();
+  state.SetBytesProcessed(state.iterations() * buffer.size());
+}
+
+JsonWriter::Style GetStyle(const benchmark::State &state) {
+  return state.range(0) ? JsonWriter::Style::kPretty
+                        : JsonWriter::Style::kCompact;
+}
+
+Json::Value BuildThermal() {
+  Json::Value json;
+  json[kOdataType] = "#Thermal.v1_6_0.Thermal";
+  json[kOdataId] = kThermalUri;
+  json[kOdataContext] = "/redfish/v1/$metadata#Thermal.Thermal";
+  json[kName] = "Thermal";
+  json[kTemperaturesCount] = kNumThermalSensors;
+  auto *members = GetJsonArray(&json, kTemperatures);
+  for (int i = 0; i < kNumThermalSensors; i++) {
+    Json::Value thermal;
+    thermal[kOdataId] = absl::StrCat(kThermalUri, "#/Temperatures/", i);
+    thermal[kOdataType] = "#Thermal.v1_6_0.Temperature";
+    thermal[kName] = absl::StrCat("dimm", i);
+    thermal[kReadingCelsius] = 40 + i;
+    thermal[kUpperThresholdCritical] = 85;
+    Json::Value dimm;
+    dimm[kOdataId] = absl::StrCat(kMemoryCollectionUri, "/", i);
+    GetJsonArray(&thermal, kRelatedItem)->append(dimm);
+    Json::Value status;
+    status[kState] = kEnabled;
+    thermal[kStatus] = status;
+    members->append(thermal);
+  }
+  return json;
+}
+
+void WriteThermal(JsonWriter *writer) {
+  writer->BeginObject();
+  writer->Key(kOdataType);
+  writer->String("#Thermal.v1_6_0.Thermal");
+  writer->Key(kOdataId);
+  writer->String(kThermalUri);
+  writer->Key(kOdataContext);
+  writer->String("/redfish/v1/$metadata#Thermal.Thermal");
+  writer->Key(kName);
+  writer->String("Thermal");
+  writer->Key(kTemperaturesCount);
+  writer->Int(kNumThermalSensors);
+  writer->Key(kTemperatures);
+  writer->BeginArray();
+  for (int i = 0; i < kNumThermalSensors; i++) {
+    writer->BeginObject();
+    writer->Key(kOdataId);
+    writer->String(absl::StrCat(kThermalUri, "#/Temperatures/", i));
+    writer->Key(kOdataType);
+    writer->String("#Thermal.v1_6_0.Temperature");
+    writer->Key(kName);
+    writer->String(absl::StrCat("dimm", i));
+    writer->Key(kReadingCelsius);
+    writer->Int(40 + i);
+    writer->Key(kUpperThresholdCritical);
+    writer->Int(85);
+    writer->Key(kRelatedItem);
+    writer->BeginArray();
+    WriteCollectionMember(writer, absl::StrCat(kMemoryCollectionUri, "/", i));
+    writer->EndArray();
+    writer->Key(kStatus);
+    writer->BeginObject();
+    writer->Key(kState);
+    writer->String(kEnabled);
+    writer->EndObject();
+    writer->EndObject();
+  }
+  writer->EndArray();
+  writer->EndObject();
+}
+
+constexpr char kMemoryUri[] = "/redfish/v1/Systems/system/Memory/0";
+
+Json::Value BuildMemory() {
+  Json::Value json;
+  json[kOdataType] = "#Memory.v1_8_0.Memory";
+  json[kOdataId] = kMemoryUri;
+  json[kOdataContext] = "/redfish/v1/$metadata#Memory.Memory";
+  json[kName] = "DIMM0";
+  json[kCapacityMiB] = 32768;
+  json[kLogicalSizeMiB] = 32768;
+  json[kManufacturer] = "Samsung";
+  json[kMemoryDeviceType] = "DDR4";
+  json[kOperatingSpeedMhz] = 2933;
+  json[kPartNumber] = "M393A4K40DB2-CVF";
+  json[kSerialNumber] = "0x12345678";
+  auto *assembly = GetJsonObject(&json, kAssembly);
+  (*assembly)[kOdataId] = absl::StrCat(kMemoryUri, "/", kAssembly);
+  auto *metrics = GetJsonObject(&json, kMetrics);
+  (*metrics)[kOdataId] = absl::StrCat(kMemoryUri, "/", kMemoryMetrics);
+  auto *status = GetJsonObject(&json, kStatus);
+  (*status)[kState] = kEnabled;
+  return json;
+}
+
+void WriteMemory(JsonWriter *writer) {
+  writer->BeginObject();
+  writer->Key(kOdataType);
+  writer->String("#Memory.v1_8_0.Memory");
+  writer->Key(kOdataId);
+  writer->String(kMemoryUri);
+  writer->Key(kOdataContext);
+  writer->String("/redfish/v1/$metadata#Memory.Memory");
+  writer->Key(kName);
+  writer->String("DIMM0");
+  writer->Key(kCapacityMiB);
+  writer->Int(32768);
+  writer->Key(kLogicalSizeMiB);
+  writer->Int(32768);
+  writer->Key(kManufacturer);
+  writer->String("Samsung");
+  writer->Key(kMemoryDeviceType);
+  writer->String("DDR4");
+  writer->Key(kOperatingSpeedMhz);
+  writer->Int(2933);
+  writer->Key(kPartNumber);
+  writer->String("M393A4K40DB2-CVF");
+  writer->Key(kSerialNumber);
+  writer->String("0x12345678");
+  WriteOdataLink(writer, kAssembly, absl::StrCat(kMemoryUri, "/", kAssembly));
+  WriteOdataLink(writer, kMetrics,
+                 absl::StrCat(kMemoryUri, "/", kMemoryMetrics));
+  writer->Key(kStatus);
+  writer->BeginObject();
+  writer->Key(kState);
+  writer->String(kEnabled);
+  writer->EndObject();
+  writer->EndObject();
+}
+
+// Assemblies are loaded from files and served from the loaded Json::Value, so
+// only the serialization is measured for them.
+Json::Value BuildAssembly() {
+  constexpr char kAssemblyUri[] = "/redfish/v1/Chassis/chassis/Assembly";
+  Json::Value json;
+  json[kOdataId] = kAssemblyUri;
+  json[kOdataType] = "#Assembly.v1_2_0.Assembly";
+  json["Id"] = "Assembly";
+  json[kName] = "indus";
+  Json::Value assembly;
+  assembly[kOdataId] = absl::StrCat(kAssemblyUri, "#/Assemblies/0");
+  assembly["MemberId"] = "0";
+  assembly[kName] = "indus";
+  Json::Value &components = assembly["Oem"]["Google"]["Components"];
+  for (int i = 0; i < kNumAssemblyComponents; i++) {
+    Json::Value component;
+    component[kOdataId] = absl::StrCat(
+        kAssemblyUri, "#/Assemblies/0/Oem/Google/Components/", i);
+    component["MemberId"] = absl::StrCat(i);
+    component[kName] = absl::StrCat("DIMM", i);
+    component["PhysicalContext"] = "Connector";
+    Json::Value associated;
+    associated[kOdataId] = absl::StrCat(kMemoryCollectionUri, "/", i);
+    component["AssociatedWith"].append(associated);
+    components.append(component);
+  }
+  json["Assemblies"].append(assembly);
+  return json;
+}
+
+void BM_ThermalStyledString(benchmark::State &state) {
+  RunSerializeBenchmark(state, [](std::string *out) {
+    *out = BuildThermal().toStyledString();
+  });
+}
+BENCHMARK(BM_ThermalStyledString);
+
+void BM_ThermalJsonWriter(benchmark::State &state) {
+  RunSerializeBenchmark(state, [&](std::string *out) {
+    JsonWriter writer(out, GetStyle(state));
+    WriteThermal(&writer);
+  });
+}
+BENCHMARK(BM_ThermalJsonWriter)->ArgName("pretty")->Arg(0)->Arg(1);
+
+void BM_MemoryStyledString(benchmark::State &state) {
+  RunSerializeBenchmark(state, [](std::string *out) {
+    *out = BuildMemory().toStyledString();
+  });
+}
+BENCHMARK(BM_MemoryStyledString);
+
+void BM_MemoryJsonWriter(benchmark::State &state) {
+  RunSerializeBenchmark(state, [&](std::string *out) {
+    JsonWriter writer(out, GetStyle(state));
+    WriteMemory(&writer);
+  });
+}
+BENCHMARK(BM_MemoryJsonWriter)->ArgName("pretty")->Arg(0)->Arg(1);
+
+void BM_AssemblyStyledString(benchmark::State &state) {
+  Json::Value assembly = BuildAssembly();
+  RunSerializeBenchmark(state, [&](std::string *out) {
+    *out = assembly.toStyledString();
+  });
+}
+BENCHMARK(BM_AssemblyStyledString);
+
+void BM_AssemblyJsonWriter(benchmark::State &state) {
+  Json::Value assembly = BuildAssembly();
+  RunSerializeBenchmark(state, [&](std::string *out) {
+    JsonWriter writer(out, GetStyle(state));
+    WriteJsonValue(assembly, &writer);
+  });
+}
+BENCHMARK(BM_AssemblyJsonWriter)->ArgName("pretty")->Arg(0)->Arg(1);
+
+}  // namespace
+}  // namespace ecclesia
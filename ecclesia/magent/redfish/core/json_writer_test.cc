@@ -0,0 +1,148 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/redfish/core/json_writer.h"
+
+#include <limits>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "ecclesia/magent/redfish/core/json_helper.h"
+#include "json/reader.h"
+#include "json/value.h"
+
+namespace ecclesia {
+namespace {
+
+// Writes a small document with a bit of everything in it.
+void WriteSample(JsonWriter *writer) {
+  writer->BeginObject();
+  writer->Key("Name");
+  writer->String("dimm0");
+  writer->Key("Count");
+  writer->Int(-3);
+  writer->Key("Size");
+  writer->Uint(18446744073709551615u);
+  writer->Key("Members");
+  writer->BeginArray();
+  writer->Bool(true);
+  writer->Null();
+  writer->BeginObject();
+  writer->EndObject();
+  writer->BeginArray();
+  writer->EndArray();
+  writer->EndArray();
+  writer->EndObject();
+}
+
+TEST(JsonWriterTest, CompactByDefault) {
+  std::string out;
+  JsonWriter writer(&out);
+  WriteSample(&writer);
+  EXPECT_EQ(out,
+            R"({"Name":"dimm0","Count":-3,"Size":18446744073709551615,)"
+            R"("Members":[true,null,{},[]]})");
+}
+
+TEST(JsonWriterTest, Pretty) {
+  std::string out;
+  JsonWriter writer(&out, JsonWriter::Style::kPretty);
+  WriteSample(&writer);
+  EXPECT_EQ(out, R"({
+   "Name" : "dimm0",
+   "Count" : -3,
+   "Size" : 18446744073709551615,
+   "Members" : [
+      true,
+      null,
+      {},
+      []
+   ]
+})");
+}
+
+TEST(JsonWriterTest, AppendsToExistingContents) {
+  std::string out = "[";
+  JsonWriter writer(&out);
+  writer.String("a");
+  EXPECT_EQ(out, R"(["a")");
+}
+
+TEST(JsonWriterTest, EscapesStrings) {
+  std::string out;
+  JsonWriter writer(&out);
+  writer.String(std::string("\"quoted\\path\"\n\t\x01\x1f\0end", 21));
+  EXPECT_EQ(out, R"("\"quoted\\path\"\n\t\u0001\u001f\u0000end")");
+}
+
+TEST(JsonWriterTest, Doubles) {
+  std::string out;
+  JsonWriter writer(&out);
+  writer.BeginArray();
+  writer.Double(1.5);
+  writer.Double(2);
+  writer.Double(1e300);
+  writer.Double(std::numeric_limits<double>::infinity());
+  writer.Double(std::numeric_limits<double>::quiet_NaN());
+  writer.EndArray();
+  EXPECT_EQ(out, "[1.5,2.0,1.0000000000000001e+300,null,null]");
+}
+
+TEST(JsonWriterTest, WriteJsonValueRoundTrips) {
+  Json::Value json;
+  json["@odata.id"] = "/redfish/v1/Chassis/chassis/Assembly";
+  json["Count"] = 24;
+  json["Ratio"] = 0.25;
+  json["Present"] = false;
+  json["Missing"] = Json::Value();
+  Json::Value component;
+  component["Name"] = "CPU0";
+  component["MemberId"] = "0";
+  json["Components"].append(component);
+  json["Components"].append(Json::Value(Json::arrayValue));
+
+  for (JsonWriter::Style style :
+       {JsonWriter::Style::kCompact, JsonWriter::Style::kPretty}) {
+    std::string out;
+    JsonWriter writer(&out, style);
+    WriteJsonValue(json, &writer);
+
+    Json::Value parsed;
+    Json::Reader reader;
+    ASSERT_TRUE(reader.parse(out, parsed)) << out;
+    EXPECT_EQ(parsed, json) << out;
+  }
+}
+
+TEST(JsonWriterTest, WriteCollectionMembers) {
+  std::string out;
+  JsonWriter writer(&out);
+  writer.BeginObject();
+  writer.Key("Members");
+  writer.BeginArray();
+  WriteCollectionMember(&writer, "/redfish/v1/Systems/system/Memory/0");
+  writer.EndArray();
+  WriteOdataLink(&writer, "Metrics", "/redfish/v1/Systems/system/Memory/0/M");
+  writer.EndObject();
+  EXPECT_EQ(out,
+            R"({"Members":[{"@odata.id":"/redfish/v1/Systems/system/)"
+            R"(Memory/0"}],"Metrics":{"@odata.id":"/redfish/v1/Systems/)"
+            R"(system/Memory/0/M"}})");
+}
+
+}  // namespace
+}  // namespace ecclesia
@@ -140,27 +140,30 @@ inline constexpr char kAssociatedWith[] = "AssociatedWith";
 inline constexpr char kAttachedTo[] = "AttachedTo";
 inline constexpr char kDevpath[] = "Devpath";
 
-// Redfish resource URIs
+// Debug URIs, which are not part of the Redfish tree.
+inline constexpr char kSysmodelInitPhasesUri[] = "/debug/sysmodel/init_phases";
+
+// Redfish resource URIs. The patterns use the syntax from uri_router.h.
 inline constexpr char kServiceRootUri[] = "/redfish/v1/";
 inline constexpr char kComputerSystemCollectionUri[] = "/redfish/v1/Systems";
 inline constexpr char kComputerSystemUri[] = "/redfish/v1/Systems/system";
 inline constexpr char kChassisCollectionUri[] = "/redfish/v1/Chassis";
-inline constexpr char kChassisUriPattern[] = "/redfish/v1/Chassis/(\\w+)";
+inline constexpr char kChassisUriPattern[] = "/redfish/v1/Chassis/{string}";
 inline constexpr char kChassisUri[] = "/redfish/v1/Chassis/chassis";
 inline constexpr char kMemoryCollectionUri[] =
     "/redfish/v1/Systems/system/Memory";
 inline constexpr char kMemoryUriPattern[] =
-    "/redfish/v1/Systems/system/Memory/(\\d+)";
+    "/redfish/v1/Systems/system/Memory/{int}";
 inline constexpr char kMemoryMetricsUriPattern[] =
-    "/redfish/v1/Systems/system/Memory/(\\d+)/MemoryMetrics";
-// Regex pattern for an Assembly resource.
-inline constexpr char kAssemblyUriPattern[] = "/redfish/v1/[\\w/]+/Assembly";
+    "/redfish/v1/Systems/system/Memory/{int}/MemoryMetrics";
+// URI pattern for an Assembly resource.
+inline constexpr char kAssemblyUriPattern[] = "/redfish/v1/{path}/Assembly";
 inline constexpr char kProcessorCollectionUri[] =
     "/redfish/v1/Systems/system/Processors";
 inline constexpr char kProcessorUriPattern[] =
-    "/redfish/v1/Systems/system/Processors/(\\d+)";
+    "/redfish/v1/Systems/system/Processors/{int}";
 inline constexpr char kProcessorMetricsUriPattern[] =
-    "/redfish/v1/Systems/system/Processors/(\\d+)/ProcessorMetrics";
+    "/redfish/v1/Systems/system/Processors/{int}/ProcessorMetrics";
 inline constexpr char kThermalUri[] = "/redfish/v1/Chassis/chassis/Thermal";
 inline constexpr char kPowerUri[] = "/redfish/v1/Chassis/chassis/Power";
 inline constexpr char kAssemblyUri[] = "/redfish/v1/Chassis/chassis/Assembly";
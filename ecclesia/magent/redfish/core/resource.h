@@ -17,14 +17,28 @@
 #ifndef ECCLESIA_MAGENT_REDFISH_CORE_RESOURCE_H_
 #define ECCLESIA_MAGENT_REDFISH_CORE_RESOURCE_H_
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/functional/function_ref.h"
 #include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
-#include "absl/types/variant.h"
+#include "absl/time/time.h"
+#include "ecclesia/lib/logging/logging.h"
+#include "ecclesia/magent/redfish/core/compression.h"
+#include "ecclesia/magent/redfish/core/json_helper.h"
+#include "ecclesia/magent/redfish/core/json_writer.h"
+#include "ecclesia/magent/redfish/core/response_cache.h"
+#include "ecclesia/magent/redfish/core/uri_router.h"
 #include "json/value.h"
 #include "tensorflow_serving/util/net_http/server/public/httpserver_interface.h"
 #include "tensorflow_serving/util/net_http/server/public/response_code_enum.h"
@@ -37,6 +51,55 @@ using tensorflow::serving::net_http::HTTPStatusCode;
 using tensorflow::serving::net_http::RequestHandlerOptions;
 using tensorflow::serving::net_http::ServerRequestInterface;
 
+// The style that all JSON responses are written in. Responses are compact
+// unless pretty printing is requested, which is useful when reading them by
+// hand. This should be set before serving starts, since responses which are
+// already cached keep the style they were written in.
+inline std::atomic<JsonWriter::Style> &JsonResponseStyle() {
+  static std::atomic<JsonWriter::Style> style(JsonWriter::Style::kCompact);
+  return style;
+}
+inline void SetJsonResponseStyle(JsonWriter::Style style) {
+  JsonResponseStyle().store(style, std::memory_order_relaxed);
+}
+
+// Appends a JSON response body produced by write to the given string.
+inline void WriteJSONResponseBody(absl::FunctionRef<void(JsonWriter *)> write,
+                                  std::string *body) {
+  JsonWriter::Style style = JsonResponseStyle().load(std::memory_order_relaxed);
+  JsonWriter writer(body, style);
+  write(&writer);
+  if (style == JsonWriter::Style::kPretty) body->push_back('\n');
+}
+
+// Returns the encoding to compress the response body with, based on the
+// Accept-Encoding header of the request.
+inline ContentEncoding GetResponseEncoding(ServerRequestInterface *req) {
+  return NegotiateContentEncoding(req->GetRequestHeader("Accept-Encoding"));
+}
+
+// Writes a JSON response body which is generated for every request. Bodies
+// which are large enough are compressed with the fastest compression level if
+// the client accepts it.
+inline void WriteDynamicJSONBody(ServerRequestInterface *req,
+                                 absl::string_view body) {
+  tensorflow::serving::net_http::SetContentType(req, "application/json");
+  req->OverwriteResponseHeader("Vary", "Accept-Encoding");
+  ContentEncoding encoding = GetResponseEncoding(req);
+  if (body.size() >= kMinCompressedBodySize &&
+      encoding != ContentEncoding::kIdentity) {
+    absl::StatusOr<std::string> compressed =
+        CompressBody(body, encoding, kDynamicCompressionLevel);
+    if (compressed.ok()) {
+      req->OverwriteResponseHeader("Content-Encoding",
+                                   ContentEncodingName(encoding));
+      req->WriteResponseString(*compressed);
+      return;
+    }
+  }
+  req->WriteResponseString(body);
+}
+
 // Abstract base class to represent a Redfish resource.
 class Resource {
  public:
@@ -47,24 +110,20 @@ class Resource {
   virtual ~Resource() {}
 
   // Register a request handler to route requests corresponding to uri_.
-  // The default implementation does not support regex.
-  // To register a handler with regex, override this method and register a
-  // custom request dispatcher instead.
-  virtual void RegisterRequestHandler(HTTPServerInterface *server) {
-    RequestHandlerOptions handler_options;
-    server->RegisterRequestHandler(
-        this->Uri(),
-        [this](ServerRequestInterface *req) {
-          return this->RequestHandler(req);
-        },
-        handler_options);
+  // The URI can be a pattern with captures, as described in uri_router.h;
+  // the captured values are passed to the Get and Post methods. To route
+  // more than one URI to the resource, override this method.
+  virtual void RegisterRequestHandler(UriRouter *router) {
+    AddRoute(router, Uri(), [this](ServerRequestInterface *req,
+                                   const ParamsType &params) {
+      this->RequestHandler(req, params);
+    });
   }
 
  protected:
-  using ParamsType = std::vector<absl::variant<int, std::string>>;
+  using ParamsType = UriParams;
   // Generates a response for Http GET request
-  // "params" is to allow a regex dispatcher to pass capture values to the
-  // method.
+  // "params" is to allow a URI pattern to pass capture values to the method.
   virtual void Get(ServerRequestInterface *req, const ParamsType &params) = 0;
 
   // Generates a response for HTTP POST response
@@ -72,40 +131,126 @@ class Resource {
     req->ReplyWithStatus(HTTPStatusCode::METHOD_NA);
   }
 
-  virtual void RequestHandler(ServerRequestInterface *req) {
+  virtual void RequestHandler(ServerRequestInterface *req,
+                              const ParamsType &params) {
     if (req->http_method() == "GET") {
-      Get(req, ParamsType());
+      Get(req, params);
     } else if (req->http_method() == "POST") {
-      Post(req, ParamsType());
+      Post(req, params);
     } else {
       req->ReplyWithStatus(HTTPStatusCode::METHOD_NA);
     }
   }
 
+  // Adds a route to the router. The patterns used by resources are fixed, so
+  // a pattern which cannot be added is a programming error.
+  static void AddRoute(UriRouter *router, absl::string_view pattern,
+                       UriRouter::Handler handler) {
+    absl::Status status = router->AddRoute(pattern, std::move(handler));
+    Check(status.ok(), "route can be added") << status;
+  }
+
   // Get the URI corresponding to the resource
-  // This can be a regex when the resource is a member within a collection
+  // This can be a pattern when the resource is a member within a collection
   const absl::string_view Uri() const { return uri_; }
 
+  // Generates a response from the resource's response cache, keyed on the
+  // request URI. The router only matches the canonical form of a URI, so each
+  // resource is cached once and under the same URI as its @odata.id. If there
+  // is no valid cached body then generate is called to build the JSON and to
+  // set how long it remains valid for. Requests with an If-None-Match header
+  // that matches the body's ETag get a 304 instead of the body. Clients which
+  // accept compressed responses are sent the copy of the body which was
+  // compressed when it was cached, if there is one.
+  void CachedJSONResponse(
+      ServerRequestInterface *req,
+      absl::FunctionRef<Json::Value(ResponseValidity *)> generate) {
+    CachedJSONResponse(req,
+                       [&](ResponseValidity *validity, JsonWriter *writer) {
+                         WriteJsonValue(generate(validity), writer);
+                       });
+  }
+
+  // As above, but generate writes the JSON directly instead of building it.
+  void CachedJSONResponse(
+      ServerRequestInterface *req,
+      absl::FunctionRef<void(ResponseValidity *, JsonWriter *)> generate) {
+    std::shared_ptr<const ResponseCache::Response> response =
+        response_cache_.GetOrGenerate(
+            req->uri_path(), [&](ResponseValidity *validity) {
+              std::string body;
+              WriteJSONResponseBody(
+                  [&](JsonWriter *writer) { generate(validity, writer); },
+                  &body);
+              return body;
+            });
+    const ResponseCache::Response::Encoded *encoded =
+        response->Find(GetResponseEncoding(req));
+    absl::string_view etag = encoded ? encoded->etag : response->etag;
+    req->OverwriteResponseHeader("Vary", "Accept-Encoding");
+    req->OverwriteResponseHeader("ETag", etag);
+    if (IfNoneMatchMatches(req->GetRequestHeader("If-None-Match"), etag)) {
+      req->ReplyWithStatus(HTTPStatusCode::NOT_MODIFIED);
+      return;
+    }
+    tensorflow::serving::net_http::SetContentType(req, "application/json");
+    if (encoded) {
+      req->OverwriteResponseHeader("Content-Encoding",
+                                   ContentEncodingName(encoded->encoding));
+      req->WriteResponseString(encoded->body);
+    } else {
+      req->WriteResponseString(response->body);
+    }
+    req->ReplyWithStatus(HTTPStatusCode::OK);
+  }
+
  private:
   const std::string uri_;
+  ResponseCache response_cache_;
 };
 
 // Factory function to create a resource given the construction arguments.
 // It is recommended to use this function to create an instance of a resource.
 template <typename ResourceType, typename... Args>
-std::unique_ptr<Resource> CreateResource(HTTPServerInterface *server,
-                                         Args &&... args) {
+std::unique_ptr<Resource> CreateResource(UriRouter *router, Args &&... args) {
   auto resource = absl::make_unique<ResourceType>(std::forward<Args>(args)...);
-  resource->RegisterRequestHandler(server);
+  resource->RegisterRequestHandler(router);
   return std::move(resource);
 }
 
+// Generate a response with the json written by write and set http status OK.
+// The body is written into a per-thread buffer which is reused across
+// responses.
+inline void JSONResponseOK(ServerRequestInterface *req,
+                           absl::FunctionRef<void(JsonWriter *)> write) {
+  thread_local std::string buffer;
+  buffer.clear();
+  WriteJSONResponseBody(write, &buffer);
+  WriteDynamicJSONBody(req, buffer);
+  req->ReplyWithStatus(HTTPStatusCode::OK);
+}
+
 // Generate a response with the input json object and set http status OK.
 inline void JSONResponseOK(const Json::Value &json,
                            ServerRequestInterface *req) {
-  tensorflow::serving::net_http::SetContentType(req, "application/json");
-  req->WriteResponseString(json.toStyledString());
-  req->ReplyWithStatus(HTTPStatusCode::OK);
+  JSONResponseOK(req,
+                 [&](JsonWriter *writer) { WriteJsonValue(json, writer); });
+}
+
+// Returns the oldest data the client is willing to accept, from the max-age
+// directive of the Cache-Control request header. Returns an infinite duration
+// if the client does not specify a max-age.
+inline absl::Duration GetRequestedMaxAge(ServerRequestInterface *req) {
+  absl::string_view cache_control = req->GetRequestHeader("Cache-Control");
+  for (absl::string_view directive : absl::StrSplit(cache_control, ',')) {
+    directive = absl::StripAsciiWhitespace(directive);
+    int seconds;
+    if (absl::ConsumePrefix(&directive, "max-age=") &&
+        absl::SimpleAtoi(directive, &seconds) && seconds >= 0) {
+      return absl::Seconds(seconds);
+    }
+  }
+  return absl::InfiniteDuration();
 }
 
 }  // namespace ecclesia
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "ecclesia/magent/redfish/core/response_cache.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/functional/function_ref.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "absl/synchronization/mutex.h"
+#include "ecclesia/lib/hash/fnv.h"
+#include "ecclesia/magent/redfish/core/compression.h"
+
+namespace ecclesia {
+
+const ResponseCache::Response::Encoded *ResponseCache::Response::Find(
+    ContentEncoding encoding) const {
+  for (const Encoded &copy : encoded) {
+    if (copy.encoding == encoding) return &copy;
+  }
+  return nullptr;
+}
+
+ResponseCache::ResponseCache() : ResponseCache(Options()) {}
+
+ResponseCache::ResponseCache(const Options &options) : options_(options) {}
+
+std::shared_ptr<const ResponseCache::Response> ResponseCache::GetOrGenerate(
+    absl::string_view key,
+    absl::FunctionRef<std::string(ResponseValidity *)> generate) {
+  {
+    absl::MutexLock ml(&mutex_);
+    auto iter = entries_.find(key);
+    if (iter != entries_.end() && iter->second.validity.IsValid()) {
+      return iter->second.response;
+    }
+  }
+
+  // Two requests which miss at the same time will both generate the body.
+  // That is harmless, and avoids holding the lock while generating.
+  Entry entry;
+  auto generated = std::make_shared<Response>();
+  generated->body = generate(&entry.validity);
+  generated->etag = ComputeEtag(generated->body);
+  if (generated->body.size() >= options_.min_compressed_size) {
+    for (ContentEncoding encoding :
+         {ContentEncoding::kGzip, ContentEncoding::kDeflate}) {
+      absl::StatusOr<std::string> compressed = CompressBody(
+          generated->body, encoding, kCachedCompressionLevel);
+      // Only keep copies which actually save something.
+      if (!compressed.ok() || compressed->size() >= generated->body.size()) {
+        continue;
+      }
+      generated->encoded.push_back(
+          {.encoding = encoding,
+           .body = *std::move(compressed),
+           .etag = EncodedEtag(generated->etag, encoding)});
+    }
+  }
+  std::shared_ptr<const Response> response = std::move(generated);
+  entry.response = response;
+
+  absl::MutexLock ml(&mutex_);
+  if (entries_.size() >= options_.max_entries && !entries_.contains(key)) {
+    MakeRoom();
+  }
+  entries_.insert_or_assign(std::string(key), std::move(entry));
+  return response;
+}
+
+void ResponseCache::MakeRoom() {
+  for (auto iter = entries_.begin(); iter != entries_.end();) {
+    if (iter->second.validity.IsValid()) {
+      ++iter;
+    } else {
+      entries_.erase(iter++);
+    }
+  }
+  while (!entries_.empty() && entries_.size() >= options_.max_entries) {
+    entries_.erase(entries_.begin());
+  }
+}
+
+void ResponseCache::Clear() {
+  absl::MutexLock ml(&mutex_);
+  entries_.clear();
+}
+
+std::string ComputeEtag(absl::string_view body) {
+  // The ETag only needs to change when the body does, but it has to be the
+  // same across restarts so that clients' cached copies stay valid.
+  return absl::StrFormat("\"%016x\"", Fnv1a64(body));
+}
+
+std::string EncodedEtag(absl::string_view etag, ContentEncoding encoding) {
+  // Insert the name of the coding before the closing quote.
+  absl::string_view opaque = etag;
+  absl::ConsumeSuffix(&opaque, "\"");
+  return absl::StrCat(opaque, "-", ContentEncodingName(encoding), "\"");
+}
+
+bool IfNoneMatchMatches(absl::string_view if_none_match,
+                        absl::string_view etag) {
+  for (absl::string_view candidate : absl::StrSplit(if_none_match, ',')) {
+    candidate = absl::StripAsciiWhitespace(candidate);
+    if (candidate == "*") return true;
+    absl::ConsumePrefix(&candidate, "W/");
+    if (candidate == etag) return true;
+  }
+  return false;
+}
+
+}  // namespace ecclesia
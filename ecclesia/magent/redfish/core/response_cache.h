@@ -0,0 +1,174 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+// This library provides a cache of serialized response bodies. Many Redfish
+// resources produce the same response on every request, or only change when
+// some underlying data changes, and so there is no need to rebuild and
+// serialize their JSON every time.
+//
+// Each cached body is stored along with a strong ETag computed from its
+// contents, so that clients which already have the body can be told so with a
+// 304 instead of it being sent again. How long a body can be served for is
+// described by a ResponseValidity, which the resource provides when it
+// generates the body.
+//
+// Bodies which are large enough are also compressed when they are cached,
+// once for each supported content coding, so that clients which accept
+// compressed responses can be served without compressing on every request.
+
+#ifndef ECCLESIA_MAGENT_REDFISH_CORE_RESPONSE_CACHE_H_
+#define ECCLESIA_MAGENT_REDFISH_CORE_RESPONSE_CACHE_H_
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/function_ref.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "ecclesia/lib/cache/rcu_snapshot.h"
+#include "ecclesia/lib/time/clock.h"
+#include "ecclesia/magent/redfish/core/compression.h"
+
+namespace ecclesia {
+
+// Describes how long a cached response can continue to be served.
+class ResponseValidity {
+ public:
+  // A response which can never be served from the cache.
+  ResponseValidity() : is_valid_([]() { return false; }) {}
+
+  // A response which never changes.
+  static ResponseValidity Static() {
+    return ResponseValidity([]() { return true; });
+  }
+
+  // A response which can be served for a fixed amount of time.
+  static ResponseValidity Ttl(absl::Duration ttl,
+                              const Clock *clock = Clock::RealClock()) {
+    absl::Time expiry = clock->Now() + ttl;
+    return ResponseValidity(
+        [clock, expiry]() { return clock->Now() < expiry; });
+  }
+
+  // A response which was generated from the given snapshot, and so can be
+  // served until the snapshot is replaced.
+  template <typename T>
+  static ResponseValidity WhileFresh(RcuSnapshot<T> snapshot) {
+    return ResponseValidity(
+        [snapshot = std::move(snapshot)]() { return snapshot.IsFresh(); });
+  }
+
+  // A response which is only valid while all of the given validities are.
+  static ResponseValidity AllOf(ResponseValidity a, ResponseValidity b) {
+    return ResponseValidity(
+        [a = std::move(a), b = std::move(b)]() {
+          return a.IsValid() && b.IsValid();
+        });
+  }
+
+  bool IsValid() const { return is_valid_(); }
+
+ private:
+  explicit ResponseValidity(std::function<bool()> is_valid)
+      : is_valid_(std::move(is_valid)) {}
+
+  std::function<bool()> is_valid_;
+};
+
+class ResponseCache {
+ public:
+  // A serialized response body and its ETag. The ETag is already quoted, and
+  // so can be used as the value of an ETag header as-is.
+  struct Response {
+    // A copy of the body compressed with a content coding. Each coding has
+    // its own ETag, since the bytes sent differ.
+    struct Encoded {
+      ContentEncoding encoding;
+      std::string body;
+      std::string etag;
+    };
+
+    // Returns the copy of the body compressed with the given encoding, or
+    // null if there is not one.
+    const Encoded *Find(ContentEncoding encoding) const;
+
+    std::string body;
+    std::string etag;
+    std::vector<Encoded> encoded;
+  };
+
+  struct Options {
+    // Bodies smaller than this are only cached uncompressed.
+    size_t min_compressed_size = kMinCompressedBodySize;
+    // The most responses that are kept. When the cache is full, responses
+    // which are no longer valid are dropped first, and then arbitrary ones.
+    size_t max_entries = kDefaultMaxEntries;
+  };
+
+  // Far more than the number of URIs served by any single resource.
+  static constexpr size_t kDefaultMaxEntries = 1024;
+
+  ResponseCache();
+  explicit ResponseCache(const Options &options);
+  ResponseCache(const ResponseCache &other) = delete;
+  ResponseCache &operator=(const ResponseCache &other) = delete;
+
+  // Returns the cached response for the given key if there is one and it is
+  // still valid. Otherwise calls generate to produce a new body and its
+  // validity, and caches it. The generator is not called with any locks held.
+  std::shared_ptr<const Response> GetOrGenerate(
+      absl::string_view key,
+      absl::FunctionRef<std::string(ResponseValidity *)> generate);
+
+  // Drop every cached response.
+  void Clear();
+
+ private:
+  struct Entry {
+    std::shared_ptr<const Response> response;
+    ResponseValidity validity;
+  };
+
+  // Drops entries until there is room for a new one.
+  void MakeRoom() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const Options options_;
+
+  absl::Mutex mutex_;
+  absl::flat_hash_map<std::string, Entry> entries_ ABSL_GUARDED_BY(mutex_);
+};
+
+// Computes a strong ETag for a response body.
+std::string ComputeEtag(absl::string_view body);
+
+// Derives the ETag for a compressed copy of a body from the ETag of the
+// uncompressed body.
+std::string EncodedEtag(absl::string_view etag, ContentEncoding encoding);
+
+// Indicates if an If-None-Match header value matches the given ETag. As the
+// header is only used for conditional GETs, weak validators match as well.
+bool IfNoneMatchMatches(absl::string_view if_none_match,
+                        absl::string_view etag);
+
+}  // namespace ecclesia
+
+#endif  // ECCLESIA_MAGENT_REDFISH_CORE_RESPONSE_CACHE_H_
@@ -0,0 +1,219 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "ecclesia/magent/redfish/core/response_cache.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+#include "ecclesia/lib/cache/rcu_snapshot.h"
+#include "ecclesia/lib/cache/rcu_store.h"
+#include "ecclesia/lib/time/clock_fake.h"
+#include "ecclesia/magent/redfish/core/compression.h"
+
+namespace ecclesia {
+namespace {
+
+// Wraps a body up as a generator, counting how many times it is called.
+class Generator {
+ public:
+  Generator(std::string body, ResponseValidity validity)
+      : body_(std::move(body)), validity_(std::move(validity)) {}
+
+  std::string operator()(ResponseValidity *validity) {
+    ++calls_;
+    *validity = validity_;
+    return body_;
+  }
+
+  int calls() const { return calls_; }
+
+ private:
+  std::string body_;
+  ResponseValidity validity_;
+  int calls_ = 0;
+};
+
+TEST(ResponseCacheTest, StaticResponsesAreGeneratedOnce) {
+  ResponseCache cache;
+  Generator generate("{}", ResponseValidity::Static());
+
+  auto response = cache.GetOrGenerate("/redfish/v1", std::ref(generate));
+  EXPECT_EQ(response->body, "{}");
+  EXPECT_EQ(response->etag, ComputeEtag("{}"));
+  EXPECT_EQ(cache.GetOrGenerate("/redfish/v1", std::ref(generate)), response);
+  EXPECT_EQ(generate.calls(), 1);
+
+  // Each key is cached separately.
+  cache.GetOrGenerate("/redfish/v1/Systems", std::ref(generate));
+  EXPECT_EQ(generate.calls(), 2);
+
+  cache.Clear();
+  cache.GetOrGenerate("/redfish/v1", std::ref(generate));
+  EXPECT_EQ(generate.calls(), 3);
+}
+
+TEST(ResponseCacheTest, DefaultValidityIsNeverCached) {
+  ResponseCache cache;
+  Generator generate("{}", ResponseValidity());
+  cache.GetOrGenerate("/", std::ref(generate));
+  cache.GetOrGenerate("/", std::ref(generate));
+  EXPECT_EQ(generate.calls(), 2);
+}
+
+TEST(ResponseCacheTest, TtlExpires) {
+  FakeClock clock;
+  ResponseCache cache;
+  Generator generate("{}", ResponseValidity::Ttl(absl::Seconds(10), &clock));
+
+  cache.GetOrGenerate("/", std::ref(generate));
+  clock.AdvanceTime(absl::Seconds(9));
+  cache.GetOrGenerate("/", std::ref(generate));
+  EXPECT_EQ(generate.calls(), 1);
+  clock.AdvanceTime(absl::Seconds(1));
+  cache.GetOrGenerate("/", std::ref(generate));
+  EXPECT_EQ(generate.calls(), 2);
+}
+
+TEST(ResponseCacheTest, SnapshotUpdatesInvalidate) {
+  RcuStore<int> store(1);
+  ResponseCache cache;
+  int calls = 0;
+  auto generate = [&](ResponseValidity *validity) {
+    ++calls;
+    RcuSnapshot<int> snapshot = store.Read();
+    *validity = ResponseValidity::WhileFresh(snapshot);
+    return std::to_string(*snapshot);
+  };
+
+  EXPECT_EQ(cache.GetOrGenerate("/", generate)->body, "1");
+  EXPECT_EQ(cache.GetOrGenerate("/", generate)->body, "1");
+  EXPECT_EQ(calls, 1);
+  store.Update(2);
+  EXPECT_EQ(cache.GetOrGenerate("/", generate)->body, "2");
+  EXPECT_EQ(calls, 2);
+}
+
+TEST(ResponseCacheTest, AllOfRequiresEveryValidity) {
+  RcuStore<int> store(1);
+  FakeClock clock;
+  ResponseValidity validity =
+      ResponseValidity::AllOf(ResponseValidity::WhileFresh(store.Read()),
+                              ResponseValidity::Ttl(absl::Seconds(1), &clock));
+  EXPECT_TRUE(validity.IsValid());
+  clock.AdvanceTime(absl::Seconds(1));
+  EXPECT_FALSE(validity.IsValid());
+}
+
+TEST(ResponseCacheTest, EtagsDependOnTheBody) {
+  EXPECT_EQ(ComputeEtag("{\"a\": 1}"), ComputeEtag("{\"a\": 1}"));
+  EXPECT_NE(ComputeEtag("{\"a\": 1}"), ComputeEtag("{\"a\": 2}"));
+  EXPECT_EQ(ComputeEtag("").front(), '"');
+  EXPECT_EQ(ComputeEtag("").back(), '"');
+}
+
+TEST(ResponseCacheTest, LargeBodiesAreCompressedOnce) {
+  std::string body(4096, 'a');
+  ResponseCache cache;
+  Generator generate(body, ResponseValidity::Static());
+
+  auto response = cache.GetOrGenerate("/", std::ref(generate));
+  EXPECT_EQ(response->body, body);
+  const ResponseCache::Response::Encoded *gzip =
+      response->Find(ContentEncoding::kGzip);
+  ASSERT_NE(gzip, nullptr);
+  EXPECT_LT(gzip->body.size(), body.size());
+  EXPECT_EQ(gzip->etag, EncodedEtag(response->etag, ContentEncoding::kGzip));
+  EXPECT_NE(gzip->etag, response->etag);
+  const ResponseCache::Response::Encoded *deflate =
+      response->Find(ContentEncoding::kDeflate);
+  ASSERT_NE(deflate, nullptr);
+  EXPECT_NE(deflate->etag, gzip->etag);
+  EXPECT_EQ(response->Find(ContentEncoding::kIdentity), nullptr);
+
+  // The compressed copies are cached along with the body.
+  EXPECT_EQ(cache.GetOrGenerate("/", std::ref(generate))->Find(
+                ContentEncoding::kGzip),
+            gzip);
+  EXPECT_EQ(generate.calls(), 1);
+}
+
+TEST(ResponseCacheTest, SmallBodiesAreNotCompressed) {
+  ResponseCache cache({.min_compressed_size = 100});
+  Generator small(std::string(99, 'a'), ResponseValidity::Static());
+  EXPECT_TRUE(cache.GetOrGenerate("/small", std::ref(small))->encoded.empty());
+  Generator large(std::string(100, 'a'), ResponseValidity::Static());
+  EXPECT_FALSE(cache.GetOrGenerate("/large", std::ref(large))->encoded.empty());
+}
+
+TEST(ResponseCacheTest, InvalidEntriesAreDroppedFirstWhenFull) {
+  FakeClock clock;
+  ResponseCache cache({.max_entries = 2});
+  Generator expiring("{}", ResponseValidity::Ttl(absl::Seconds(10), &clock));
+  Generator fixed("{}", ResponseValidity::Static());
+  Generator other("{}", ResponseValidity::Static());
+
+  cache.GetOrGenerate("/expiring", std::ref(expiring));
+  cache.GetOrGenerate("/fixed", std::ref(fixed));
+  clock.AdvanceTime(absl::Seconds(10));
+  cache.GetOrGenerate("/other", std::ref(other));
+
+  // The expired response made room, so the others are still cached.
+  cache.GetOrGenerate("/fixed", std::ref(fixed));
+  cache.GetOrGenerate("/other", std::ref(other));
+  EXPECT_EQ(fixed.calls(), 1);
+  EXPECT_EQ(other.calls(), 1);
+}
+
+TEST(ResponseCacheTest, EntriesAreBounded) {
+  ResponseCache cache({.max_entries = 1});
+  Generator first("{}", ResponseValidity::Static());
+  Generator second("{}", ResponseValidity::Static());
+
+  cache.GetOrGenerate("/first", std::ref(first));
+  cache.GetOrGenerate("/first", std::ref(first));
+  EXPECT_EQ(first.calls(), 1);
+
+  // Only one response is kept, so each key pushes out the other.
+  cache.GetOrGenerate("/second", std::ref(second));
+  cache.GetOrGenerate("/first", std::ref(first));
+  cache.GetOrGenerate("/second", std::ref(second));
+  EXPECT_EQ(first.calls(), 2);
+  EXPECT_EQ(second.calls(), 2);
+}
+
+TEST(ResponseCacheTest, EncodedEtags) {
+  EXPECT_EQ(EncodedEtag("\"0123\"", ContentEncoding::kGzip), "\"0123-gzip\"");
+  EXPECT_EQ(EncodedEtag("\"0123\"", ContentEncoding::kDeflate),
+            "\"0123-deflate\"");
+}
+
+TEST(ResponseCacheTest, IfNoneMatch) {
+  std::string etag = ComputeEtag("{}");
+  EXPECT_TRUE(IfNoneMatchMatches(etag, etag));
+  EXPECT_TRUE(IfNoneMatchMatches("*", etag));
+  EXPECT_TRUE(IfNoneMatchMatches("\"other\", " + etag, etag));
+  EXPECT_TRUE(IfNoneMatchMatches("W/" + etag, etag));
+  EXPECT_FALSE(IfNoneMatchMatches("", etag));
+  EXPECT_FALSE(IfNoneMatchMatches("\"other\"", etag));
+}
+
+}  // namespace
+}  // namespace ecclesia
@@ -21,9 +21,8 @@
 
 #include "absl/strings/string_view.h"
 #include "absl/strings/strip.h"
-#include "absl/types/variant.h"
 #include "ecclesia/magent/redfish/core/resource.h"
-#include "tensorflow_serving/util/net_http/server/public/httpserver_interface.h"
+#include "ecclesia/magent/redfish/core/uri_router.h"
 #include "tensorflow_serving/util/net_http/server/public/response_code_enum.h"
 #include "tensorflow_serving/util/net_http/server/public/server_request_interface.h"
 
@@ -40,24 +39,14 @@ class ServiceRootResource : public Resource {
   // Register a request handler to route requests corresponding to uri_.
   // This treats the URI with a trailing forward slash as equivalent to a
   // request without a trailing forward slash.
-  void RegisterRequestHandler(HTTPServerInterface *server) override {
-    server->RegisterRequestDispatcher(
-        [this](ServerRequestInterface *http_request)
-            -> tensorflow::serving::net_http::RequestHandler {
-          if (http_request->uri_path() == this->Uri()) {
-            return [this](ServerRequestInterface *req) {
-              return this->RequestHandler(req);
-            };
-          } else if (http_request->uri_path() ==
-                     absl::StripSuffix(this->Uri(), "/")) {
-            return [this](ServerRequestInterface *req) {
-              return this->RedirectHandler(req);
-            };
-          } else {
-            return nullptr;
-          }
-        },
-        RequestHandlerOptions());
+  void RegisterRequestHandler(UriRouter *router) override {
+    Resource::RegisterRequestHandler(router);
+    absl::string_view without_slash = absl::StripSuffix(this->Uri(), "/");
+    if (without_slash == this->Uri()) return;
+    AddRoute(router, without_slash,
+             [this](ServerRequestInterface *req, const ParamsType &) {
+               this->RedirectHandler(req);
+             });
   }
 
  private:
@@ -0,0 +1,192 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/redfish/core/uri_router.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/status/status.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tensorflow_serving/util/net_http/server/public/httpserver_interface.h"
+#include "tensorflow_serving/util/net_http/server/public/server_request_interface.h"
+
+namespace ecclesia {
+
+using tensorflow::serving::net_http::HTTPServerInterface;
+using tensorflow::serving::net_http::RequestHandlerOptions;
+using tensorflow::serving::net_http::ServerRequestInterface;
+
+struct UriRouter::Node {
+  absl::flat_hash_map<std::string, std::unique_ptr<Node>> literals;
+  std::unique_ptr<Node> int_child;
+  std::unique_ptr<Node> string_child;
+  std::unique_ptr<Node> path_child;
+  // Set if a route ends at this node.
+  Handler handler;
+};
+
+namespace {
+
+constexpr absl::string_view kIntSegment = "{int}";
+constexpr absl::string_view kStringSegment = "{string}";
+constexpr absl::string_view kPathSegment = "{path}";
+
+// Enough for the segments of any Redfish URI without allocating.
+using Segments = absl::InlinedVector<absl::string_view, 16>;
+
+// Splits a path into its segments. The path must be absolute. A trailing
+// slash produces an empty final segment, so that "/a/" and "/a" are distinct.
+bool SplitPath(absl::string_view path, Segments *segments) {
+  if (!absl::ConsumePrefix(&path, "/")) return false;
+  for (absl::string_view segment : absl::StrSplit(path, '/')) {
+    segments->push_back(segment);
+  }
+  return true;
+}
+
+// Matches the \w+ words accepted by {string} and {path}.
+bool IsWord(absl::string_view segment) {
+  if (segment.empty()) return false;
+  for (char c : segment) {
+    if (!absl::ascii_isalnum(c) && c != '_') return false;
+  }
+  return true;
+}
+
+// Parses the segments accepted by {int}. Only the canonical form of a number
+// is accepted, with no leading zeros, so that each value has a single URI.
+bool ParseInt(absl::string_view segment, int *value) {
+  if (segment.empty() || (segment.size() > 1 && segment[0] == '0')) {
+    return false;
+  }
+  for (char c : segment) {
+    if (!absl::ascii_isdigit(c)) return false;
+  }
+  return absl::SimpleAtoi(segment, value);
+}
+
+}  // namespace
+
+UriRouter::UriRouter() : root_(std::make_unique<Node>()) {}
+
+UriRouter::~UriRouter() = default;
+
+absl::Status UriRouter::AddRoute(absl::string_view pattern, Handler handler) {
+  Segments segments;
+  if (!SplitPath(pattern, &segments)) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("URI pattern '%s' is not an absolute path", pattern));
+  }
+  Node *node = root_.get();
+  for (absl::string_view segment : segments) {
+    std::unique_ptr<Node> *child;
+    if (segment == kIntSegment) {
+      child = &node->int_child;
+    } else if (segment == kStringSegment) {
+      child = &node->string_child;
+    } else if (segment == kPathSegment) {
+      child = &node->path_child;
+    } else if (segment.find_first_of("{}") != absl::string_view::npos) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "URI pattern '%s' has an unknown segment '%s'", pattern, segment));
+    } else {
+      child = &node->literals[segment];
+    }
+    if (!*child) *child = std::make_unique<Node>();
+    node = child->get();
+  }
+  if (node->handler) {
+    return absl::AlreadyExistsError(
+        absl::StrFormat("URI pattern '%s' already has a route", pattern));
+  }
+  node->handler = std::move(handler);
+  return absl::OkStatus();
+}
+
+const UriRouter::Handler *UriRouter::MatchSegments(
+    const Node &node, absl::Span<const absl::string_view> segments,
+    UriParams *params) {
+  if (segments.empty()) return node.handler ? &node.handler : nullptr;
+  absl::string_view segment = segments.front();
+  absl::Span<const absl::string_view> rest = segments.subspan(1);
+
+  auto iter = node.literals.find(segment);
+  if (iter != node.literals.end()) {
+    if (const Handler *handler = MatchSegments(*iter->second, rest, params)) {
+      return handler;
+    }
+  }
+  int value;
+  if (node.int_child && ParseInt(segment, &value)) {
+    params->push_back(value);
+    if (const Handler *handler =
+            MatchSegments(*node.int_child, rest, params)) {
+      return handler;
+    }
+    params->pop_back();
+  }
+  if (!IsWord(segment)) return nullptr;
+  if (node.string_child) {
+    params->push_back(std::string(segment));
+    if (const Handler *handler =
+            MatchSegments(*node.string_child, rest, params)) {
+      return handler;
+    }
+    params->pop_back();
+  }
+  if (node.path_child) {
+    // Try consuming one or more words, shortest first.
+    for (size_t i = 1; i <= segments.size(); ++i) {
+      if (!IsWord(segments[i - 1])) break;
+      if (const Handler *handler = MatchSegments(
+              *node.path_child, segments.subspan(i), params)) {
+        return handler;
+      }
+    }
+  }
+  return nullptr;
+}
+
+const UriRouter::Handler *UriRouter::Match(absl::string_view path,
+                                           UriParams *params) const {
+  Segments segments;
+  if (!SplitPath(path, &segments)) return nullptr;
+  return MatchSegments(*root_, segments, params);
+}
+
+void UriRouter::RegisterRequestDispatcher(HTTPServerInterface *server) {
+  server->RegisterRequestDispatcher(
+      [this](ServerRequestInterface *http_request)
+          -> tensorflow::serving::net_http::RequestHandler {
+        UriParams params;
+        const Handler *handler = Match(http_request->uri_path(), &params);
+        if (handler == nullptr) return nullptr;
+        return [handler, params = std::move(params)](
+                   ServerRequestInterface *req) { (*handler)(req, params); };
+      },
+      RequestHandlerOptions());
+}
+
+}  // namespace ecclesia
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A router which maps request URIs to handlers. All of the URI patterns are
+// compiled up front into a trie of path segments, so routing a request is a
+// single walk over the segments of its path, no matter how many resources are
+// registered.
+//
+// URI patterns are paths where each segment is either a literal or one of:
+//   {int}     A decimal integer with no leading zeros, which is captured as
+//             an int.
+//   {string}  A word made of letters, digits and underscores, which is
+//             captured as a string.
+//   {path}    One or more segments which are words. This is not captured.
+// For example, "/redfish/v1/Systems/system/Memory/{int}".
+//
+// When more than one route could match a segment, literals are preferred over
+// {int}, which is preferred over {string}, which is preferred over {path}.
+
+#ifndef ECCLESIA_MAGENT_REDFISH_CORE_URI_ROUTER_H_
+#define ECCLESIA_MAGENT_REDFISH_CORE_URI_ROUTER_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "absl/types/variant.h"
+#include "tensorflow_serving/util/net_http/server/public/httpserver_interface.h"
+#include "tensorflow_serving/util/net_http/server/public/server_request_interface.h"
+
+namespace ecclesia {
+
+// The values captured from a request URI, in the order they appear.
+using UriParams = std::vector<absl::variant<int, std::string>>;
+
+class UriRouter {
+ public:
+  using Handler = std::function<void(
+      tensorflow::serving::net_http::ServerRequestInterface *,
+      const UriParams &)>;
+
+  UriRouter();
+  UriRouter(const UriRouter &) = delete;
+  UriRouter &operator=(const UriRouter &) = delete;
+  ~UriRouter();
+
+  // Adds a route for the given pattern. Fails if the pattern is malformed or
+  // if there is already a route for the same pattern.
+  absl::Status AddRoute(absl::string_view pattern, Handler handler);
+
+  // Finds the handler for a request path, filling in any captured values.
+  // Returns null if no route matches the path.
+  const Handler *Match(absl::string_view path, UriParams *params) const;
+
+  // Registers a single request dispatcher with the server which routes all
+  // requests through this router. Routes must not be added after this is
+  // called, and the router must outlive the server.
+  void RegisterRequestDispatcher(
+      tensorflow::serving::net_http::HTTPServerInterface *server);
+
+ private:
+  struct Node;
+
+  // Matches the remaining segments against the subtree under node, trying the
+  // more specific kinds of segment first and backtracking if they fail.
+  static const Handler *MatchSegments(
+      const Node &node, absl::Span<const absl::string_view> segments,
+      UriParams *params);
+
+  std::unique_ptr<Node> root_;
+};
+
+}  // namespace ecclesia
+
+#endif  // ECCLESIA_MAGENT_REDFISH_CORE_URI_ROUTER_H_
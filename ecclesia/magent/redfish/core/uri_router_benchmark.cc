@@ -0,0 +1,150 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks for routing requests with all of the Indus resources registered.
+// This compares the UriRouter against the previous approach, where the server
+// looked up exact URIs in a map and then tried a dispatcher for each pattern
+// resource in turn, each one compiling its regex for every request.
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "benchmark/benchmark.h"
+#include "ecclesia/magent/redfish/core/redfish_keywords.h"
+#include "ecclesia/magent/redfish/core/uri_router.h"
+#include "re2/re2.h"
+
+namespace ecclesia {
+namespace {
+
+// The exact URIs served by the Indus Redfish service.
+const std::vector<std::string> &IndusUris() {
+  static const auto *uris = new std::vector<std::string>({
+      "/redfish",
+      kServiceRootUri,
+      kComputerSystemCollectionUri,
+      kComputerSystemUri,
+      kChassisCollectionUri,
+      kMemoryCollectionUri,
+      kProcessorCollectionUri,
+      kThermalUri,
+      kUpdateServiceUri,
+      kSoftwareInventoryCollectionUri,
+      kSoftwareInventoryMagentUri,
+      kFirmwareInventoryCollectionUri,
+      kSysmodelInitPhasesUri,
+  });
+  return *uris;
+}
+
+// The URI patterns served by the Indus Redfish service, in the order the
+// resources are registered.
+const std::vector<std::string> &IndusPatterns() {
+  static const auto *patterns = new std::vector<std::string>({
+      kChassisUriPattern,
+      kMemoryUriPattern,
+      kAssemblyUriPattern,
+      kMemoryMetricsUriPattern,
+      kProcessorUriPattern,
+      kProcessorMetricsUriPattern,
+  });
+  return *patterns;
+}
+
+// The same patterns, written as the regexes that were used before.
+const std::vector<std::string> &IndusRegexes() {
+  static const auto *regexes = new std::vector<std::string>({
+      "/redfish/v1/Chassis/(\\w+)",
+      "/redfish/v1/Systems/system/Memory/(\\d+)",
+      "/redfish/v1/[\\w/]+/Assembly",
+      "/redfish/v1/Systems/system/Memory/(\\d+)/MemoryMetrics",
+      "/redfish/v1/Systems/system/Processors/(\\d+)",
+      "/redfish/v1/Systems/system/Processors/(\\d+)/ProcessorMetrics",
+  });
+  return *regexes;
+}
+
+// A mix of requests a collector makes while walking the tree.
+const std::vector<std::string> &RequestPaths() {
+  static const auto *paths = new std::vector<std::string>({
+      "/redfish/v1/",
+      "/redfish/v1/Chassis/chassis/Thermal",
+      "/redfish/v1/Chassis/chassis",
+      "/redfish/v1/Systems/system/Memory/17",
+      "/redfish/v1/Systems/system/Memory/17/MemoryMetrics",
+      "/redfish/v1/Systems/system/Processors/1/ProcessorMetrics",
+      "/redfish/v1/Chassis/Sleipnir/Assembly",
+      "/redfish/v1/Managers",
+  });
+  return *paths;
+}
+
+void BM_RegexDispatchers(benchmark::State &state) {
+  absl::flat_hash_map<std::string, int> exact;
+  for (const std::string &uri : IndusUris()) exact[uri] = 0;
+  const std::vector<std::string> &regexes = IndusRegexes();
+
+  for (auto _ : state) {
+    for (const std::string &path : RequestPaths()) {
+      if (exact.contains(path)) continue;
+      for (const std::string &pattern : regexes) {
+        RE2 regex(pattern);
+        if (RE2::FullMatch(path, regex)) {
+          // The index resources compiled the regex again to parse the index.
+          if (regex.NumberOfCapturingGroups() == 0) break;
+          RE2 index_regex(pattern);
+          std::string index;
+          benchmark::DoNotOptimize(RE2::FullMatch(path, index_regex, &index));
+          break;
+        }
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * RequestPaths().size());
+}
+BENCHMARK(BM_RegexDispatchers);
+
+void BM_UriRouter(benchmark::State &state) {
+  UriRouter router;
+  auto handler = [](tensorflow::serving::net_http::ServerRequestInterface *,
+                    const UriParams &) {};
+  for (const std::string &uri : IndusUris()) {
+    if (!router.AddRoute(uri, handler).ok()) {
+      state.SkipWithError("failed to add a route");
+      return;
+    }
+  }
+  for (const std::string &pattern : IndusPatterns()) {
+    if (!router.AddRoute(pattern, handler).ok()) {
+      state.SkipWithError("failed to add a route");
+      return;
+    }
+  }
+
+  for (auto _ : state) {
+    for (const std::string &path : RequestPaths()) {
+      UriParams params;
+      benchmark::DoNotOptimize(router.Match(path, &params));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * RequestPaths().size());
+}
+BENCHMARK(BM_UriRouter);
+
+}  // namespace
+}  // namespace ecclesia
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/redfish/core/uri_router.h"
+
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/variant.h"
+#include "tensorflow_serving/util/net_http/server/public/server_request_interface.h"
+
+namespace ecclesia {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using tensorflow::serving::net_http::ServerRequestInterface;
+
+class UriRouterTest : public ::testing::Test {
+ protected:
+  // Adds a route whose handler records the name of the route when called.
+  void AddRoute(absl::string_view pattern, std::string name) {
+    absl::Status status = router_.AddRoute(
+        pattern, [this, name](ServerRequestInterface *, const UriParams &) {
+          matched_ = name;
+        });
+    ASSERT_TRUE(status.ok()) << status;
+  }
+
+  // Returns the name of the route that matches the path, or an empty string
+  // if none do.
+  std::string Route(absl::string_view path, UriParams *params = nullptr) {
+    UriParams unused;
+    if (params == nullptr) params = &unused;
+    params->clear();
+    matched_.clear();
+    const UriRouter::Handler *handler = router_.Match(path, params);
+    if (handler == nullptr) return "";
+    (*handler)(nullptr, *params);
+    return matched_;
+  }
+
+  UriRouter router_;
+  std::string matched_;
+};
+
+TEST_F(UriRouterTest, LiteralRoutes) {
+  AddRoute("/redfish", "root");
+  AddRoute("/redfish/v1/", "service_root");
+  AddRoute("/redfish/v1/Systems", "systems");
+
+  EXPECT_EQ(Route("/redfish"), "root");
+  EXPECT_EQ(Route("/redfish/v1/"), "service_root");
+  EXPECT_EQ(Route("/redfish/v1/Systems"), "systems");
+  EXPECT_EQ(Route("/redfish/v1"), "");
+  EXPECT_EQ(Route("/redfish/v1/Systems/"), "");
+  EXPECT_EQ(Route("/redfish/v1/Chassis"), "");
+  EXPECT_EQ(Route("redfish"), "");
+  EXPECT_EQ(Route(""), "");
+}
+
+TEST_F(UriRouterTest, TypedCaptures) {
+  AddRoute("/redfish/v1/Systems/system/Memory/{int}", "memory");
+  AddRoute("/redfish/v1/Systems/system/Memory/{int}/MemoryMetrics",
+           "memory_metrics");
+  AddRoute("/redfish/v1/Chassis/{string}", "chassis");
+
+  UriParams params;
+  EXPECT_EQ(Route("/redfish/v1/Systems/system/Memory/12", &params), "memory");
+  EXPECT_THAT(params, ElementsAre(absl::variant<int, std::string>(12)));
+  EXPECT_EQ(
+      Route("/redfish/v1/Systems/system/Memory/3/MemoryMetrics", &params),
+      "memory_metrics");
+  EXPECT_THAT(params, ElementsAre(absl::variant<int, std::string>(3)));
+  EXPECT_EQ(Route("/redfish/v1/Chassis/Sleipnir", &params), "chassis");
+  EXPECT_THAT(params,
+              ElementsAre(absl::variant<int, std::string>("Sleipnir")));
+
+  EXPECT_EQ(Route("/redfish/v1/Systems/system/Memory/-1"), "");
+  EXPECT_EQ(Route("/redfish/v1/Systems/system/Memory/abc"), "");
+  EXPECT_EQ(Route("/redfish/v1/Systems/system/Memory/99999999999"), "");
+  EXPECT_EQ(Route("/redfish/v1/Chassis/bad-name"), "");
+}
+
+TEST_F(UriRouterTest, IntegersMustBeCanonical) {
+  AddRoute("/redfish/v1/Systems/system/Memory/{int}", "memory");
+
+  UriParams params;
+  EXPECT_EQ(Route("/redfish/v1/Systems/system/Memory/0", &params), "memory");
+  EXPECT_THAT(params, ElementsAre(absl::variant<int, std::string>(0)));
+  EXPECT_EQ(Route("/redfish/v1/Systems/system/Memory/10", &params), "memory");
+  EXPECT_THAT(params, ElementsAre(absl::variant<int, std::string>(10)));
+
+  // Each value has a single URI, so leading zeros are not matched.
+  EXPECT_EQ(Route("/redfish/v1/Systems/system/Memory/00"), "");
+  EXPECT_EQ(Route("/redfish/v1/Systems/system/Memory/012"), "");
+  EXPECT_EQ(Route("/redfish/v1/Systems/system/Memory/+1"), "");
+}
+
+TEST_F(UriRouterTest, PathWildcard) {
+  AddRoute("/redfish/v1/{path}/Assembly", "assembly");
+
+  UriParams params;
+  EXPECT_EQ(Route("/redfish/v1/Chassis/chassis/Assembly", &params),
+            "assembly");
+  EXPECT_THAT(params, IsEmpty());
+  EXPECT_EQ(Route("/redfish/v1/Systems/system/Memory/0/Assembly"),
+            "assembly");
+  // The wildcard can consume segments which look like the literal after it.
+  EXPECT_EQ(Route("/redfish/v1/Assembly/Assembly"), "assembly");
+
+  EXPECT_EQ(Route("/redfish/v1/Assembly"), "");
+  EXPECT_EQ(Route("/redfish/v1/Chassis//Assembly"), "");
+  EXPECT_EQ(Route("/redfish/v1/Chassis/chassis/Assembly/"), "");
+}
+
+TEST_F(UriRouterTest, MoreSpecificRoutesArePreferred) {
+  AddRoute("/redfish/v1/Chassis/chassis", "literal");
+  AddRoute("/redfish/v1/Chassis/{int}", "int");
+  AddRoute("/redfish/v1/Chassis/{string}", "string");
+  AddRoute("/redfish/v1/{path}/Assembly", "assembly");
+  AddRoute("/redfish/v1/Chassis/{string}/Thermal", "thermal");
+
+  EXPECT_EQ(Route("/redfish/v1/Chassis/chassis"), "literal");
+  EXPECT_EQ(Route("/redfish/v1/Chassis/7"), "int");
+  EXPECT_EQ(Route("/redfish/v1/Chassis/Sleipnir"), "string");
+  // Falls back from the literal and string routes to the wildcard.
+  UriParams params;
+  EXPECT_EQ(Route("/redfish/v1/Chassis/chassis/Assembly", &params),
+            "assembly");
+  EXPECT_THAT(params, IsEmpty());
+  EXPECT_EQ(Route("/redfish/v1/Chassis/chassis/Thermal", &params), "thermal");
+  EXPECT_THAT(params, ElementsAre(absl::variant<int, std::string>("chassis")));
+}
+
+TEST_F(UriRouterTest, BadPatterns) {
+  auto handler = [](ServerRequestInterface *, const UriParams &) {};
+  EXPECT_EQ(router_.AddRoute("redfish", handler).code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_EQ(router_.AddRoute("/redfish/{float}", handler).code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_TRUE(router_.AddRoute("/redfish/{int}", handler).ok());
+  EXPECT_EQ(router_.AddRoute("/redfish/{int}", handler).code(),
+            absl::StatusCode::kAlreadyExists);
+}
+
+}  // namespace
+}  // namespace ecclesia
@@ -22,6 +22,7 @@
 
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "ecclesia/lib/cache/rcu_snapshot.h"
 #include "ecclesia/magent/redfish/core/index_resource.h"
 #include "ecclesia/magent/redfish/core/json_helper.h"
 #include "ecclesia/magent/redfish/core/redfish_keywords.h"
@@ -40,27 +41,32 @@ class ChassisCollection : public Resource {
 
  private:
   void Get(ServerRequestInterface *req, const ParamsType &params) override {
-    Json::Value json;
-    json[kOdataType] = "#ChassisCollection.ChassisCollection";
-    json[kOdataId] = std::string(Uri());
-    json[kOdataContext] =
-        "/redfish/v1/"
-        "$metadata#ChassisCollection.ChassisCollection";
-    json[kName] = "Chassis Collection";
-    json[kMembersCount] = system_model_->GetAllChassis().size();
-    auto *json_members = GetJsonArray(&json, kMembers);
-    for (const auto &chassis_id : system_model_->GetAllChassis()) {
-      // We leave the Indus chassis URL the hardcoded string for now.
-      if (chassis_id == ChassisId::kIndus) {
-        AppendCollectionMember(json_members, kChassisUri);
-      } else {
-        AppendCollectionMember(
-            json_members,
-            absl::StrCat(kChassisCollectionUri, "/",
-                         ChassisIdToString(chassis_id)));
+    RcuSnapshot<std::vector<ChassisId>> all_chassis =
+        system_model_->GetAllChassis();
+    CachedJSONResponse(req, [&](ResponseValidity *validity) {
+      *validity = ResponseValidity::WhileFresh(all_chassis);
+      Json::Value json;
+      json[kOdataType] = "#ChassisCollection.ChassisCollection";
+      json[kOdataId] = std::string(Uri());
+      json[kOdataContext] =
+          "/redfish/v1/"
+          "$metadata#ChassisCollection.ChassisCollection";
+      json[kName] = "Chassis Collection";
+      json[kMembersCount] = all_chassis->size();
+      auto *json_members = GetJsonArray(&json, kMembers);
+      for (const auto &chassis_id : *all_chassis) {
+        // We leave the Indus chassis URL the hardcoded string for now.
+        if (chassis_id == ChassisId::kIndus) {
+          AppendCollectionMember(json_members, kChassisUri);
+        } else {
+          AppendCollectionMember(
+              json_members,
+              absl::StrCat(kChassisCollectionUri, "/",
+                           ChassisIdToString(chassis_id)));
+        }
       }
-    }
-    JSONResponseOK(json, req);
+      return json;
+    });
   }
 
   SystemModel *const system_model_;
@@ -69,8 +75,7 @@ class ChassisCollection : public Resource {
 class Chassis : public IndexResource {
  public:
   Chassis(SystemModel *system_model)
-      : IndexResource(kChassisUriPattern, IndexType::kString),
-        system_model_(system_model) {}
+      : IndexResource(kChassisUriPattern), system_model_(system_model) {}
 
  private:
   void Get(ServerRequestInterface *req, const ParamsType &params) override;
@@ -18,12 +18,15 @@
 #define ECCLESIA_MAGENT_REDFISH_INDUS_MEMORY_COLLECTION_H_
 
 #include <string>
+#include <vector>
 
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "ecclesia/lib/cache/rcu_snapshot.h"
 #include "ecclesia/magent/redfish/core/json_helper.h"
 #include "ecclesia/magent/redfish/core/redfish_keywords.h"
 #include "ecclesia/magent/redfish/core/resource.h"
+#include "ecclesia/magent/sysmodel/x86/dimm.h"
 #include "ecclesia/magent/sysmodel/x86/sysmodel.h"
 #include "json/value.h"
 #include "tensorflow_serving/util/net_http/server/public/server_request_interface.h"
@@ -37,15 +40,19 @@ class MemoryCollection : public Resource {
 
  private:
   void Get(ServerRequestInterface *req, const ParamsType &params) override {
-    Json::Value json;
-    AddStaticFields(&json);
-    int num_dimms = system_model_->NumDimms();
-    json[kMembersCount] = num_dimms;
-    auto *members = GetJsonArray(&json, kMembers);
-    for (int i = 0; i < num_dimms; i++) {
-      AppendCollectionMember(members, absl::StrCat(Uri(), "/", i));
-    }
-    JSONResponseOK(json, req);
+    RcuSnapshot<std::vector<Dimm>> dimms = system_model_->GetDimms();
+    CachedJSONResponse(req, [&](ResponseValidity *validity) {
+      *validity = ResponseValidity::WhileFresh(dimms);
+      Json::Value json;
+      AddStaticFields(&json);
+      int num_dimms = dimms->size();
+      json[kMembersCount] = num_dimms;
+      auto *members = GetJsonArray(&json, kMembers);
+      for (int i = 0; i < num_dimms; i++) {
+        AppendCollectionMember(members, absl::StrCat(Uri(), "/", i));
+      }
+      return json;
+    });
   }
 
   void AddStaticFields(Json::Value *json) {
@@ -19,12 +19,14 @@
 
 #include <string>
 #include <type_traits>
+#include <vector>
 
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
 #include "absl/types/variant.h"
+#include "ecclesia/lib/cache/rcu_snapshot.h"
 #include "ecclesia/magent/redfish/core/index_resource.h"
 #include "ecclesia/magent/redfish/core/json_helper.h"
 #include "ecclesia/magent/redfish/core/redfish_keywords.h"
@@ -54,52 +56,55 @@ class Processor : public IndexResource {
  private:
   void Get(ServerRequestInterface *req, const ParamsType &params) override {
     // Expect to be passed in the cpu index
-    if (!ValidateResourceIndex(params, system_model_->NumCpus())) {
+    RcuSnapshot<std::vector<Cpu>> cpus = system_model_->GetCpus();
+    if (!ValidateResourceIndex(params, cpus->size())) {
       req->ReplyWithStatus(HTTPStatusCode::NOT_FOUND);
       return;
     }
     // Fill in the json response
-    auto cpu = system_model_->GetCpu(std::get<int>(params[0]));
-    auto cpu_info = cpu->GetCpuInfo();
-    Json::Value json;
-    json[kOdataType] = "#Processor.v1_6_0.Processor";
-    json[kOdataId] = std::string(req->uri_path());
-    json[kOdataContext] = "/redfish/v1/$metadata#Processor.Processor";
-    json[kName] = cpu_info.name;
-    json[kSocket] = cpu_info.name;
+    CachedJSONResponse(req, [&](ResponseValidity *validity) {
+      *validity = ResponseValidity::WhileFresh(cpus);
+      const CpuInfo &cpu_info = (*cpus)[std::get<int>(params[0])].GetCpuInfo();
+      Json::Value json;
+      json[kOdataType] = "#Processor.v1_6_0.Processor";
+      json[kOdataId] = std::string(req->uri_path());
+      json[kOdataContext] = "/redfish/v1/$metadata#Processor.Processor";
+      json[kName] = cpu_info.name;
+      json[kSocket] = cpu_info.name;
 
-    if (cpu_info.enabled) {
-      json[kMaxSpeedMHz] = cpu_info.max_speed_mhz;
-      json[kSerialNumber] = cpu_info.serial_number;
-      json[kPartNumber] = cpu_info.part_number;
-      json[kTotalCores] = cpu_info.total_cores;
-      json[kTotalEnabledCores] = cpu_info.enabled_cores;
-      json[kTotalThreads] = cpu_info.total_threads;
-      auto *assembly = GetJsonObject(&json, kAssembly);
-      (*assembly)[kOdataId] = absl::StrCat(req->uri_path(), "/", kAssembly);
-      if (cpu_info.cpu_signature) {
-        json[kManufacturer] = cpu_info.cpu_signature->vendor;
-        auto *processor_id = GetJsonObject(&json, kProcessorId);
-        (*processor_id)[kEffectiveFamily] =
-            absl::StrFormat("0x%x", cpu_info.cpu_signature->family);
-        (*processor_id)[kEffectiveModel] =
-            absl::StrFormat("0x%x", cpu_info.cpu_signature->model);
-        (*processor_id)[kStep] =
-            absl::StrFormat("0x%x", cpu_info.cpu_signature->stepping);
-        // CPU Signature vendor ID should be coming from MSR and not SMBIOS.
-        // Return the hardcoded signature instead of reading from MSR.
-        (*processor_id)[kVendorId] = std::string(kGenuineIntelVendorSignature);
+      if (cpu_info.enabled) {
+        json[kMaxSpeedMHz] = cpu_info.max_speed_mhz;
+        json[kSerialNumber] = cpu_info.serial_number;
+        json[kPartNumber] = cpu_info.part_number;
+        json[kTotalCores] = cpu_info.total_cores;
+        json[kTotalEnabledCores] = cpu_info.enabled_cores;
+        json[kTotalThreads] = cpu_info.total_threads;
+        auto *assembly = GetJsonObject(&json, kAssembly);
+        (*assembly)[kOdataId] = absl::StrCat(req->uri_path(), "/", kAssembly);
+        if (cpu_info.cpu_signature) {
+          json[kManufacturer] = cpu_info.cpu_signature->vendor;
+          auto *processor_id = GetJsonObject(&json, kProcessorId);
+          (*processor_id)[kEffectiveFamily] =
+              absl::StrFormat("0x%x", cpu_info.cpu_signature->family);
+          (*processor_id)[kEffectiveModel] =
+              absl::StrFormat("0x%x", cpu_info.cpu_signature->model);
+          (*processor_id)[kStep] =
+              absl::StrFormat("0x%x", cpu_info.cpu_signature->stepping);
+          // CPU Signature vendor ID should be coming from MSR and not SMBIOS.
+          // Return the hardcoded signature instead of reading from MSR.
+          (*processor_id)[kVendorId] =
+              std::string(kGenuineIntelVendorSignature);
+        }
       }
-    }
-
-    auto *metrics = GetJsonObject(&json, kMetrics);
-    (*metrics)[kOdataId] =
-        absl::StrCat(req->uri_path(), "/", kProcessorMetrics);
 
-    auto *status = GetJsonObject(&json, kStatus);
-    (*status)[kState] = cpu_info.enabled ? "Enabled" : "Absent";
+      auto *metrics = GetJsonObject(&json, kMetrics);
+      (*metrics)[kOdataId] =
+          absl::StrCat(req->uri_path(), "/", kProcessorMetrics);
 
-    JSONResponseOK(json, req);
+      auto *status = GetJsonObject(&json, kStatus);
+      (*status)[kState] = cpu_info.enabled ? "Enabled" : "Absent";
+      return json;
+    });
   }
 
   SystemModel *const system_model_;
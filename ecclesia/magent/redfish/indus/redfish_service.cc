@@ -30,6 +30,7 @@
 #include "ecclesia/magent/redfish/core/resource.h"
 #include "ecclesia/magent/redfish/indus/chassis.h"
 #include "ecclesia/magent/redfish/indus/firmware_inventory.h"
+#include "ecclesia/magent/redfish/indus/init_phases.h"
 #include "ecclesia/magent/redfish/indus/memory.h"
 #include "ecclesia/magent/redfish/indus/memory_collection.h"
 #include "ecclesia/magent/redfish/indus/memory_metrics.h"
@@ -45,6 +46,7 @@
 #include "ecclesia/magent/redfish/indus/thermal.h"
 #include "ecclesia/magent/redfish/indus/update_service.h"
 #include "ecclesia/magent/sysmodel/x86/fru.h"
+#include "ecclesia/magent/sysmodel/x86/fru_acquisition.h"
 #include "ecclesia/magent/sysmodel/x86/sysmodel.h"
 #include "json/value.h"
 #include "tensorflow_serving/util/net_http/server/public/httpserver_interface.h"
@@ -63,7 +65,8 @@ namespace {
 Assembly::AssemblyModifier CreateModifierToAddFruInfo(
     const SysmodelFru &sysmodel_fru, const std::string &assembly_url,
     const std::string &component_name) {
-  return [&](absl::flat_hash_map<std::string, Json::Value> &assemblies) {
+  return [sysmodel_fru, assembly_url, component_name](
+             absl::flat_hash_map<std::string, Json::Value> &assemblies) {
     auto assembly_iter = assemblies.find(assembly_url);
     if (assembly_iter == assemblies.end()) {
       ErrorLog() << "Failed to find a matched asembly with URL: "
@@ -85,49 +88,58 @@ Assembly::AssemblyModifier CreateModifierToAddFruInfo(
 IndusRedfishService::IndusRedfishService(HTTPServerInterface *server,
                                          SystemModel *system_model,
                                          absl::string_view assemblies_dir) {
-  resources_.push_back(CreateResource<Root>(server));
-  resources_.push_back(CreateResource<ServiceRoot>(server));
-  resources_.push_back(CreateResource<ComputerSystemCollection>(server));
-  resources_.push_back(CreateResource<ComputerSystem>(server));
-  resources_.push_back(CreateResource<ChassisCollection>(server, system_model));
-  resources_.push_back(CreateResource<Chassis>(server, system_model));
-  resources_.push_back(CreateResource<MemoryCollection>(server, system_model));
-  resources_.push_back(CreateResource<Memory>(server, system_model));
+  resources_.push_back(CreateResource<Root>(&router_));
+  resources_.push_back(CreateResource<ServiceRoot>(&router_));
+  resources_.push_back(CreateResource<ComputerSystemCollection>(&router_));
+  resources_.push_back(CreateResource<ComputerSystem>(&router_));
+  resources_.push_back(
+      CreateResource<ChassisCollection>(&router_, system_model));
+  resources_.push_back(CreateResource<Chassis>(&router_, system_model));
+  resources_.push_back(
+      CreateResource<MemoryCollection>(&router_, system_model));
+  resources_.push_back(CreateResource<Memory>(&router_, system_model));
 
-  // Create a vector of AssemblyModifier that add the IPMI FRUs part number and
-  // serial number to the corresponding component in Sleipnir assemblies.
-  std::vector<Assembly::AssemblyModifier> assembly_modifiers;
+  // The IPMI FRUs are read from the BMC in the background, so the assemblies
+  // start out without them. Add the part number and serial number of each one
+  // to the corresponding component in the Sleipnir assemblies once it has been
+  // read. The callbacks share ownership of the resource so that a FRU which
+  // arrives late can never outlive it.
+  assembly_ = std::make_shared<Assembly>(assemblies_dir);
+  assembly_->RegisterRequestHandler(&router_);
   const std::string sleipnir_chassis_assembly_url =
       "/redfish/v1/Chassis/Sleipnir/Assembly";
-  if (auto *fru_reader = system_model->GetFruReader("sleipnir_hsbp")) {
-    auto optional_fru = fru_reader->Read();
-    if (optional_fru.has_value()) {
-      assembly_modifiers.push_back(CreateModifierToAddFruInfo(
-          optional_fru.value(), sleipnir_chassis_assembly_url,
-          "sleipnir_mainboard"));
-    }
-  }
-  if (auto *fru_reader = system_model->GetFruReader("sleipnir_bmc")) {
-    auto optional_fru = fru_reader->Read();
-    if (optional_fru.has_value()) {
-      assembly_modifiers.push_back(CreateModifierToAddFruInfo(
-          optional_fru.value(), sleipnir_chassis_assembly_url, "bmc_riser"));
-    }
-  }
+  FruAcquisition *fru_acquisition = system_model->GetFruAcquisition();
+  fru_acquisition->OnAcquired(
+      "sleipnir_hsbp",
+      [assembly = assembly_,
+       sleipnir_chassis_assembly_url](const SysmodelFru &fru) {
+        assembly->ApplyModifier(CreateModifierToAddFruInfo(
+            fru, sleipnir_chassis_assembly_url, "sleipnir_mainboard"));
+      });
+  fru_acquisition->OnAcquired(
+      "sleipnir_bmc", [assembly = assembly_,
+                       sleipnir_chassis_assembly_url](const SysmodelFru &fru) {
+        assembly->ApplyModifier(CreateModifierToAddFruInfo(
+            fru, sleipnir_chassis_assembly_url, "bmc_riser"));
+      });
 
-  resources_.push_back(CreateResource<Assembly>(server, assemblies_dir,
-                                                std::move(assembly_modifiers)));
-  resources_.push_back(CreateResource<MemoryMetrics>(server, system_model));
+  resources_.push_back(CreateResource<MemoryMetrics>(&router_, system_model));
+  resources_.push_back(
+      CreateResource<ProcessorCollection>(&router_, system_model));
+
+  resources_.push_back(CreateResource<Processor>(&router_, system_model));
+  resources_.push_back(
+      CreateResource<ProcessorMetrics>(&router_, system_model));
+  resources_.push_back(CreateResource<Thermal>(&router_, system_model));
+  resources_.push_back(CreateResource<UpdateService>(&router_));
+  resources_.push_back(CreateResource<SoftwareInventoryCollection>(&router_));
+  resources_.push_back(CreateResource<SoftwareInventory>(&router_));
+  resources_.push_back(CreateResource<FirmwareInventoryCollection>(&router_));
   resources_.push_back(
-      CreateResource<ProcessorCollection>(server, system_model));
+      CreateResource<SysmodelInitPhases>(&router_, system_model));
 
-  resources_.push_back(CreateResource<Processor>(server, system_model));
-  resources_.push_back(CreateResource<ProcessorMetrics>(server, system_model));
-  resources_.push_back(CreateResource<Thermal>(server, system_model));
-  resources_.push_back(CreateResource<UpdateService>(server));
-  resources_.push_back(CreateResource<SoftwareInventoryCollection>(server));
-  resources_.push_back(CreateResource<SoftwareInventory>(server));
-  resources_.push_back(CreateResource<FirmwareInventoryCollection>(server));
+  // All of the resources are routed by a single dispatcher.
+  router_.RegisterRequestDispatcher(server);
 }
 
 }  // namespace ecclesia
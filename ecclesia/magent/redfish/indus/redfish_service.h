@@ -21,7 +21,9 @@
 #include <vector>
 
 #include "absl/strings/string_view.h"
+#include "ecclesia/magent/redfish/core/assembly.h"
 #include "ecclesia/magent/redfish/core/resource.h"
+#include "ecclesia/magent/redfish/core/uri_router.h"
 #include "ecclesia/magent/sysmodel/x86/sysmodel.h"
 #include "tensorflow_serving/util/net_http/server/public/httpserver_interface.h"
 
@@ -39,7 +41,12 @@ class IndusRedfishService {
   IndusRedfishService &operator=(const IndusRedfishService &) = delete;
 
  private:
+  // Routes requests to the resources. Resources register their URIs with it
+  // as they are created.
+  UriRouter router_;
   std::vector<std::unique_ptr<Resource>> resources_;
+  // The assembly resource is shared with callbacks which fill in FRU info.
+  std::shared_ptr<Assembly> assembly_;
 };
 
 }  // namespace ecclesia
@@ -35,16 +35,20 @@ class ServiceRoot : public ServiceRootResource {
 
  private:
   void Get(ServerRequestInterface *req, const ParamsType &params) override {
-    Json::Value json;
-    json[kOdataType] = "#ServiceRoot.v1_5_0.ServiceRoot";
-    json[kOdataId] = std::string(Uri());
-    json[kOdataContext] = "/redfish/v1/$metadata#ServiceRoot.ServiceRoot";
-    json[kId] = "RootService";
-    json[kName] = "Root Service";
-    json["RedfishVersion"] = "1.6.1";
-    (*GetJsonObject(&json, kSystems))[kOdataId] = kComputerSystemCollectionUri;
-    (*GetJsonObject(&json, kChassis))[kOdataId] = kChassisCollectionUri;
-    JSONResponseOK(json, req);
+    CachedJSONResponse(req, [this](ResponseValidity *validity) {
+      *validity = ResponseValidity::Static();
+      Json::Value json;
+      json[kOdataType] = "#ServiceRoot.v1_5_0.ServiceRoot";
+      json[kOdataId] = std::string(Uri());
+      json[kOdataContext] = "/redfish/v1/$metadata#ServiceRoot.ServiceRoot";
+      json[kId] = "RootService";
+      json[kName] = "Root Service";
+      json["RedfishVersion"] = "1.6.1";
+      (*GetJsonObject(&json, kSystems))[kOdataId] =
+          kComputerSystemCollectionUri;
+      (*GetJsonObject(&json, kChassis))[kOdataId] = kChassisCollectionUri;
+      return json;
+    });
   }
 };
 
@@ -34,17 +34,19 @@ class SoftwareInventory : public Resource {
 
  private:
   void Get(ServerRequestInterface *req, const ParamsType &params) override {
-    Json::Value json;
-    json[kOdataType] = "#SoftwareInventory.v1_3_0.SoftwareInventory";
-    json[kOdataId] = std::string(Uri());
-    json[kOdataContext] =
-        "/redfish/v1/"
-        "$metadata#SoftwareInventory.SoftwareInventory";
-    json[kId] = "Software Inventory";
-    json[kName] = "magent_indus";
-    json[kVersion] = std::string(GetBuildVersion());
-
-    JSONResponseOK(json, req);
+    CachedJSONResponse(req, [this](ResponseValidity *validity) {
+      *validity = ResponseValidity::Static();
+      Json::Value json;
+      json[kOdataType] = "#SoftwareInventory.v1_3_0.SoftwareInventory";
+      json[kOdataId] = std::string(Uri());
+      json[kOdataContext] =
+          "/redfish/v1/"
+          "$metadata#SoftwareInventory.SoftwareInventory";
+      json[kId] = "Software Inventory";
+      json[kName] = "magent_indus";
+      json[kVersion] = std::string(GetBuildVersion());
+      return json;
+    });
   }
 };
 
@@ -35,19 +35,23 @@ class ComputerSystem : public Resource {
 
  private:
   void Get(ServerRequestInterface *req, const ParamsType &params) override {
-    Json::Value json;
-    json[kOdataType] = "#ComputerSystem.v1_8_0_.ComputerSystem";
-    json[kOdataId] = std::string(Uri());
-    json[kOdataContext] = "/redfish/v1/$metadata#ComputerSystem.ComputerSystem";
-
-    json[kName] = "Indus";
-    json[kId] = "system";
-
-    auto *memory = GetJsonObject(&json, kMemory);
-    (*memory)[kOdataId] = absl::StrCat(Uri(), "/", kMemory);
-    auto *processors = GetJsonObject(&json, kProcessors);
-    (*processors)[kOdataId] = absl::StrCat(Uri(), "/", kProcessors);
-    JSONResponseOK(json, req);
+    CachedJSONResponse(req, [this](ResponseValidity *validity) {
+      *validity = ResponseValidity::Static();
+      Json::Value json;
+      json[kOdataType] = "#ComputerSystem.v1_8_0_.ComputerSystem";
+      json[kOdataId] = std::string(Uri());
+      json[kOdataContext] =
+          "/redfish/v1/$metadata#ComputerSystem.ComputerSystem";
+
+      json[kName] = "Indus";
+      json[kId] = "system";
+
+      auto *memory = GetJsonObject(&json, kMemory);
+      (*memory)[kOdataId] = absl::StrCat(Uri(), "/", kMemory);
+      auto *processors = GetJsonObject(&json, kProcessors);
+      (*processors)[kOdataId] = absl::StrCat(Uri(), "/", kProcessors);
+      return json;
+    });
   }
 };
 }  // namespace ecclesia
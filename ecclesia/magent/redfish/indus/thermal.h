@@ -19,17 +19,20 @@
 
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
+#include "ecclesia/lib/cache/rcu_snapshot.h"
 #include "ecclesia/magent/redfish/core/json_helper.h"
+#include "ecclesia/magent/redfish/core/json_writer.h"
 #include "ecclesia/magent/redfish/core/redfish_keywords.h"
 #include "ecclesia/magent/redfish/core/resource.h"
+#include "ecclesia/magent/sysmodel/thermal_sampler.h"
 #include "ecclesia/magent/sysmodel/x86/dimm.h"
 #include "ecclesia/magent/sysmodel/x86/sysmodel.h"
 #include "ecclesia/magent/sysmodel/x86/thermal.h"
-#include "json/value.h"
 #include "tensorflow_serving/util/net_http/server/public/server_request_interface.h"
 
 namespace ecclesia {
@@ -41,53 +44,68 @@ class Thermal : public Resource {
 
  private:
   void Get(ServerRequestInterface *req, const ParamsType &params) override {
-    Json::Value json;
-    AddStaticFields(&json);
     int num_sensors = system_model_->NumDimmThermalSensors();
-    json[kTemperaturesCount] = num_sensors;
-    auto *members = GetJsonArray(&json, kTemperatures);
-
-    // CPU thermal is not listed here, because (at least some Intel) CPU only
-    // reports thermal margin. Those are listed in ProcessorMetrics.
-    for (int i = 0; i < num_sensors; i++) {
-      PciThermalSensor *sensor = system_model_->GetDimmThermalSensor(i);
-
-      Json::Value thermal;
-      thermal[kOdataId] = absl::StrCat(kThermalUri, "#/Temperatures/", i);
-      thermal[kOdataType] = "#Thermal.v1_6_0.Temperature";
-      thermal[kName] = std::string(sensor->Name());
-      {
-        auto temp = sensor->Read();
-        if (temp) {
-          thermal[kReadingCelsius] = std::move(*temp);
+    RcuSnapshot<std::vector<Dimm>> dimms = system_model_->GetDimms();
+    RcuSnapshot<ThermalReadings> readings =
+        system_model_->GetDimmThermalReadings(GetRequestedMaxAge(req));
+
+    JSONResponseOK(req, [&](JsonWriter *writer) {
+      writer->BeginObject();
+      WriteStaticFields(writer);
+      writer->Key(kTemperaturesCount);
+      writer->Int(num_sensors);
+      writer->Key(kTemperatures);
+      writer->BeginArray();
+      // CPU thermal is not listed here, because (at least some Intel) CPU
+      // only reports thermal margin. Those are listed in ProcessorMetrics.
+      for (int i = 0; i < num_sensors; i++) {
+        PciThermalSensor *sensor = system_model_->GetDimmThermalSensor(i);
+
+        writer->BeginObject();
+        writer->Key(kOdataId);
+        writer->String(absl::StrCat(kThermalUri, "#/Temperatures/", i));
+        writer->Key(kOdataType);
+        writer->String("#Thermal.v1_6_0.Temperature");
+        writer->Key(kName);
+        writer->String(sensor->Name());
+        if (i < static_cast<int>(readings->values.size()) &&
+            readings->values[i]) {
+          writer->Key(kReadingCelsius);
+          writer->Int(*readings->values[i]);
         }
+        writer->Key(kUpperThresholdCritical);
+        writer->Int(sensor->UpperThresholdCritical());
+
+        writer->Key(kRelatedItem);
+        writer->BeginArray();
+        WriteCollectionMember(writer,
+                              absl::StrCat(kMemoryCollectionUri, "/", i));
+        writer->EndArray();
+
+        bool present = i < static_cast<int>(dimms->size()) &&
+                       (*dimms)[i].GetDimmInfo().present;
+        writer->Key(kStatus);
+        writer->BeginObject();
+        writer->Key(kState);
+        writer->String(present ? kEnabled : kAbsent);
+        writer->EndObject();
+
+        writer->EndObject();
       }
-      thermal[kUpperThresholdCritical] = sensor->UpperThresholdCritical();
-
-      Json::Value dimm;
-      dimm[kOdataId] = absl::StrCat(kMemoryCollectionUri, "/", i);
-      GetJsonArray(&thermal, kRelatedItem)->append(dimm);
-
-      Json::Value status;
-      if (system_model_->GetDimm(i)->GetDimmInfo().present) {
-        status[kState] = kEnabled;
-      } else {
-        status[kState] = kAbsent;
-      }
-
-      thermal[kStatus] = status;
-
-      members->append(thermal);
-    }
-
-    JSONResponseOK(json, req);
+      writer->EndArray();
+      writer->EndObject();
+    });
   }
 
-  void AddStaticFields(Json::Value *json) {
-    (*json)[kOdataType] = "#Thermal.v1_6_0.Thermal";
-    (*json)[kOdataId] = std::string(Uri());
-    (*json)[kOdataContext] = "/redfish/v1/$metadata#Thermal.Thermal";
-    (*json)[kName] = "Thermal";
+  void WriteStaticFields(JsonWriter *writer) {
+    writer->Key(kOdataType);
+    writer->String("#Thermal.v1_6_0.Thermal");
+    writer->Key(kOdataId);
+    writer->String(Uri());
+    writer->Key(kOdataContext);
+    writer->String("/redfish/v1/$metadata#Thermal.Thermal");
+    writer->Key(kName);
+    writer->String("Thermal");
   }
 
   SystemModel *const system_model_;
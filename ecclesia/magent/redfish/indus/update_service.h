@@ -34,19 +34,22 @@ class UpdateService : public Resource {
 
  private:
   void Get(ServerRequestInterface *req, const ParamsType &params) override {
-    Json::Value json;
-    json[kOdataType] = "#UpdateService.v1_8_1.UpdateService";
-    json[kOdataId] = std::string(Uri());
-    json[kOdataContext] = "/redfish/v1/$metadata#UpdateService.UpdateService";
-
-    json[kName] = "UpdateService";
-    json[kId] = "Update Service";
-
-    (*GetJsonObject(&json, kSoftwareInventory))[kOdataId] =
-        kSoftwareInventoryCollectionUri;
-    (*GetJsonObject(&json, kFirmwareInventory))[kOdataId] =
-        kFirmwareInventoryCollectionUri;
-    JSONResponseOK(json, req);
+    CachedJSONResponse(req, [this](ResponseValidity *validity) {
+      *validity = ResponseValidity::Static();
+      Json::Value json;
+      json[kOdataType] = "#UpdateService.v1_8_1.UpdateService";
+      json[kOdataId] = std::string(Uri());
+      json[kOdataContext] = "/redfish/v1/$metadata#UpdateService.UpdateService";
+
+      json[kName] = "UpdateService";
+      json[kId] = "Update Service";
+
+      (*GetJsonObject(&json, kSoftwareInventory))[kOdataId] =
+          kSoftwareInventoryCollectionUri;
+      (*GetJsonObject(&json, kFirmwareInventory))[kOdataId] =
+          kFirmwareInventoryCollectionUri;
+      return json;
+    });
   }
 };
 }  // namespace ecclesia
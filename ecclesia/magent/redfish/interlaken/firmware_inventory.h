@@ -34,18 +34,21 @@ class FirmwareInventoryCollection : public Resource {
 
  private:
   void Get(ServerRequestInterface *req, const ParamsType &params) override {
-    Json::Value json;
-    json[kOdataType] =
-        "#FirmwareInventoryCollection.FirmwareInventoryCollection";
-    json[kOdataId] = std::string(Uri());
-    json[kOdataContext] =
-        "/redfish/v1/"
-        "$metadata#FirmwareInventoryCollection.FirmwareInventoryCollection";
-    json[kName] = "Firmware Inventory Collection";
-    json[kMembersCount] = 1;
-    auto *json_members = GetJsonArray(&json, kMembers);
-    AppendCollectionMember(json_members, kFirmwareInventoryMagentUri);
-    JSONResponseOK(json, req);
+    CachedJSONResponse(req, [this](ResponseValidity *validity) {
+      *validity = ResponseValidity::Static();
+      Json::Value json;
+      json[kOdataType] =
+          "#FirmwareInventoryCollection.FirmwareInventoryCollection";
+      json[kOdataId] = std::string(Uri());
+      json[kOdataContext] =
+          "/redfish/v1/"
+          "$metadata#FirmwareInventoryCollection.FirmwareInventoryCollection";
+      json[kName] = "Firmware Inventory Collection";
+      json[kMembersCount] = 1;
+      auto *json_members = GetJsonArray(&json, kMembers);
+      AppendCollectionMember(json_members, kFirmwareInventoryMagentUri);
+      return json;
+    });
   }
 };
 
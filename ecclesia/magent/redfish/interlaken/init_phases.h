@@ -0,0 +1,80 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ECCLESIA_MAGENT_REDFISH_INTERLAKEN_INIT_PHASES_H_
+#define ECCLESIA_MAGENT_REDFISH_INTERLAKEN_INIT_PHASES_H_
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "ecclesia/magent/redfish/core/json_helper.h"
+#include "ecclesia/magent/redfish/core/redfish_keywords.h"
+#include "ecclesia/magent/redfish/core/resource.h"
+#include "ecclesia/magent/sysmodel/x86/init_graph.h"
+#include "ecclesia/magent/sysmodel/x86/sysmodel.h"
+#include "json/value.h"
+#include "tensorflow_serving/util/net_http/server/public/server_request_interface.h"
+
+namespace ecclesia {
+
+// A debug resource which reports the progress of the system model
+// initialization, with the start time and duration of every phase. Start times
+// are given in milliseconds relative to the first phase to start.
+class SysmodelInitPhases : public Resource {
+ public:
+  explicit SysmodelInitPhases(SystemModel *system_model)
+      : Resource(kSysmodelInitPhasesUri), system_model_(system_model) {}
+
+ private:
+  void Get(ServerRequestInterface *req, const ParamsType &params) override {
+    // Check for readiness before fetching the timings so that a ready model
+    // never reports an unfinished phase.
+    bool ready = system_model_->IsReady();
+    std::vector<InitGraph::PhaseTiming> timings =
+        system_model_->GetInitTimings();
+
+    absl::Time first_start = absl::InfiniteFuture();
+    for (const auto &timing : timings) {
+      if (timing.start) first_start = std::min(first_start, *timing.start);
+    }
+
+    Json::Value json;
+    json["Ready"] = ready;
+    auto *phases = GetJsonArray(&json, "Phases");
+    for (const auto &timing : timings) {
+      Json::Value phase;
+      phase[kName] = timing.name;
+      auto *deps = GetJsonArray(&phase, "DependsOn");
+      for (const std::string &dep : timing.dependencies) deps->append(dep);
+      if (timing.start) {
+        phase["StartMs"] =
+            absl::ToDoubleMilliseconds(*timing.start - first_start);
+      }
+      if (timing.duration) {
+        phase["DurationMs"] = absl::ToDoubleMilliseconds(*timing.duration);
+      }
+      phases->append(phase);
+    }
+    JSONResponseOK(json, req);
+  }
+
+  SystemModel *const system_model_;
+};
+
+}  // namespace ecclesia
+
+#endif  // ECCLESIA_MAGENT_REDFISH_INTERLAKEN_INIT_PHASES_H_
@@ -19,18 +19,20 @@
 
 #include <string>
 #include <type_traits>
+#include <vector>
 
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
 #include "absl/types/variant.h"
+#include "ecclesia/lib/cache/rcu_snapshot.h"
 #include "ecclesia/magent/redfish/core/index_resource.h"
 #include "ecclesia/magent/redfish/core/json_helper.h"
+#include "ecclesia/magent/redfish/core/json_writer.h"
 #include "ecclesia/magent/redfish/core/redfish_keywords.h"
 #include "ecclesia/magent/redfish/core/resource.h"
 #include "ecclesia/magent/sysmodel/x86/dimm.h"
 #include "ecclesia/magent/sysmodel/x86/sysmodel.h"
-#include "json/value.h"
 #include "tensorflow_serving/util/net_http/server/public/response_code_enum.h"
 #include "tensorflow_serving/util/net_http/server/public/server_request_interface.h"
 
@@ -44,36 +46,53 @@ class Memory : public IndexResource {
  private:
   void Get(ServerRequestInterface *req, const ParamsType &params) override {
     // Expect to be passed in the dimm index
-    if (!ValidateResourceIndex(params, system_model_->NumDimms())) {
+    RcuSnapshot<std::vector<Dimm>> dimms = system_model_->GetDimms();
+    if (!ValidateResourceIndex(params, dimms->size())) {
       req->ReplyWithStatus(HTTPStatusCode::NOT_FOUND);
       return;
     }
     // Fill in the json response
-    auto dimm = system_model_->GetDimm(std::get<int>(params[0]));
-    auto dimm_info = dimm->GetDimmInfo();
-    Json::Value json;
-    json[kOdataType] = "#Memory.v1_8_0.Memory";
-    json[kOdataId] = std::string(req->uri_path());
-    json[kOdataContext] = "/redfish/v1/$metadata#Memory.Memory";
-    json[kName] = dimm_info.slot_name;
-    if (dimm_info.present) {
-      json[kCapacityMiB] = dimm_info.size_mb;
-      json[kLogicalSizeMiB] = dimm_info.size_mb;
-      json[kManufacturer] = dimm_info.manufacturer;
-      json[kMemoryDeviceType] = dimm_info.type;
-      json[kOperatingSpeedMhz] = dimm_info.configured_speed_mhz;
-      json[kPartNumber] = dimm_info.part_number;
-      json[kSerialNumber] = dimm_info.serial_number;
-      auto *assembly = GetJsonObject(&json, kAssembly);
-      (*assembly)[kOdataId] = absl::StrCat(req->uri_path(), "/", kAssembly);
-    }
-    auto *metrics = GetJsonObject(&json, kMetrics);
-    (*metrics)[kOdataId] = absl::StrCat(req->uri_path(), "/", kMemoryMetrics);
-
-    auto *status = GetJsonObject(&json, kStatus);
-    (*status)[kState] = dimm_info.present ? kEnabled : kAbsent;
-
-    JSONResponseOK(json, req);
+    CachedJSONResponse(req, [&](ResponseValidity *validity,
+                                JsonWriter *writer) {
+      *validity = ResponseValidity::WhileFresh(dimms);
+      const DimmInfo &dimm_info =
+          (*dimms)[std::get<int>(params[0])].GetDimmInfo();
+      writer->BeginObject();
+      writer->Key(kOdataType);
+      writer->String("#Memory.v1_8_0.Memory");
+      writer->Key(kOdataId);
+      writer->String(req->uri_path());
+      writer->Key(kOdataContext);
+      writer->String("/redfish/v1/$metadata#Memory.Memory");
+      writer->Key(kName);
+      writer->String(dimm_info.slot_name);
+      if (dimm_info.present) {
+        writer->Key(kCapacityMiB);
+        writer->Int(dimm_info.size_mb);
+        writer->Key(kLogicalSizeMiB);
+        writer->Int(dimm_info.size_mb);
+        writer->Key(kManufacturer);
+        writer->String(dimm_info.manufacturer);
+        writer->Key(kMemoryDeviceType);
+        writer->String(dimm_info.type);
+        writer->Key(kOperatingSpeedMhz);
+        writer->Int(dimm_info.configured_speed_mhz);
+        writer->Key(kPartNumber);
+        writer->String(dimm_info.part_number);
+        writer->Key(kSerialNumber);
+        writer->String(dimm_info.serial_number);
+        WriteOdataLink(writer, kAssembly,
+                       absl::StrCat(req->uri_path(), "/", kAssembly));
+      }
+      WriteOdataLink(writer, kMetrics,
+                     absl::StrCat(req->uri_path(), "/", kMemoryMetrics));
+      writer->Key(kStatus);
+      writer->BeginObject();
+      writer->Key(kState);
+      writer->String(dimm_info.present ? kEnabled : kAbsent);
+      writer->EndObject();
+      writer->EndObject();
+    });
   }
 
   SystemModel *const system_model_;
@@ -18,12 +18,15 @@
 #define ECCLESIA_MAGENT_REDFISH_INTERLAKEN_PROCESSOR_COLLECTION_H_
 
 #include <string>
+#include <vector>
 
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "ecclesia/lib/cache/rcu_snapshot.h"
 #include "ecclesia/magent/redfish/core/json_helper.h"
 #include "ecclesia/magent/redfish/core/redfish_keywords.h"
 #include "ecclesia/magent/redfish/core/resource.h"
+#include "ecclesia/magent/sysmodel/x86/cpu.h"
 #include "ecclesia/magent/sysmodel/x86/sysmodel.h"
 #include "json/value.h"
 #include "tensorflow_serving/util/net_http/server/public/server_request_interface.h"
@@ -37,15 +40,19 @@ class ProcessorCollection : public Resource {
 
  private:
   void Get(ServerRequestInterface *req, const ParamsType &params) override {
-    Json::Value json;
-    AddStaticFields(&json);
-    int num_cpus = system_model_->NumCpus();
-    json[kMembersCount] = num_cpus;
-    auto *members = GetJsonArray(&json, kMembers);
-    for (int i = 0; i < num_cpus; i++) {
-      AppendCollectionMember(members, absl::StrCat(Uri(), "/", i));
-    }
-    JSONResponseOK(json, req);
+    RcuSnapshot<std::vector<Cpu>> cpus = system_model_->GetCpus();
+    CachedJSONResponse(req, [&](ResponseValidity *validity) {
+      *validity = ResponseValidity::WhileFresh(cpus);
+      Json::Value json;
+      AddStaticFields(&json);
+      int num_cpus = cpus->size();
+      json[kMembersCount] = num_cpus;
+      auto *members = GetJsonArray(&json, kMembers);
+      for (int i = 0; i < num_cpus; i++) {
+        AppendCollectionMember(members, absl::StrCat(Uri(), "/", i));
+      }
+      return json;
+    });
   }
 
   void AddStaticFields(Json::Value *json) {
@@ -25,6 +25,7 @@
 #include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "absl/types/variant.h"
+#include "ecclesia/lib/cache/rcu_snapshot.h"
 #include "ecclesia/lib/mcedecoder/cpu_topology.h"
 #include "ecclesia/magent/lib/event_logger/intel_cpu_topology.h"
 #include "ecclesia/magent/lib/event_logger/interlaken/system_event_visitors.h"
@@ -32,6 +33,7 @@
 #include "ecclesia/magent/redfish/core/json_helper.h"
 #include "ecclesia/magent/redfish/core/redfish_keywords.h"
 #include "ecclesia/magent/redfish/core/resource.h"
+#include "ecclesia/magent/sysmodel/thermal_sampler.h"
 #include "ecclesia/magent/sysmodel/x86/sysmodel.h"
 #include "json/value.h"
 #include "tensorflow_serving/util/net_http/server/public/response_code_enum.h"
@@ -108,12 +110,11 @@ void ProcessorMetrics::Get(ServerRequestInterface *req,
   }
 
   // Get CPU thermal margin.
-  auto sensor = system_model_->GetCpuMarginSensor(cpu_num);
-  if (sensor) {
-    auto value = sensor->Read();
-    if (value) {
-      json[kThrottlingCelsius] = *value;
-    }
+  RcuSnapshot<ThermalReadings> readings =
+      system_model_->GetCpuMarginReadings(GetRequestedMaxAge(req));
+  if (cpu_num < static_cast<int>(readings->values.size()) &&
+      readings->values[cpu_num]) {
+    json[kThrottlingCelsius] = *readings->values[cpu_num];
   }
 
   JSONResponseOK(json, req);
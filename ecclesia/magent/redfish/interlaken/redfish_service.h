@@ -23,8 +23,10 @@
 #include "absl/strings/string_view.h"
 #include "ecclesia/magent/redfish/core/assembly.h"
 #include "ecclesia/magent/redfish/core/resource.h"
+#include "ecclesia/magent/redfish/core/uri_router.h"
 #include "ecclesia/magent/redfish/interlaken/chassis.h"
 #include "ecclesia/magent/redfish/interlaken/firmware_inventory.h"
+#include "ecclesia/magent/redfish/interlaken/init_phases.h"
 #include "ecclesia/magent/redfish/interlaken/memory.h"
 #include "ecclesia/magent/redfish/interlaken/memory_collection.h"
 #include "ecclesia/magent/redfish/interlaken/memory_metrics.h"
@@ -51,28 +53,33 @@ class InterlakenRedfishService {
   explicit InterlakenRedfishService(HTTPServerInterface *server,
                                     SystemModel *system_model,
                                     absl::string_view assemblies_dir) {
-    resources_.push_back(CreateResource<Root>(server));
-    resources_.push_back(CreateResource<ServiceRoot>(server));
-    resources_.push_back(CreateResource<ComputerSystemCollection>(server));
-    resources_.push_back(CreateResource<ComputerSystem>(server));
-    resources_.push_back(CreateResource<ChassisCollection>(server));
-    resources_.push_back(CreateResource<Chassis>(server, system_model));
+    resources_.push_back(CreateResource<Root>(&router_));
+    resources_.push_back(CreateResource<ServiceRoot>(&router_));
+    resources_.push_back(CreateResource<ComputerSystemCollection>(&router_));
+    resources_.push_back(CreateResource<ComputerSystem>(&router_));
+    resources_.push_back(CreateResource<ChassisCollection>(&router_));
+    resources_.push_back(CreateResource<Chassis>(&router_, system_model));
     resources_.push_back(
-        CreateResource<MemoryCollection>(server, system_model));
-    resources_.push_back(CreateResource<Memory>(server, system_model));
-    resources_.push_back(CreateResource<Assembly>(server, assemblies_dir));
-    resources_.push_back(CreateResource<MemoryMetrics>(server, system_model));
+        CreateResource<MemoryCollection>(&router_, system_model));
+    resources_.push_back(CreateResource<Memory>(&router_, system_model));
+    resources_.push_back(CreateResource<Assembly>(&router_, assemblies_dir));
+    resources_.push_back(CreateResource<MemoryMetrics>(&router_, system_model));
     resources_.push_back(
-        CreateResource<ProcessorCollection>(server, system_model));
+        CreateResource<ProcessorCollection>(&router_, system_model));
 
-    resources_.push_back(CreateResource<Processor>(server, system_model));
+    resources_.push_back(CreateResource<Processor>(&router_, system_model));
     resources_.push_back(
-        CreateResource<ProcessorMetrics>(server, system_model));
-    resources_.push_back(CreateResource<Thermal>(server, system_model));
-    resources_.push_back(CreateResource<UpdateService>(server));
-    resources_.push_back(CreateResource<SoftwareInventoryCollection>(server));
-    resources_.push_back(CreateResource<SoftwareInventory>(server));
-    resources_.push_back(CreateResource<FirmwareInventoryCollection>(server));
+        CreateResource<ProcessorMetrics>(&router_, system_model));
+    resources_.push_back(CreateResource<Thermal>(&router_, system_model));
+    resources_.push_back(CreateResource<UpdateService>(&router_));
+    resources_.push_back(CreateResource<SoftwareInventoryCollection>(&router_));
+    resources_.push_back(CreateResource<SoftwareInventory>(&router_));
+    resources_.push_back(CreateResource<FirmwareInventoryCollection>(&router_));
+    resources_.push_back(
+        CreateResource<SysmodelInitPhases>(&router_, system_model));
+
+    // All of the resources are routed by a single dispatcher.
+    router_.RegisterRequestDispatcher(server);
   }
 
   InterlakenRedfishService(const InterlakenRedfishService &) = delete;
@@ -80,6 +87,9 @@ class InterlakenRedfishService {
       delete;
 
  private:
+  // Routes requests to the resources. Resources register their URIs with it
+  // as they are created.
+  UriRouter router_;
   std::vector<std::unique_ptr<Resource>> resources_;
 };
 
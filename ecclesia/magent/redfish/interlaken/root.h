@@ -30,9 +30,12 @@ class Root : public Resource {
 
  private:
   void Get(ServerRequestInterface *req, const ParamsType &params) override {
-    Json::Value json;
-    json["v1"] = kServiceRootUri;
-    JSONResponseOK(json, req);
+    CachedJSONResponse(req, [](ResponseValidity *validity) {
+      *validity = ResponseValidity::Static();
+      Json::Value json;
+      json["v1"] = kServiceRootUri;
+      return json;
+    });
   }
 };
 
@@ -32,6 +32,7 @@
 #include "ecclesia/lib/redfish/raw.h"
 #include "ecclesia/magent/lib/thread_pool/thread_pool.h"
 #include "ecclesia/magent/redfish/core/resource.h"
+#include "ecclesia/magent/redfish/core/uri_router.h"
 #include "json/reader.h"
 #include "json/value.h"
 #include "tensorflow_serving/util/net_http/server/public/httpserver.h"
@@ -76,7 +77,8 @@ class ServiceRootTest : public ::testing::Test {
   ServiceRootTest() {
     InitServer();
     service_root_ = absl::make_unique<ServiceRoot>();
-    service_root_->RegisterRequestHandler(server_.get());
+    service_root_->RegisterRequestHandler(&router_);
+    router_.RegisterRequestDispatcher(server_.get());
   }
 
   ~ServiceRootTest() {
@@ -88,6 +90,7 @@ class ServiceRootTest : public ::testing::Test {
 
  protected:
   std::unique_ptr<HTTPServerInterface> server_;
+  UriRouter router_;
   std::unique_ptr<ServiceRoot> service_root_;
   int port_;
 
@@ -34,18 +34,21 @@ class SoftwareInventoryCollection : public Resource {
 
  private:
   void Get(ServerRequestInterface *req, const ParamsType &params) override {
-    Json::Value json;
-    json[kOdataType] =
-        "#SoftwareInventoryCollection.SoftwareInventoryCollection";
-    json[kOdataId] = std::string(Uri());
-    json[kOdataContext] =
-        "/redfish/v1/"
-        "$metadata#SoftwareInventoryCollection.SoftwareInventoryCollection";
-    json[kName] = "Software Inventory Collection";
-    json[kMembersCount] = 1;
-    auto *json_members = GetJsonArray(&json, kMembers);
-    AppendCollectionMember(json_members, kSoftwareInventoryMagentUri);
-    JSONResponseOK(json, req);
+    CachedJSONResponse(req, [this](ResponseValidity *validity) {
+      *validity = ResponseValidity::Static();
+      Json::Value json;
+      json[kOdataType] =
+          "#SoftwareInventoryCollection.SoftwareInventoryCollection";
+      json[kOdataId] = std::string(Uri());
+      json[kOdataContext] =
+          "/redfish/v1/"
+          "$metadata#SoftwareInventoryCollection.SoftwareInventoryCollection";
+      json[kName] = "Software Inventory Collection";
+      json[kMembersCount] = 1;
+      auto *json_members = GetJsonArray(&json, kMembers);
+      AppendCollectionMember(json_members, kSoftwareInventoryMagentUri);
+      return json;
+    });
   }
 };
 
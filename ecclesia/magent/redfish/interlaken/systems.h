@@ -34,17 +34,20 @@ class ComputerSystemCollection : public Resource {
 
  private:
   void Get(ServerRequestInterface *req, const ParamsType &params) override {
-    Json::Value json;
-    json[kOdataType] = "#ComputerSystemCollection.ComputerSystemCollection";
-    json[kOdataId] = std::string(Uri());
-    json[kOdataContext] =
-        "/redfish/v1/"
-        "$metadata#ComputerSystemCollection.ComputerSystemCollection";
-    json[kName] = "Computer System Collection";
-    json[kMembersCount] = 1;
-    auto *json_members = GetJsonArray(&json, kMembers);
-    AppendCollectionMember(json_members, kComputerSystemUri);
-    JSONResponseOK(json, req);
+    CachedJSONResponse(req, [this](ResponseValidity *validity) {
+      *validity = ResponseValidity::Static();
+      Json::Value json;
+      json[kOdataType] = "#ComputerSystemCollection.ComputerSystemCollection";
+      json[kOdataId] = std::string(Uri());
+      json[kOdataContext] =
+          "/redfish/v1/"
+          "$metadata#ComputerSystemCollection.ComputerSystemCollection";
+      json[kName] = "Computer System Collection";
+      json[kMembersCount] = 1;
+      auto *json_members = GetJsonArray(&json, kMembers);
+      AppendCollectionMember(json_members, kComputerSystemUri);
+      return json;
+    });
   }
 };
 
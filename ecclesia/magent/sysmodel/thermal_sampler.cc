@@ -0,0 +1,83 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "ecclesia/magent/sysmodel/thermal_sampler.h"
+
+#include <cstddef>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "ecclesia/lib/cache/rcu_snapshot.h"
+#include "ecclesia/magent/sysmodel/thermal.h"
+
+namespace ecclesia {
+
+ThermalSampler::ThermalSampler() : ThermalSampler(Options()) {}
+
+ThermalSampler::ThermalSampler(const Options &options) : options_(options) {}
+
+ThermalSampler::~ThermalSampler() {
+  stop_.Notify();
+  if (thread_.joinable()) thread_.join();
+}
+
+std::size_t ThermalSampler::AddSensor(ThermalSensor *sensor) {
+  absl::MutexLock ml(&sample_mutex_);
+  sensors_.push_back(sensor);
+  return sensors_.size() - 1;
+}
+
+RcuSnapshot<ThermalReadings> ThermalSampler::GetReadings(
+    absl::Duration max_age) {
+  // Any readings taken at or after this point are acceptable. That includes
+  // readings from a read that some other caller starts while this one is
+  // waiting for the lock.
+  absl::Time oldest_acceptable = options_.clock->Now() - max_age;
+  RcuSnapshot<ThermalReadings> readings = readings_.Read();
+  if (readings->timestamp >= oldest_acceptable) return readings;
+
+  absl::MutexLock ml(&sample_mutex_);
+  readings = readings_.Read();
+  if (readings->timestamp >= oldest_acceptable) return readings;
+  SampleAllLocked();
+  return readings_.Read();
+}
+
+void ThermalSampler::SampleAll() {
+  absl::MutexLock ml(&sample_mutex_);
+  SampleAllLocked();
+}
+
+void ThermalSampler::SampleAllLocked() {
+  ThermalReadings readings;
+  readings.timestamp = options_.clock->Now();
+  readings.values.reserve(sensors_.size());
+  for (ThermalSensor *sensor : sensors_) {
+    readings.values.push_back(sensor->Read());
+  }
+  readings_.Update(std::move(readings));
+}
+
+void ThermalSampler::Start() {
+  thread_ = std::thread([this]() {
+    do {
+      SampleAll();
+    } while (!stop_.WaitForNotificationWithTimeout(options_.interval));
+  });
+}
+
+}  // namespace ecclesia
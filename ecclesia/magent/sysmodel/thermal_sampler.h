@@ -0,0 +1,112 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+// This library provides a sampler which reads a set of thermal sensors in the
+// background. Reading a sensor means going out to the hardware, so if every
+// request read the sensors itself then both the request latency and the load
+// on the hardware would scale with how often clients poll.
+//
+// Instead the sampler reads all of its sensors on a fixed interval and
+// publishes the timestamped readings as an RCU snapshot, which requests can
+// then serve from. Clients which need fresher readings than the interval
+// provides can ask for readings with a maximum age; if several ask at once
+// the sensors are only read once on behalf of all of them.
+
+#ifndef ECCLESIA_MAGENT_SYSMODEL_THERMAL_SAMPLER_H_
+#define ECCLESIA_MAGENT_SYSMODEL_THERMAL_SAMPLER_H_
+
+#include <cstddef>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "ecclesia/lib/cache/rcu_snapshot.h"
+#include "ecclesia/lib/cache/rcu_store.h"
+#include "ecclesia/lib/time/clock.h"
+#include "ecclesia/magent/sysmodel/thermal.h"
+
+namespace ecclesia {
+
+// The readings of all of the sensors in a sampler at a single point in time.
+struct ThermalReadings {
+  // When the sensors were read. Before the first read this is the infinite
+  // past, and there are no values.
+  absl::Time timestamp = absl::InfinitePast();
+  // The reading of each sensor, in the order the sensors were added to the
+  // sampler. Sensors which could not be read have no value.
+  std::vector<absl::optional<int>> values;
+};
+
+class ThermalSampler {
+ public:
+  struct Options {
+    // How often the background thread reads the sensors.
+    absl::Duration interval = absl::Seconds(5);
+    // The clock used to timestamp readings.
+    Clock *clock = Clock::RealClock();
+  };
+
+  ThermalSampler();
+  explicit ThermalSampler(const Options &options);
+
+  // The sampler can own a thread, so it cannot be copied.
+  ThermalSampler(const ThermalSampler &other) = delete;
+  ThermalSampler &operator=(const ThermalSampler &other) = delete;
+
+  // Stops the background thread, if it was started.
+  ~ThermalSampler();
+
+  // Add a sensor to be sampled. Returns the index of its values in the
+  // readings. The sensor must outlive the sampler.
+  std::size_t AddSensor(ThermalSensor *sensor);
+
+  // Returns readings which are no more than max_age old. If the most recent
+  // readings are older than that then the sensors are read first. With the
+  // default max_age this always returns the most recent readings without
+  // touching the sensors.
+  RcuSnapshot<ThermalReadings> GetReadings(
+      absl::Duration max_age = absl::InfiniteDuration());
+
+  // Read every sensor once and publish the readings. This can be used to drive
+  // the sampler directly, instead of using a background thread.
+  void SampleAll();
+
+  // Start a background thread which reads the sensors on the configured
+  // interval until the sampler is destroyed. Must be called at most once.
+  void Start();
+
+ private:
+  void SampleAllLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(sample_mutex_);
+
+  const Options options_;
+
+  // Held while the sensors are being read, so that only one read of them is
+  // ever in flight.
+  absl::Mutex sample_mutex_;
+  std::vector<ThermalSensor *> sensors_ ABSL_GUARDED_BY(sample_mutex_);
+
+  RcuStore<ThermalReadings> readings_;
+
+  absl::Notification stop_;
+  std::thread thread_;
+};
+
+}  // namespace ecclesia
+
+#endif  // ECCLESIA_MAGENT_SYSMODEL_THERMAL_SAMPLER_H_
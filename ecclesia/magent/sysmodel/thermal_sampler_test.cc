@@ -0,0 +1,177 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "ecclesia/magent/sysmodel/thermal_sampler.h"
+
+#include <atomic>
+#include <thread>  // NOLINT(build/c++11)
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "ecclesia/lib/cache/rcu_snapshot.h"
+#include "ecclesia/lib/time/clock_fake.h"
+#include "ecclesia/magent/sysmodel/thermal.h"
+
+namespace ecclesia {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::Optional;
+
+// A sensor which counts how many times it has been read. Each read returns the
+// number of reads so far, or nothing if the sensor has been marked as broken.
+class CountingSensor : public ThermalSensor {
+ public:
+  explicit CountingSensor(bool broken = false)
+      : ThermalSensor("counting", 100), broken_(broken) {}
+
+  absl::optional<int> Read() override {
+    int reads = ++reads_;
+    if (broken_) return absl::nullopt;
+    return reads;
+  }
+
+  int reads() const { return reads_; }
+
+ private:
+  const bool broken_;
+  std::atomic<int> reads_ = 0;
+};
+
+// A sensor whose reads block until they are released.
+class BlockingSensor : public ThermalSensor {
+ public:
+  BlockingSensor() : ThermalSensor("blocking", 100) {}
+
+  absl::optional<int> Read() override {
+    ++reads_;
+    entered_.Notify();
+    released_.WaitForNotification();
+    return 42;
+  }
+
+  void WaitUntilEntered() { entered_.WaitForNotification(); }
+  void Release() { released_.Notify(); }
+  int reads() const { return reads_; }
+
+ private:
+  absl::Notification entered_;
+  absl::Notification released_;
+  std::atomic<int> reads_ = 0;
+};
+
+TEST(ThermalSamplerTest, NoReadingsBeforeSampling) {
+  CountingSensor sensor;
+  ThermalSampler sampler;
+  EXPECT_EQ(sampler.AddSensor(&sensor), 0);
+
+  RcuSnapshot<ThermalReadings> readings = sampler.GetReadings();
+  EXPECT_EQ(readings->timestamp, absl::InfinitePast());
+  EXPECT_THAT(readings->values, IsEmpty());
+  EXPECT_EQ(sensor.reads(), 0);
+}
+
+TEST(ThermalSamplerTest, SampleAllReadsEverySensor) {
+  FakeClock clock;
+  CountingSensor sensor0;
+  CountingSensor sensor1(/*broken=*/true);
+  ThermalSampler sampler({.clock = &clock});
+  EXPECT_EQ(sampler.AddSensor(&sensor0), 0);
+  EXPECT_EQ(sampler.AddSensor(&sensor1), 1);
+
+  sampler.SampleAll();
+  RcuSnapshot<ThermalReadings> readings = sampler.GetReadings();
+  EXPECT_EQ(readings->timestamp, clock.Now());
+  EXPECT_THAT(readings->values, ElementsAre(Optional(1), absl::nullopt));
+
+  // Snapshots which are already held are not affected by new samples.
+  clock.AdvanceTime(absl::Seconds(1));
+  sampler.SampleAll();
+  EXPECT_FALSE(readings.IsFresh());
+  EXPECT_THAT(readings->values, ElementsAre(Optional(1), absl::nullopt));
+  EXPECT_THAT(sampler.GetReadings()->values,
+              ElementsAre(Optional(2), absl::nullopt));
+}
+
+TEST(ThermalSamplerTest, MaxAgeRefreshesOldReadings) {
+  FakeClock clock;
+  CountingSensor sensor;
+  ThermalSampler sampler({.clock = &clock});
+  sampler.AddSensor(&sensor);
+
+  // With no readings at all, any max age requires a read.
+  EXPECT_THAT(sampler.GetReadings(absl::Hours(1))->values,
+              ElementsAre(Optional(1)));
+
+  // Readings which are young enough are served as-is.
+  clock.AdvanceTime(absl::Seconds(3));
+  EXPECT_THAT(sampler.GetReadings(absl::Seconds(5))->values,
+              ElementsAre(Optional(1)));
+  EXPECT_THAT(sampler.GetReadings(absl::Seconds(3))->values,
+              ElementsAre(Optional(1)));
+  EXPECT_EQ(sensor.reads(), 1);
+
+  // Readings which are too old are refreshed.
+  RcuSnapshot<ThermalReadings> readings = sampler.GetReadings(absl::Seconds(2));
+  EXPECT_EQ(readings->timestamp, clock.Now());
+  EXPECT_THAT(readings->values, ElementsAre(Optional(2)));
+  EXPECT_EQ(sensor.reads(), 2);
+}
+
+TEST(ThermalSamplerTest, ConcurrentRefreshesShareARead) {
+  FakeClock clock;
+  BlockingSensor sensor;
+  ThermalSampler sampler({.clock = &clock});
+  sampler.AddSensor(&sensor);
+
+  absl::optional<int> first_value;
+  std::thread first([&]() {
+    first_value = sampler.GetReadings(absl::ZeroDuration())->values[0];
+  });
+  sensor.WaitUntilEntered();
+
+  // This refresh arrives while the first one is reading the sensor. The read
+  // started no earlier than this request, so it can share the result.
+  absl::optional<int> second_value;
+  std::thread second([&]() {
+    second_value = sampler.GetReadings(absl::ZeroDuration())->values[0];
+  });
+
+  sensor.Release();
+  first.join();
+  second.join();
+  EXPECT_THAT(first_value, Optional(42));
+  EXPECT_THAT(second_value, Optional(42));
+  EXPECT_EQ(sensor.reads(), 1);
+}
+
+TEST(ThermalSamplerTest, BackgroundSampling) {
+  CountingSensor sensor;
+  ThermalSampler sampler({.interval = absl::Milliseconds(1)});
+  sampler.AddSensor(&sensor);
+  sampler.Start();
+
+  while (sensor.reads() < 3) absl::SleepFor(absl::Milliseconds(1));
+  RcuSnapshot<ThermalReadings> readings = sampler.GetReadings();
+  ASSERT_EQ(readings->values.size(), 1);
+  EXPECT_GE(*readings->values[0], 2);
+}
+
+}  // namespace
+}  // namespace ecclesia
@@ -16,19 +16,21 @@
 
 #include "ecclesia/magent/sysmodel/x86/cpu.h"
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/numbers.h"
-#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "ecclesia/lib/io/constants.h"
-#include "ecclesia/lib/io/msr.h"
+#include "ecclesia/lib/io/msr_batch.h"
 #include "ecclesia/lib/smbios/processor_information.h"
 #include "ecclesia/lib/smbios/reader.h"
 #include "ecclesia/lib/smbios/structures.emb.h"
@@ -43,34 +45,61 @@ const LazyRE2 kCpuRegex = {"^CPU\\d+"};
 
 constexpr int kIntelPPINCapabilityBit = 23;
 
-absl::StatusOr<uint64_t> GetCpuSerialNumberFromMsr(int socket_id) {
+// Read the PPIN of each of the given sockets. The registers for all of the
+// sockets are read together in each step. Sockets whose PPIN cannot be read
+// will get an error instead.
+std::vector<absl::StatusOr<uint64_t>> GetCpuSerialNumbersFromMsr(
+    absl::Span<const int> socket_ids, MsrBatch &msrs) {
+  std::vector<absl::StatusOr<uint64_t>> serials;
   IntelCpuTopology top;
-  std::vector<int> lpus = top.GetLpusForSocketId(socket_id);
-  if (lpus.empty()) {
-    return absl::InternalError(absl::StrFormat(
-        "Unable to find any LPUs associated with socket %d", socket_id));
+  std::vector<int> lpus;
+  std::vector<MsrBatch::Request> requests;
+  for (int socket_id : socket_ids) {
+    std::vector<int> socket_lpus = top.GetLpusForSocketId(socket_id);
+    if (socket_lpus.empty()) {
+      serials.push_back(absl::InternalError(absl::StrFormat(
+          "Unable to find any LPUs associated with socket %d", socket_id)));
+      lpus.push_back(-1);
+      continue;
+    }
+    serials.push_back(absl::UnknownError("PPIN was not read"));
+    lpus.push_back(socket_lpus[0]);
+    requests.push_back({.cpu = socket_lpus[0], .reg = kMsrIa32PlatformInfo});
   }
 
-  Msr msr(absl::StrCat("/dev/cpu/", lpus[0], "/msr"));
-
   // kMsrIa32PlatformInfo Msr bit 23 is set for Intel cpus that have PPIN.
-  absl::StatusOr<uint64_t> maybe_platform_info = msr.Read(kMsrIa32PlatformInfo);
-  if (!maybe_platform_info.ok()) {
-    return maybe_platform_info.status();
-  }
-
-  if (!(*maybe_platform_info & (1 << kIntelPPINCapabilityBit))) {
-    // This cpu does not have PPIN.
-    return absl::UnimplementedError("CPU does not support PPIN");
-  }
-
-  //  Write 2 to PPIN_CTL (MSR 0x4e) to enable PPIN read.
-  if (absl::Status status = msr.Write(kMsrIa32PpinCtl, 0x2); !status.ok()) {
-    return status;
+  std::vector<absl::StatusOr<uint64_t>> platform_infos =
+      msrs.ReadAll(requests);
+  requests.clear();
+  std::vector<size_t> ppin_sockets;
+  for (size_t i = 0, r = 0; i < lpus.size(); ++i) {
+    if (lpus[i] < 0) continue;
+    const absl::StatusOr<uint64_t> &maybe_platform_info = platform_infos[r++];
+    if (!maybe_platform_info.ok()) {
+      serials[i] = maybe_platform_info.status();
+      continue;
+    }
+    if (!(*maybe_platform_info & (1 << kIntelPPINCapabilityBit))) {
+      // This cpu does not have PPIN.
+      serials[i] = absl::UnimplementedError("CPU does not support PPIN");
+      continue;
+    }
+    //  Write 2 to PPIN_CTL (MSR 0x4e) to enable PPIN read.
+    if (absl::Status status = msrs.Write(lpus[i], kMsrIa32PpinCtl, 0x2);
+        !status.ok()) {
+      serials[i] = status;
+      continue;
+    }
+    ppin_sockets.push_back(i);
+    requests.push_back({.cpu = lpus[i], .reg = kMsrIa32Ppin});
   }
 
   // Read the PPIN (MSR 0x4f)
-  return msr.Read(kMsrIa32Ppin);
+  std::vector<absl::StatusOr<uint64_t>> ppins = msrs.ReadAll(requests);
+  for (size_t r = 0; r < ppin_sockets.size(); ++r) {
+    serials[ppin_sockets[r]] = std::move(ppins[r]);
+  }
+  return serials;
 }
 
 int GetCpuSocketId(const ProcessorInformation &processor) {
@@ -88,20 +117,43 @@ int GetCpuSocketId(const ProcessorInformation &processor) {
   return -1;
 }
 
-std::string GetCpuSerialNumber(const ProcessorInformation &processor) {
+// Get the serial number of the processor, using the PPIN if one was read for
+// it and the SMBIOS serial number otherwise.
+std::string GetCpuSerialNumber(const ProcessorInformation &processor,
+                               const absl::StatusOr<uint64_t> &maybe_ppin) {
+  if (maybe_ppin.ok()) {
+    return absl::StrFormat("0x%016x", *maybe_ppin);
+  }
   auto view = processor.GetMessageView();
-  if (processor.IsIntelProcessor()) {
-    int socket_id;
-    if ((socket_id = GetCpuSocketId(processor)) != -1) {
-      absl::StatusOr<uint64_t> maybe_serial =
-          GetCpuSerialNumberFromMsr(socket_id);
-      if (maybe_serial.ok()) {
-        return absl::StrFormat("0x%016x", *maybe_serial);
-      }
-    }
+  return std::string(processor.GetString(view.serial_number_snum().Read()));
+}
+
+// Read the PPINs of the processors which are Intel processors with one.
+std::vector<absl::StatusOr<uint64_t>> GetCpuPpins(
+    absl::Span<const ProcessorInformation> processors, MsrBatch &msrs) {
+  std::vector<absl::StatusOr<uint64_t>> ppins(
+      processors.size(), absl::NotFoundError("CPU PPIN is not available"));
+  std::vector<size_t> indexes;
+  std::vector<int> socket_ids;
+  for (size_t i = 0; i < processors.size(); ++i) {
+    if (!processors[i].IsIntelProcessor()) continue;
+    int socket_id = GetCpuSocketId(processors[i]);
+    if (socket_id == -1) continue;
+    indexes.push_back(i);
+    socket_ids.push_back(socket_id);
+  }
+  if (socket_ids.empty()) return ppins;
+  std::vector<absl::StatusOr<uint64_t>> serials =
+      GetCpuSerialNumbersFromMsr(socket_ids, msrs);
+  for (size_t i = 0; i < indexes.size(); ++i) {
+    ppins[indexes[i]] = std::move(serials[i]);
   }
+  return ppins;
+}
 
-  return std::string(processor.GetString(view.serial_number_snum().Read()));
+absl::StatusOr<uint64_t> GetCpuPpin(const ProcessorInformation &processor) {
+  MsrBatch msrs;
+  return GetCpuPpins(absl::MakeConstSpan(&processor, 1), msrs).front();
 }
 
 std::string GetCpuPartNumber(const ProcessorInformation &processor) {
@@ -115,13 +167,17 @@ std::string GetCpuPartNumber(const ProcessorInformation &processor) {
 
 }  // namespace
 
-Cpu::Cpu(const ProcessorInformation &processor) {
+Cpu::Cpu(const ProcessorInformation &processor)
+    : Cpu(processor, GetCpuPpin(processor)) {}
+
+Cpu::Cpu(const ProcessorInformation &processor,
+         const absl::StatusOr<uint64_t> &maybe_ppin) {
   auto view = processor.GetMessageView();
   cpu_info_.name = processor.GetString(view.socket_designation_snum().Read());
   cpu_info_.enabled = processor.IsProcessorEnabled();
   cpu_info_.cpu_signature = processor.GetSignature();
   cpu_info_.max_speed_mhz = view.max_speed_mhz().Read();
-  cpu_info_.serial_number = GetCpuSerialNumber(processor);
+  cpu_info_.serial_number = GetCpuSerialNumber(processor, maybe_ppin);
   cpu_info_.part_number = GetCpuPartNumber(processor);
   cpu_info_.total_cores = processor.GetCoreCount();
   cpu_info_.enabled_cores = processor.GetCoreEnabled();
@@ -130,9 +186,13 @@ Cpu::Cpu(const ProcessorInformation &processor) {
 }
 
 std::vector<Cpu> CreateCpus(const SmbiosReader &reader) {
+  std::vector<ProcessorInformation> processors = reader.GetAllProcessors();
+  // The PPINs for all of the sockets are read together.
+  MsrBatch msrs;
+  std::vector<absl::StatusOr<uint64_t>> ppins = GetCpuPpins(processors, msrs);
   std::vector<Cpu> cpus;
-  for (auto &processor : reader.GetAllProcessors()) {
-    cpus.emplace_back(processor);
+  for (size_t i = 0; i < processors.size(); ++i) {
+    cpus.emplace_back(processors[i], ppins[i]);
   }
   return cpus;
 }
@@ -17,9 +17,12 @@
 #ifndef ECCLESIA_MAGENT_SYSMODEL_X86_CPU_H_
 #define ECCLESIA_MAGENT_SYSMODEL_X86_CPU_H_
 
+#include <cstdint>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "absl/status/statusor.h"
 #include "absl/types/optional.h"
 #include "ecclesia/lib/smbios/processor_information.h"
 #include "ecclesia/lib/smbios/reader.h"
@@ -42,6 +45,12 @@ struct CpuInfo {
 class Cpu {
  public:
   explicit Cpu(const ProcessorInformation &processor);
+  // Construct a CPU using a PPIN which has already been read for it. If the
+  // PPIN could not be read the serial number from SMBIOS is used instead.
+  Cpu(const ProcessorInformation &processor,
+      const absl::StatusOr<uint64_t> &maybe_ppin);
+  // Construct a CPU from previously gathered information.
+  explicit Cpu(CpuInfo cpu_info) : cpu_info_(std::move(cpu_info)) {}
 
   // Allow the object to be copyable
   // Make sure that copy construction is relatively light weight.
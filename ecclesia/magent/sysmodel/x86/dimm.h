@@ -19,6 +19,7 @@
 
 #include <cstdint>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "ecclesia/lib/smbios/memory_device.h"
@@ -43,6 +44,8 @@ class Dimm {
  public:
   Dimm(const MemoryDevice &memory_device,
        const SmbiosFieldTranslator *field_translator);
+  // Construct a DIMM from previously gathered information.
+  explicit Dimm(DimmInfo dimm_info) : dimm_info_(std::move(dimm_info)) {}
 
   // Allow the object to be copyable
   // Make sure that copy construction is relatively light weight.
@@ -27,12 +27,13 @@
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "ecclesia/magent/lib/eeprom/smbus_eeprom.h"
-#include "ecclesia/magent/lib/fru/fru.h"
+#include "ecclesia/magent/lib/fru/fru_view.h"
 #include "ecclesia/magent/lib/ipmi/ipmi.h"
 
 namespace ecclesia {
@@ -42,17 +43,25 @@ namespace {
 constexpr int kFruCommonHeaderSize = 8;
 constexpr int kFruBoardInfoAreaSizeIndex = 9;
 
-// Given an input string, returns a new string that contains only the portion
-// of the string up to (but not including) the first NUL character. If the
-// input string contains no NUL characters than the returned value will be
-// equal to the input.
-//
-// The implementation is intended to be equivalent to:
-//    return s.c_str();
-// but we want to avoid this because many linting tools will (correctly) flag
-// string -> char* -> string conversions as possible bugs.
+// Given a FRU field, returns the entire decoded field as a string. Fields which
+// cannot be decoded produce an empty string.
+std::string FieldAsString(const FruFieldView &field) {
+  FruFieldView::DecodeBuffer buffer;
+  absl::StatusOr<absl::string_view> maybe_value = field.Decode(&buffer);
+  if (!maybe_value.ok()) return "";
+  return std::string(*maybe_value);
+}
 
-std::string StringUpToNul(std::string s) { return s.substr(0, s.find('\0')); }
+// Given a FRU field, returns a new string that contains only the portion of
+// the decoded field up to (but not including) the first NUL character. If the
+// field contains no NUL characters then the returned value will be the entire
+// decoded field. Fields which cannot be decoded produce an empty string.
+std::string FieldUpToNul(const FruFieldView &field) {
+  FruFieldView::DecodeBuffer buffer;
+  absl::StatusOr<absl::string_view> maybe_value = field.Decode(&buffer);
+  if (!maybe_value.ok()) return "";
+  return std::string(maybe_value->substr(0, maybe_value->find('\0')));
+}
 
 absl::Status ValidateFruCommonHeader(
     absl::Span<const unsigned char> common_header) {
@@ -85,8 +94,17 @@ absl::Status GetBoardInfoAreaSize(SmbusEeprom2ByteAddr &eeprom, size_t *size) {
   return status;
 }
 
+// Fills info in from the fields of a board info area.
+void FruInfoFromBoardInfo(const FruBoardInfoView &board_info, FruInfo &info) {
+  info = {
+      .product_name = FieldUpToNul(board_info.product_name()),
+      .manufacturer = FieldUpToNul(board_info.manufacturer()),
+      .serial_number = FieldUpToNul(board_info.serial_number()),
+      .part_number = FieldUpToNul(board_info.part_number())};
+}
+
 // Processes fru_data into info if the fru_data is valid.
-absl::Status ProcessBoardFromFruImage(absl::Span<unsigned char> fru_data,
+absl::Status ProcessBoardFromFruImage(absl::Span<const unsigned char> fru_data,
                                       FruInfo &info) {
   absl::Status status = ValidateFruCommonHeader(
       absl::MakeSpan(fru_data.data(), kFruCommonHeaderSize));
@@ -94,21 +112,14 @@ absl::Status ProcessBoardFromFruImage(absl::Span<unsigned char> fru_data,
     return status;
   }
 
-  VectorFruImageSource fru_image(fru_data);
-  BoardInfoArea board_info;
-
   // BoardInfoArea is right after common header,
   // starts from offset: 0 + kFruCommonHeaderSize
-  board_info.FillFromImage(fru_image, 0 + kFruCommonHeaderSize);
-
-  info = {
-      .product_name =
-          StringUpToNul(board_info.product_name().GetDataAsString()),
-      .manufacturer =
-          StringUpToNul(board_info.manufacturer().GetDataAsString()),
-      .serial_number =
-          StringUpToNul(board_info.serial_number().GetDataAsString()),
-      .part_number = StringUpToNul(board_info.part_number().GetDataAsString())};
+  absl::StatusOr<FruBoardInfoView> maybe_board_info =
+      FruBoardInfoView::Parse(fru_data, 0 + kFruCommonHeaderSize);
+  if (!maybe_board_info.ok()) {
+    return maybe_board_info.status();
+  }
+  FruInfoFromBoardInfo(*maybe_board_info, info);
   return absl::OkStatus();
 }
 
@@ -157,17 +168,19 @@ absl::optional<SysmodelFru> IpmiSysmodelFruReader::Read() {
   if (!status.ok()) {
     return absl::nullopt;
   }
-  VectorFruImageSource fru_image(absl::MakeSpan(data));
-  BoardInfoArea bia;
-  if (bia.FillFromImage(fru_image, 8) == 0) {
+  absl::StatusOr<FruBoardInfoView> maybe_board_info =
+      FruBoardInfoView::Parse(data, 8);
+  if (!maybe_board_info.ok()) {
     return absl::nullopt;
   }
-  FruInfo fru_info;
-  fru_info.manufacturer = bia.manufacturer().GetDataAsString();
-  fru_info.product_name = bia.product_name().GetDataAsString();
-  fru_info.part_number = bia.part_number().GetDataAsString();
-  fru_info.serial_number = bia.serial_number().GetDataAsString();
-  cached_fru_.emplace(fru_info);
+  // Unlike the EEPROM and file readers, fields read over IPMI are used in full
+  // without being truncated at the first NUL.
+  FruInfo fru_info = {
+      .product_name = FieldAsString(maybe_board_info->product_name()),
+      .manufacturer = FieldAsString(maybe_board_info->manufacturer()),
+      .serial_number = FieldAsString(maybe_board_info->serial_number()),
+      .part_number = FieldAsString(maybe_board_info->part_number())};
+  cached_fru_.emplace(std::move(fru_info));
   return cached_fru_;
 }
 
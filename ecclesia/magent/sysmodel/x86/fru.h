@@ -17,9 +17,11 @@
 #ifndef ECCLESIA_MAGENT_SYSMODEL_X86_FRU_H_
 #define ECCLESIA_MAGENT_SYSMODEL_X86_FRU_H_
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
@@ -52,6 +54,8 @@ class SysmodelFru {
   absl::string_view GetSerialNumber() const;
   absl::string_view GetPartNumber() const;
 
+  const FruInfo &GetFruInfo() const { return fru_info_; }
+
  private:
   FruInfo fru_info_;
 };
@@ -119,16 +123,25 @@ class SmbusEeprom2ByteAddrFruReader : public SysmodelFruReaderIntf {
 };
 
 // SysmodelFruReaderFactory wraps a lambda for constructing a SysmodelFruReader
-// instance.
+// instance. Each factory can also name the bus that its FRU is read over;
+// FRUs on the same bus are never read concurrently. An empty bus name means
+// the FRU can be read independently of all other FRUs.
 class SysmodelFruReaderFactory {
  public:
   using FactoryFunction =
       std::function<std::unique_ptr<SysmodelFruReaderIntf>()>;
   SysmodelFruReaderFactory(std::string name, FactoryFunction factory)
       : name_(std::move(name)), factory_(std::move(factory)) {}
+  SysmodelFruReaderFactory(std::string name, std::string bus,
+                           FactoryFunction factory)
+      : name_(std::move(name)),
+        bus_(std::move(bus)),
+        factory_(std::move(factory)) {}
 
   // Returns the name of the associated SysmodelFruReaderIntf.
   absl::string_view Name() const { return name_; }
+  // Returns the name of the bus the FRU is read over.
+  absl::string_view Bus() const { return bus_; }
   // Invokes the FactoryFunction to construct a SysmodelFruReaderIntf instance.
   std::unique_ptr<SysmodelFruReaderIntf> Construct() const {
     return factory_();
@@ -136,9 +149,32 @@ class SysmodelFruReaderFactory {
 
  private:
   std::string name_;
+  std::string bus_;
   FactoryFunction factory_;
 };
 
+// SysmodelFruDiscovery wraps a lambda for finding FRUs which cannot be listed
+// up front, such as the FRUs that are only known to a BMC. Discovery is done
+// on the given bus, and the FRUs it finds are then read on that same bus.
+class SysmodelFruDiscovery {
+ public:
+  using DiscoveryFunction =
+      std::function<std::vector<SysmodelFruReaderFactory>()>;
+  SysmodelFruDiscovery(std::string bus, DiscoveryFunction discovery)
+      : bus_(std::move(bus)), discovery_(std::move(discovery)) {}
+
+  // Returns the name of the bus the discovery is done over.
+  absl::string_view Bus() const { return bus_; }
+  // Invokes the DiscoveryFunction to find FRUs.
+  std::vector<SysmodelFruReaderFactory> Discover() const {
+    return discovery_();
+  }
+
+ private:
+  std::string bus_;
+  DiscoveryFunction discovery_;
+};
+
 // This method generates a map of FruReader names to FruReader instances. The
 // FruReader name is the same as that of the FruReader factory. Thus the factory
 // names must be unique.
@@ -0,0 +1,218 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/sysmodel/x86/fru_acquisition.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "ecclesia/lib/logging/globals.h"
+#include "ecclesia/lib/logging/logging.h"
+#include "ecclesia/magent/sysmodel/x86/fru.h"
+
+namespace ecclesia {
+
+// The discoveries and FRU reads which are done on a single bus. Once the
+// acquisition has started, these are only used by the thread for the bus.
+struct FruAcquisition::Bus {
+  std::string name;
+  std::vector<SysmodelFruDiscovery> discoveries;
+  std::vector<SysmodelFruReaderFactory> factories;
+};
+
+FruAcquisition::FruAcquisition(
+    absl::Span<const SysmodelFruReaderFactory> factories,
+    absl::Span<const SysmodelFruDiscovery> discoveries, const Options &options)
+    : options_(options) {
+  std::vector<std::unique_ptr<Bus>> buses;
+  absl::flat_hash_map<std::string, Bus *> buses_by_name;
+  auto get_bus = [&](absl::string_view name) {
+    if (!name.empty()) {
+      if (auto iter = buses_by_name.find(name); iter != buses_by_name.end()) {
+        return iter->second;
+      }
+    }
+    // FRUs without a bus each get a bus of their own.
+    buses.push_back(absl::make_unique<Bus>());
+    Bus *bus = buses.back().get();
+    bus->name = std::string(name);
+    if (!name.empty()) buses_by_name.emplace(name, bus);
+    return bus;
+  };
+
+  absl::MutexLock ml(&mutex_);
+  for (const SysmodelFruReaderFactory &factory : factories) {
+    AddFru(factory, get_bus(factory.Bus()));
+  }
+  for (const SysmodelFruDiscovery &discovery : discoveries) {
+    get_bus(discovery.Bus())->discoveries.push_back(discovery);
+  }
+  buses_ = std::move(buses);
+}
+
+FruAcquisition::~FruAcquisition() { Join(); }
+
+void FruAcquisition::Join() {
+  for (std::thread &thread : threads_) {
+    if (thread.joinable()) thread.join();
+  }
+}
+
+void FruAcquisition::Preload(const std::string &name, SysmodelFru fru) {
+  {
+    absl::MutexLock ml(&mutex_);
+    auto [iter, inserted] = frus_.try_emplace(name, nullptr);
+    if (inserted) {
+      iter->second = absl::make_unique<AcquiredFru>();
+      preloaded_.insert(name);
+    }
+  }
+  Publish(name, std::move(fru));
+}
+
+void FruAcquisition::Start() {
+  deadline_ = absl::Now() + options_.deadline;
+
+  std::vector<Bus *> buses;
+  {
+    absl::MutexLock ml(&mutex_);
+    for (const auto &bus : buses_) buses.push_back(bus.get());
+    buses_remaining_ = buses.size();
+  }
+  if (buses.empty()) {
+    done_.Notify();
+    if (options_.on_done) options_.on_done();
+    return;
+  }
+  for (Bus *bus : buses) {
+    threads_.emplace_back([this, bus]() { ReadBus(bus); });
+  }
+}
+
+bool FruAcquisition::WaitUntilDone() const {
+  return done_.WaitForNotificationWithDeadline(deadline_);
+}
+
+std::size_t FruAcquisition::NumReaders() const {
+  absl::MutexLock ml(&mutex_);
+  return frus_.size();
+}
+
+SysmodelFruReaderIntf *FruAcquisition::GetReader(absl::string_view name) const {
+  absl::MutexLock ml(&mutex_);
+  auto iter = frus_.find(name);
+  if (iter == frus_.end()) return nullptr;
+  return iter->second.get();
+}
+
+void FruAcquisition::OnAcquired(absl::string_view name, Callback callback) {
+  absl::optional<SysmodelFru> fru;
+  {
+    absl::MutexLock ml(&mutex_);
+    if (auto iter = frus_.find(name); iter != frus_.end()) {
+      fru = iter->second->Read();
+    }
+    if (!fru.has_value()) {
+      callbacks_[name].push_back(std::move(callback));
+      return;
+    }
+  }
+  callback(*fru);
+}
+
+void FruAcquisition::AddFru(const SysmodelFruReaderFactory &factory,
+                            Bus *bus) {
+  auto [iter, inserted] = frus_.try_emplace(factory.Name(), nullptr);
+  if (inserted) {
+    iter->second = absl::make_unique<AcquiredFru>();
+  } else if (preloaded_.erase(factory.Name()) == 0) {
+    // The FRU already has a reader, unless it was only preloaded.
+    ErrorLog() << "ignoring duplicate FRU: " << factory.Name();
+    return;
+  }
+  bus->factories.push_back(factory);
+}
+
+void FruAcquisition::ReadBus(Bus *bus) {
+  for (const SysmodelFruDiscovery &discovery : bus->discoveries) {
+    if (absl::Now() >= deadline_) break;
+    std::vector<SysmodelFruReaderFactory> found = discovery.Discover();
+    absl::MutexLock ml(&mutex_);
+    for (const SysmodelFruReaderFactory &factory : found) {
+      AddFru(factory, bus);
+    }
+  }
+
+  std::size_t num_read = 0;
+  for (; num_read < bus->factories.size(); ++num_read) {
+    if (absl::Now() >= deadline_) break;
+    const SysmodelFruReaderFactory &factory = bus->factories[num_read];
+    std::unique_ptr<SysmodelFruReaderIntf> reader = factory.Construct();
+    absl::optional<SysmodelFru> fru;
+    if (reader) fru = reader->Read();
+    if (fru.has_value()) {
+      Publish(std::string(factory.Name()), std::move(*fru));
+    } else {
+      WarningLog() << "unable to read FRU: " << factory.Name();
+    }
+  }
+  if (num_read < bus->factories.size()) {
+    WarningLog() << "giving up on " << bus->factories.size() - num_read
+                 << " FRUs on bus '" << bus->name
+                 << "' after the deadline of "
+                 << absl::FormatDuration(options_.deadline);
+  }
+
+  bool last_bus;
+  {
+    absl::MutexLock ml(&mutex_);
+    last_bus = --buses_remaining_ == 0;
+  }
+  if (last_bus) {
+    done_.Notify();
+    if (options_.on_done) options_.on_done();
+  }
+}
+
+void FruAcquisition::Publish(const std::string &name, SysmodelFru fru) {
+  std::vector<Callback> callbacks;
+  {
+    absl::MutexLock ml(&mutex_);
+    auto iter = frus_.find(name);
+    if (iter == frus_.end()) return;
+    iter->second->Set(fru);
+    if (auto cb_iter = callbacks_.find(name); cb_iter != callbacks_.end()) {
+      callbacks = std::move(cb_iter->second);
+      callbacks_.erase(cb_iter);
+    }
+  }
+  for (const Callback &callback : callbacks) {
+    callback(fru);
+  }
+}
+
+}  // namespace ecclesia
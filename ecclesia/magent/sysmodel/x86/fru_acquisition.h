@@ -0,0 +1,166 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This library provides a startup stage which reads all of the system FRUs in
+// the background. FRUs are read over slow buses (SMBus EEPROMs, or IPMI via
+// the BMC), and reading them one at a time before the agent starts serving
+// delays every request by the sum of all of the reads.
+//
+// FRUs which share a bus are read one at a time, in the order they were given.
+// FRUs on different buses are read in parallel. The whole stage has a single
+// deadline: once it passes no further reads are started, and any FRU which
+// has not been read by then is treated as absent. The readers handed out by
+// the stage never block. They return nothing until their FRU has been read,
+// and callers which want to fill in FRU data once it arrives can register a
+// callback to be run when it does.
+
+#ifndef ECCLESIA_MAGENT_SYSMODEL_X86_FRU_ACQUISITION_H_
+#define ECCLESIA_MAGENT_SYSMODEL_X86_FRU_ACQUISITION_H_
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "ecclesia/magent/sysmodel/x86/fru.h"
+
+namespace ecclesia {
+
+class FruAcquisition {
+ public:
+  struct Options {
+    // How long after Start to keep starting new reads for.
+    absl::Duration deadline = absl::Seconds(30);
+    // If set, this is run once every bus has finished being read. It is run
+    // on one of the acquisition's threads, or by Start if there are no FRUs.
+    std::function<void()> on_done;
+  };
+
+  using Callback = std::function<void(const SysmodelFru &)>;
+
+  FruAcquisition(absl::Span<const SysmodelFruReaderFactory> factories,
+                 absl::Span<const SysmodelFruDiscovery> discoveries,
+                 const Options &options);
+
+  // The acquisition owns threads so it cannot be copied.
+  FruAcquisition(const FruAcquisition &other) = delete;
+  FruAcquisition &operator=(const FruAcquisition &other) = delete;
+
+  // Waits for any reads which are still in flight, including reads which
+  // started before the deadline but have not yet finished.
+  ~FruAcquisition();
+
+  // Waits for all of the reads to finish, as the destructor does. Once this
+  // returns no more reads or callbacks will be run, including on_done. This
+  // allows an owner whose on_done uses the acquisition to wait for it before
+  // starting to destroy it. It must not be called concurrently with Start.
+  void Join();
+
+  // Seed the named FRU with contents saved from an earlier read, such as from
+  // a system model snapshot. The FRU reads as these contents straight away
+  // and its callbacks are run with them; they are replaced if the FRU is read
+  // again. The name does not have to have been discovered yet. Must be called
+  // before Start.
+  void Preload(const std::string &name, SysmodelFru fru);
+
+  // Start reading the FRUs in the background. Must be called at most once.
+  void Start();
+
+  // Blocks until either every FRU has been read or the deadline has passed.
+  // Returns true if every FRU was read.
+  bool WaitUntilDone() const;
+
+  // Access the readers for the FRUs. The FRUs found by discoveries are only
+  // present once their discovery has finished.
+  std::size_t NumReaders() const;
+  template <typename IteratorF>
+  void GetReaders(IteratorF iterator) const {
+    absl::MutexLock ml(&mutex_);
+    for (const auto &[name, fru] : frus_) {
+      iterator(name, fru.get());
+    }
+  }
+  SysmodelFruReaderIntf *GetReader(absl::string_view name) const;
+
+  // Register a callback to be run with the named FRU once it has been read.
+  // If it has already been read the callback is run immediately; otherwise it
+  // is run on a background thread. If the FRU is never successfully read the
+  // callback is never run. The name does not have to have been discovered yet.
+  void OnAcquired(absl::string_view name, Callback callback);
+
+ private:
+  // A reader which returns the contents of a FRU once it has been acquired.
+  class AcquiredFru : public SysmodelFruReaderIntf {
+   public:
+    absl::optional<SysmodelFru> Read() override {
+      absl::MutexLock ml(&mutex_);
+      return fru_;
+    }
+
+    void Set(SysmodelFru fru) {
+      absl::MutexLock ml(&mutex_);
+      fru_.emplace(std::move(fru));
+    }
+
+   private:
+    absl::Mutex mutex_;
+    absl::optional<SysmodelFru> fru_ ABSL_GUARDED_BY(mutex_);
+  };
+
+  struct Bus;
+
+  // Add a reader for a FRU which will be read on the given bus.
+  void AddFru(const SysmodelFruReaderFactory &factory, Bus *bus)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Run the discoveries and read all of the FRUs on a single bus.
+  void ReadBus(Bus *bus);
+
+  // Publish the contents of a FRU, running any callbacks waiting on it.
+  void Publish(const std::string &name, SysmodelFru fru);
+
+  const Options options_;
+  absl::Time deadline_;
+
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<std::string, std::unique_ptr<AcquiredFru>> frus_
+      ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<std::string, std::vector<Callback>> callbacks_
+      ABSL_GUARDED_BY(mutex_);
+  // FRUs which were preloaded but have not yet been given a reader.
+  absl::flat_hash_set<std::string> preloaded_ ABSL_GUARDED_BY(mutex_);
+  std::vector<std::unique_ptr<Bus>> buses_ ABSL_GUARDED_BY(mutex_);
+  std::size_t buses_remaining_ ABSL_GUARDED_BY(mutex_) = 0;
+
+  absl::Notification done_;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace ecclesia
+
+#endif  // ECCLESIA_MAGENT_SYSMODEL_X86_FRU_ACQUISITION_H_
@@ -0,0 +1,329 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/sysmodel/x86/fru_acquisition.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "ecclesia/magent/sysmodel/x86/fru.h"
+
+namespace ecclesia {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::UnorderedElementsAre;
+
+// A reader which returns a FRU with the given serial number, after running an
+// optional hook. An empty serial number reads as a failure.
+class FakeFruReader : public SysmodelFruReaderIntf {
+ public:
+  FakeFruReader(std::string serial, std::function<void()> hook)
+      : serial_(std::move(serial)), hook_(std::move(hook)) {}
+
+  absl::optional<SysmodelFru> Read() override {
+    if (hook_) hook_();
+    if (serial_.empty()) return absl::nullopt;
+    return SysmodelFru({.serial_number = serial_});
+  }
+
+ private:
+  std::string serial_;
+  std::function<void()> hook_;
+};
+
+SysmodelFruReaderFactory FakeFactory(std::string name, std::string bus,
+                                     std::string serial,
+                                     std::function<void()> hook = nullptr) {
+  return SysmodelFruReaderFactory(
+      std::move(name), std::move(bus),
+      [serial, hook]() -> std::unique_ptr<SysmodelFruReaderIntf> {
+        return absl::make_unique<FakeFruReader>(serial, hook);
+      });
+}
+
+// Returns the serial number read by the named reader, or "" if it has none.
+std::string ReadSerial(const FruAcquisition &acquisition,
+                       absl::string_view name) {
+  SysmodelFruReaderIntf *reader = acquisition.GetReader(name);
+  if (!reader) return "";
+  absl::optional<SysmodelFru> fru = reader->Read();
+  if (!fru.has_value()) return "";
+  return std::string(fru->GetSerialNumber());
+}
+
+TEST(FruAcquisitionTest, ReadsAllFrus) {
+  std::vector<SysmodelFruReaderFactory> factories = {
+      FakeFactory("motherboard", "smbus", "mobo-sn"),
+      FakeFactory("riser", "smbus", "riser-sn"),
+      FakeFactory("file", "", "file-sn"),
+      FakeFactory("broken", "", ""),
+  };
+  FruAcquisition acquisition(factories, {}, {});
+  EXPECT_EQ(acquisition.NumReaders(), 4);
+  // Nothing is read until the acquisition is started.
+  EXPECT_EQ(ReadSerial(acquisition, "motherboard"), "");
+
+  acquisition.Start();
+  EXPECT_TRUE(acquisition.WaitUntilDone());
+  EXPECT_EQ(ReadSerial(acquisition, "motherboard"), "mobo-sn");
+  EXPECT_EQ(ReadSerial(acquisition, "riser"), "riser-sn");
+  EXPECT_EQ(ReadSerial(acquisition, "file"), "file-sn");
+  EXPECT_EQ(ReadSerial(acquisition, "broken"), "");
+  EXPECT_EQ(acquisition.GetReader("missing"), nullptr);
+
+  std::vector<std::string> names;
+  acquisition.GetReaders(
+      [&](absl::string_view name, SysmodelFruReaderIntf *) {
+        names.emplace_back(name);
+      });
+  EXPECT_THAT(names,
+              UnorderedElementsAre("motherboard", "riser", "file", "broken"));
+}
+
+TEST(FruAcquisitionTest, NoFrus) {
+  FruAcquisition acquisition({}, {}, {});
+  acquisition.Start();
+  EXPECT_TRUE(acquisition.WaitUntilDone());
+  EXPECT_EQ(acquisition.NumReaders(), 0);
+}
+
+TEST(FruAcquisitionTest, ReadersDoNotBlockOnReads) {
+  absl::Notification release;
+  std::vector<SysmodelFruReaderFactory> factories = {
+      FakeFactory("slow", "ipmi", "slow-sn",
+                  [&]() { release.WaitForNotification(); }),
+  };
+  FruAcquisition acquisition(factories, {}, {});
+  acquisition.Start();
+
+  EXPECT_EQ(ReadSerial(acquisition, "slow"), "");
+
+  absl::Notification acquired;
+  std::string acquired_serial;
+  acquisition.OnAcquired("slow", [&](const SysmodelFru &fru) {
+    acquired_serial = std::string(fru.GetSerialNumber());
+    acquired.Notify();
+  });
+  release.Notify();
+  acquired.WaitForNotification();
+  EXPECT_EQ(acquired_serial, "slow-sn");
+  EXPECT_TRUE(acquisition.WaitUntilDone());
+  EXPECT_EQ(ReadSerial(acquisition, "slow"), "slow-sn");
+
+  // A callback registered after the read runs immediately.
+  bool called = false;
+  acquisition.OnAcquired("slow", [&](const SysmodelFru &) { called = true; });
+  EXPECT_TRUE(called);
+}
+
+TEST(FruAcquisitionTest, SameBusIsSerialized) {
+  absl::Mutex mutex;
+  std::vector<std::string> order;
+  int in_flight = 0;
+  int max_in_flight = 0;
+  auto hook = [&](std::string name) {
+    return [&, name]() {
+      {
+        absl::MutexLock ml(&mutex);
+        order.push_back(name);
+        max_in_flight = std::max(max_in_flight, ++in_flight);
+      }
+      absl::SleepFor(absl::Milliseconds(5));
+      absl::MutexLock ml(&mutex);
+      --in_flight;
+    };
+  };
+  std::vector<SysmodelFruReaderFactory> factories = {
+      FakeFactory("a", "smbus", "a-sn", hook("a")),
+      FakeFactory("b", "smbus", "b-sn", hook("b")),
+      FakeFactory("c", "smbus", "c-sn", hook("c")),
+  };
+  FruAcquisition acquisition(factories, {}, {});
+  acquisition.Start();
+  EXPECT_TRUE(acquisition.WaitUntilDone());
+
+  absl::MutexLock ml(&mutex);
+  EXPECT_EQ(max_in_flight, 1);
+  EXPECT_THAT(order, ElementsAre("a", "b", "c"));
+}
+
+TEST(FruAcquisitionTest, DifferentBusesAreParallel) {
+  // Each read waits for the other to start, which can only succeed if they
+  // are done in parallel.
+  absl::Notification a_started;
+  absl::Notification b_started;
+  std::atomic<bool> overlapped = true;
+  std::vector<SysmodelFruReaderFactory> factories = {
+      FakeFactory("a", "smbus", "a-sn",
+                  [&]() {
+                    a_started.Notify();
+                    if (!b_started.WaitForNotificationWithTimeout(
+                            absl::Seconds(10))) {
+                      overlapped = false;
+                    }
+                  }),
+      FakeFactory("b", "ipmi", "b-sn",
+                  [&]() {
+                    b_started.Notify();
+                    if (!a_started.WaitForNotificationWithTimeout(
+                            absl::Seconds(10))) {
+                      overlapped = false;
+                    }
+                  }),
+  };
+  FruAcquisition acquisition(factories, {}, {});
+  acquisition.Start();
+  EXPECT_TRUE(acquisition.WaitUntilDone());
+  EXPECT_TRUE(overlapped);
+}
+
+TEST(FruAcquisitionTest, NoReadsStartAfterDeadline) {
+  absl::Notification release;
+  std::atomic<int> num_constructed = 0;
+  std::vector<SysmodelFruReaderFactory> factories = {
+      FakeFactory("slow", "smbus", "slow-sn",
+                  [&]() { release.WaitForNotification(); }),
+      SysmodelFruReaderFactory(
+          "late", "smbus",
+          [&]() -> std::unique_ptr<SysmodelFruReaderIntf> {
+            ++num_constructed;
+            return absl::make_unique<FakeFruReader>("late-sn", nullptr);
+          }),
+  };
+  auto acquisition = absl::make_unique<FruAcquisition>(
+      factories, absl::Span<const SysmodelFruDiscovery>(),
+      FruAcquisition::Options{.deadline = absl::Milliseconds(50)});
+  acquisition->Start();
+  EXPECT_FALSE(acquisition->WaitUntilDone());
+
+  // The read which was in flight at the deadline is still published.
+  absl::Notification acquired;
+  acquisition->OnAcquired("slow",
+                          [&](const SysmodelFru &) { acquired.Notify(); });
+  release.Notify();
+  acquired.WaitForNotification();
+  EXPECT_EQ(ReadSerial(*acquisition, "slow"), "slow-sn");
+
+  // But the read after it is never started.
+  acquisition.reset();
+  EXPECT_EQ(num_constructed, 0);
+}
+
+TEST(FruAcquisitionTest, DiscoveredFrus) {
+  std::vector<SysmodelFruDiscovery> discoveries = {SysmodelFruDiscovery(
+      "ipmi", []() -> std::vector<SysmodelFruReaderFactory> {
+        return {FakeFactory("bmc", "ipmi", "bmc-sn"),
+                FakeFactory("hsbp", "ipmi", "hsbp-sn")};
+      })};
+  FruAcquisition acquisition({}, discoveries, {});
+  EXPECT_EQ(acquisition.NumReaders(), 0);
+
+  // Callbacks can be registered before the FRU has been discovered.
+  absl::Notification acquired;
+  acquisition.OnAcquired("hsbp",
+                         [&](const SysmodelFru &) { acquired.Notify(); });
+
+  acquisition.Start();
+  EXPECT_TRUE(acquisition.WaitUntilDone());
+  EXPECT_TRUE(acquired.HasBeenNotified());
+  EXPECT_EQ(acquisition.NumReaders(), 2);
+  EXPECT_EQ(ReadSerial(acquisition, "bmc"), "bmc-sn");
+  EXPECT_EQ(ReadSerial(acquisition, "hsbp"), "hsbp-sn");
+}
+
+TEST(FruAcquisitionTest, DuplicateNamesIgnored) {
+  std::vector<SysmodelFruReaderFactory> factories = {
+      FakeFactory("mobo", "smbus", "first"),
+      FakeFactory("mobo", "smbus", "second"),
+  };
+  FruAcquisition acquisition(factories, {}, {});
+  acquisition.Start();
+  EXPECT_TRUE(acquisition.WaitUntilDone());
+  EXPECT_EQ(acquisition.NumReaders(), 1);
+  EXPECT_EQ(ReadSerial(acquisition, "mobo"), "first");
+}
+
+TEST(FruAcquisitionTest, PreloadedFrusAreReadAgain) {
+  absl::Notification release;
+  std::vector<SysmodelFruReaderFactory> factories = {
+      FakeFactory("mobo", "smbus", "mobo-sn",
+                  [&]() { release.WaitForNotification(); }),
+  };
+  std::vector<SysmodelFruDiscovery> discoveries = {SysmodelFruDiscovery(
+      "ipmi", []() -> std::vector<SysmodelFruReaderFactory> {
+        return {FakeFactory("bmc", "ipmi", "bmc-sn")};
+      })};
+  FruAcquisition acquisition(factories, discoveries, {});
+
+  // Callbacks are run with the preloaded contents.
+  std::string acquired_serial;
+  acquisition.OnAcquired("mobo", [&](const SysmodelFru &fru) {
+    acquired_serial = std::string(fru.GetSerialNumber());
+  });
+  acquisition.Preload("mobo", SysmodelFru({.serial_number = "old-mobo-sn"}));
+  acquisition.Preload("bmc", SysmodelFru({.serial_number = "old-bmc-sn"}));
+  EXPECT_EQ(acquired_serial, "old-mobo-sn");
+  EXPECT_EQ(ReadSerial(acquisition, "mobo"), "old-mobo-sn");
+  EXPECT_EQ(ReadSerial(acquisition, "bmc"), "old-bmc-sn");
+  EXPECT_EQ(acquisition.NumReaders(), 2);
+
+  // The FRUs are still read, including a preloaded FRU which is only found
+  // by a discovery.
+  acquisition.Start();
+  release.Notify();
+  EXPECT_TRUE(acquisition.WaitUntilDone());
+  EXPECT_EQ(ReadSerial(acquisition, "mobo"), "mobo-sn");
+  EXPECT_EQ(ReadSerial(acquisition, "bmc"), "bmc-sn");
+  EXPECT_EQ(acquisition.NumReaders(), 2);
+}
+
+TEST(FruAcquisitionTest, OnDoneRunsAfterAllReads) {
+  std::vector<SysmodelFruReaderFactory> factories = {
+      FakeFactory("mobo", "smbus", "mobo-sn"),
+      FakeFactory("bmc", "ipmi", "bmc-sn"),
+  };
+  absl::Notification done;
+  std::vector<std::string> serials;
+  FruAcquisition *acquisition_ptr = nullptr;
+  FruAcquisition::Options options;
+  options.on_done = [&]() {
+    serials.push_back(ReadSerial(*acquisition_ptr, "mobo"));
+    serials.push_back(ReadSerial(*acquisition_ptr, "bmc"));
+    done.Notify();
+  };
+  FruAcquisition acquisition(factories, {}, options);
+  acquisition_ptr = &acquisition;
+  acquisition.Start();
+  done.WaitForNotification();
+  EXPECT_THAT(serials, ElementsAre("mobo-sn", "bmc-sn"));
+}
+
+}  // namespace
+}  // namespace ecclesia
@@ -16,8 +16,12 @@
 
 #include "ecclesia/magent/sysmodel/x86/fru.h"
 
+#include <cstdint>
+#include <vector>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/strings/string_view.h"
 #include "ecclesia/magent/lib/ipmi/ipmi_mock.h"
 
 namespace ecclesia {
@@ -57,5 +61,26 @@ TEST(IpmiSysmodelFruReaderTest, ReadFruSucces) {
   EXPECT_EQ(fru_reader.GetSerialNumber(), "SRCQTW193100125");
 }
 
+TEST(IpmiSysmodelFruReaderTest, FieldsAreNotTruncatedAtNul) {
+  MockIpmiInterface ipmi_intf;
+  uint16_t fru_id = 1;
+  IpmiSysmodelFruReader ipmi_fru_reader(&ipmi_intf, fru_id);
+  // The same data as above, but with the '-' in the part number replaced by a
+  // NUL, and the board area checksum adjusted to match.
+  std::vector<uint8_t> data = {
+      1,  0,   0,  1,   0,   0,   0,   254, 1,   8,   0,   58,  134, 189, 198,
+      81, 117, 97, 110, 116, 97,  204, 83,  108, 101, 105, 112, 110, 105, 114,
+      32, 66,  77, 67,  207, 83,  82,  67,  81,  84,  87,  49,  57,  51,  49,
+      48, 48,  49, 50,  53,  202, 49,  48,  53,  51,  57,  52,  56,  0,   48,
+      50, 0,   0,  193, 0,   0,   0,   0,   0,   0,   0,   114};
+  auto expect_data = absl::MakeSpan(data);
+  EXPECT_CALL(ipmi_intf, ReadFru(fru_id, 0, _))
+      .WillOnce(IpmiReadFru(expect_data.data()));
+  auto optional_fru_reader = ipmi_fru_reader.Read();
+  ASSERT_TRUE(optional_fru_reader.has_value());
+  EXPECT_EQ(optional_fru_reader->GetPartNumber(),
+            absl::string_view("1053948\0" "02", 10));
+}
+
 }  // namespace
 }  // namespace ecclesia
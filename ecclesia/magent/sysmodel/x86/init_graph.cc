@@ -0,0 +1,122 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/sysmodel/x86/init_graph.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "ecclesia/lib/logging/globals.h"
+#include "ecclesia/lib/logging/logging.h"
+#include "ecclesia/lib/time/clock.h"
+
+namespace ecclesia {
+
+InitGraph::InitGraph(Clock *clock) : clock_(clock) {}
+
+InitGraph::~InitGraph() {
+  for (std::thread &thread : threads_) {
+    thread.join();
+  }
+}
+
+void InitGraph::AddPhase(std::string name,
+                         absl::Span<const absl::string_view> deps,
+                         std::function<void()> run) {
+  Check(!started_, "phases are not added after the graph is started");
+  auto phase = absl::make_unique<Phase>();
+  phase->index = phases_.size();
+  phase->run = std::move(run);
+
+  absl::MutexLock ml(&mutex_);
+  PhaseTiming timing;
+  timing.name = std::move(name);
+  for (absl::string_view dep : deps) {
+    Phase *found = nullptr;
+    for (const auto &other : phases_) {
+      if (timings_[other->index].name == dep) found = other.get();
+    }
+    Check(found != nullptr, "phase dependencies are added before the phase");
+    phase->dependencies.push_back(found);
+    timing.dependencies.emplace_back(dep);
+  }
+  timings_.push_back(std::move(timing));
+  phases_.push_back(std::move(phase));
+}
+
+void InitGraph::Start() {
+  Check(!started_, "the graph is only started once");
+  started_ = true;
+  start_ = clock_->Now();
+  {
+    absl::MutexLock ml(&mutex_);
+    phases_remaining_ = phases_.size();
+  }
+  if (phases_.empty()) {
+    done_.Notify();
+    return;
+  }
+  for (const auto &phase : phases_) {
+    threads_.emplace_back([this, phase = phase.get()]() { RunPhase(phase); });
+  }
+}
+
+std::vector<InitGraph::PhaseTiming> InitGraph::GetTimings() const {
+  absl::MutexLock ml(&mutex_);
+  return timings_;
+}
+
+void InitGraph::RunPhase(Phase *phase) {
+  for (Phase *dep : phase->dependencies) {
+    dep->finished.WaitForNotification();
+  }
+
+  absl::Time start = clock_->Now();
+  std::string name;
+  {
+    absl::MutexLock ml(&mutex_);
+    timings_[phase->index].start = start;
+    name = timings_[phase->index].name;
+  }
+  phase->run();
+  absl::Duration duration = clock_->Now() - start;
+  InfoLog() << "init phase '" << name << "' took "
+            << absl::FormatDuration(duration);
+
+  bool last_phase;
+  {
+    absl::MutexLock ml(&mutex_);
+    timings_[phase->index].duration = duration;
+    last_phase = --phases_remaining_ == 0;
+  }
+  phase->finished.Notify();
+  if (last_phase) {
+    InfoLog() << "all init phases finished after "
+              << absl::FormatDuration(clock_->Now() - start_);
+    done_.Notify();
+  }
+}
+
+}  // namespace ecclesia
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This library runs a set of initialization phases, each of which can depend
+// on other phases. Every phase is started as soon as all of its dependencies
+// have finished, so phases which are independent of each other run in
+// parallel and the whole graph takes as long as its slowest chain of phases
+// rather than the sum of all of them.
+//
+// The wall time taken by each phase is recorded and logged, so that slow
+// phases can be identified.
+
+#ifndef ECCLESIA_MAGENT_SYSMODEL_X86_INIT_GRAPH_H_
+#define ECCLESIA_MAGENT_SYSMODEL_X86_INIT_GRAPH_H_
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "ecclesia/lib/time/clock.h"
+
+namespace ecclesia {
+
+class InitGraph {
+ public:
+  // The timing information for a single phase.
+  struct PhaseTiming {
+    std::string name;
+    std::vector<std::string> dependencies;
+    // When the phase started running and how long it took, if it has. Phases
+    // which are still waiting on their dependencies have no start time, and
+    // phases which are still running have no duration.
+    absl::optional<absl::Time> start;
+    absl::optional<absl::Duration> duration;
+  };
+
+  explicit InitGraph(Clock *clock = Clock::RealClock());
+
+  // The graph owns threads so it cannot be copied.
+  InitGraph(const InitGraph &other) = delete;
+  InitGraph &operator=(const InitGraph &other) = delete;
+
+  // Waits for all of the phases to finish.
+  ~InitGraph();
+
+  // Add a phase which will run the given function once all of the named
+  // dependencies have finished. The dependencies must already have been added,
+  // which means that the graph can never contain a cycle. Phases cannot be
+  // added once the graph has been started.
+  void AddPhase(std::string name, absl::Span<const absl::string_view> deps,
+                std::function<void()> run);
+
+  // Start running the phases in the background. Must be called at most once.
+  void Start();
+
+  // Indicates if every phase has finished, and blocks until they have.
+  bool IsDone() const { return done_.HasBeenNotified(); }
+  void WaitUntilDone() const { done_.WaitForNotification(); }
+
+  // Returns the timing of every phase, in the order they were added.
+  std::vector<PhaseTiming> GetTimings() const;
+
+ private:
+  struct Phase {
+    // The index of the phase in phases_ and timings_.
+    std::size_t index;
+    std::vector<Phase *> dependencies;
+    std::function<void()> run;
+    absl::Notification finished;
+  };
+
+  // Wait for the dependencies of a phase and then run it.
+  void RunPhase(Phase *phase);
+
+  Clock *const clock_;
+  absl::Time start_;
+
+  std::vector<std::unique_ptr<Phase>> phases_;
+  bool started_ = false;
+
+  mutable absl::Mutex mutex_;
+  // The timings of the phases, which are updated as they run.
+  std::vector<PhaseTiming> timings_ ABSL_GUARDED_BY(mutex_);
+  std::size_t phases_remaining_ ABSL_GUARDED_BY(mutex_) = 0;
+
+  absl::Notification done_;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace ecclesia
+
+#endif  // ECCLESIA_MAGENT_SYSMODEL_X86_INIT_GRAPH_H_
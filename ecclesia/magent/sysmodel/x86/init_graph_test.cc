@@ -0,0 +1,128 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/sysmodel/x86/init_graph.h"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "ecclesia/lib/time/clock_fake.h"
+
+namespace ecclesia {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::Optional;
+
+TEST(InitGraphTest, NoPhases) {
+  InitGraph graph;
+  EXPECT_FALSE(graph.IsDone());
+  graph.Start();
+  EXPECT_TRUE(graph.IsDone());
+  EXPECT_TRUE(graph.GetTimings().empty());
+}
+
+TEST(InitGraphTest, DependenciesRunFirst) {
+  absl::Mutex mutex;
+  std::vector<std::string> order;
+  auto record = [&](std::string name) {
+    return [&, name]() {
+      absl::MutexLock ml(&mutex);
+      order.push_back(name);
+    };
+  };
+
+  InitGraph graph;
+  graph.AddPhase("smbios", {}, record("smbios"));
+  graph.AddPhase("dimms", {"smbios"}, record("dimms"));
+  graph.AddPhase("cpus", {"smbios"}, record("cpus"));
+  graph.AddPhase("snapshot", {"dimms", "cpus"}, record("snapshot"));
+  graph.Start();
+  graph.WaitUntilDone();
+
+  absl::MutexLock ml(&mutex);
+  ASSERT_EQ(order.size(), 4);
+  EXPECT_EQ(order.front(), "smbios");
+  EXPECT_EQ(order.back(), "snapshot");
+}
+
+TEST(InitGraphTest, IndependentPhasesAreParallel) {
+  // Each phase waits for the other to start, which can only succeed if they
+  // run in parallel.
+  absl::Notification a_started;
+  absl::Notification b_started;
+  bool a_overlapped = false;
+  bool b_overlapped = false;
+
+  InitGraph graph;
+  graph.AddPhase("a", {}, [&]() {
+    a_started.Notify();
+    a_overlapped = b_started.WaitForNotificationWithTimeout(absl::Seconds(10));
+  });
+  graph.AddPhase("b", {}, [&]() {
+    b_started.Notify();
+    b_overlapped = a_started.WaitForNotificationWithTimeout(absl::Seconds(10));
+  });
+  graph.Start();
+  graph.WaitUntilDone();
+  EXPECT_TRUE(a_overlapped);
+  EXPECT_TRUE(b_overlapped);
+}
+
+TEST(InitGraphTest, RecordsTimings) {
+  FakeClock clock;
+  absl::Time start = clock.Now();
+  absl::Notification release;
+
+  InitGraph graph(&clock);
+  graph.AddPhase("fast", {}, []() {});
+  graph.AddPhase("slow", {"fast"}, [&]() {
+    release.WaitForNotification();
+    clock.AdvanceTime(absl::Milliseconds(250));
+  });
+  graph.Start();
+
+  // Wait for the slow phase to start, after which it should be the only
+  // phase which has not finished.
+  std::vector<InitGraph::PhaseTiming> timings;
+  do {
+    absl::SleepFor(absl::Milliseconds(1));
+    timings = graph.GetTimings();
+  } while (!timings[1].start.has_value());
+  EXPECT_FALSE(graph.IsDone());
+  EXPECT_THAT(timings[0].duration, Optional(absl::ZeroDuration()));
+  EXPECT_FALSE(timings[1].duration.has_value());
+
+  release.Notify();
+  graph.WaitUntilDone();
+  timings = graph.GetTimings();
+  ASSERT_EQ(timings.size(), 2);
+  EXPECT_EQ(timings[0].name, "fast");
+  EXPECT_TRUE(timings[0].dependencies.empty());
+  EXPECT_THAT(timings[0].start, Optional(start));
+  EXPECT_EQ(timings[1].name, "slow");
+  EXPECT_THAT(timings[1].dependencies, ElementsAre("fast"));
+  EXPECT_THAT(timings[1].start, Optional(start));
+  EXPECT_THAT(timings[1].duration, Optional(absl::Milliseconds(250)));
+}
+
+}  // namespace
+}  // namespace ecclesia
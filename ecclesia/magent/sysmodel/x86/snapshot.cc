@@ -0,0 +1,324 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/sysmodel/x86/snapshot.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "ecclesia/lib/codec/endian.h"
+#include "ecclesia/lib/hash/fnv.h"
+#include "ecclesia/lib/smbios/processor_information.h"
+#include "ecclesia/magent/sysmodel/x86/cpu.h"
+#include "ecclesia/magent/sysmodel/x86/dimm.h"
+#include "ecclesia/magent/sysmodel/x86/fru.h"
+
+namespace ecclesia {
+namespace {
+
+// The snapshot file starts with a magic value and the version of the file
+// format, followed by the key and then the DIMMs, CPUs and FRUs. Each list is
+// stored as a count followed by the fields of each entry in declaration
+// order. Integers are stored as 32-bit little endian values (except for the
+// 64-bit SMBIOS hash) and strings are stored as their length followed by
+// their contents.
+constexpr absl::string_view kSnapshotFileMagic = "ESMS";
+constexpr uint8_t kSnapshotFileVersion = 1;
+
+// Read the entire contents of a file.
+absl::StatusOr<std::string> ReadFile(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return absl::NotFoundError(absl::StrFormat("unable to open %s", path));
+  }
+  std::string contents((std::istreambuf_iterator<char>(file)),
+                       std::istreambuf_iterator<char>());
+  if (file.bad()) {
+    return absl::InternalError(absl::StrFormat("unable to read %s", path));
+  }
+  return contents;
+}
+
+// Helper for appending fields to a serialized snapshot.
+class SnapshotEncoder {
+ public:
+  void AddInt(uint32_t value) {
+    char bytes[4];
+    LittleEndian::Store32(value, bytes);
+    contents_.append(bytes, sizeof(bytes));
+  }
+  void AddInt64(uint64_t value) {
+    char bytes[8];
+    LittleEndian::Store64(value, bytes);
+    contents_.append(bytes, sizeof(bytes));
+  }
+  void AddString(absl::string_view value) {
+    AddInt(value.size());
+    contents_.append(value.data(), value.size());
+  }
+
+  std::string &contents() { return contents_; }
+
+ private:
+  std::string contents_;
+};
+
+// Helper for consuming fields from a serialized snapshot. All of the functions
+// return false if the contents are too short to hold the field.
+class SnapshotDecoder {
+ public:
+  explicit SnapshotDecoder(absl::string_view contents) : contents_(contents) {}
+
+  bool ReadInt(uint32_t *value) {
+    if (contents_.size() < 4) return false;
+    *value = LittleEndian::Load32(contents_.data());
+    contents_.remove_prefix(4);
+    return true;
+  }
+  bool ReadInt(int *value) {
+    uint32_t raw;
+    if (!ReadInt(&raw)) return false;
+    *value = static_cast<int32_t>(raw);
+    return true;
+  }
+  bool ReadBool(bool *value) {
+    uint32_t raw;
+    if (!ReadInt(&raw)) return false;
+    *value = raw != 0;
+    return true;
+  }
+  bool ReadInt64(uint64_t *value) {
+    if (contents_.size() < 8) return false;
+    *value = LittleEndian::Load64(contents_.data());
+    contents_.remove_prefix(8);
+    return true;
+  }
+  bool ReadString(std::string *value) {
+    uint32_t size;
+    if (!ReadInt(&size) || contents_.size() < size) return false;
+    value->assign(contents_.data(), size);
+    contents_.remove_prefix(size);
+    return true;
+  }
+
+  bool Done() const { return contents_.empty(); }
+
+ private:
+  absl::string_view contents_;
+};
+
+void EncodeDimm(const DimmInfo &dimm, SnapshotEncoder &encoder) {
+  encoder.AddString(dimm.slot_name);
+  encoder.AddInt(dimm.present);
+  encoder.AddInt(dimm.size_mb);
+  encoder.AddString(dimm.type);
+  encoder.AddInt(dimm.max_speed_mhz);
+  encoder.AddInt(dimm.configured_speed_mhz);
+  encoder.AddString(dimm.manufacturer);
+  encoder.AddString(dimm.serial_number);
+  encoder.AddString(dimm.part_number);
+}
+
+bool DecodeDimm(SnapshotDecoder &decoder, DimmInfo *dimm) {
+  return decoder.ReadString(&dimm->slot_name) &&
+         decoder.ReadBool(&dimm->present) && decoder.ReadInt(&dimm->size_mb) &&
+         decoder.ReadString(&dimm->type) &&
+         decoder.ReadInt(&dimm->max_speed_mhz) &&
+         decoder.ReadInt(&dimm->configured_speed_mhz) &&
+         decoder.ReadString(&dimm->manufacturer) &&
+         decoder.ReadString(&dimm->serial_number) &&
+         decoder.ReadString(&dimm->part_number);
+}
+
+void EncodeCpu(const CpuInfo &cpu, SnapshotEncoder &encoder) {
+  encoder.AddString(cpu.name);
+  encoder.AddInt(cpu.enabled);
+  encoder.AddInt(cpu.cpu_signature.has_value());
+  if (cpu.cpu_signature.has_value()) {
+    encoder.AddString(cpu.cpu_signature->vendor);
+    encoder.AddInt(cpu.cpu_signature->type);
+    encoder.AddInt(cpu.cpu_signature->family);
+    encoder.AddInt(cpu.cpu_signature->model);
+    encoder.AddInt(cpu.cpu_signature->stepping);
+  }
+  encoder.AddInt(cpu.max_speed_mhz);
+  encoder.AddString(cpu.serial_number);
+  encoder.AddString(cpu.part_number);
+  encoder.AddInt(cpu.total_cores);
+  encoder.AddInt(cpu.enabled_cores);
+  encoder.AddInt(cpu.total_threads);
+  encoder.AddInt(cpu.socket_id);
+}
+
+bool DecodeCpu(SnapshotDecoder &decoder, CpuInfo *cpu) {
+  bool has_signature;
+  if (!decoder.ReadString(&cpu->name) || !decoder.ReadBool(&cpu->enabled) ||
+      !decoder.ReadBool(&has_signature)) {
+    return false;
+  }
+  if (has_signature) {
+    CpuSignature &signature = cpu->cpu_signature.emplace();
+    if (!decoder.ReadString(&signature.vendor) ||
+        !decoder.ReadInt(&signature.type) ||
+        !decoder.ReadInt(&signature.family) ||
+        !decoder.ReadInt(&signature.model) ||
+        !decoder.ReadInt(&signature.stepping)) {
+      return false;
+    }
+  }
+  return decoder.ReadInt(&cpu->max_speed_mhz) &&
+         decoder.ReadString(&cpu->serial_number) &&
+         decoder.ReadString(&cpu->part_number) &&
+         decoder.ReadInt(&cpu->total_cores) &&
+         decoder.ReadInt(&cpu->enabled_cores) &&
+         decoder.ReadInt(&cpu->total_threads) &&
+         decoder.ReadInt(&cpu->socket_id);
+}
+
+void EncodeFru(const std::string &name, const FruInfo &fru,
+               SnapshotEncoder &encoder) {
+  encoder.AddString(name);
+  encoder.AddString(fru.product_name);
+  encoder.AddString(fru.manufacturer);
+  encoder.AddString(fru.serial_number);
+  encoder.AddString(fru.part_number);
+}
+
+bool DecodeFru(SnapshotDecoder &decoder, std::string *name, FruInfo *fru) {
+  return decoder.ReadString(name) && decoder.ReadString(&fru->product_name) &&
+         decoder.ReadString(&fru->manufacturer) &&
+         decoder.ReadString(&fru->serial_number) &&
+         decoder.ReadString(&fru->part_number);
+}
+
+}  // namespace
+
+absl::StatusOr<SysmodelSnapshotKey> GetSysmodelSnapshotKey(
+    const std::string &boot_id_path, absl::Span<const uint8_t> smbios_table) {
+  absl::StatusOr<std::string> maybe_boot_id = ReadFile(boot_id_path);
+  if (!maybe_boot_id.ok()) return maybe_boot_id.status();
+
+  SysmodelSnapshotKey key = {
+      .boot_id = std::string(absl::StripAsciiWhitespace(*maybe_boot_id)),
+      .smbios_hash = Fnv1a64(smbios_table)};
+  if (key.boot_id.empty()) {
+    return absl::NotFoundError(
+        absl::StrFormat("no boot ID found in %s", boot_id_path));
+  }
+  return key;
+}
+
+absl::Status WriteSysmodelSnapshot(const std::string &path,
+                                   const SysmodelSnapshotKey &key,
+                                   const SysmodelSnapshot &snapshot) {
+  SnapshotEncoder encoder;
+  encoder.contents().append(kSnapshotFileMagic.data(),
+                            kSnapshotFileMagic.size());
+  encoder.contents().push_back(kSnapshotFileVersion);
+  encoder.AddString(key.boot_id);
+  encoder.AddInt64(key.smbios_hash);
+  encoder.AddInt(snapshot.dimms.size());
+  for (const DimmInfo &dimm : snapshot.dimms) EncodeDimm(dimm, encoder);
+  encoder.AddInt(snapshot.cpus.size());
+  for (const CpuInfo &cpu : snapshot.cpus) EncodeCpu(cpu, encoder);
+  encoder.AddInt(snapshot.frus.size());
+  for (const auto &[name, fru] : snapshot.frus) EncodeFru(name, fru, encoder);
+
+  std::string temp_path = absl::StrCat(path, ".tmp");
+  {
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    const std::string &contents = encoder.contents();
+    if (!file.write(contents.data(), contents.size()) || !file.flush()) {
+      return absl::InternalError(
+          absl::StrFormat("unable to write snapshot file %s", temp_path));
+    }
+  }
+  if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+    std::remove(temp_path.c_str());
+    return absl::InternalError(
+        absl::StrFormat("unable to replace snapshot file %s", path));
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<SysmodelSnapshot> ReadSysmodelSnapshot(
+    const std::string &path, const SysmodelSnapshotKey &key) {
+  absl::StatusOr<std::string> maybe_contents = ReadFile(path);
+  if (!maybe_contents.ok()) return maybe_contents.status();
+  absl::string_view contents = *maybe_contents;
+
+  auto invalid_error = [&path]() {
+    return absl::DataLossError(
+        absl::StrFormat("%s is not a valid snapshot file", path));
+  };
+
+  if (contents.size() < kSnapshotFileMagic.size() + 1 ||
+      contents.substr(0, kSnapshotFileMagic.size()) != kSnapshotFileMagic ||
+      static_cast<uint8_t>(contents[kSnapshotFileMagic.size()]) !=
+          kSnapshotFileVersion) {
+    return invalid_error();
+  }
+  SnapshotDecoder decoder(contents.substr(kSnapshotFileMagic.size() + 1));
+
+  SysmodelSnapshotKey saved_key;
+  if (!decoder.ReadString(&saved_key.boot_id) ||
+      !decoder.ReadInt64(&saved_key.smbios_hash)) {
+    return invalid_error();
+  }
+  if (saved_key != key) {
+    return absl::FailedPreconditionError(absl::StrFormat(
+        "snapshot %s was taken from a different boot or SMBIOS table", path));
+  }
+
+  SysmodelSnapshot snapshot;
+  uint32_t count;
+  if (!decoder.ReadInt(&count)) return invalid_error();
+  for (uint32_t i = 0; i < count; ++i) {
+    if (!DecodeDimm(decoder, &snapshot.dimms.emplace_back())) {
+      return invalid_error();
+    }
+  }
+  if (!decoder.ReadInt(&count)) return invalid_error();
+  for (uint32_t i = 0; i < count; ++i) {
+    if (!DecodeCpu(decoder, &snapshot.cpus.emplace_back())) {
+      return invalid_error();
+    }
+  }
+  if (!decoder.ReadInt(&count)) return invalid_error();
+  for (uint32_t i = 0; i < count; ++i) {
+    std::string name;
+    FruInfo fru;
+    if (!DecodeFru(decoder, &name, &fru)) return invalid_error();
+    snapshot.frus.emplace(std::move(name), std::move(fru));
+  }
+  if (!decoder.Done()) return invalid_error();
+  return snapshot;
+}
+
+}  // namespace ecclesia
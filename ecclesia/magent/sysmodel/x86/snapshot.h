@@ -0,0 +1,91 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A snapshot of the static parts of the system model, which can be saved to
+// disk and loaded again when the agent restarts. Building the model from the
+// hardware means reading the PPIN of every socket through MSRs and reading
+// every FRU over SMBus or IPMI; a restart within the same boot can instead
+// load the last snapshot and serve the inventory immediately.
+//
+// A snapshot is only valid for the boot it was taken in, and for the SMBIOS
+// tables it was built from. Both are recorded in a key stored with the
+// snapshot, and a snapshot whose key does not match the current system is
+// never loaded. The key hashes the structure table already loaded by the
+// SmbiosReader, so checking it does not read the table again.
+
+#ifndef ECCLESIA_MAGENT_SYSMODEL_X86_SNAPSHOT_H_
+#define ECCLESIA_MAGENT_SYSMODEL_X86_SNAPSHOT_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "ecclesia/magent/sysmodel/x86/cpu.h"
+#include "ecclesia/magent/sysmodel/x86/dimm.h"
+#include "ecclesia/magent/sysmodel/x86/fru.h"
+
+namespace ecclesia {
+
+// The standard location of the kernel's boot ID.
+inline constexpr char kKernelBootIdPath[] = "/proc/sys/kernel/random/boot_id";
+
+// Identifies the system state that a snapshot was built from.
+struct SysmodelSnapshotKey {
+  // The kernel's random boot ID, which changes on every boot.
+  std::string boot_id;
+  // A hash of the contents of the SMBIOS structure table.
+  uint64_t smbios_hash;
+
+  bool operator==(const SysmodelSnapshotKey &other) const {
+    return boot_id == other.boot_id && smbios_hash == other.smbios_hash;
+  }
+  bool operator!=(const SysmodelSnapshotKey &other) const {
+    return !(*this == other);
+  }
+};
+
+// Constructs the key for the current system from the boot ID file and the
+// raw bytes of the SMBIOS structure table.
+absl::StatusOr<SysmodelSnapshotKey> GetSysmodelSnapshotKey(
+    const std::string &boot_id_path, absl::Span<const uint8_t> smbios_table);
+
+// The static parts of the system model.
+struct SysmodelSnapshot {
+  std::vector<DimmInfo> dimms;
+  std::vector<CpuInfo> cpus;
+  // The FRUs which were successfully read, by reader name.
+  absl::flat_hash_map<std::string, FruInfo> frus;
+};
+
+// Write out a snapshot along with its key. The snapshot is written to a
+// temporary file which is then renamed over the path, so that a partially
+// written snapshot is never loaded.
+absl::Status WriteSysmodelSnapshot(const std::string &path,
+                                   const SysmodelSnapshotKey &key,
+                                   const SysmodelSnapshot &snapshot);
+
+// Read the snapshot saved at the given path. Returns a FailedPrecondition
+// error if the snapshot was saved with a different key.
+absl::StatusOr<SysmodelSnapshot> ReadSysmodelSnapshot(
+    const std::string &path, const SysmodelSnapshotKey &key);
+
+}  // namespace ecclesia
+
+#endif  // ECCLESIA_MAGENT_SYSMODEL_X86_SNAPSHOT_H_
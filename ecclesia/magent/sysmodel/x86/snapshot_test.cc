@@ -0,0 +1,209 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/sysmodel/x86/snapshot.h"
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "ecclesia/lib/file/test_filesystem.h"
+#include "ecclesia/lib/smbios/processor_information.h"
+#include "ecclesia/lib/testing/status.h"
+#include "ecclesia/magent/sysmodel/x86/cpu.h"
+#include "ecclesia/magent/sysmodel/x86/dimm.h"
+#include "ecclesia/magent/sysmodel/x86/fru.h"
+
+namespace ecclesia {
+namespace {
+
+using ::testing::Not;
+
+class SysmodelSnapshotTest : public ::testing::Test {
+ protected:
+  SysmodelSnapshotTest()
+      : fs_(GetTestTempdirPath()),
+        snapshot_path_(fs_.GetTruePath("/snapshot")) {
+    fs_.CreateFile("/boot_id", "6a4e7c3e-0b9f-4c8a-9d2e-1f5b3a7c9e01\n");
+  }
+
+  SysmodelSnapshotKey GetKey() {
+    absl::StatusOr<SysmodelSnapshotKey> maybe_key =
+        GetSysmodelSnapshotKey(fs_.GetTruePath("/boot_id"), smbios_table_);
+    EXPECT_THAT(maybe_key, IsOk());
+    if (!maybe_key.ok()) return {};
+    return *maybe_key;
+  }
+
+  static SysmodelSnapshot MakeSnapshot() {
+    SysmodelSnapshot snapshot;
+    snapshot.dimms.push_back({.slot_name = "DIMM0",
+                              .present = true,
+                              .size_mb = 32768,
+                              .type = "DDR4",
+                              .max_speed_mhz = 2933,
+                              .configured_speed_mhz = 2666,
+                              .manufacturer = "Samsung",
+                              .serial_number = "dimm-sn",
+                              .part_number = "dimm-pn"});
+    snapshot.dimms.push_back({.slot_name = "DIMM1", .present = false});
+    snapshot.cpus.push_back({.name = "CPU0",
+                             .enabled = true,
+                             .cpu_signature = CpuSignature{.vendor = "Intel",
+                                                           .type = 0,
+                                                           .family = 6,
+                                                           .model = 85,
+                                                           .stepping = 7},
+                             .max_speed_mhz = 4000,
+                             .serial_number = "0x1234",
+                             .part_number = "cpu-pn",
+                             .total_cores = 18,
+                             .enabled_cores = 18,
+                             .total_threads = 36,
+                             .socket_id = 0});
+    snapshot.cpus.push_back({.name = "CPU1", .enabled = false});
+    snapshot.frus["motherboard"] = {.product_name = "mobo",
+                                    .manufacturer = "Google",
+                                    .serial_number = "mobo-sn",
+                                    .part_number = "mobo-pn"};
+    return snapshot;
+  }
+
+  TestFilesystem fs_;
+  std::string snapshot_path_;
+  std::vector<uint8_t> smbios_table_ = {0x00, 0x18, 0x00, 0x00, 0x00, 0x00};
+};
+
+TEST_F(SysmodelSnapshotTest, KeyUsesBootIdAndTables) {
+  SysmodelSnapshotKey key = GetKey();
+  EXPECT_EQ(key.boot_id, "6a4e7c3e-0b9f-4c8a-9d2e-1f5b3a7c9e01");
+
+  // A change to the tables changes the key.
+  smbios_table_[3] = 0x01;
+  EXPECT_NE(GetKey(), key);
+}
+
+TEST_F(SysmodelSnapshotTest, KeyRequiresBootId) {
+  EXPECT_THAT(
+      GetSysmodelSnapshotKey(fs_.GetTruePath("/missing"), smbios_table_),
+      Not(IsOk()));
+  fs_.WriteFile("/boot_id", "\n");
+  EXPECT_THAT(
+      GetSysmodelSnapshotKey(fs_.GetTruePath("/boot_id"), smbios_table_),
+      Not(IsOk()));
+}
+
+TEST_F(SysmodelSnapshotTest, RoundTrip) {
+  SysmodelSnapshotKey key = GetKey();
+  SysmodelSnapshot snapshot = MakeSnapshot();
+  ASSERT_THAT(WriteSysmodelSnapshot(snapshot_path_, key, snapshot), IsOk());
+
+  absl::StatusOr<SysmodelSnapshot> maybe_snapshot =
+      ReadSysmodelSnapshot(snapshot_path_, key);
+  ASSERT_THAT(maybe_snapshot, IsOk());
+
+  ASSERT_EQ(maybe_snapshot->dimms.size(), 2);
+  const DimmInfo &dimm = maybe_snapshot->dimms[0];
+  EXPECT_EQ(dimm.slot_name, "DIMM0");
+  EXPECT_TRUE(dimm.present);
+  EXPECT_EQ(dimm.size_mb, 32768);
+  EXPECT_EQ(dimm.type, "DDR4");
+  EXPECT_EQ(dimm.max_speed_mhz, 2933);
+  EXPECT_EQ(dimm.configured_speed_mhz, 2666);
+  EXPECT_EQ(dimm.manufacturer, "Samsung");
+  EXPECT_EQ(dimm.serial_number, "dimm-sn");
+  EXPECT_EQ(dimm.part_number, "dimm-pn");
+  EXPECT_EQ(maybe_snapshot->dimms[1].slot_name, "DIMM1");
+  EXPECT_FALSE(maybe_snapshot->dimms[1].present);
+
+  ASSERT_EQ(maybe_snapshot->cpus.size(), 2);
+  const CpuInfo &cpu = maybe_snapshot->cpus[0];
+  EXPECT_EQ(cpu.name, "CPU0");
+  EXPECT_TRUE(cpu.enabled);
+  ASSERT_TRUE(cpu.cpu_signature.has_value());
+  EXPECT_EQ(cpu.cpu_signature->vendor, "Intel");
+  EXPECT_EQ(cpu.cpu_signature->family, 6);
+  EXPECT_EQ(cpu.cpu_signature->model, 85);
+  EXPECT_EQ(cpu.cpu_signature->stepping, 7);
+  EXPECT_EQ(cpu.max_speed_mhz, 4000);
+  EXPECT_EQ(cpu.serial_number, "0x1234");
+  EXPECT_EQ(cpu.part_number, "cpu-pn");
+  EXPECT_EQ(cpu.total_cores, 18);
+  EXPECT_EQ(cpu.enabled_cores, 18);
+  EXPECT_EQ(cpu.total_threads, 36);
+  EXPECT_EQ(cpu.socket_id, 0);
+  EXPECT_FALSE(maybe_snapshot->cpus[1].cpu_signature.has_value());
+  EXPECT_EQ(maybe_snapshot->cpus[1].socket_id, -1);
+
+  ASSERT_EQ(maybe_snapshot->frus.size(), 1);
+  const FruInfo &fru = maybe_snapshot->frus.at("motherboard");
+  EXPECT_EQ(fru.product_name, "mobo");
+  EXPECT_EQ(fru.manufacturer, "Google");
+  EXPECT_EQ(fru.serial_number, "mobo-sn");
+  EXPECT_EQ(fru.part_number, "mobo-pn");
+}
+
+TEST_F(SysmodelSnapshotTest, DifferentKeyRejected) {
+  SysmodelSnapshotKey key = GetKey();
+  ASSERT_THAT(WriteSysmodelSnapshot(snapshot_path_, key, MakeSnapshot()),
+              IsOk());
+
+  SysmodelSnapshotKey new_boot = key;
+  new_boot.boot_id = "0d3b2f9a-5c1e-4e7b-8a6d-2c4f6e8a0b13";
+  EXPECT_TRUE(absl::IsFailedPrecondition(
+      ReadSysmodelSnapshot(snapshot_path_, new_boot).status()));
+
+  SysmodelSnapshotKey new_tables = key;
+  new_tables.smbios_hash += 1;
+  EXPECT_TRUE(absl::IsFailedPrecondition(
+      ReadSysmodelSnapshot(snapshot_path_, new_tables).status()));
+}
+
+TEST_F(SysmodelSnapshotTest, MissingSnapshot) {
+  EXPECT_TRUE(absl::IsNotFound(
+      ReadSysmodelSnapshot(snapshot_path_, GetKey()).status()));
+}
+
+TEST_F(SysmodelSnapshotTest, CorruptSnapshotRejected) {
+  SysmodelSnapshotKey key = GetKey();
+  ASSERT_THAT(WriteSysmodelSnapshot(snapshot_path_, key, MakeSnapshot()),
+              IsOk());
+  ASSERT_THAT(ReadSysmodelSnapshot(snapshot_path_, key), IsOk());
+
+  // Truncate the snapshot part way through the FRUs.
+  std::string contents;
+  {
+    std::ifstream file(snapshot_path_, std::ios::binary);
+    contents.assign(std::istreambuf_iterator<char>(file),
+                    std::istreambuf_iterator<char>());
+  }
+  fs_.WriteFile("/snapshot", contents.substr(0, contents.size() - 3));
+  EXPECT_TRUE(
+      absl::IsDataLoss(ReadSysmodelSnapshot(snapshot_path_, key).status()));
+
+  fs_.WriteFile("/snapshot", "not a snapshot");
+  EXPECT_TRUE(
+      absl::IsDataLoss(ReadSysmodelSnapshot(snapshot_path_, key).status()));
+}
+
+}  // namespace
+}  // namespace ecclesia
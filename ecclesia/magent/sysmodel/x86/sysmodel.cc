@@ -19,13 +19,19 @@
 #include <cstddef>
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <utility>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/types/optional.h"
+#include "ecclesia/lib/cache/rcu_snapshot.h"
+#include "ecclesia/lib/logging/globals.h"
+#include "ecclesia/lib/logging/logging.h"
 #include "ecclesia/lib/smbios/reader.h"
 #include "ecclesia/lib/time/clock.h"
 #include "ecclesia/magent/lib/event_logger/event_logger.h"
@@ -36,19 +42,19 @@
 #include "ecclesia/magent/sysmodel/x86/cpu.h"
 #include "ecclesia/magent/sysmodel/x86/dimm.h"
 #include "ecclesia/magent/sysmodel/x86/fru.h"
+#include "ecclesia/magent/sysmodel/x86/fru_acquisition.h"
+#include "ecclesia/magent/sysmodel/x86/init_graph.h"
+#include "ecclesia/magent/sysmodel/x86/snapshot.h"
 #include "ecclesia/magent/sysmodel/x86/thermal.h"
 
 namespace ecclesia {
 
-std::size_t SystemModel::NumDimms() const {
-  absl::ReaderMutexLock ml(&dimms_lock_);
-  return dimms_.size();
-}
+std::size_t SystemModel::NumDimms() const { return dimms_.Read()->size(); }
 
-absl::optional<Dimm> SystemModel::GetDimm(std::size_t index) {
-  absl::ReaderMutexLock ml(&dimms_lock_);
-  if (index < dimms_.size()) {
-    return dimms_[index];
+absl::optional<Dimm> SystemModel::GetDimm(std::size_t index) const {
+  RcuSnapshot<std::vector<Dimm>> dimms = dimms_.Read();
+  if (index < dimms->size()) {
+    return (*dimms)[index];
   }
   return absl::nullopt;
 }
@@ -66,15 +72,12 @@ PciThermalSensor *SystemModel::GetDimmThermalSensor(std::size_t index) {
   return nullptr;
 }
 
-std::size_t SystemModel::NumCpus() const {
-  absl::ReaderMutexLock ml(&cpus_lock_);
-  return cpus_.size();
-}
+std::size_t SystemModel::NumCpus() const { return cpus_.Read()->size(); }
 
-absl::optional<Cpu> SystemModel::GetCpu(std::size_t index) {
-  absl::ReaderMutexLock ml(&cpus_lock_);
-  if (index < cpus_.size()) {
-    return cpus_[index];
+absl::optional<Cpu> SystemModel::GetCpu(std::size_t index) const {
+  RcuSnapshot<std::vector<Cpu>> cpus = cpus_.Read();
+  if (index < cpus->size()) {
+    return (*cpus)[index];
   }
   return absl::nullopt;
 }
@@ -94,29 +97,17 @@ absl::optional<CpuMarginSensor> SystemModel::GetCpuMarginSensor(
 }
 
 std::size_t SystemModel::NumFruReaders() const {
-  absl::ReaderMutexLock ml(&fru_readers_lock_);
-  return fru_readers_.size();
+  return fru_acquisition_->NumReaders();
 }
 
 SysmodelFruReaderIntf *SystemModel::GetFruReader(
     absl::string_view fru_name) const {
-  absl::ReaderMutexLock ml(&fru_readers_lock_);
-  auto fru = fru_readers_.find(fru_name);
-  if (fru != fru_readers_.end()) {
-    return fru->second.get();
-  }
-
-  return nullptr;
+  return fru_acquisition_->GetReader(fru_name);
 }
 
-std::vector<ChassisId> SystemModel::GetAllChassis() const {
-  absl::ReaderMutexLock ml(&chassis_lock_);
-  return chassis_;
-}
 absl::optional<ChassisId> SystemModel::GetChassisByName(
     absl::string_view chassis_name) const {
-  absl::ReaderMutexLock ml(&chassis_lock_);
-  for (const auto &chassis_id : chassis_) {
+  for (const auto &chassis_id : *chassis_.Read()) {
     if (chassis_name == ChassisIdToString(chassis_id)) {
       return chassis_id;
     }
@@ -124,60 +115,187 @@ absl::optional<ChassisId> SystemModel::GetChassisByName(
   return absl::nullopt;
 }
 
+SystemModel::~SystemModel() {
+  // The refresh and the FRU acquisition can save a snapshot from their
+  // threads, which uses the rest of the model and the acquisition itself, so
+  // their threads must all be finished before anything is destroyed. They
+  // must not be stopped until the init phases which start them have finished.
+  init_graph_.WaitUntilDone();
+  if (refresh_thread_.joinable()) refresh_thread_.join();
+  fru_acquisition_->Join();
+  fru_acquisition_.reset();
+}
+
+void SystemModel::RefreshFromHardware() {
+  dimms_.Update(CreateDimms(smbios_reader_.get(), field_translator_.get()));
+  cpus_.Update(CreateCpus(*smbios_reader_));
+  SaveSnapshotWhenComplete();
+}
+
+void SystemModel::SaveSnapshotWhenComplete() {
+  if (--snapshot_waits_ == 0 && snapshot_key_.has_value()) SaveSnapshot();
+}
+
+void SystemModel::SaveSnapshot() {
+  SysmodelSnapshot snapshot;
+  for (const Dimm &dimm : *dimms_.Read()) {
+    snapshot.dimms.push_back(dimm.GetDimmInfo());
+  }
+  for (const Cpu &cpu : *cpus_.Read()) {
+    snapshot.cpus.push_back(cpu.GetCpuInfo());
+  }
+  fru_acquisition_->GetReaders(
+      [&snapshot](absl::string_view name, SysmodelFruReaderIntf *reader) {
+        if (absl::optional<SysmodelFru> fru = reader->Read()) {
+          snapshot.frus.emplace(name, fru->GetFruInfo());
+        }
+      });
+  absl::Status status =
+      WriteSysmodelSnapshot(snapshot_path_, *snapshot_key_, snapshot);
+  if (!status.ok()) {
+    WarningLog() << "unable to save the system model snapshot: " << status;
+  }
+}
+
 SystemModel::SystemModel(SysmodelParams params)
-    : smbios_reader_(absl::make_unique<SmbiosReader>(
-          params.smbios_entry_point_path, params.smbios_tables_path)),
-      field_translator_(std::move(params.field_translator)),
+    : field_translator_(std::move(params.field_translator)),
+      pci_topology_(params.uevents),
+      usb_inventory_(params.uevents),
+      dimm_thermal_sampler_({.interval = params.sensor_sample_interval}),
+      cpu_margin_sampler_({.interval = params.sensor_sample_interval}),
       dimm_thermal_params_(std::move(params.dimm_thermal_params)),
-      cpu_margin_params_(std::move(params.cpu_margin_params)) {
-  // Construct system model objects
-  auto dimms = CreateDimms(smbios_reader_.get(), field_translator_.get());
-  {
-    absl::WriterMutexLock ml(&dimms_lock_);
-    dimms_ = std::move(dimms);
+      cpu_margin_params_(std::move(params.cpu_margin_params)),
+      snapshot_path_(std::move(params.snapshot_path)) {
+  // Reading the FRUs can be slow, so it is done in the background. The FRUs
+  // from the snapshot are served until they have been read again, and a new
+  // snapshot is saved once the reads are done.
+  FruAcquisition::Options fru_options;
+  fru_options.deadline = params.fru_deadline;
+  if (!snapshot_path_.empty()) {
+    fru_options.on_done = [this]() { SaveSnapshotWhenComplete(); };
   }
+  fru_acquisition_ = absl::make_unique<FruAcquisition>(
+      params.fru_factories, params.fru_discoveries, fru_options);
 
-  auto cpus = CreateCpus(*smbios_reader_);
-  {
-    absl::WriterMutexLock ml(&cpus_lock_);
-    cpus_ = std::move(cpus);
-  }
+  // The rest of the model is constructed by a graph of phases, so that the
+  // phases which do not depend on each other are run in parallel.
+  init_graph_.AddPhase(
+      "smbios", {},
+      [this, entry_point_path = params.smbios_entry_point_path,
+       tables_path = params.smbios_tables_path]() {
+        smbios_reader_ =
+            absl::make_unique<SmbiosReader>(entry_point_path, tables_path);
+      });
+
+  // Load the snapshot from a previous run in this boot, if there is one. The
+  // snapshot is checked against the SMBIOS table which has already been
+  // loaded, rather than reading the table file again.
+  init_graph_.AddPhase(
+      "snapshot", {"smbios"}, [this, boot_id_path = params.boot_id_path]() {
+        if (snapshot_path_.empty()) return;
+        absl::StatusOr<SysmodelSnapshotKey> maybe_key = GetSysmodelSnapshotKey(
+            boot_id_path, smbios_reader_->GetRawTable());
+        if (!maybe_key.ok()) {
+          WarningLog() << "system model snapshots are unavailable: "
+                       << maybe_key.status();
+          return;
+        }
+        snapshot_key_ = std::move(*maybe_key);
+        absl::StatusOr<SysmodelSnapshot> maybe_snapshot =
+            ReadSysmodelSnapshot(snapshot_path_, *snapshot_key_);
+        if (maybe_snapshot.ok()) {
+          init_snapshot_ = std::move(*maybe_snapshot);
+        } else if (!absl::IsNotFound(maybe_snapshot.status())) {
+          InfoLog() << "not using the system model snapshot: "
+                    << maybe_snapshot.status();
+        }
+      });
+
+  init_graph_.AddPhase("dimms", {"smbios", "snapshot"}, [this]() {
+    std::vector<Dimm> dimms;
+    if (init_snapshot_.has_value()) {
+      for (DimmInfo &info : init_snapshot_->dimms) {
+        dimms.emplace_back(std::move(info));
+      }
+    } else {
+      dimms = CreateDimms(smbios_reader_.get(), field_translator_.get());
+    }
+    dimms_.Update(std::move(dimms));
+  });
+
+  init_graph_.AddPhase("cpus", {"smbios", "snapshot"}, [this]() {
+    std::vector<Cpu> cpus;
+    if (init_snapshot_.has_value()) {
+      for (CpuInfo &info : init_snapshot_->cpus) {
+        cpus.emplace_back(std::move(info));
+      }
+    } else {
+      cpus = CreateCpus(*smbios_reader_);
+    }
+    cpus_.Update(std::move(cpus));
+  });
 
-  auto fru_readers = CreateFruReaders(params.fru_factories);
-  {
-    absl::WriterMutexLock ml(&fru_readers_lock_);
-    fru_readers_ = std::move(fru_readers);
+  // A model loaded from a snapshot is ready as soon as the snapshot has been
+  // published, so the hardware is read again outside of the init graph.
+  if (!snapshot_path_.empty()) {
+    init_graph_.AddPhase("save_snapshot", {"dimms", "cpus"}, [this]() {
+      if (init_snapshot_.has_value()) {
+        refresh_thread_ = std::thread([this]() { RefreshFromHardware(); });
+      } else {
+        SaveSnapshotWhenComplete();
+      }
+    });
   }
 
-  auto dimm_thermal_sensors = CreatePciThermalSensors(dimm_thermal_params_);
-  {
+  init_graph_.AddPhase("frus", {"snapshot"}, [this]() {
+    if (init_snapshot_.has_value()) {
+      for (auto &[name, info] : init_snapshot_->frus) {
+        fru_acquisition_->Preload(name, SysmodelFru(std::move(info)));
+      }
+    }
+    fru_acquisition_->Start();
+  });
+
+  init_graph_.AddPhase("dimm_thermal_sensors", {}, [this]() {
+    auto dimm_thermal_sensors = CreatePciThermalSensors(dimm_thermal_params_);
     absl::WriterMutexLock ml(&dimm_thermal_sensors_lock_);
     dimm_thermal_sensors_ = std::move(dimm_thermal_sensors);
-  }
+    for (PciThermalSensor &sensor : dimm_thermal_sensors_) {
+      dimm_thermal_sampler_.AddSensor(&sensor);
+    }
+    dimm_thermal_sampler_.Start();
+  });
 
-  auto cpu_margin_sensors = CreateCpuMarginSensors(cpu_margin_params_);
-  {
+  init_graph_.AddPhase("cpu_margin_sensors", {}, [this]() {
+    auto cpu_margin_sensors = CreateCpuMarginSensors(cpu_margin_params_);
     absl::WriterMutexLock ml(&cpu_margin_sensors_lock_);
     cpu_margin_sensors_ = std::move(cpu_margin_sensors);
-  }
+    for (CpuMarginSensor &sensor : cpu_margin_sensors_) {
+      cpu_margin_sampler_.AddSensor(&sensor);
+    }
+    cpu_margin_sampler_.Start();
+  });
 
-  auto chassis = CreateChassis();
-  {
-    absl::WriterMutexLock ml(&chassis_lock_);
-    chassis_ = std::move(chassis);
-  }
+  init_graph_.AddPhase("chassis", {},
+                       [this]() { chassis_.Update(CreateChassis()); });
 
-  // Create event readers to feed into the event logger
-  std::vector<std::unique_ptr<SystemEventReader>> readers;
-  readers.push_back(absl::make_unique<McedaemonReader>(params.mced_socket_path,
-                                                       &mcedaemon_socket_));
-  if (auto system_event_log = smbios_reader_->GetSystemEventLog()) {
-    readers.push_back(absl::make_unique<ElogReader>(
-        std::move(system_event_log), params.sysfs_mem_file_path));
-  }
+  init_graph_.AddPhase(
+      "event_logger", {"smbios"},
+      [this, mced_socket_path = params.mced_socket_path,
+       sysfs_mem_file_path = params.sysfs_mem_file_path]() {
+        // Create event readers to feed into the event logger
+        std::vector<std::unique_ptr<SystemEventReader>> readers;
+        readers.push_back(absl::make_unique<McedaemonReader>(
+            mced_socket_path, &mcedaemon_socket_));
+        if (auto system_event_log = smbios_reader_->GetSystemEventLog()) {
+          readers.push_back(absl::make_unique<ElogReader>(
+              std::move(system_event_log), sysfs_mem_file_path));
+        }
+        event_logger_ = absl::make_unique<SystemEventLogger>(
+            std::move(readers), Clock::RealClock());
+      });
 
-  event_logger_ = absl::make_unique<SystemEventLogger>(std::move(readers),
-                                                       Clock::RealClock());
+  init_graph_.Start();
 }
 
 }  // namespace ecclesia
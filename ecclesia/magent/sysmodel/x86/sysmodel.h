@@ -17,9 +17,11 @@
 #ifndef ECCLESIA_MAGENT_SYSMODEL_X86_SYSMODEL_H_
 #define ECCLESIA_MAGENT_SYSMODEL_X86_SYSMODEL_H_
 
+#include <atomic>
 #include <cstddef>
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <utility>
 #include <vector>
 
@@ -27,17 +29,29 @@
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
+#include "ecclesia/lib/cache/rcu_snapshot.h"
+#include "ecclesia/lib/cache/rcu_store.h"
 #include "ecclesia/lib/smbios/platform_translator.h"
 #include "ecclesia/lib/smbios/reader.h"
+#include "ecclesia/lib/uevent/invalidation_service.h"
 #include "ecclesia/magent/lib/eeprom/smbus_eeprom.h"
 #include "ecclesia/magent/lib/event_logger/event_logger.h"
 #include "ecclesia/magent/lib/event_reader/mced_reader.h"
+#include "ecclesia/magent/lib/io/pci_sys.h"
+#include "ecclesia/magent/lib/io/pci_topology.h"
+#include "ecclesia/magent/lib/io/usb.h"
+#include "ecclesia/magent/lib/io/usb_sysfs.h"
+#include "ecclesia/magent/sysmodel/thermal_sampler.h"
 #include "ecclesia/magent/sysmodel/x86/chassis.h"
 #include "ecclesia/magent/sysmodel/x86/cpu.h"
 #include "ecclesia/magent/sysmodel/x86/dimm.h"
 #include "ecclesia/magent/sysmodel/x86/fru.h"
+#include "ecclesia/magent/sysmodel/x86/fru_acquisition.h"
+#include "ecclesia/magent/sysmodel/x86/init_graph.h"
+#include "ecclesia/magent/sysmodel/x86/snapshot.h"
 #include "ecclesia/magent/sysmodel/x86/thermal.h"
 
 namespace ecclesia {
@@ -50,18 +64,54 @@ struct SysmodelParams {
   std::string mced_socket_path;
   std::string sysfs_mem_file_path;
   absl::Span<const SysmodelFruReaderFactory> fru_factories;
+  absl::Span<const SysmodelFruDiscovery> fru_discoveries;
+  // The FRUs are read in the background; this bounds how long for.
+  absl::Duration fru_deadline = absl::Seconds(30);
   absl::Span<const PciSensorParams> dimm_thermal_params;
   absl::Span<const CpuMarginSensorParams> cpu_margin_params;
+  // How often the thermal sensors are read in the background.
+  absl::Duration sensor_sample_interval = absl::Seconds(5);
+  // If non-empty, a snapshot of the DIMMs, CPUs and FRUs is saved here once
+  // the FRUs have been read. On startup the snapshot is served straight away
+  // if it was saved during the current boot from the same SMBIOS tables, and
+  // the DIMMs, CPUs and FRUs are then read again from the hardware in the
+  // background, replacing the snapshot contents as they are read.
+  std::string snapshot_path;
+  std::string boot_id_path = kKernelBootIdPath;
+  // If set, the cached PCI topology and USB inventory are invalidated by
+  // hotplug events from this service. It must outlive the model.
+  UeventInvalidationService *uevents = nullptr;
 };
 
 // The SystemModel must be thread safe
 class SystemModel {
  public:
+  // The model is initialized in the background, with the objects being
+  // filled in as each initialization phase finishes. Until the model is ready
+  // the accessors may return incomplete results.
   explicit SystemModel(SysmodelParams params);
-  ~SystemModel() {}
+  ~SystemModel();
+
+  // Indicates if every part of the model has been initialized, and blocks
+  // until it has.
+  bool IsReady() const { return init_graph_.IsDone(); }
+  void WaitUntilReady() const { init_graph_.WaitUntilDone(); }
+
+  // Returns the timing of each of the initialization phases.
+  std::vector<InitGraph::PhaseTiming> GetInitTimings() const {
+    return init_graph_.GetTimings();
+  }
+
+  // The DIMMs, CPUs and chassis are published as RCU snapshots. A snapshot
+  // remains valid for as long as the caller holds it, even if the model is
+  // updated in the meantime, so callers can work with references into it
+  // without any copying or locking. Prefer these to the indexed accessors,
+  // which return copies.
+  RcuSnapshot<std::vector<Dimm>> GetDimms() const { return dimms_.Read(); }
+  RcuSnapshot<std::vector<Cpu>> GetCpus() const { return cpus_.Read(); }
 
   std::size_t NumDimms() const;
-  absl::optional<Dimm> GetDimm(std::size_t index);
+  absl::optional<Dimm> GetDimm(std::size_t index) const;
 
   // The number of DIMM thermal sensors. This should be the same as the number
   // of DIMMs.
@@ -71,22 +121,46 @@ class SystemModel {
   PciThermalSensor *GetDimmThermalSensor(std::size_t index);
 
   std::size_t NumCpus() const;
-  absl::optional<Cpu> GetCpu(std::size_t index);
+  absl::optional<Cpu> GetCpu(std::size_t index) const;
 
   std::size_t NumCpuMarginSensors() const;
   absl::optional<CpuMarginSensor> GetCpuMarginSensor(std::size_t index);
 
+  // The readings of the DIMM thermal and CPU margin sensors, which are read in
+  // the background. The values are indexed the same way as the sensors. The
+  // sensors are only read directly if the readings are older than max_age.
+  RcuSnapshot<ThermalReadings> GetDimmThermalReadings(
+      absl::Duration max_age = absl::InfiniteDuration()) {
+    return dimm_thermal_sampler_.GetReadings(max_age);
+  }
+  RcuSnapshot<ThermalReadings> GetCpuMarginReadings(
+      absl::Duration max_age = absl::InfiniteDuration()) {
+    return cpu_margin_sampler_.GetReadings(max_age);
+  }
+
+  // The FRU readers never block: a FRU which is still being read in the
+  // background reads as absent. Use GetFruAcquisition to wait for FRUs.
   std::size_t NumFruReaders() const;
   template <typename IteratorF>
   void GetFruReaders(IteratorF iterator) const {
-    absl::ReaderMutexLock ml(&fru_readers_lock_);
-    for (const auto &f : fru_readers_) {
-      iterator(f.first, f.second);
-    }
+    fru_acquisition_->GetReaders(iterator);
   }
   SysmodelFruReaderIntf *GetFruReader(absl::string_view fru_name) const;
+  FruAcquisition *GetFruAcquisition() const { return fru_acquisition_.get(); }
 
-  std::vector<ChassisId> GetAllChassis() const;
+  RcuSnapshot<std::vector<ChassisId>> GetAllChassis() const {
+    return chassis_.Read();
+  }
+
+  // The PCI topology and USB inventory are scanned from sysfs when they are
+  // first read, and then only rescanned once they have been invalidated.
+  RcuSnapshot<PciTopology> GetPciTopology() const {
+    return pci_topology_.Read();
+  }
+  RcuSnapshot<UsbInventory> GetUsbInventory() const {
+    return usb_inventory_.Read();
+  }
+  UsbDiscoveryInterface *GetUsbDiscovery() { return &usb_inventory_; }
   absl::optional<ChassisId> GetChassisByName(
       absl::string_view chassis_name) const;
 
@@ -94,28 +168,38 @@ class SystemModel {
   // errors. This method provides a mechanism to process the events for error
   // reporting.
   void VisitSystemEvents(SystemEventVisitor *visitor) {
-    if (event_logger_) {
+    if (IsReady() && event_logger_) {
       event_logger_->Visit(visitor);
     }
   }
 
  private:
+  // Rebuild the DIMMs and CPUs from the hardware, replacing the ones loaded
+  // from the snapshot, and then save a new snapshot.
+  void RefreshFromHardware();
+
+  // Save a snapshot of the current DIMMs, CPUs and FRUs. The snapshot is only
+  // saved once the FRUs have been read and the DIMMs and CPUs have been
+  // constructed from the hardware; each of those calls
+  // SaveSnapshotWhenComplete when it is done.
+  void SaveSnapshotWhenComplete();
+  void SaveSnapshot();
+
   // Platform interfaces
   std::unique_ptr<SmbiosReader> smbios_reader_;
   std::unique_ptr<SmbiosFieldTranslator> field_translator_;
   LibcMcedaemonSocket mcedaemon_socket_;
 
-  // System model objects
+  // System model objects. The inventory is replaced as a whole, while the
+  // sensors are read in place and so are guarded by locks instead.
 
-  mutable absl::Mutex dimms_lock_;
-  std::vector<Dimm> dimms_ ABSL_GUARDED_BY(dimms_lock_);
+  RcuStore<std::vector<Dimm>> dimms_;
+  RcuStore<std::vector<Cpu>> cpus_;
+  RcuStore<std::vector<ChassisId>> chassis_;
+  SysfsPciTopology pci_topology_;
+  SysfsUsbInventory usb_inventory_;
 
-  mutable absl::Mutex cpus_lock_;
-  std::vector<Cpu> cpus_ ABSL_GUARDED_BY(cpus_lock_);
-
-  mutable absl::Mutex fru_readers_lock_;
-  absl::flat_hash_map<std::string, std::unique_ptr<SysmodelFruReaderIntf>>
-      fru_readers_ ABSL_GUARDED_BY(fru_readers_lock_);
+  std::unique_ptr<FruAcquisition> fru_acquisition_;
 
   mutable absl::Mutex dimm_thermal_sensors_lock_;
   std::vector<PciThermalSensor> dimm_thermal_sensors_
@@ -125,13 +209,26 @@ class SystemModel {
   std::vector<CpuMarginSensor> cpu_margin_sensors_
       ABSL_GUARDED_BY(cpu_margin_sensors_lock_);
 
-  mutable absl::Mutex chassis_lock_;
-  std::vector<ChassisId> chassis_ ABSL_GUARDED_BY(chassis_lock_);
+  // These sample the sensors above, so they must be destroyed first.
+  ThermalSampler dimm_thermal_sampler_;
+  ThermalSampler cpu_margin_sampler_;
 
   std::unique_ptr<SystemEventLogger> event_logger_;
 
   const absl::Span<const PciSensorParams> dimm_thermal_params_;
   const absl::Span<const CpuMarginSensorParams> cpu_margin_params_;
+
+  // Where to save snapshots of the model and the key to save them with. The
+  // key is only present if snapshots are enabled.
+  const std::string snapshot_path_;
+  absl::optional<SysmodelSnapshotKey> snapshot_key_;
+  std::atomic<int> snapshot_waits_ = 2;
+  // The snapshot loaded at startup, if any. Only used by the init phases.
+  absl::optional<SysmodelSnapshot> init_snapshot_;
+  // Runs RefreshFromHardware when the model was loaded from a snapshot.
+  std::thread refresh_thread_;
+
+  InitGraph init_graph_;
 };
 
 }  // namespace ecclesia
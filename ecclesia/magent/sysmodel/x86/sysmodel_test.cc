@@ -0,0 +1,188 @@
+/*
+ * Copyright 2020 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecclesia/magent/sysmodel/x86/sysmodel.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "ecclesia/lib/file/test_filesystem.h"
+#include "ecclesia/lib/testing/status.h"
+#include "ecclesia/magent/sysmodel/x86/fru.h"
+#include "ecclesia/magent/sysmodel/x86/snapshot.h"
+
+namespace ecclesia {
+namespace {
+
+using ::testing::Contains;
+using ::testing::IsEmpty;
+using ::testing::Key;
+
+// A FRU reader which signals when it starts reading, and then takes a while to
+// finish.
+class SlowFruReader : public SysmodelFruReaderIntf {
+ public:
+  explicit SlowFruReader(absl::Notification *started) : started_(started) {}
+
+  absl::optional<SysmodelFru> Read() override {
+    started_->Notify();
+    absl::SleepFor(absl::Milliseconds(100));
+    return SysmodelFru({.serial_number = "mobo-sn"});
+  }
+
+ private:
+  absl::Notification *started_;
+};
+
+// A FRU reader which does not finish reading until it is released.
+class BlockingFruReader : public SysmodelFruReaderIntf {
+ public:
+  BlockingFruReader(absl::string_view serial_number,
+                    absl::Notification *release)
+      : serial_number_(serial_number), release_(release) {}
+
+  absl::optional<SysmodelFru> Read() override {
+    release_->WaitForNotification();
+    return SysmodelFru({.serial_number = serial_number_});
+  }
+
+ private:
+  std::string serial_number_;
+  absl::Notification *release_;
+};
+
+// Sets up a system with no SMBIOS tables, sensors or event sources, which
+// saves its snapshots into the test filesystem.
+class SystemModelTest : public ::testing::Test {
+ protected:
+  SystemModelTest() : fs_(GetTestTempdirPath()) {
+    fs_.CreateFile("/boot_id", "6a4e7c3e-0b9f-4c8a-9d2e-1f5b3a7c9e01\n");
+    fs_.CreateFile("/smbios_entry_point", "");
+    fs_.CreateFile("/DMI", "");
+  }
+
+  SysmodelParams MakeParams(
+      absl::Span<const SysmodelFruReaderFactory> fru_factories) {
+    SysmodelParams params;
+    params.smbios_entry_point_path = fs_.GetTruePath("/smbios_entry_point");
+    params.smbios_tables_path = fs_.GetTruePath("/DMI");
+    params.mced_socket_path = fs_.GetTruePath("/mced.socket");
+    params.sysfs_mem_file_path = fs_.GetTruePath("/mem");
+    params.fru_factories = fru_factories;
+    params.snapshot_path = fs_.GetTruePath("/snapshot");
+    params.boot_id_path = fs_.GetTruePath("/boot_id");
+    return params;
+  }
+
+  // The key the model uses for its snapshots. The SMBIOS entry point is not
+  // valid, so the model sees an empty structure table.
+  absl::StatusOr<SysmodelSnapshotKey> GetKey() {
+    return GetSysmodelSnapshotKey(fs_.GetTruePath("/boot_id"), {});
+  }
+
+  // Reads back the snapshot saved by the model.
+  absl::StatusOr<SysmodelSnapshot> ReadSnapshot() {
+    absl::StatusOr<SysmodelSnapshotKey> maybe_key = GetKey();
+    if (!maybe_key.ok()) return maybe_key.status();
+    return ReadSysmodelSnapshot(fs_.GetTruePath("/snapshot"), *maybe_key);
+  }
+
+  TestFilesystem fs_;
+};
+
+TEST_F(SystemModelTest, DestroyDuringSlowFruRead) {
+  absl::Notification started;
+  std::vector<SysmodelFruReaderFactory> fru_factories = {
+      SysmodelFruReaderFactory(
+          "mobo", [&started]() -> std::unique_ptr<SysmodelFruReaderIntf> {
+            return absl::make_unique<SlowFruReader>(&started);
+          })};
+  {
+    SystemModel model(MakeParams(fru_factories));
+    // Destroy the model while the FRU is still being read. Once the read
+    // finishes the snapshot is saved from the acquisition's thread, which
+    // must happen before the acquisition is torn down.
+    started.WaitForNotification();
+  }
+
+  absl::StatusOr<SysmodelSnapshot> maybe_snapshot = ReadSnapshot();
+  ASSERT_THAT(maybe_snapshot, IsOk());
+  EXPECT_THAT(maybe_snapshot->frus, Contains(Key("mobo")));
+}
+
+TEST_F(SystemModelTest, SnapshotIsServedAndThenRefreshed) {
+  absl::StatusOr<SysmodelSnapshotKey> maybe_key = GetKey();
+  ASSERT_THAT(maybe_key, IsOk());
+  SysmodelSnapshot snapshot;
+  snapshot.dimms.push_back({.slot_name = "DIMM0", .present = true});
+  snapshot.cpus.push_back({.name = "CPU0", .enabled = true});
+  snapshot.frus["mobo"] = {.serial_number = "snapshot-sn"};
+  ASSERT_THAT(WriteSysmodelSnapshot(fs_.GetTruePath("/snapshot"), *maybe_key,
+                                    snapshot),
+              IsOk());
+
+  absl::Notification release;
+  std::vector<SysmodelFruReaderFactory> fru_factories = {
+      SysmodelFruReaderFactory(
+          "mobo", [&release]() -> std::unique_ptr<SysmodelFruReaderIntf> {
+            return absl::make_unique<BlockingFruReader>("mobo-sn", &release);
+          })};
+  {
+    SystemModel model(MakeParams(fru_factories));
+    model.WaitUntilReady();
+
+    // The FRU from the snapshot is served while it is being read again.
+    SysmodelFruReaderIntf *reader = model.GetFruReader("mobo");
+    ASSERT_NE(reader, nullptr);
+    absl::optional<SysmodelFru> fru = reader->Read();
+    ASSERT_TRUE(fru.has_value());
+    EXPECT_EQ(fru->GetSerialNumber(), "snapshot-sn");
+
+    // The DIMMs and CPUs from the snapshot are replaced in the background by
+    // the ones in the SMBIOS tables, of which there are none.
+    absl::Time deadline = absl::Now() + absl::Seconds(10);
+    while ((model.NumDimms() != 0 || model.NumCpus() != 0) &&
+           absl::Now() < deadline) {
+      absl::SleepFor(absl::Milliseconds(1));
+    }
+    EXPECT_EQ(model.NumDimms(), 0);
+    EXPECT_EQ(model.NumCpus(), 0);
+
+    release.Notify();
+  }
+
+  // Once everything has been read again, the new contents are saved.
+  absl::StatusOr<SysmodelSnapshot> maybe_snapshot = ReadSnapshot();
+  ASSERT_THAT(maybe_snapshot, IsOk());
+  EXPECT_THAT(maybe_snapshot->dimms, IsEmpty());
+  EXPECT_THAT(maybe_snapshot->cpus, IsEmpty());
+  ASSERT_THAT(maybe_snapshot->frus, Contains(Key("mobo")));
+  EXPECT_EQ(maybe_snapshot->frus.at("mobo").serial_number, "mobo-sn");
+}
+
+}  // namespace
+}  // namespace ecclesia
@@ -19,15 +19,15 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
-#include "absl/strings/str_cat.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "ecclesia/lib/io/constants.h"
-#include "ecclesia/lib/io/msr.h"
+#include "ecclesia/lib/io/msr_batch.h"
 #include "ecclesia/magent/lib/event_logger/intel_cpu_topology.h"
 #include "ecclesia/magent/lib/io/pci.h"
 #include "ecclesia/magent/lib/io/pci_sys.h"
@@ -63,25 +63,30 @@ std::vector<PciThermalSensor> CreatePciThermalSensors(
 }
 
 CpuMarginSensor::CpuMarginSensor(const CpuMarginSensorParams &params)
+    : CpuMarginSensor(params, std::make_shared<MsrBatch>()) {}
+
+CpuMarginSensor::CpuMarginSensor(const CpuMarginSensorParams &params,
+                                 std::shared_ptr<MsrBatch> msrs)
     // Right now we don’t know the upper critical limit for (at least some
     // Intel) CPUs. So it is set to some arbitrary number.
-    : ThermalSensor(params.name, 0), lpu_path_(absl::nullopt) {
+    : ThermalSensor(params.name, 0),
+      lpu_(absl::nullopt),
+      msrs_(std::move(msrs)) {
   // Determine the LPU index to use.
   IntelCpuTopology top;
   std::vector<int> lpus = top.GetLpusForSocketId(params.cpu_index);
   if (!lpus.empty()) {
-    lpu_path_ = absl::StrCat("/dev/cpu/", lpus[0], "/msr");
+    lpu_ = lpus[0];
   }
 }
 
 absl::optional<int> CpuMarginSensor::Read() {
-  if (!lpu_path_) {
+  if (!lpu_) {
     return absl::nullopt;
   }
 
-  Msr msr(*lpu_path_);
   absl::StatusOr<uint64_t> maybe_therm_status =
-      msr.Read(kMsrIa32PackageThermStatus);
+      msrs_->Read(*lpu_, kMsrIa32PackageThermStatus);
   if (!maybe_therm_status.ok()) {
     return absl::nullopt;
   }
@@ -100,9 +105,11 @@ absl::optional<int> CpuMarginSensor::Read() {
 
 std::vector<CpuMarginSensor> CreateCpuMarginSensors(
     const absl::Span<const CpuMarginSensorParams> param_set) {
+  // All of the sensors share a single set of open msr devices.
+  auto msrs = std::make_shared<MsrBatch>();
   std::vector<CpuMarginSensor> sensors;
   for (const auto &param : param_set) {
-    sensors.emplace_back(param);
+    sensors.emplace_back(param, msrs);
   }
   return sensors;
 }
@@ -25,6 +25,7 @@
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
+#include "ecclesia/lib/io/msr_batch.h"
 #include "ecclesia/magent/lib/io/pci.h"
 #include "ecclesia/magent/lib/io/pci_location.h"
 #include "ecclesia/magent/lib/io/pci_sys.h"
@@ -83,12 +84,18 @@ struct CpuMarginSensorParams {
 class CpuMarginSensor : public ThermalSensor {
  public:
   explicit CpuMarginSensor(const CpuMarginSensorParams &params);
+
+  // This constructor takes in a shared MSR accessor, so that multiple sensors
+  // can reuse the same open msr devices instead of opening one on every read.
+  CpuMarginSensor(const CpuMarginSensorParams &params,
+                  std::shared_ptr<MsrBatch> msrs);
   virtual ~CpuMarginSensor() = default;
 
   absl::optional<int> Read() override;
 
  private:
-  absl::optional<std::string> lpu_path_;
+  absl::optional<int> lpu_;
+  std::shared_ptr<MsrBatch> msrs_;
 };
 
 std::vector<CpuMarginSensor> CreateCpuMarginSensors(